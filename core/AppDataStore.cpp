@@ -95,6 +95,9 @@ bool AppDataStore::bind(SqlCipherDb& db)
 {
     if (!db.isOpen()) return false;
     m_db = &db;
+    m_chainCache.clear();
+    m_chainLru.clear();
+    m_replayBytes = -1;
     // Enable FK cascade — the desktop DBM declares ON DELETE CASCADE on
     // messages.peer_id but never enables foreign_keys, so the cascade
     // silently no-ops on desktop today.  Bug fix carried into the port.
@@ -417,6 +420,46 @@ void AppDataStore::createTables()
     q.exec("CREATE INDEX IF NOT EXISTS idx_group_replay_cache_sent_at"
            " ON group_replay_cache(sent_at);");
 
+    // group_replay_payload + group_replay_ref: deduplicated replay
+    // storage for recipients that accept re-sealed replays.  One
+    // payload row per sent message (recipient-independent inner
+    // payload, field-encrypted like every other body at rest) and one
+    // ref row per recipient carrying the chain links.  stored_bytes is
+    // what the message charges against the replay budget — payload
+    // plus its refs — so eviction never has to count refs.
+    //
+    // Additive on top of v3, like blocked_keys.
+    q.exec(
+        "CREATE TABLE IF NOT EXISTS group_replay_payload ("
+        "  id            INTEGER PRIMARY KEY,"
+        "  group_id      TEXT NOT NULL,"
+        "  msg_id        TEXT NOT NULL,"
+        "  payload       TEXT NOT NULL,"
+        "  stored_bytes  INTEGER NOT NULL,"
+        "  sent_at       INTEGER NOT NULL,"
+        "  UNIQUE (group_id, msg_id),"
+        "  FOREIGN KEY (group_id) REFERENCES conversations(id) ON DELETE CASCADE"
+        ");"
+    );
+    q.exec("CREATE INDEX IF NOT EXISTS idx_group_replay_payload_sent_at"
+           " ON group_replay_payload(sent_at);");
+    q.exec(
+        "CREATE TABLE IF NOT EXISTS group_replay_ref ("
+        "  peer_id      TEXT NOT NULL,"
+        "  group_id     TEXT NOT NULL,"
+        "  session_id   BLOB NOT NULL,"
+        "  counter      INTEGER NOT NULL,"
+        "  payload_id   INTEGER NOT NULL,"
+        "  prev_hash    BLOB,"
+        "  env_hash     BLOB NOT NULL,"
+        "  PRIMARY KEY (peer_id, group_id, session_id, counter),"
+        "  FOREIGN KEY (payload_id) REFERENCES group_replay_payload(id) ON DELETE CASCADE"
+        ");"
+    );
+    // Eviction deletes by payload; the cascade needs this to not scan.
+    q.exec("CREATE INDEX IF NOT EXISTS idx_group_replay_ref_payload"
+           " ON group_replay_ref(payload_id);");
+
     // group_chain_state: receiver's per-(group, sender) state machine
     // for the Causally-Linked Pairwise protocol.  One row per (group,
     // sender) — only the CURRENT session_id is tracked; on session
@@ -924,6 +967,8 @@ bool AppDataStore::deleteConversation(const std::string& id)
     if (!m_db || id.empty()) return false;
     // FK ON DELETE CASCADE on messages, conversation_members, and the
     // group_* tables sweeps everything tied to this conversation.
+    uncacheChainStates(id);
+    m_replayBytes = -1;
     SqlCipherQuery q(*m_db);
     q.prepare("DELETE FROM conversations WHERE id=:id;");
     q.bindValue(":id", id);
@@ -1368,6 +1413,7 @@ bool AppDataStore::addReplayCacheEntry(const std::string& peerIdB64u,
     q.bindValue(":ctr",  counter);
     q.bindValue(":env",  sealedEnvelope);
     q.bindValue(":ts",   sentAt);
+    m_replayBytes = -1;
     return q.exec();
 }
 
@@ -1439,27 +1485,151 @@ bool AppDataStore::dropReplayCacheEntry(const std::string& peerIdB64u,
     q.bindValue(":gid",  groupId);
     q.bindValue(":sid",  sessionId);
     q.bindValue(":ctr",  counter);
+    m_replayBytes = -1;
     return q.exec();
 }
 
 int AppDataStore::purgeReplayCacheOlderThan(int64_t cutoffSecs)
 {
     if (!m_db) return 0;
-    SqlCipherQuery q(*m_db);
-    q.prepare("DELETE FROM group_replay_cache WHERE sent_at < :cutoff;");
-    q.bindValue(":cutoff", cutoffSecs);
-    if (!q.exec()) return 0;
-    return q.numRowsAffected();
+    m_replayBytes = -1;
+    int dropped = 0;
+    for (const char* sql : {
+             "DELETE FROM group_replay_cache WHERE sent_at < :cutoff;",
+             "DELETE FROM group_replay_payload WHERE sent_at < :cutoff;"}) {
+        SqlCipherQuery q(*m_db);
+        q.prepare(sql);
+        q.bindValue(":cutoff", cutoffSecs);
+        if (q.exec()) dropped += q.numRowsAffected();
+    }
+    return dropped;
+}
+
+void AppDataStore::setReplayCacheBudget(int64_t bytes)
+{
+    m_replayBudget = std::max<int64_t>(bytes, 0);
+    if (!m_db) return;
+    const int64_t total = replayCacheBytes();
+    if (total <= m_replayBudget) return;
+
+    Tx tx(m_db->handle());
+    const int64_t after = evictReplayCache(total);
+    m_replayBytes = tx.commit() ? after : -1;
+}
+
+int64_t AppDataStore::replayCacheBytes() const
+{
+    if (!m_db) return 0;
+    if (m_replayBytes >= 0) return m_replayBytes;
+
+    int64_t total = 0;
+    for (const char* sql : {
+             "SELECT COALESCE(SUM(length(sealed_envelope)), 0) FROM group_replay_cache;",
+             "SELECT COALESCE(SUM(stored_bytes), 0) FROM group_replay_payload;"}) {
+        SqlCipherQuery q(m_db->handle());
+        q.prepare(sql);
+        if (q.exec() && q.next()) total += q.valueInt64(0);
+    }
+    m_replayBytes = total;
+    return total;
+}
+
+int64_t AppDataStore::evictReplayCache(int64_t total)
+{
+    // Oldest first across both forms.  Each pass pulls a small window
+    // off the sent_at index of each table and merges them, so a send
+    // that tips the cache over budget costs a few index reads rather
+    // than a sort of the whole cache.
+    constexpr int kWindow = 64;
+    struct Victim { int64_t sentAt; bool payload; int64_t id; int64_t bytes; };
+
+    while (total > m_replayBudget) {
+        std::vector<Victim> victims;
+        for (const bool payload : {false, true}) {
+            SqlCipherQuery q(m_db->handle());
+            q.prepare(payload
+                ? "SELECT sent_at, id, stored_bytes FROM group_replay_payload "
+                  "ORDER BY sent_at ASC LIMIT :n;"
+                : "SELECT sent_at, rowid, length(sealed_envelope) FROM group_replay_cache "
+                  "ORDER BY sent_at ASC LIMIT :n;");
+            q.bindValue(":n", int64_t(kWindow));
+            if (!q.exec()) return total;
+            while (q.next())
+                victims.push_back({q.valueInt64(0), payload,
+                                   q.valueInt64(1), q.valueInt64(2)});
+        }
+        if (victims.empty()) return 0;   // nothing left; the count was stale
+        std::stable_sort(victims.begin(), victims.end(),
+                         [](const Victim& a, const Victim& b) { return a.sentAt < b.sentAt; });
+
+        for (const Victim& v : victims) {
+            if (total <= m_replayBudget) break;
+            SqlCipherQuery del(*m_db);
+            // A payload's refs go with it (ON DELETE CASCADE).
+            del.prepare(v.payload
+                ? "DELETE FROM group_replay_payload WHERE id=:id;"
+                : "DELETE FROM group_replay_cache WHERE rowid=:id;");
+            del.bindValue(":id", v.id);
+            if (!del.exec()) return total;
+            total -= v.bytes;
+        }
+    }
+    return total;
+}
+
+void AppDataStore::loadReplayRefRange(
+    const std::string& peerIdB64u,
+    const std::string& groupId,
+    const Bytes& sessionId,
+    int64_t fromCounter, int64_t toCounter,
+    const std::function<void(const ReplayRef&)>& cb) const
+{
+    if (!m_db || !cb || peerIdB64u.empty() || groupId.empty()
+        || sessionId.empty() || toCounter < fromCounter) return;
+
+    SqlCipherQuery q(m_db->handle());
+    q.prepare(
+        "SELECT r.counter, r.prev_hash, r.env_hash, p.msg_id, p.payload "
+        "FROM group_replay_ref r "
+        "JOIN group_replay_payload p ON p.id = r.payload_id "
+        "WHERE r.peer_id=:peer AND r.group_id=:gid AND r.session_id=:sid "
+        "AND r.counter BETWEEN :lo AND :hi "
+        "ORDER BY r.counter ASC;"
+    );
+    q.bindValue(":peer", peerIdB64u);
+    q.bindValue(":gid",  groupId);
+    q.bindValue(":sid",  sessionId);
+    q.bindValue(":lo",   fromCounter);
+    q.bindValue(":hi",   toCounter);
+    if (!q.exec()) return;
+    while (q.next()) {
+        ReplayRef ref;
+        ref.counter  = q.valueInt64(0);
+        ref.prevHash = q.valueBlob(1);
+        ref.envHash  = q.valueBlob(2);
+        ref.payload  = decryptField(q.valueText(4),
+                           fieldAad("group_replay_payload", "payload",
+                                    groupId + "|" + q.valueText(3)));
+        cb(ref);
+    }
 }
 
 // ── Group chain state ───────────────────────────────────────────────────────
 
 bool AppDataStore::loadChainState(const std::string& groupId,
                                     const std::string& senderPeerId,
-                                    ChainState& out) const
+                                    ChainState& out,
+                                    const Bytes& sessionId) const
 {
     if (!m_db || groupId.empty() || senderPeerId.empty()) return false;
 
+    if (auto it = m_chainCache.find({groupId, senderPeerId, sessionId});
+        !sessionId.empty() && it != m_chainCache.end()) {
+        m_chainLru.splice(m_chainLru.begin(), m_chainLru, it->second.second);
+        out = it->second.first;
+        return true;
+    }
+
     SqlCipherQuery q(m_db->handle());
     q.prepare(
         "SELECT session_id, expected_next, last_hash, blocked_since, "
@@ -1479,6 +1649,8 @@ bool AppDataStore::loadChainState(const std::string& groupId,
     out.gapTo        = q.valueInt64(5);
     out.lastRetryAt  = q.valueInt64(6);
     out.retryCount   = q.valueInt(7);
+    uncacheChainState(groupId, senderPeerId);
+    cacheChainState({groupId, senderPeerId, out.sessionId}, out);
     return true;
 }
 
@@ -1506,13 +1678,19 @@ bool AppDataStore::saveChainState(const std::string& groupId,
     q.bindValue(":gto",     s.gapTo);
     q.bindValue(":lretry",  s.lastRetryAt);
     q.bindValue(":rcount",  static_cast<int64_t>(s.retryCount));
-    return q.exec();
+    // Whatever session was cached for the pair, the row is now this one
+    // (or, on failure, unknown — let the next load go to disk).
+    uncacheChainState(groupId, senderPeerId);
+    if (!q.exec()) return false;
+    cacheChainState({groupId, senderPeerId, s.sessionId}, s);
+    return true;
 }
 
 bool AppDataStore::dropChainState(const std::string& groupId,
                                     const std::string& senderPeerId)
 {
     if (!m_db || groupId.empty() || senderPeerId.empty()) return false;
+    uncacheChainState(groupId, senderPeerId);
     SqlCipherQuery q(*m_db);
     q.prepare(
         "DELETE FROM group_chain_state "
@@ -1523,6 +1701,42 @@ bool AppDataStore::dropChainState(const std::string& groupId,
     return q.exec();
 }
 
+void AppDataStore::cacheChainState(const ChainKey& key, const ChainState& state) const
+{
+    if (auto it = m_chainCache.find(key); it != m_chainCache.end()) {
+        it->second.first = state;
+        m_chainLru.splice(m_chainLru.begin(), m_chainLru, it->second.second);
+        return;
+    }
+    m_chainLru.push_front(key);
+    m_chainCache.emplace(key, std::make_pair(state, m_chainLru.begin()));
+    if (m_chainCache.size() > kChainStateCacheMax) {
+        m_chainCache.erase(m_chainLru.back());
+        m_chainLru.pop_back();
+    }
+}
+
+void AppDataStore::uncacheChainState(const std::string& groupId,
+                                      const std::string& senderPeerId) const
+{
+    auto it = m_chainCache.lower_bound({groupId, senderPeerId, Bytes()});
+    while (it != m_chainCache.end() && std::get<0>(it->first) == groupId
+           && std::get<1>(it->first) == senderPeerId) {
+        m_chainLru.erase(it->second.second);
+        it = m_chainCache.erase(it);
+    }
+}
+
+void AppDataStore::uncacheChainStates(const std::string& groupId)
+{
+    // Keys sort by group first, so one group's senders are contiguous.
+    auto it = m_chainCache.lower_bound({groupId, std::string(), Bytes()});
+    while (it != m_chainCache.end() && std::get<0>(it->first) == groupId) {
+        m_chainLru.erase(it->second.second);
+        it = m_chainCache.erase(it);
+    }
+}
+
 // ── Group message buffer ────────────────────────────────────────────────────
 
 namespace {
@@ -1725,6 +1939,131 @@ bool AppDataStore::saveSendState(const std::string& peerIdB64u,
     return q.exec();
 }
 
+std::map<std::pair<std::string, Bytes>, AppDataStore::SendState>
+AppDataStore::loadSendStates(const std::string& groupId) const
+{
+    std::map<std::pair<std::string, Bytes>, SendState> out;
+    if (!m_db || groupId.empty()) return out;
+
+    SqlCipherQuery q(m_db->handle());
+    q.prepare(
+        "SELECT peer_id, session_id, next_counter, last_hash "
+        "FROM group_send_state WHERE group_id=:gid;"
+    );
+    q.bindValue(":gid", groupId);
+    if (!q.exec()) return out;
+    while (q.next()) {
+        SendState& st = out[{q.valueText(0), q.valueBlob(1)}];
+        st.nextCounter = q.valueInt64(2);
+        st.lastHash    = q.valueBlob(3);
+    }
+    return out;
+}
+
+bool AppDataStore::commitGroupSend(const std::string& groupId,
+                                     const std::vector<GroupSendRecord>& records,
+                                     int64_t sentAt,
+                                     const std::string& msgId,
+                                     const std::string& sharedPayload)
+{
+    if (!m_db || groupId.empty()) return false;
+    if (records.empty()) return true;
+
+    const size_t refs = std::count_if(records.begin(), records.end(),
+        [](const GroupSendRecord& r) { return r.sealedEnvelope.empty(); });
+    if (refs > 0 && (msgId.empty() || sharedPayload.empty())) return false;
+
+    int64_t total = replayCacheBytes();
+    Tx tx(m_db->handle());
+
+    // The shared payload first, so the refs below can point at it.
+    int64_t payloadId = 0;
+    if (refs > 0) {
+        const std::string stored = encryptField(sharedPayload,
+            fieldAad("group_replay_payload", "payload", groupId + "|" + msgId));
+        const int64_t bytes = int64_t(stored.size())
+                            + int64_t(refs) * kReplayRefRowBytes;
+
+        SqlCipherQuery ins(*m_db);
+        ins.prepare(
+            "INSERT INTO group_replay_payload "
+            "(group_id, msg_id, payload, stored_bytes, sent_at) "
+            "VALUES (:gid, :mid, :payload, :bytes, :ts);"
+        );
+        ins.bindValue(":gid",     groupId);
+        ins.bindValue(":mid",     msgId);
+        ins.bindValue(":payload", stored);
+        ins.bindValue(":bytes",   bytes);
+        ins.bindValue(":ts",      sentAt);
+        if (!ins.exec()) return false;
+
+        SqlCipherQuery id(*m_db);
+        id.prepare("SELECT last_insert_rowid();");
+        if (!id.exec() || !id.next()) return false;
+        payloadId = id.valueInt64(0);
+        total += bytes;
+    }
+
+    for (const GroupSendRecord& r : records) {
+        if (r.peerId.empty() || r.sessionId.empty()) return false;
+
+        if (r.sealedEnvelope.empty()) {
+            if (r.next.lastHash.empty()) return false;
+            SqlCipherQuery ref(*m_db);
+            ref.prepare(
+                "INSERT OR REPLACE INTO group_replay_ref "
+                "(peer_id, group_id, session_id, counter, payload_id, "
+                " prev_hash, env_hash) "
+                "VALUES (:peer, :gid, :sid, :ctr, :pid, :prev, :envh);"
+            );
+            ref.bindValue(":peer", r.peerId);
+            ref.bindValue(":gid",  groupId);
+            ref.bindValue(":sid",  r.sessionId);
+            ref.bindValue(":ctr",  r.counter);
+            ref.bindValue(":pid",  payloadId);
+            ref.bindValue(":prev", r.prevHash);
+            ref.bindValue(":envh", r.next.lastHash);
+            if (!ref.exec()) return false;
+        } else {
+            SqlCipherQuery cache(*m_db);
+            cache.prepare(
+                "INSERT OR REPLACE INTO group_replay_cache "
+                "(peer_id, group_id, session_id, counter, sealed_envelope, sent_at) "
+                "VALUES (:peer, :gid, :sid, :ctr, :env, :ts);"
+            );
+            cache.bindValue(":peer", r.peerId);
+            cache.bindValue(":gid",  groupId);
+            cache.bindValue(":sid",  r.sessionId);
+            cache.bindValue(":ctr",  r.counter);
+            cache.bindValue(":env",  r.sealedEnvelope);
+            cache.bindValue(":ts",   sentAt);
+            if (!cache.exec()) return false;
+            total += int64_t(r.sealedEnvelope.size());
+        }
+
+        SqlCipherQuery state(*m_db);
+        state.prepare(
+            "INSERT OR REPLACE INTO group_send_state "
+            "(peer_id, group_id, session_id, next_counter, last_hash) "
+            "VALUES (:peer, :gid, :sid, :next, :hash);"
+        );
+        state.bindValue(":peer", r.peerId);
+        state.bindValue(":gid",  groupId);
+        state.bindValue(":sid",  r.sessionId);
+        state.bindValue(":next", r.next.nextCounter);
+        state.bindValue(":hash", r.next.lastHash);
+        if (!state.exec()) return false;
+    }
+
+    total = evictReplayCache(total);
+    if (!tx.commit()) {
+        m_replayBytes = -1;
+        return false;
+    }
+    m_replayBytes = total;
+    return true;
+}
+
 bool AppDataStore::dropSendState(const std::string& peerIdB64u,
                                    const std::string& groupId,
                                    const Bytes& sessionId)
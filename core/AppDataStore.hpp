@@ -4,8 +4,11 @@
 
 #include <cstdint>
 #include <functional>
+#include <list>
 #include <map>
 #include <string>
+#include <tuple>
+#include <utility>
 #include <vector>
 
 #include "SqlCipherDb.hpp"
@@ -359,11 +362,53 @@ public:
                                const Bytes& sessionId,
                                int64_t counter);
 
-    /// Sweep rows whose `sent_at` is strictly less than `cutoffSecs`.
-    /// Returns the number of rows deleted.  Wired to a periodic timer
-    /// that runs `purgeReplayCacheOlderThan(now - kReplayCacheMaxAgeSecs)`.
+    /// Sweep rows whose `sent_at` is strictly less than `cutoffSecs`
+    /// (full envelopes and shared payloads alike — a payload takes its
+    /// per-recipient refs with it).  Returns the number of rows
+    /// deleted.  Wired to a periodic timer that runs
+    /// `purgeReplayCacheOlderThan(now - kReplayCacheMaxAgeSecs)`.
     int  purgeReplayCacheOlderThan(int64_t cutoffSecs);
 
+    // Deduplicated form.  A recipient that reads re-sealed replays
+    // doesn't need its envelope kept: the recipient-independent inner
+    // payload is stored once per message (group_replay_payload) and
+    // each recipient gets a small ref row (group_replay_ref) with the
+    // chain links needed to re-seal it on a gap_request.  The ref's
+    // env_hash is the hash of the envelope that originally went out,
+    // which the replay carries so the receiver's prev_hash chain
+    // still lines up.
+    //
+    // Both forms count against one byte budget; commitGroupSend evicts
+    // the oldest messages once the cache goes over it.
+    static constexpr int64_t kDefaultReplayCacheBudget = 8LL * 1024 * 1024;
+
+    /// Budget charge for one ref row (keys, hashes, index entry).
+    static constexpr int64_t kReplayRefRowBytes = 128;
+
+    /// Set the byte budget and evict down to it right away.
+    void    setReplayCacheBudget(int64_t bytes);
+    int64_t replayCacheBudget() const { return m_replayBudget; }
+
+    /// Bytes the replay cache currently charges against the budget.
+    int64_t replayCacheBytes() const;
+
+    struct ReplayRef {
+        int64_t     counter = 0;
+        Bytes       prevHash;     // the prev link the original carried
+        Bytes       envHash;      // hash of the original sealed envelope
+        std::string payload;      // shared inner payload (JSON)
+    };
+
+    /// Stream every ref in [fromCounter, toCounter] for a (recipient,
+    /// group, session) tuple, in counter-ascending order, joined with
+    /// its decrypted shared payload.
+    void loadReplayRefRange(
+        const std::string& peerIdB64u,
+        const std::string& groupId,
+        const Bytes& sessionId,
+        int64_t fromCounter, int64_t toCounter,
+        const std::function<void(const ReplayRef&)>& cb) const;
+
     // ── Group chain state (Phase 1, receiver side) ───────────────────────
 
     /// Per-(group, sender) state machine.  One row per pair; on session
@@ -380,9 +425,21 @@ public:
         int      retryCount     = 0;
     };
 
+    /// Chain state is read and rewritten for every inbound pv=2 group
+    /// message, so the most recently used rows are held in memory,
+    /// written through on save and dropped with their row (including
+    /// the deleteConversation cascade).  A steady-state receive is then
+    /// one write and no reads.
+    static constexpr size_t kChainStateCacheMax = 1024;
+
+    /// `sessionId` is the session the caller is receiving on: a cached
+    /// row is only served to that same session, anything else (or an
+    /// empty id) reads the row from disk — which may still carry an
+    /// older session, for the caller's reset check.
     bool loadChainState(const std::string& groupId,
                          const std::string& senderPeerId,
-                         ChainState& out) const;
+                         ChainState& out,
+                         const Bytes& sessionId = {}) const;
 
     /// Upsert the chain state row for (groupId, senderPeerId).
     bool saveChainState(const std::string& groupId,
@@ -484,6 +541,38 @@ public:
                         const Bytes& sessionId,
                         const SendState& state);
 
+    /// Every send-state row for `groupId`, keyed by (peer, session) —
+    /// one query for a whole group fan-out instead of one per member.
+    /// Tuples without a row are simply absent (callers default them).
+    std::map<std::pair<std::string, Bytes>, SendState>
+        loadSendStates(const std::string& groupId) const;
+
+    /// One recipient's share of a group send: what to cache under
+    /// `counter` and the send state to advance to.  A non-empty
+    /// `sealedEnvelope` is cached whole; an empty one becomes a ref
+    /// against the send's shared payload, with `prevHash` and
+    /// `next.lastHash` as its chain links.
+    struct GroupSendRecord {
+        std::string peerId;
+        Bytes       sessionId;
+        int64_t     counter = 0;
+        Bytes       sealedEnvelope;
+        Bytes       prevHash;
+        SendState   next;
+    };
+
+    /// Replay-cache rows + saveSendState for every record of one group
+    /// send, in a single transaction (one journal sync for the fan-out
+    /// rather than two per member), then evict down to the replay
+    /// budget in the same transaction.  `msgId` / `sharedPayload` are
+    /// required when any record is a ref.  All-or-nothing: returns
+    /// false and writes nothing if any row fails.
+    bool commitGroupSend(const std::string& groupId,
+                         const std::vector<GroupSendRecord>& records,
+                         int64_t sentAt,
+                         const std::string& msgId = {},
+                         const std::string& sharedPayload = {});
+
     /// Drop the send state for a (peer, group, session) tuple.  Used
     /// when the recipient is removed from the group or the user
     /// leaves the group.
@@ -543,7 +632,27 @@ private:
     std::string decryptField(const std::string& stored,
                               const std::string& aad = {}) const;
 
+    /// Delete oldest replay-cache messages until `total` fits the
+    /// budget.  Caller owns the transaction.  Returns the new total.
+    int64_t evictReplayCache(int64_t total);
+
+    // Chain-state cache — see kChainStateCacheMax.  LRU: m_chainLru
+    // front is the most recently used key.  At most one session per
+    // (group, sender) is cached: the one its row was last read or
+    // written with.
+    using ChainKey = std::tuple<std::string, std::string, Bytes>;   // (group, sender, session)
+    void cacheChainState(const ChainKey& key, const ChainState& state) const;
+    void uncacheChainState(const std::string& groupId,
+                           const std::string& senderPeerId) const;
+    void uncacheChainStates(const std::string& groupId);
+
     SqlCipherDb*       m_db = nullptr;
     Bytes              m_encKey;       // 32-byte primary key; empty = plaintext
     std::vector<Bytes> m_legacyKeys;   // tried in order on decrypt failure
+    int64_t            m_replayBudget = kDefaultReplayCacheBudget;
+    mutable int64_t    m_replayBytes  = -1;  // running total; -1 = recount
+
+    mutable std::list<ChainKey> m_chainLru;
+    mutable std::map<ChainKey, std::pair<ChainState, std::list<ChainKey>::iterator>>
+                                m_chainCache;
 };
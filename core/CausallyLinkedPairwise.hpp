@@ -46,7 +46,9 @@
  *     "prev":      "<16B base64url>",       // prev_hash, see below
  *     "text":      "<user message body>",
  *     "ts":        <unix-secs>,
- *     "msgId":     "<uuid>"
+ *     "msgId":     "<uuid>",
+ *     "grv":       1,                       // reads re-sealed replays
+ *     "eh":        "<16B base64url>"        // re-sealed replays only, see below
  *   }
  *
  * The whole payload is sealed pairwise via SessionSealer::sealForPeer
@@ -99,12 +101,21 @@
  *
  * ── Replay cache (sender side) ──────────────────────────────────────
  *
- * After successfully sealing each envelope, the sender stores the
- * sealed bytes in `group_replay_cache` keyed by
- * (peer_id, group_id, session_id, counter).  When a later
- * `gap_request` arrives, the sender replays byte-identical envelopes
- * (no re-encryption, no DR step that would shift the chain past the
- * receiver's expected counter).
+ * After successfully sealing each envelope, the sender records it
+ * under (peer_id, group_id, session_id, counter), in one of two forms:
+ *
+ *   - Recipient advertised "grv" >= 1: the recipient-independent
+ *     payload once per message (`group_replay_payload`) plus a ref row
+ *     per recipient holding ctr, prev and the hash of the envelope
+ *     that went out (`group_replay_ref`).  A `gap_request` rebuilds
+ *     the payload and re-seals it through the live DR session, adding
+ *     "eh" = that original hash; the receiver chains on "eh" instead
+ *     of the bytes it got, so the next message's prev still matches.
+ *   - Otherwise: the sealed bytes (`group_replay_cache`), replayed
+ *     byte-identical.
+ *
+ * Both forms share one byte budget (AppDataStore::setReplayCacheBudget,
+ * oldest message evicted first).
  *
  * Cache TTL: 7 days (kReplayCacheMaxAgeSecs).  The relay mailbox TTL
  * is 14 days, so the relay-served path covers the wider window;
@@ -136,12 +147,13 @@
  *     "groupId":   "<group uuid>",      // Phase 2.0 transition only; dropped in 2.1
  *     "session":   "<8B base64url>",
  *     "from_ctr":  <integer>,           // inclusive
- *     "to_ctr":    <integer>            // inclusive
+ *     "to_ctr":    <integer>,           // inclusive
+ *     "grv":       1                    // reads re-sealed replays
  *   }
  *
- * Sender response: replay every matching `group_replay_cache` row in
- * counter-ascending order using the sender's normal sealed-envelope
- * path (each replay is byte-identical to the original send).
+ * Sender response: replay every matching cached counter in
+ * counter-ascending order — re-sealed with "eh" for ref rows,
+ * byte-identical for full-envelope rows.
  *
  * Receivers cap retry attempts (exponential backoff: immediate, 30s,
  * 5min, 1h) and after a 24h ceiling surface a UI prompt to skip the
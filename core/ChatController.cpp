@@ -1,4 +1,6 @@
 #include "ChatController.hpp"
+#include "PayloadCodec.hpp"
+#include "TreeHash.hpp"
 #include "AppDataStore.hpp"  // used by v2 group_msg + gap_request dispatch
 #include "bytes_util.hpp"  // strBytes helper (Qt-free)
 #ifdef PEER2PEAR_P2P
@@ -36,6 +38,7 @@ using nlohmann::json;
 // translation unit sees the same definition (they used to be
 // duplicated in each file's anonymous namespace).
 using p2p::nowSecs;
+using p2p::steadyMs;
 
 // Byte range starts-with / utility — replaces QByteArray::startsWith.
 static bool bytesStartsWith(const Bytes& data, const char* prefix) {
@@ -44,6 +47,17 @@ static bool bytesStartsWith(const Bytes& data, const char* prefix) {
     return std::memcmp(data.data(), prefix, n) == 0;
 }
 
+// Relay scheduling class for a sealed payload type.  Chat content is
+// Message; everything else that goes through sendSealedPayload (KEM /
+// sender-key announces, ICE signalling, file + group control) is small,
+// gates other traffic, and gets strict priority as Control.
+static RelayClient::TrafficClass trafficClassFor(const std::string& type) {
+    if (type == "text" || type == "group_msg" ||
+        type == "avatar" || type == "group_avatar")
+        return RelayClient::TrafficClass::Message;
+    return RelayClient::TrafficClass::Control;
+}
+
 // Byte range past the given prefix, trimmed of leading whitespace / newlines.
 // Replaces the QByteArray mid + trimmed idiom.
 static Bytes bytesAfterPrefix(const Bytes& data, const char* prefix) {
@@ -86,6 +100,12 @@ ChatController::ChatController(IWebSocketFactory& wsFactory, IHttpClient& http,
         [this](const std::string& peerId, const nlohmann::json& payload) -> Bytes {
             return sendSealedPayload(peerId, payload);
         });
+    // Multi-recipient fan-outs take the batch route so members that read
+    // multi-recipient envelopes share one signature (sealForPeers).
+    m_groupProto.setSendSealedBatchFn(
+        [this](const GroupProtocol::SealedBatch& items) {
+            return sendSealedPayloads(items);
+        });
     // Wire the v2 sender path's required dependencies.  AppDataStore
     // pointer comes from p2p_context via setAppDataStore() (see below);
     // SessionManager is owned by ChatController so we forward it now.
@@ -98,9 +118,9 @@ ChatController::ChatController(IWebSocketFactory& wsFactory, IHttpClient& http,
 
     // Raw-relay callback for handleGapRequest: replays cached sealed
     // envelopes byte-identically.  Bypasses SessionSealer because the
-    // bytes are already sealed for the requestor — re-sealing would
-    // produce a fresh DR step and shift the chain past their
-    // expected counter.
+    // bytes are already sealed for the requestor.  (Peers that read
+    // re-sealed replays get theirs through sendSealedPayload instead,
+    // with the original chain hash attached.)
     m_groupProto.setReplayRelayFn([this](const Bytes& env) {
         m_relay.sendEnvelope(env);
     });
@@ -110,8 +130,15 @@ ChatController::ChatController(IWebSocketFactory& wsFactory, IHttpClient& http,
     // lastMessageKey in one atomic step, and can't re-seal through
     // sendSealedPayload.  The sealing itself still goes through
     // m_sealer (which FileProtocol holds a reference to).
-    m_fileProto.setSendEnvelopeFn(
-        [this](const Bytes& env) { m_relay.sendEnvelope(env); });
+    // Those envelopes (file_key / accept / cancel) are transfer control,
+    // so they jump any queued chunks.
+    m_fileProto.setSendEnvelopeFn([this](const Bytes& env) {
+        m_relay.sendEnvelope(env, RelayClient::TrafficClass::Control);
+    });
+    m_fileProto.setEncodePayloadFn(
+        [this](const std::string& peerId, const nlohmann::json& payload) {
+            return encodePayload(peerId, payload);
+        });
 
     // Forward FileProtocol's transfer lifecycle callbacks to
     // ChatController's public surface.
@@ -220,6 +247,17 @@ ChatController::ChatController(IWebSocketFactory& wsFactory, IHttpClient& http,
         if (onFileTransferCanceled) onFileTransferCanceled(transferId, false);
     };
 
+    // A tree-hashed chunk failed its proof — queue it; the next
+    // maintenance pass asks the sender for the transfer's bad chunks
+    // in one file_request.
+    m_fileMgr.onChunkRejected = [this](const std::string& fromPeerId,
+                                       const std::string& transferId,
+                                       uint32_t chunkIndex) {
+        RejectedChunks& r = m_rejectedChunks[transferId];
+        r.peerId = fromPeerId;
+        r.chunks.insert(chunkIndex);
+    };
+
     m_fileMgr.onOutboundBlockedByPolicy =
         [this](const std::string& transferId, const std::string&, bool byReceiver) {
         if (onFileTransferBlocked) onFileTransferBlocked(transferId, byReceiver);
@@ -256,7 +294,10 @@ void ChatController::runMaintenance()
     m_envelopeCount.clear();
     m_fileRequestCount.clear();
 
-    // Purge stale incomplete transfers
+    requestRejectedChunks();
+
+    // Make stalled transfers' progress durable, then purge stale ones.
+    m_fileMgr.flushIncomingProgress();
     m_fileMgr.purgeStaleTransfers();
     m_fileMgr.purgeStaleOutbound();
     m_fileMgr.purgeStalePartialFiles();
@@ -275,25 +316,28 @@ void ChatController::runMaintenance()
     pruneSeenEnvelopes();
 
 #ifdef PEER2PEAR_P2P
-    const int64_t now = nowSecs();
-    std::vector<std::string> toRemove;
-    for (auto it = m_p2pConnections.begin(); it != m_p2pConnections.end(); ++it) {
-        if (it->second->isReady()) continue;
-        auto ts = m_p2pCreatedSecs.find(it->first);
-        const int64_t created = (ts != m_p2pCreatedSecs.end()) ? ts->second : now;
-        if ((now - created) < kP2PCleanupGraceSecs) continue;
-        toRemove.push_back(it->first);
-    }
-    for (const std::string &key : toRemove) {
-        P2P_LOG("[ICE] Cleaning up stale connection to " << p2p::peerPrefix(key) << "..."
-                 << " (exceeded " << kP2PCleanupGraceSecs << "s grace)");
-        delete m_p2pConnections[key];
-        m_p2pConnections.erase(key);
-        m_p2pCreatedSecs.erase(key);
-    }
+    maintainP2PConnections();
 #endif
 }
 
+void ChatController::requestRejectedChunks()
+{
+    std::map<std::string, RejectedChunks> pending;
+    pending.swap(m_rejectedChunks);
+    for (const auto& [transferId, r] : pending) {
+        // Canceled meanwhile (too many bad chunks, or by either side).
+        if (m_fileMgr.inboundPeerFor(transferId).empty()) continue;
+
+        json chunks = json::array();
+        for (uint32_t idx : r.chunks) chunks.push_back(int(idx));
+        json msg = json::object();
+        msg["type"]       = "file_request";
+        msg["transferId"] = transferId;
+        msg["chunks"]     = std::move(chunks);
+        m_fileProto.sendControlMessage(r.peerId, msg);
+    }
+}
+
 void ChatController::setPassphrase(const std::string& pass)
 {
     m_crypto.setPassphrase(pass);
@@ -363,6 +407,7 @@ void ChatController::setDatabase(SqlCipherDb& db)
     }
 
     m_sessionMgr = std::make_unique<SessionManager>(m_crypto, *m_sessionStore);
+    m_sessionMgr->setKemCadence(m_kemEveryDhSteps, m_kemMaxIntervalSecs);
 
     // Wire the session manager into GroupProtocol now that it exists.
     // The v2 group sender path uses sessionIdFor() to namespace its
@@ -400,7 +445,7 @@ void ChatController::setDatabase(SqlCipherDb& db)
         if (env.empty()) return;
         P2P_LOG("[SEND MAILBOX] sealed handshake response to "
                  << p2p::peerPrefix(peerId) << "...");
-        m_relay.sendEnvelope(env);
+        m_relay.sendEnvelope(env, RelayClient::TrafficClass::Control);
     });
 
     // Seal callback for file chunks.  Routes through SessionSealer
@@ -423,6 +468,7 @@ void ChatController::setDatabase(SqlCipherDb& db)
     //     receiver unpads in onFileDataReceived before handing the
     //     bytes to FileTransferManager.
     m_fileMgr.setP2PFileSendFn([this](const std::string& peerId,
+                                       const std::string& transferId,
                                        const Bytes& data) -> bool {
         auto it = m_p2pConnections.find(peerId);
         if (it == m_p2pConnections.end() ||
@@ -430,16 +476,33 @@ void ChatController::setDatabase(SqlCipherDb& db)
             !it->second->quicActive()) {
             return false;  // fall back to mailbox
         }
+        m_p2pPool.noteActivity(peerId, steadyMs());
         if (m_sealer.detectKeyChange(peerId) && m_sealer.hardBlockOnKeyChange()) {
             P2P_WARN("[P2P] BLOCKED — peer's safety number changed for "
                      << p2p::peerPrefix(peerId) << "... (hard-block on)");
             return false;
         }
-        const Bytes padded = SealedEnvelope::padForP2P(data);
+        Bytes padded = SealedEnvelope::padForP2P(data);
         if (padded.empty()) return false;
-        it->second->sendFileData(padded);
+        it->second->sendFileData(std::move(padded), transferId);
         return true;
     });
+
+    // Release the transfer's QUIC stream once a pass over its chunks
+    // ends; a later resend opens another.
+    m_fileMgr.onOutboundStreamEnded = [this](const std::string& peerId,
+                                             const std::string& transferId) {
+        auto it = m_p2pConnections.find(peerId);
+        if (it != m_p2pConnections.end()) it->second->endTransfer(transferId);
+    };
+
+    // Multi-megabyte chunks are negotiated only while the same direct
+    // QUIC path the file-send hook above uses is up.
+    m_fileProto.setDirectPathFn([this](const std::string& peerId) {
+        auto it = m_p2pConnections.find(peerId);
+        return it != m_p2pConnections.end() &&
+               it->second->isReady() && it->second->quicActive();
+    });
 #endif
 
 }
@@ -484,6 +547,15 @@ std::string ChatController::sendFile(const std::string& peerIdB64u,
     if (tid.empty() && onStatus) {
         onStatus("File not sent — check size, path, or session state.");
     }
+#ifdef PEER2PEAR_P2P
+    // Opted in: start ICE while the receiver decides, so the chunks can
+    // go direct once file_accept arrives.  It doesn't raise the chunk
+    // size: the offer above was already sized by offeredChunkBytes,
+    // which only offers big chunks when a direct path was up at send
+    // time.  Otherwise file_accept dials.
+    if (!tid.empty() && m_fileWarmupBeforeConsent)
+        initiateP2PConnection(peerIdB64u, /*warmup=*/true);
+#endif
     return tid;
 }
 
@@ -502,6 +574,15 @@ std::string ChatController::sendGroupFile(const std::string& groupId,
         onStatus("'" + fileName + "' queued for group " + groupName
                  + " (awaiting per-member consent)");
     }
+#ifdef PEER2PEAR_P2P
+    if (!tid.empty() && m_fileWarmupBeforeConsent) {
+        const auto pending = m_fileMgr.outboundPendingPeers();
+        for (const std::string& peerRaw : memberPeerIds) {
+            const std::string peer = p2p::trimmed(peerRaw);
+            if (pending.count(peer)) initiateP2PConnection(peer, /*warmup=*/true);
+        }
+    }
+#endif
     return tid;
 }
 
@@ -549,6 +630,13 @@ void ChatController::setSelfKeys(const std::vector<std::string>& keys) {
     m_selfKeys = keys;
 }
 
+void ChatController::setKemRatchetCadence(uint32_t everyDhSteps, int64_t maxIntervalSecs)
+{
+    m_kemEveryDhSteps    = everyDhSteps;
+    m_kemMaxIntervalSecs = maxIntervalSecs;
+    if (m_sessionMgr) m_sessionMgr->setKemCadence(everyDhSteps, maxIntervalSecs);
+}
+
 ChatController::~ChatController()
 {
 #ifdef PEER2PEAR_P2P
@@ -585,6 +673,10 @@ void ChatController::setTurnServer(const std::string& host, int port,
     m_turnUserCt = encCred(username);
     m_turnPassCt = encCred(password);
 
+    // No ICE prewarm here: nothing is gathered (no STUN / TURN traffic)
+    // until the first P2P attempt.  That attempt's IceAgentPool::take()
+    // misses and primes the pool for the ones after it.
+
     P2P_LOG("[ChatController] TURN server set: " << host << ":" << port);
 }
 #endif
@@ -607,17 +699,23 @@ void ChatController::sendGroupMessageViaMailbox(const std::string& groupId,
                                                 const std::vector<std::string>& memberPeerIds,
                                                 const std::string& text)
 {
-    // Default to the pv=2 path.  sendTextV2 internally falls back to
+    // pv=2 pairwise for small groups, sender-chain for large ones (see
+    // GroupProtocol::sendTextAuto).  sendTextV2 internally falls back to
     // the legacy sendText when its deps (AppDataStore + SessionManager)
     // aren't wired — protects boot-up windows where the DB key hasn't
     // been derived yet.
-    m_groupProto.sendTextV2(groupId, groupName, memberPeerIds, text);
+    //
+    // At privacy level 0 the per-member envelopes are coalesced into one
+    // /v1/send-batch request per relay instead of one POST each.
+    RelayClient::SendBatch batch(m_relay);
+    m_groupProto.sendTextAuto(groupId, groupName, memberPeerIds, text);
 }
 
 void ChatController::sendGroupLeaveNotification(const std::string& groupId,
                                                 const std::string& groupName,
                                                 const std::vector<std::string>& memberPeerIds)
 {
+    RelayClient::SendBatch batch(m_relay);
     m_groupProto.sendLeave(groupId, groupName, memberPeerIds);
 }
 
@@ -713,37 +811,78 @@ void ChatController::pruneSeenEnvelopes()
 // Returns the sealed envelope bytes (SEALED:<version>\n<ciphertext>), or empty
 // on failure.  Every outbound path should call this instead of inlining the
 // encrypt→convert→seal→prefix logic.
+// ── Inner payload encoding ────────────────────────────────────────────────
+// Compact (CBOR) form only once the peer has shown it can read it;
+// everyone else keeps getting JSON with the capability advertised.
+// Compact payloads advertise too, so a peer that upgrades later still
+// learns our level.  "dsak" tells the peer which of its ML-DSA keys we
+// hold, so it can stop embedding the full pub in every sealed envelope;
+// "msv" that we read multi-recipient sealed envelopes; "fhv" that we
+// verify tree-hashed file transfers; "rhv" that a group_msg may carry
+// just the roster hash; "khv" that we parse the flagged hybrid ratchet
+// header.
+//
+// Compression is bucket-driven: the relay pads to 2 / 16 / 256 KiB, so
+// deflating a payload that stays in the same bucket buys nothing on the
+// wire.  Payloads already in the smallest bucket skip deflate entirely.
+
+// First-send estimate of the sealing overhead for a peer: hybrid
+// sealed envelope with the ML-DSA pub by reference plus a ratchet
+// message carrying a KEM ciphertext.  Replaced by the measured value
+// after the first send.
+static constexpr size_t kDefaultSealOverhead = 3 * 1024;
+
+Bytes ChatController::encodePayload(const std::string& peerIdB64u,
+                                    const nlohmann::json& payload)
+{
+    auto levelIt = m_peerCodecLevel.find(peerIdB64u);
+    const uint8_t level = levelIt != m_peerCodecLevel.end() ? levelIt->second : 0;
+    const bool compact = level >= PayloadCodec::kCompactVersion;
+    const Bytes dsaKeyId = m_sealer.peerDsaKeyId(peerIdB64u);
+
+    Bytes encoded;
+    if (!payload.is_object()) {
+        encoded = PayloadCodec::encode(payload, compact);
+    } else {
+        nlohmann::json stamped = payload;
+        if (compact)
+            stamped[PayloadCodec::kCapabilityField] = PayloadCodec::kCodecLevel;
+        if (!dsaKeyId.empty())
+            stamped["dsak"] = CryptoEngine::toBase64Url(dsaKeyId);
+        stamped["msv"] = SessionSealer::kMultiSealVersion;
+        stamped["fhv"] = TreeHash::kVersion;
+        stamped["rhv"] = GroupProtocol::kRosterHashVersion;
+        stamped["khv"] = RatchetSession::kKemHeaderVersion;
+        encoded = PayloadCodec::encode(stamped, compact);
+    }
+
+    if (level < PayloadCodec::kCompressedVersion || encoded.empty()) return encoded;
+
+    auto ohIt = m_sealOverhead.find(peerIdB64u);
+    const size_t overhead = ohIt != m_sealOverhead.end() ? ohIt->second
+                                                         : kDefaultSealOverhead;
+    const size_t bucket = SealedEnvelope::relayPaddedSize(encoded.size() + overhead);
+    if (bucket <= SealedEnvelope::relayPaddedSize(0)) return encoded;
+
+    Bytes packed = PayloadCodec::compress(encoded);
+    if (packed.empty() ||
+        SealedEnvelope::relayPaddedSize(packed.size() + overhead) >= bucket)
+        return encoded;
+    return packed;
+}
+
 // ── Sealed payload via mailbox, fail-closed ───────────────────────────────
 Bytes ChatController::sendSealedPayload(const std::string& peerIdB64u,
                                        const nlohmann::json& payload,
                                        SendMode mode)
 {
-    const std::string ptStr = payload.dump();
-    const Bytes pt(ptStr.begin(), ptStr.end());
+    const Bytes pt = encodePayload(peerIdB64u, payload);
     const std::string type = payload.value("type", std::string());
 
     Bytes env = m_sealer.sealForPeer(peerIdB64u, pt);
+    noteSealOverhead(peerIdB64u, pt, env);
     if (env.empty()) {
-        // Fail closed.  Seal failures (hard-block, missing ratchet,
-        // unreachable peer) must not leak content — log + drop +
-        // surface a user-visible status.  Group fan-outs were silent
-        // here until we started flagging per-recipient seal errors;
-        // text + group_msg both deserve the same feedback so the user
-        // knows a message didn't reach some of their peers.
-        P2P_WARN("[SEND] BLOCKED — cannot seal " << type
-                   << " to " << p2p::peerPrefix(peerIdB64u) << "...");
-        if (onStatus) {
-            if (mode == SendMode::PreferP2P) {
-                onStatus("Message not sent — encrypted session unavailable. Try again shortly.");
-            } else if (type == "group_msg") {
-                onStatus("Group message not delivered to " +
-                           p2p::peerPrefix(peerIdB64u) +
-                           "… — encrypted session unavailable.");
-            }
-            // Other envelope types (avatars, ICE signalling, KEM announces)
-            // stay quiet — they're chatty per connect and would flood
-            // the toast channel.
-        }
+        reportSealFailure(peerIdB64u, type, mode);
         return {};
     }
 
@@ -753,17 +892,16 @@ Bytes ChatController::sendSealedPayload(const std::string& peerIdB64u,
         // mailbox + kick off ICE for next time.  Only 1:1 text uses
         // this — other types always go through the relay (fan-outs,
         // ICE signalling itself, KEM announces on fresh sessions).
-        auto itConn = m_p2pConnections.find(peerIdB64u);
-        if (itConn != m_p2pConnections.end() && itConn->second->isReady()) {
+        if (QuicConnection* conn = readyP2PConnection(peerIdB64u)) {
             P2P_LOG("[SEND P2P] " << type << " to " << p2p::peerPrefix(peerIdB64u) << "...");
-            itConn->second->sendData(env);
+            conn->sendData(env);
             return env;
         }
     }
 #endif
 
     P2P_LOG("[SEND MAILBOX] " << type << " to " << p2p::peerPrefix(peerIdB64u) << "...");
-    m_relay.sendEnvelope(env);
+    m_relay.sendEnvelope(env, trafficClassFor(type));
 
 #ifdef PEER2PEAR_P2P
     if (mode == SendMode::PreferP2P) {
@@ -775,12 +913,79 @@ Bytes ChatController::sendSealedPayload(const std::string& peerIdB64u,
     return env;
 }
 
+// ── Group fan-out: one seal batch, one shared signature ─────────────────
+std::vector<Bytes> ChatController::sendSealedPayloads(
+    const GroupProtocol::SealedBatch& items)
+{
+    std::vector<std::pair<std::string, Bytes>> plaintexts;
+    plaintexts.reserve(items.size());
+    for (const auto& item : items)
+        plaintexts.emplace_back(item.first, encodePayload(item.first, item.second));
+
+    std::vector<Bytes> envs = m_sealer.sealForPeers(plaintexts);
+    for (size_t i = 0; i < items.size(); ++i) {
+        const std::string& peerIdB64u = items[i].first;
+        const std::string type = items[i].second.value("type", std::string());
+        noteSealOverhead(peerIdB64u, plaintexts[i].second, envs[i]);
+        if (envs[i].empty()) {
+            reportSealFailure(peerIdB64u, type, SendMode::RelayOnly);
+            continue;
+        }
+        P2P_LOG("[SEND MAILBOX] " << type << " to " << p2p::peerPrefix(peerIdB64u) << "...");
+        m_relay.sendEnvelope(envs[i], trafficClassFor(type));
+    }
+    return envs;
+}
+
+void ChatController::noteSealOverhead(const std::string& peerIdB64u,
+                                      const Bytes& plaintext, const Bytes& env)
+{
+    if (const size_t sealed = SealedEnvelope::relaySealedSize(env); sealed > plaintext.size())
+        m_sealOverhead[peerIdB64u] = sealed - plaintext.size();
+}
+
+void ChatController::reportSealFailure(const std::string& peerIdB64u,
+                                       const std::string& type, SendMode mode)
+{
+    // Fail closed.  Seal failures (hard-block, missing ratchet,
+    // unreachable peer) must not leak content — log + drop +
+    // surface a user-visible status.  Group fan-outs were silent
+    // here until we started flagging per-recipient seal errors;
+    // text + group_msg both deserve the same feedback so the user
+    // knows a message didn't reach some of their peers.
+    P2P_WARN("[SEND] BLOCKED — cannot seal " << type
+               << " to " << p2p::peerPrefix(peerIdB64u) << "...");
+    if (!onStatus) return;
+    if (mode == SendMode::PreferP2P) {
+        onStatus("Message not sent — encrypted session unavailable. Try again shortly.");
+    } else if (type == "group_msg") {
+        onStatus("Group message not delivered to " +
+                   p2p::peerPrefix(peerIdB64u) +
+                   "… — encrypted session unavailable.");
+    }
+    // Other envelope types (avatars, ICE signalling, KEM announces)
+    // stay quiet — they're chatty per connect and would flood
+    // the toast channel.
+}
+
 #ifdef PEER2PEAR_P2P
 // ── QUIC + ICE connection setup ──────────────────────────────────────────────
-QuicConnection* ChatController::setupP2PConnection(const std::string& peerIdB64u, bool controlling)
+QuicConnection* ChatController::setupP2PConnection(const std::string& peerIdB64u, bool controlling,
+                                                   bool warmup)
 {
     // Lifetime is managed by m_p2pConnections raw pointer ownership;
-    // runMaintenance() deletes stale entries.
+    // m_p2pPool decides when an entry goes (LRU cap here, stale / dead /
+    // idle in maintainP2PConnections), closeP2PConnection deletes it.
+    const auto pinned = m_fileMgr.outboundPendingPeers();
+    for (const std::string& victim :
+         m_p2pPool.admit(peerIdB64u, steadyMs(),
+                         [&pinned](const std::string& p) { return pinned.count(p) != 0; },
+                         warmup)) {
+        P2P_LOG("[P2P] pool full — closing least recently used connection to "
+                 << p2p::peerPrefix(victim) << "...");
+        closeP2PConnection(victim);
+    }
+
     QuicConnection* conn = new QuicConnection(*m_timerFactory);
     if (!m_turnHost.empty()) {
         // Decrypt TURN creds just-in-time into scratch buffers, pass to
@@ -801,7 +1006,6 @@ QuicConnection* ChatController::setupP2PConnection(const std::string& peerIdB64u
         sodium_memzero(const_cast<char*>(pass.data()), pass.size());
     }
     m_p2pConnections[peerIdB64u] = conn;
-    m_p2pCreatedSecs[peerIdB64u] = nowSecs();
 
     const std::string iceType = controlling ? "ice_offer" : "ice_answer";
 
@@ -814,31 +1018,36 @@ QuicConnection* ChatController::setupP2PConnection(const std::string& peerIdB64u
         p["sdp"]  = sdp;
         p["quic"] = true;
         p["quic_fingerprint"] = conn->localQuicFingerprint();
+        p["quic_file_streams"] = QuicConnection::kMaxTransferStreams;
         sendSealedPayload(peerIdB64u, p);
     };
     conn->onStateChanged = [this, peerIdB64u, conn](int state) {
         if (state == NICE_COMPONENT_STATE_READY) {
             const std::string mode = conn->quicActive() ? "QUIC" : "ICE";
             if (onStatus) onStatus("P2P ready (" + mode + ") with " + peerIdB64u);
+            m_p2pPool.noteReady(peerIdB64u, steadyMs());
             m_fileMgr.notifyP2PReady(peerIdB64u);
         } else if (state == NICE_COMPONENT_STATE_FAILED) {
             if (onStatus) onStatus("P2P failed for " + peerIdB64u);
         }
     };
-    conn->onDataReceived = [this, peerIdB64u](const Bytes& d) {
-        onP2PDataReceived(peerIdB64u, d);
+    conn->onDataReceived = [this, peerIdB64u](const uint8_t* d, size_t n) {
+        m_p2pPool.noteActivity(peerIdB64u, steadyMs());
+        onP2PDataReceived(peerIdB64u, Bytes(d, d + n));
     };
-    conn->onFileDataReceived = [this, peerIdB64u](const Bytes& d) {
+    conn->onFileDataReceived = [this, peerIdB64u](const uint8_t* d, size_t n) {
         // Arch-review #10: sender padded the frame to a bucket via
         // SealedEnvelope::padForP2P; strip the 4-byte innerLen header
         // + random tail padding before handing the raw chunk bytes
-        // to FileTransferManager.
-        Bytes unpadded = SealedEnvelope::unpadFromP2P(d);
+        // to FileTransferManager.  `d` points into the QUIC receive
+        // buffer, so this is the only copy the chunk takes.
+        Bytes unpadded = SealedEnvelope::unpadFromP2P(d, n);
         if (unpadded.empty()) {
             P2P_WARN("[P2P] dropping malformed chunk frame from "
                      << p2p::peerPrefix(peerIdB64u) << "... (padForP2P unwrap failed)");
             return;
         }
+        m_p2pPool.noteActivity(peerIdB64u, steadyMs());
         m_fileMgr.handleFileEnvelope(peerIdB64u, unpadded,
             [this](const std::string& id) { return markSeen(id); },
             m_fileProto.fileKeys());
@@ -847,10 +1056,73 @@ QuicConnection* ChatController::setupP2PConnection(const std::string& peerIdB64u
     return conn;
 }
 
-void ChatController::initiateP2PConnection(const std::string& peerIdB64u)
+void ChatController::initiateP2PConnection(const std::string& peerIdB64u, bool warmup)
 {
     if (m_p2pConnections.count(peerIdB64u)) return;
-    setupP2PConnection(peerIdB64u, true);
+    setupP2PConnection(peerIdB64u, true, warmup);
+}
+
+QuicConnection* ChatController::readyP2PConnection(const std::string& peerIdB64u)
+{
+    auto it = m_p2pConnections.find(peerIdB64u);
+    QuicConnection* conn = (it != m_p2pConnections.end() && it->second->isReady())
+                               ? it->second : nullptr;
+    m_p2pPool.noteUse(peerIdB64u, steadyMs(), conn != nullptr);
+    return conn;
+}
+
+void ChatController::closeP2PConnection(const std::string& peerIdB64u)
+{
+    m_p2pPool.remove(peerIdB64u);
+    auto it = m_p2pConnections.find(peerIdB64u);
+    if (it == m_p2pConnections.end()) return;
+    delete it->second;
+    m_p2pConnections.erase(it);
+}
+
+void ChatController::maintainP2PConnections()
+{
+    const auto pinnedPeers = m_fileMgr.outboundPendingPeers();
+    const auto pinned = [&pinnedPeers](const std::string& p) {
+        return pinnedPeers.count(p) != 0;
+    };
+    const auto sweep = m_p2pPool.sweep(steadyMs(), [this](const std::string& p) {
+        auto it = m_p2pConnections.find(p);
+        return it != m_p2pConnections.end() && it->second->isReady();
+    }, pinned);
+
+    for (const std::string& peer : sweep.evict) {
+        P2P_LOG("[ICE] Cleaning up connection to " << p2p::peerPrefix(peer) << "..."
+                 << " (stale, dropped or idle)");
+        closeP2PConnection(peer);
+    }
+    for (const std::string& peer : sweep.keepAliveOn) {
+        auto it = m_p2pConnections.find(peer);
+        if (it != m_p2pConnections.end()) it->second->setKeepAlive(true);
+    }
+    for (const std::string& peer : sweep.keepAliveOff) {
+        auto it = m_p2pConnections.find(peer);
+        if (it != m_p2pConnections.end()) it->second->setKeepAlive(false);
+    }
+
+    // Re-dial peers that accepted a file and are waiting on a direct
+    // path (and, when opted in, peers that haven't answered yet) whose
+    // connection is gone — e.g. just evicted as dead.  A live or
+    // still-connecting peer is left alone, and an unreachable one is
+    // retried on the pool's per-peer backoff rather than every sweep.
+    const auto redial = m_fileWarmupBeforeConsent ? pinnedPeers
+                                                  : m_fileMgr.outboundAcceptedPeers();
+    for (const std::string& peer : redial) {
+        if (m_p2pConnections.count(peer)) continue;
+        if (!m_p2pPool.claimRedial(peer, steadyMs())) continue;
+        initiateP2PConnection(peer, /*warmup=*/true);
+    }
+
+    const auto st = m_p2pPool.stats();
+    P2P_LOG("[P2P] pool: " << m_p2pPool.size() << " conns, setup avg "
+             << st.averageSetupMs() << "ms max " << st.setupMsMax << "ms ("
+             << st.setupsReady << "/" << st.setups << " ready), reuse "
+             << st.reuseHits << " hit / " << st.reuseMisses << " miss");
 }
 
 void ChatController::onP2PDataReceived(const std::string& peerIdB64u, const Bytes& data)
@@ -906,11 +1178,17 @@ void ChatController::onEnvelope(const Bytes& body)
         // Unseal to learn sender identity (pass KEM priv for hybrid PQ envelopes).
         // Binding recipientEdPub (our own identity) into AEAD AAD — if a relay
         // rewrote the outer routing pubkey, AEAD fails.
+        // By-reference ML-DSA keys resolve through the sealer's cache of
+        // keys previously seen inline.
         UnsealResult unsealed = SealedEnvelope::unseal(
             m_crypto.curvePriv(), m_crypto.identityPub(),
-            rest, m_crypto.kemPriv());
+            rest, m_crypto.kemPriv(),
+            [this](const Bytes& senderEdPub, const Bytes&) {
+                return m_sealer.lookupPeerDsaPub(CryptoEngine::toBase64Url(senderEdPub));
+            });
         if (!unsealed.valid) {
-            P2P_WARN("[ChatController] Failed to unseal envelope");
+            P2P_WARN("[ChatController] Failed to unseal envelope"
+                     << (unsealed.unknownDsaKey ? " (unknown ML-DSA key reference)" : ""));
             return;
         }
 
@@ -935,6 +1213,8 @@ void ChatController::onEnvelope(const Bytes& body)
         }
 
         std::string senderId = CryptoEngine::toBase64Url(unsealedSenderEdPub);
+        if (!unsealed.senderDsaPub.empty())
+            m_sealer.savePeerDsaPub(senderId, unsealed.senderDsaPub);
         P2P_LOG("[RECV " << via << "] unsealed OK | sender: " << p2p::peerPrefix(senderId) << "..."
                  << " | inner: " << unsealedInnerPayload.size() << "B");
 
@@ -1011,9 +1291,18 @@ void ChatController::onEnvelope(const Bytes& body)
         // dispatcher.  Everything above this point is envelope plumbing
         // (unseal, dedup, decrypt, rate limit); everything below is
         // per-type routing.
-        const json o = json::parse(pt.begin(), pt.end(),
-                                   /*cb=*/nullptr, /*allow_exceptions=*/false);
+        const json o = PayloadCodec::decode(pt);
         if (!o.is_object()) return;
+        if (const uint8_t level = PayloadCodec::advertisedLevel(o, pt[0]))
+            m_peerCodecLevel[senderId] = level;
+        else
+            m_peerCodecLevel.erase(senderId);
+        m_sealer.notePeerDsaKeyAck(
+            senderId, CryptoEngine::fromBase64Url(o.value("dsak", std::string())));
+        m_sealer.notePeerMultiSeal(senderId, o.value("msv", 0));
+        m_fileProto.notePeerFileHash(senderId, o.value("fhv", 0));
+        m_groupProto.notePeerRosterHash(senderId, o.value("rhv", 0));
+        m_sessionMgr->notePeerKemHeader(senderId, o.value("khv", 0));
 
         const std::string type = o.value("type", std::string());
         const int64_t tsSecs = o.value("ts", int64_t(0));
@@ -1145,13 +1434,9 @@ void ChatController::dispatchSealedPayload(const nlohmann::json& o,
                 const int64_t     ctr       = o.value("ctr",      int64_t(0));
                 const std::string prevB64   = o.value("prev",     std::string());
                 const std::string text      = o.value("text",     std::string());
-                const std::string innerName = o.value("groupName", std::string());
-                std::vector<std::string> memberKeys;
-                if (o.contains("members") && o["members"].is_array()) {
-                    for (const auto& v : o["members"]) {
-                        if (v.is_string()) memberKeys.push_back(v.get<std::string>());
-                    }
-                }
+                const std::string ehB64     = o.value("eh",       std::string());
+                m_groupProto.notePeerReplayLevel(
+                    senderId, o.value(GroupProtocol::kReplayLevelField, 0));
 
                 // Phase 2: resolve `bundle` → local groupId.  Existing
                 // mapping wins; otherwise accept + persist the binding
@@ -1168,6 +1453,10 @@ void ChatController::dispatchSealedPayload(const nlohmann::json& o,
                 const Bytes sessionId = CryptoEngine::fromBase64Url(sessionB64);
                 Bytes prevHash;
                 if (!prevB64.empty()) prevHash = CryptoEngine::fromBase64Url(prevB64);
+                // Re-sealed gap replay: chain on the original envelope's
+                // hash, not the bytes that carried it this time.
+                Bytes chainHash;
+                if (!ehB64.empty()) chainHash = CryptoEngine::fromBase64Url(ehB64);
 
                 // v3: ensure the conversations row exists before any
                 // group_* CRUD fires — chain_state, msg_buffer, etc.
@@ -1175,20 +1464,27 @@ void ChatController::dispatchSealedPayload(const nlohmann::json& o,
                 // INSERT otherwise.  Idempotent.
                 if (m_appData) m_appData->ensureGroupConversation(gid);
 
+                // Most messages carry only the roster hash; the full
+                // list arrives once per roster version (or on request
+                // when our view has drifted).
+                const auto roster = m_groupProto.resolveInboundRoster(gid, senderId, o);
+                const std::string& innerName = roster.groupName;
+                const std::vector<std::string>& memberKeys = roster.members;
+
                 // Trust-bootstrap the roster from the (now decrypted)
                 // envelope — same model as v1: a peer claiming
                 // membership can update our view because the outer
                 // 1:1 ratchet already authenticated them.
                 m_groupProto.upsertMembersFromTrustedMessage(
                     gid, senderId, memberKeys);
-                if (m_appData) {
+                if (m_appData && roster.full) {
                     m_appData->setConversationMembers(gid, memberKeys);
                 }
 
                 auto result = m_groupProto.dispatchGroupMessageV2(
                     gid, senderId, sessionId, ctr, prevHash,
                     text, /*senderName=*/innerName, tsSecs, msgId,
-                    outerSealed);
+                    outerSealed, chainHash);
 
                 // Surface every delivered message (current + drained
                 // buffer entries, in counter order).
@@ -1256,20 +1552,18 @@ void ChatController::dispatchSealedPayload(const nlohmann::json& o,
             // read the 1:1 ratchet plaintext.  Pull them from the
             // decrypted inner now.
             std::string text;
-            std::string innerGroupName;
-            std::vector<std::string> memberKeys;
+            GroupProtocol::InboundRoster roster;
             try {
                 auto inner = nlohmann::json::parse(std::string(pt.begin(), pt.end()));
-                text           = inner.value("text",      std::string());
-                innerGroupName = inner.value("groupName", std::string());
-                if (inner.contains("members") && inner["members"].is_array())
-                    for (const auto& v : inner["members"])
-                        if (v.is_string()) memberKeys.push_back(v.get<std::string>());
+                text   = inner.value("text", std::string());
+                roster = m_groupProto.resolveInboundRoster(gid, senderId, inner);
             } catch (...) {
                 P2P_WARN("[GROUP] malformed inner plaintext in group_msg from "
                          << p2p::peerPrefix(senderId) << "...");
                 return;
             }
+            const std::string& innerGroupName = roster.groupName;
+            const std::vector<std::string>& memberKeys = roster.members;
 
             // A valid sealed group_msg from X about group G adds X
             // (and the declared members) to our roster.  Known
@@ -1286,9 +1580,11 @@ void ChatController::dispatchSealedPayload(const nlohmann::json& o,
             // pv=2 control message: peer is asking us to replay
             // sealed envelopes from our group_replay_cache so they
             // can fill a gap.  Outer 1:1 ratchet already authenticated
-            // the sender; we just look up the cached bytes and
-            // re-dispatch raw (no re-seal — see setReplayRelayFn).
+            // the sender; we look up what we cached and either re-seal
+            // it or re-dispatch it raw (see handleGapRequest).
             if (!msgId.empty() && !markSeen(msgId)) return;
+            m_groupProto.notePeerReplayLevel(
+                senderId, o.value(GroupProtocol::kReplayLevelField, 0));
             std::string       gid        = o.value("groupId", std::string());
             const std::string bundleB64  = o.value("bundle",  std::string());
             const std::string sessionB64 = o.value("session",  std::string());
@@ -1310,6 +1606,34 @@ void ChatController::dispatchSealedPayload(const nlohmann::json& o,
             const Bytes sessionId = CryptoEngine::fromBase64Url(sessionB64);
             m_groupProto.handleGapRequest(senderId, gid, sessionId,
                                             fromCtr, toCtr);
+        } else if (type == "group_roster_request") {
+            // A member's view of our roster hash didn't match; answer
+            // with the full list over the same 1:1 path.
+            if (!msgId.empty() && !markSeen(msgId)) return;
+            std::string gid = o.value("groupId", std::string());
+            resolveBundleToGroupId(o.value("bundle", std::string()), gid,
+                                   /*allowBackfill=*/false);
+            if (gid.empty()) return;
+            m_groupProto.handleRosterRequest(senderId, gid);
+        } else if (type == "group_roster") {
+            if (!msgId.empty() && !markSeen(msgId)) return;
+            std::string gid = o.value("groupId", std::string());
+            resolveBundleToGroupId(o.value("bundle", std::string()), gid,
+                                   /*allowBackfill=*/false);
+            if (gid.empty()) return;
+
+            GroupProtocol::InboundRoster roster;
+            if (!m_groupProto.applyRosterResponse(senderId, gid, o, roster)) return;
+            if (m_appData) {
+                m_appData->ensureGroupConversation(gid);
+                m_appData->setConversationMembers(gid, roster.members);
+            }
+            // Same surfacing as group_member_update: empty text, the UI
+            // merges the member list.
+            if (onGroupMessageReceived) onGroupMessageReceived(senderId, gid,
+                                      roster.groupName, roster.members,
+                                      std::string(), tsSecs,
+                                      msgId.empty() ? p2p::makeUuid() : msgId);
         } else if (type == "group_leave") {
             if (!msgId.empty() && !markSeen(msgId)) return;  // dedup
             // groupName + members live inside the sender-chain
@@ -1346,6 +1670,8 @@ void ChatController::dispatchSealedPayload(const nlohmann::json& o,
             auto inner = decryptGroupControlInner(
                 "group_rename", senderId, o, /*requireAuthorizedSender=*/true);
             if (!inner) return;
+            m_groupProto.setGroupName(o.value("groupId", std::string()),
+                                      inner->value("newName", std::string()));
             if (onGroupRenamed)
                 onGroupRenamed(o.value("groupId", std::string()),
                                 inner->value("newName", std::string()));
@@ -1400,6 +1726,10 @@ void ChatController::dispatchSealedPayload(const nlohmann::json& o,
                     // someone from the roster.
                     m_groupProto.upsertMembersFromTrustedMessage(gid, senderId, memberKeys);
                 }
+                // Note the name + roster version so the sender's later
+                // hash-only group_msg counts as in sync.
+                if (inner->contains("members") && (*inner)["members"].is_array())
+                    m_groupProto.resolveInboundRoster(gid, senderId, *inner);
             }
 
             // Re-use the existing groupMessageReceived signal — the
@@ -1425,7 +1755,8 @@ void ChatController::dispatchSealedPayload(const nlohmann::json& o,
                     // Pass QUIC capability from signaling
                     if (o.value("quic", false)) {
                         connIt->second->setPeerSupportsQuic(
-                            true, o.value("quic_fingerprint", std::string()));
+                            true, o.value("quic_fingerprint", std::string()),
+                            o.value("quic_file_streams", 0));
                     }
                     connIt->second->setRemoteSdp(
                         o.value("sdp", std::string()));
@@ -1437,7 +1768,8 @@ void ChatController::dispatchSealedPayload(const nlohmann::json& o,
             if (connIt != m_p2pConnections.end() && !connIt->second->isReady()) {
                 if (o.value("quic", false)) {
                     connIt->second->setPeerSupportsQuic(
-                        true, o.value("quic_fingerprint", std::string()));
+                        true, o.value("quic_fingerprint", std::string()),
+                        o.value("quic_file_streams", 0));
                 }
                 connIt->second->setRemoteSdp(
                     o.value("sdp", std::string()));
@@ -1452,11 +1784,21 @@ void ChatController::dispatchSealedPayload(const nlohmann::json& o,
             const int64_t     fileSize   = o.value("fileSize", int64_t(0));
             const std::string gId        = o.value("groupId", std::string());
             const std::string gName      = o.value("groupName", std::string());
+            // Absent = sequential BLAKE2b-256.  A mode we can't verify
+            // can't be accepted either.
+            const std::string hashMode   = o.value("hashMode", std::string());
+            const bool        treeHash   = hashMode == TreeHash::kModeName;
 
             if (transferId.empty() || msgKey.size() != 32) {
                 sodium_memzero(msgKey.data(), msgKey.size());
                 return;
             }
+            if (!hashMode.empty() && !treeHash) {
+                P2P_WARN("[FILE] unknown hashMode on file_key for "
+                           << p2p::peerPrefix(transferId) << " — dropping");
+                sodium_memzero(msgKey.data(), msgKey.size());
+                return;
+            }
 
             // Arch-review #6: guard against retransmitted file_key.
             // A second file_key for the same transferId with a fresh
@@ -1526,10 +1868,19 @@ void ChatController::dispatchSealedPayload(const nlohmann::json& o,
                     return;
                 }
 
+                // chunkCount describes the relay-sized layout; a direct
+                // path lets us take the sender's bigger chunkMax instead.
+                const int64_t chunkBytes = m_fileProto.chooseChunkBytes(
+                    senderId, fileSize, o.value("chunkMax", int64_t(0)));
+                const int totalChunks = chunkBytes == FileTransferManager::kChunkBytes
+                    ? announcedChunkCount
+                    : FileTransferManager::chunkCountFor(fileSize, chunkBytes);
+
                 if (!m_fileMgr.announceIncoming(senderId, transferId, fileName,
-                                                  fileSize, announcedChunkCount,
+                                                  fileSize, totalChunks,
                                                   announcedHash, msgKey,
-                                                  announcedTs, gId, gName)) {
+                                                  announcedTs, gId, gName,
+                                                  chunkBytes, treeHash)) {
                     sodium_memzero(msgKey.data(), msgKey.size());
                     return;
                 }
@@ -1544,6 +1895,8 @@ void ChatController::dispatchSealedPayload(const nlohmann::json& o,
                 acceptMsg["type"]       = "file_accept";
                 acceptMsg["transferId"] = transferId;
                 if (m_fileProto.requireP2P()) acceptMsg["requireP2P"] = true;
+                if (chunkBytes != FileTransferManager::kChunkBytes)
+                    acceptMsg["chunkBytes"] = chunkBytes;
                 m_fileProto.sendControlMessage(senderId, acceptMsg);
 
                 P2P_LOG("[FILE] auto-accept " << fileName << " (" << fileSizeMB << "MB)"
@@ -1589,6 +1942,8 @@ void ChatController::dispatchSealedPayload(const nlohmann::json& o,
                 p.fileKey        = msgKey;
                 p.fileHash       = announcedHash;
                 p.totalChunks    = announcedChunkCount;
+                p.offeredChunkBytes = o.value("chunkMax", int64_t(0));
+                p.treeHash       = treeHash;
                 p.announcedTs    = announcedTs;
                 p.groupId        = gId;
                 p.groupName      = gName;
@@ -1605,6 +1960,7 @@ void ChatController::dispatchSealedPayload(const nlohmann::json& o,
             // Sender-side: receiver agreed to the transfer.
             const std::string transferId = o.value("transferId", std::string());
             const bool requireP2P        = o.value("requireP2P", false);
+            const int64_t chunkBytes     = o.value("chunkBytes", FileTransferManager::kChunkBytes);
             // Arch-review #6: dedup on (type, transferId).  A retransmit
             // would otherwise restart the outbound stream mid-flight.
             if (!transferId.empty() && !markSeen("file_accept:" + transferId))
@@ -1618,16 +1974,13 @@ void ChatController::dispatchSealedPayload(const nlohmann::json& o,
                 // Is P2P ready for this peer right now?
                 bool p2pReady = false;
 #ifdef PEER2PEAR_P2P
-                {
-                    auto it = m_p2pConnections.find(senderId);
-                    if (it != m_p2pConnections.end() && it->second->isReady())
-                        p2pReady = true;
-                }
+                p2pReady = readyP2PConnection(senderId) != nullptr;
 #endif
 
                 if (!m_fileMgr.startOutboundStream(transferId, requireP2P,
-                                                    senderRequiresP2P, p2pReady)) {
-                    P2P_WARN("[FILE] file_accept for unknown transferId "
+                                                    senderRequiresP2P, p2pReady,
+                                                    chunkBytes)) {
+                    P2P_WARN("[FILE] file_accept rejected for transferId "
                                << p2p::peerPrefix(transferId));
                     return;
                 }
@@ -1772,6 +2125,7 @@ void ChatController::sendGroupRename(const std::string& groupId,
                                      const std::string& newName,
                                      const std::vector<std::string>& memberKeys)
 {
+    RelayClient::SendBatch batch(m_relay);
     m_groupProto.sendRename(groupId, newName, memberKeys);
 }
 
@@ -1779,6 +2133,7 @@ void ChatController::sendGroupAvatar(const std::string& groupId,
                                      const std::string& avatarB64,
                                      const std::vector<std::string>& memberKeys)
 {
+    RelayClient::SendBatch batch(m_relay);
     m_groupProto.sendAvatar(groupId, avatarB64, memberKeys);
 }
 
@@ -1786,6 +2141,7 @@ void ChatController::sendGroupMemberUpdate(const std::string& groupId,
                                            const std::string& groupName,
                                            const std::vector<std::string>& memberKeys)
 {
+    RelayClient::SendBatch batch(m_relay);
     m_groupProto.sendMemberUpdate(groupId, groupName, memberKeys);
 }
 
@@ -22,6 +22,7 @@ class AppDataStore;
 #include "FileProtocol.hpp"
 #include "FileTransferManager.hpp"
 #include "ITimer.hpp"
+#include "P2PConnectionPool.hpp"
 
 #include "SqlCipherDb.hpp"
 #include <cstdint>
@@ -110,6 +111,10 @@ public:
 #ifdef PEER2PEAR_P2P
     void setTurnServer(const std::string& host, int port,
                        const std::string& username, const std::string& password);
+
+    // Direct-connection pool metrics: setup latency, reuse hits vs.
+    // relay fallbacks, evictions by cause.
+    P2PConnectionPool::Stats p2pPoolStats() const { return m_p2pPool.stats(); }
 #endif
 
     void sendAvatar(const std::string& peerIdB64u, const std::string& displayName, const std::string& avatarB64);
@@ -174,6 +179,22 @@ public:
     void setHardBlockOnKeyChange(bool on) { m_sealer.setHardBlockOnKeyChange(on); }
     bool hardBlockOnKeyChange() const     { return m_sealer.hardBlockOnKeyChange(); }
 
+    // ML-DSA signatures on every sealed envelope, or only on handshake
+    // envelopes (see SessionSealer::DsaSignPolicy).
+    void setDsaSignPolicy(SessionSealer::DsaSignPolicy p) { m_sealer.setDsaSignPolicy(p); }
+    SessionSealer::DsaSignPolicy dsaSignPolicy() const    { return m_sealer.dsaSignPolicy(); }
+
+    // Group size at which text switches from pairwise to sender-chain
+    // encryption (see GroupProtocol::sendTextAuto).
+    void setGroupSenderChainThreshold(size_t members) {
+        m_groupProto.setSenderChainThreshold(members);
+    }
+
+    // KEM ratchet cadence for hybrid sessions (see
+    // RatchetSession::setKemCadence).  Remembered here so it survives
+    // the lazy SessionManager creation in setDatabase().
+    void setKemRatchetCadence(uint32_t everyDhSteps, int64_t maxIntervalSecs);
+
     // Restore/persist group sequence counters across restarts.  Delegates
     // to GroupProtocol — the counters themselves live there.
     void setGroupSeqCounters(const std::map<std::string, int64_t>& seqOut,
@@ -230,6 +251,12 @@ public:
         // next chunk rather than finishing under the prior policy.
         m_fileMgr.setSenderRequiresP2P(on);
     }
+    /// Start ICE toward a recipient as soon as a file is queued, before
+    /// they accept it.  Off by default: the dial hands our candidate
+    /// addresses to every recipient, including ones who then decline.
+    /// Off, the direct path is dialed once file_accept arrives.
+    void setFileWarmupBeforeConsent(bool on) { m_fileWarmupBeforeConsent = on; }
+    bool fileWarmupBeforeConsent() const     { return m_fileWarmupBeforeConsent; }
     int  fileAutoAcceptMaxMB() const    { return m_fileProto.autoAcceptMaxMB(); }
     int  fileHardMaxMB() const          { return m_fileProto.hardMaxMB(); }
     bool fileRequireP2P() const         { return m_fileProto.requireP2P(); }
@@ -413,12 +440,51 @@ private:
                             const nlohmann::json& payload,
                             SendMode mode = SendMode::RelayOnly);
 
+    // GroupProtocol's batch route: encode each payload, seal the lot
+    // through SessionSealer::sealForPeers (one signature for every
+    // multi-seal-capable member) and relay-send.  Same fail-closed
+    // reporting as sendSealedPayload; results in input order.
+    std::vector<Bytes> sendSealedPayloads(const GroupProtocol::SealedBatch& items);
+
+    // Shared tails of the two send paths above.
+    void noteSealOverhead(const std::string& peerIdB64u,
+                          const Bytes& plaintext, const Bytes& env);
+    void reportSealFailure(const std::string& peerIdB64u,
+                           const std::string& type, SendMode mode);
+
+    // Plaintext for the sealer in the best PayloadCodec form the peer
+    // reads (m_peerCodecLevel): advertised JSON, compact, or compact
+    // compressed when that drops the relay envelope into a smaller
+    // padding bucket.  The level is whatever the peer's latest inbound
+    // payload advertised (or arrived in).  In-memory only — a restart
+    // falls back to JSON until the peer speaks again, which also covers
+    // a peer that downgraded to a client without the codec.
+    // Also stamps "dsak" (see SessionSealer::peerDsaKeyId) and "msv"
+    // (SessionSealer::kMultiSealVersion).
+    Bytes encodePayload(const std::string& peerIdB64u,
+                        const nlohmann::json& payload);
+    std::map<std::string, uint8_t> m_peerCodecLevel;
+
+    // Sealing overhead (relay-framed sealed size minus plaintext) seen
+    // on the last sendSealedPayload to each peer.  Feeds the bucket
+    // check in encodePayload; varies a little per message (ratchet KEM
+    // fields, ML-DSA by reference or not), which at worst costs a
+    // missed or pointless compression, never a wrong envelope.
+    std::map<std::string, size_t> m_sealOverhead;
+
     // Roster authorization for inbound group control messages lives on
     // GroupProtocol.  onEnvelope calls m_groupProto.isAuthorizedSender
     // directly — no local indirection needed.
 #ifdef PEER2PEAR_P2P
-    QuicConnection* setupP2PConnection(const std::string& peerIdB64u, bool controlling);
-    void initiateP2PConnection(const std::string& peerIdB64u);
+    QuicConnection* setupP2PConnection(const std::string& peerIdB64u, bool controlling,
+                                       bool warmup = false);
+    void initiateP2PConnection(const std::string& peerIdB64u, bool warmup = false);
+    // Ready connection to the peer, or nullptr.  Counts a pool reuse
+    // hit or miss either way.
+    QuicConnection* readyP2PConnection(const std::string& peerIdB64u);
+    void closeP2PConnection(const std::string& peerIdB64u);
+    // Pool sweep + keepalive + warm-up; part of runMaintenance.
+    void maintainP2PConnections();
 #endif
 
     // ── Deduplication ─────────────────────────────────────────────────────────
@@ -467,6 +533,8 @@ private:
     // Session-based crypto (Noise IK + Double Ratchet + Sealed Sender)
     std::unique_ptr<SessionStore>   m_sessionStore;
     std::unique_ptr<SessionManager> m_sessionMgr;
+    uint32_t m_kemEveryDhSteps    = 1;
+    int64_t  m_kemMaxIntervalSecs = 0;
     SqlCipherDb* m_dbPtr = nullptr;  // kept for group / file / seen-envelopes tables
     AppDataStore* m_appData = nullptr;  // optional, for v2 group send path
 
@@ -474,17 +542,14 @@ private:
 
 #ifdef PEER2PEAR_P2P
     std::map<std::string, QuicConnection*> m_p2pConnections;
-    // Per-peer P2P connection creation timestamp, used by the maintenance
-    // timer's cleanup pass to give in-progress ICE negotiations a grace
-    // period before pruning.  Without this, a connection that takes >30s
-    // to complete ICE (common on real networks behind NAT) would get
-    // killed mid-handshake by the default cleanup.
-    std::map<std::string, int64_t> m_p2pCreatedSecs;
-    // Do not prune a P2P connection until it's been alive at least this
-    // long without reaching isReady().  ICE + QUIC handshake on cellular
-    // or corporate networks routinely takes 30-60s.
-    static constexpr int64_t kP2PCleanupGraceSecs = 120;
+    // Lifecycle policy for m_p2pConnections: LRU cap, keepalive for
+    // recently active peers, idle / dead / stale eviction, metrics.
+    // The default 120 s setup grace matters — ICE + QUIC handshake on
+    // cellular or corporate networks routinely takes 30-60s, and a
+    // connection must not be pruned mid-handshake.
+    P2PConnectionPool m_p2pPool;
 #endif
+    bool m_fileWarmupBeforeConsent = false;
 
     // Group sequence counters + roster now live on m_groupProto.
 
@@ -517,6 +582,17 @@ private:
     // runMaintenance().
     std::map<std::string, int> m_fileRequestCount;
 
+    // Tree-hashed chunks that failed their proof, per inbound transfer,
+    // waiting to be asked for again.  Flushed by runMaintenance() as one
+    // file_request per transfer per cycle, so a burst of bad chunks
+    // stays inside the sender's per-cycle file_request cap.
+    struct RejectedChunks {
+        std::string        peerId;
+        std::set<uint32_t> chunks;
+    };
+    std::map<std::string, RejectedChunks> m_rejectedChunks;
+    void requestRejectedChunks();
+
 #ifdef PEER2PEAR_P2P
     // TURN relay config for symmetric NAT fallback.
     //
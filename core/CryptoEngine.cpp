@@ -914,24 +914,34 @@ std::string CryptoEngine::signB64u(const Bytes& msgUtf8) const {
 Bytes CryptoEngine::aeadEncrypt(const Bytes& key32,
                                 const Bytes& plaintext,
                                 const Bytes& aad) const {
-    if (key32.size() != 32) return {};
+    Bytes out;
+    if (!aeadEncryptAppend(key32, plaintext.data(), plaintext.size(), out, aad))
+        return {};
+    return out;
+}
 
-    unsigned char nonce[crypto_aead_xchacha20poly1305_ietf_NPUBBYTES];
-    randombytes_buf(nonce, sizeof(nonce));
+bool CryptoEngine::aeadEncryptAppend(const Bytes& key32,
+                                     const uint8_t* plaintext, size_t len,
+                                     Bytes& out,
+                                     const Bytes& aad) const {
+    if (key32.size() != 32) return false;
 
-    Bytes out(sizeof(nonce) + plaintext.size() + crypto_aead_xchacha20poly1305_ietf_ABYTES, 0);
+    constexpr size_t kNonce = crypto_aead_xchacha20poly1305_ietf_NPUBBYTES;
+    const size_t base = out.size();
+    out.resize(base + kNonce + len + crypto_aead_xchacha20poly1305_ietf_ABYTES);
+    unsigned char* nonce = out.data() + base;
+    randombytes_buf(nonce, kNonce);
 
     unsigned long long clen = 0;
     crypto_aead_xchacha20poly1305_ietf_encrypt(
-        out.data() + sizeof(nonce), &clen,
-        plaintext.data(), plaintext.size(),
+        nonce + kNonce, &clen,
+        plaintext, len,
         u8ptr(aad), aad.size(),
         nullptr, nonce,
         key32.data());
 
-    std::memcpy(out.data(), nonce, sizeof(nonce));
-    out.resize(sizeof(nonce) + clen);
-    return out;
+    out.resize(base + kNonce + clen);
+    return true;
 }
 
 Bytes CryptoEngine::aeadDecrypt(const Bytes& key32,
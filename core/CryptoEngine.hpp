@@ -124,6 +124,13 @@ public:
     Bytes aeadEncrypt(const Bytes& key32, const Bytes& plaintext,
                       const Bytes& aad = {}) const;
 
+    // Same output appended to `out`, sealing `len` bytes at `plaintext` in
+    // place — lets a caller encrypt straight from mapped file pages into
+    // the buffer it's building.  Returns false (out untouched) on a bad key.
+    bool aeadEncryptAppend(const Bytes& key32, const uint8_t* plaintext,
+                           size_t len, Bytes& out,
+                           const Bytes& aad = {}) const;
+
     Bytes aeadDecrypt(const Bytes& key32, const Bytes& nonceAndCiphertext,
                       const Bytes& aad = {}) const;
 
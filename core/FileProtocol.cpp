@@ -1,9 +1,12 @@
 #include "FileProtocol.hpp"
 
 #include "CryptoEngine.hpp"
+#include "FileSource.hpp"
 #include "FileTransferManager.hpp"
+#include "PayloadCodec.hpp"
 #include "SessionManager.hpp"
 #include "SessionSealer.hpp"
+#include "TreeHash.hpp"
 #include "log.hpp"
 #include "shared.hpp"
 #include "uuid.hpp"
@@ -29,6 +32,45 @@ std::string FileProtocol::myId() const
     return CryptoEngine::toBase64Url(m_crypto.identityPub());
 }
 
+Bytes FileProtocol::encodePayload(const std::string& peerIdB64u,
+                                   const nlohmann::json& payload) const
+{
+    if (m_encodePayload) return m_encodePayload(peerIdB64u, payload);
+    return PayloadCodec::encode(payload, /*compact=*/false);
+}
+
+// ── Chunk-size negotiation ────────────────────────────────────────────────
+
+int64_t FileProtocol::offeredChunkBytes(const std::string& peerIdB64u,
+                                         int64_t fileSize) const
+{
+    if (fileSize <= FileTransferManager::kChunkBytes) return FileTransferManager::kChunkBytes;
+    if (!m_directPath || !m_directPath(peerIdB64u))  return FileTransferManager::kChunkBytes;
+    return FileTransferManager::kMaxP2PChunkBytes;
+}
+
+int64_t FileProtocol::chooseChunkBytes(const std::string& peerIdB64u,
+                                        int64_t fileSize, int64_t offeredMax) const
+{
+    const bool direct = m_directPath && m_directPath(peerIdB64u);
+    return FileTransferManager::negotiateChunkBytes(fileSize, offeredMax, direct);
+}
+
+// ── Integrity-mode negotiation ────────────────────────────────────────────
+
+void FileProtocol::notePeerFileHash(const std::string& peerIdB64u, int version)
+{
+    if (version >= TreeHash::kVersion)
+        m_peersReadingTreeHash.insert(peerIdB64u);
+    else
+        m_peersReadingTreeHash.erase(peerIdB64u);
+}
+
+bool FileProtocol::peerReadsTreeHash(const std::string& peerIdB64u) const
+{
+    return m_peersReadingTreeHash.count(peerIdB64u) != 0;
+}
+
 // ── Control-message send ──────────────────────────────────────────────────
 
 void FileProtocol::sendControlMessage(const std::string& peerIdB64u,
@@ -41,8 +83,7 @@ void FileProtocol::sendControlMessage(const std::string& peerIdB64u,
     payload["ts"]    = nowSecs();
     payload["msgId"] = p2p::makeUuid();
 
-    const std::string ptStr = payload.dump();
-    const Bytes pt(ptStr.begin(), ptStr.end());
+    const Bytes pt = encodePayload(peerIdB64u, payload);
     Bytes sealed = m_sealer.sealForPeer(peerIdB64u, pt);
     if (sealed.empty()) {
         P2P_WARN("[FILE] BLOCKED — cannot seal " << msg.value("type", std::string())
@@ -65,17 +106,30 @@ std::string FileProtocol::sendFile(const std::string& peerIdB64u,
     const int64_t fileSize = int64_t(fs::file_size(filePath, ec));
     if (ec || fileSize > FileTransferManager::kMaxFileBytes) return {};
 
-    const Bytes fileHash = FileTransferManager::blake2b256File(filePath);
+    // A peer that reads tree-v1 gets a TreeHash root (leaves hashed on
+    // every core, each chunk checkable on arrival); anyone else the
+    // sequential hash.  The source closes with this scope; the stream
+    // reopens the file once the peer accepts.
+    auto source = FileSource::open(filePath);
+    if (!source || source->size() != fileSize) return {};
+    std::shared_ptr<const TreeHash> tree;
+    if (peerReadsTreeHash(peerIdB64u)) {
+        tree = TreeHash::build(*source);
+        if (!tree) return {};
+    }
+    const Bytes fileHash = tree ? tree->root() : FileTransferManager::blake2b256(*source);
     if (fileHash.size() != 32) return {};
 
-    const int chunkCount = int((fileSize + FileTransferManager::kChunkBytes - 1)
-                                / FileTransferManager::kChunkBytes);
+    const int     chunkCount = FileTransferManager::chunkCountFor(fileSize);
+    const int64_t chunkMax   = offeredChunkBytes(peerIdB64u, fileSize);
 
     const std::string transferId = p2p::makeUuid();
 
     // Announce the upcoming transfer through the ratchet: fileHash +
     // chunkCount let the receiver allocate its partial-file bitmap and
     // verify the final hash without waiting for every chunk's metadata.
+    // chunkCount always describes the relay-sized layout; chunkMax (only
+    // when we have a direct path) lets the receiver pick bigger chunks.
     json announce = json::object();
     announce["from"]        = myId();
     announce["type"]        = "file_key";
@@ -84,10 +138,11 @@ std::string FileProtocol::sendFile(const std::string& peerIdB64u,
     announce["fileSize"]    = fileSize;
     announce["fileHash"]    = CryptoEngine::toBase64Url(fileHash);
     announce["chunkCount"]  = chunkCount;
+    if (chunkMax > FileTransferManager::kChunkBytes) announce["chunkMax"] = chunkMax;
+    if (tree) announce["hashMode"] = TreeHash::kModeName;
     announce["ts"]          = nowSecs();
 
-    const std::string ptStr = announce.dump();
-    const Bytes pt(ptStr.begin(), ptStr.end());
+    const Bytes pt = encodePayload(peerIdB64u, announce);
     Bytes sealedEnv = m_sealer.sealForPeer(peerIdB64u, pt);
     if (sealedEnv.empty()) {
         P2P_WARN("[FILE] BLOCKED — cannot seal file_key for " << p2p::peerPrefix(peerIdB64u) << "...");
@@ -112,7 +167,7 @@ std::string FileProtocol::sendFile(const std::string& peerIdB64u,
     CryptoEngine::secureZero(ratchetMsgKey);
     m_ftm.queueOutboundFile(myId(), peerIdB64u,
                              fileKey, transferId, fileName, filePath,
-                             fileSize, fileHash);
+                             fileSize, fileHash, {}, {}, chunkMax, tree);
     CryptoEngine::secureZero(fileKey);
 
     m_sendEnvelope(sealedEnv);
@@ -136,14 +191,30 @@ std::string FileProtocol::sendGroupFile(const std::string& groupId,
     const int64_t fileSize = int64_t(fs::file_size(filePath, ec));
     if (ec || fileSize > FileTransferManager::kMaxFileBytes) return {};
 
-    // Hash the file once up-front (streaming) and reuse for all members.
-    const Bytes fileHash = FileTransferManager::blake2b256File(filePath);
-    if (fileHash.size() != 32) return {};
+    const std::string me = myId();
 
-    const int chunkCount = int((fileSize + FileTransferManager::kChunkBytes - 1)
-                                / FileTransferManager::kChunkBytes);
+    // Hash the file once up-front and reuse the hash for all members —
+    // once per integrity mode the members need.
+    auto source = FileSource::open(filePath);
+    if (!source || source->size() != fileSize) return {};
+    bool anyTree = false, anySequential = false;
+    for (const std::string& peerIdRaw : memberPeerIds) {
+        const std::string peerId = trimmed(peerIdRaw);
+        if (peerId.empty() || peerId == me) continue;
+        (peerReadsTreeHash(peerId) ? anyTree : anySequential) = true;
+    }
+    std::shared_ptr<const TreeHash> tree;
+    if (anyTree) {
+        tree = TreeHash::build(*source);
+        if (!tree) return {};
+    }
+    Bytes sequentialHash;
+    if (anySequential) {
+        sequentialHash = FileTransferManager::blake2b256(*source);
+        if (sequentialHash.size() != 32) return {};
+    }
 
-    const std::string me = myId();
+    const int chunkCount = FileTransferManager::chunkCountFor(fileSize);
 
     // Each member gets a unique transferId so consent is honored per
     // recipient.  The caller sees one group-level id for cancellation;
@@ -157,6 +228,9 @@ std::string FileProtocol::sendGroupFile(const std::string& groupId,
         if (peerId.empty() || peerId == me) continue;
 
         const std::string memberTid = p2p::makeUuid();
+        const int64_t     chunkMax  = offeredChunkBytes(peerId, fileSize);
+        const auto        memberTree = peerReadsTreeHash(peerId) ? tree : nullptr;
+        const Bytes&      fileHash  = memberTree ? memberTree->root() : sequentialHash;
 
         json announce = json::object();
         announce["from"]        = me;
@@ -166,12 +240,13 @@ std::string FileProtocol::sendGroupFile(const std::string& groupId,
         announce["fileSize"]    = fileSize;
         announce["fileHash"]    = CryptoEngine::toBase64Url(fileHash);
         announce["chunkCount"]  = chunkCount;
+        if (chunkMax > FileTransferManager::kChunkBytes) announce["chunkMax"] = chunkMax;
+        if (memberTree) announce["hashMode"] = TreeHash::kModeName;
         announce["ts"]          = nowSecs();
         announce["groupId"]     = groupId;
         announce["groupName"]   = groupName;
 
-        const std::string ptStr = announce.dump();
-        const Bytes pt(ptStr.begin(), ptStr.end());
+        const Bytes pt = encodePayload(peerId, announce);
         Bytes sealedEnv = m_sealer.sealForPeer(peerId, pt);
         if (sealedEnv.empty()) {
             P2P_WARN("[FILE] BLOCKED — cannot seal file_key for " << p2p::peerPrefix(peerId) << "...");
@@ -187,7 +262,7 @@ std::string FileProtocol::sendGroupFile(const std::string& groupId,
         CryptoEngine::secureZero(ratchetMsgKey);
         m_ftm.queueOutboundFile(me, peerId, fileKey, memberTid, fileName,
                                  filePath, fileSize, fileHash,
-                                 groupId, groupName);
+                                 groupId, groupName, chunkMax, memberTree);
         CryptoEngine::secureZero(fileKey);
 
         m_sendEnvelope(sealedEnv);
@@ -216,17 +291,27 @@ void FileProtocol::acceptIncoming(const std::string& transferId, bool requireP2P
     const std::string peerId   = it->second.peerId;
     const std::string compound = peerId + ":" + transferId;
 
+    // Pick the chunk size now rather than at file_key time: the user
+    // may accept long after the direct path came or went.
+    const int64_t chunkBytes = chooseChunkBytes(peerId, it->second.fileSize,
+                                                it->second.offeredChunkBytes);
+    const int totalChunks = chunkBytes == FileTransferManager::kChunkBytes
+        ? it->second.totalChunks
+        : FileTransferManager::chunkCountFor(it->second.fileSize, chunkBytes);
+
     // Announce with the metadata locked at file_key time — NOT whatever
     // the sender might put in later chunks.
     if (!m_ftm.announceIncoming(peerId,
                                   transferId,
                                   it->second.fileName,
-                                  it->second.fileSize, it->second.totalChunks,
+                                  it->second.fileSize, totalChunks,
                                   it->second.fileHash,
                                   it->second.fileKey,
                                   it->second.announcedTs,
                                   it->second.groupId,
-                                  it->second.groupName)) {
+                                  it->second.groupName,
+                                  chunkBytes,
+                                  it->second.treeHash)) {
         P2P_WARN("[FILE] acceptIncoming: announceIncoming failed for "
                    << p2p::peerPrefix(transferId));
         sodium_memzero(it->second.fileKey.data(), it->second.fileKey.size());
@@ -245,6 +330,7 @@ void FileProtocol::acceptIncoming(const std::string& transferId, bool requireP2P
     msg["transferId"] = transferId;
     // Respect the receiver's global "no relay" preference, or the per-call override.
     if (requireP2P || m_requireP2P) msg["requireP2P"] = true;
+    if (chunkBytes != FileTransferManager::kChunkBytes) msg["chunkBytes"] = chunkBytes;
     sendControlMessage(peerId, msg);
 }
 
@@ -5,6 +5,7 @@
 #include <cstdint>
 #include <functional>
 #include <map>
+#include <set>
 #include <string>
 #include <vector>
 
@@ -41,6 +42,15 @@ class FileTransferManager;
 class FileProtocol {
 public:
     using SendEnvelopeFn = std::function<void(const Bytes& relayEnvelope)>;
+    // Turns a control payload into the plaintext handed to the sealer.
+    // ChatController binds this to PayloadCodec with its per-peer
+    // compact-form knowledge; unset means plain JSON.
+    using EncodePayloadFn = std::function<Bytes(const std::string& peerIdB64u,
+                                                const nlohmann::json& payload)>;
+    // True when a direct QUIC path to the peer is up right now.  Gates
+    // the multi-megabyte chunk offer in file_key and the pick echoed in
+    // file_accept; unset means relay-only (kChunkBytes).
+    using DirectPathFn = std::function<bool(const std::string& peerIdB64u)>;
 
     FileProtocol(CryptoEngine& crypto,
                   SessionSealer& sealer,
@@ -50,6 +60,8 @@ public:
     // constructed and the relay is ready.
     void setSessionManager(SessionManager* mgr) { m_sessionMgr = mgr; }
     void setSendEnvelopeFn(SendEnvelopeFn fn)   { m_sendEnvelope = std::move(fn); }
+    void setEncodePayloadFn(EncodePayloadFn fn) { m_encodePayload = std::move(fn); }
+    void setDirectPathFn(DirectPathFn fn)       { m_directPath = std::move(fn); }
 
     // Consent policy knobs.  Read by the inbound file_key handler to
     // decide auto-accept / prompt / auto-decline.
@@ -131,6 +143,8 @@ public:
         Bytes       fileKey;            // 32 bytes, zeroed on drop
         Bytes       fileHash;           // 32 bytes — locked at file_key time
         int         totalChunks  = 0;
+        int64_t     offeredChunkBytes = 0;  // file_key chunkMax; 0 = none
+        bool        treeHash     = false;   // fileHash is a TreeHash root
         int64_t     announcedTs  = 0;
         std::string groupId;
         std::string groupName;
@@ -155,6 +169,17 @@ public:
     // Per-transfer GC from the maintenance loop / FTM signals.
     void eraseFileKey(const std::string& compoundKey);
 
+    // Receiver-side chunk size for a file_key from `peerIdB64u` that
+    // offered `offeredMax` (its chunkMax field, 0 when absent).
+    int64_t chooseChunkBytes(const std::string& peerIdB64u,
+                             int64_t fileSize, int64_t offeredMax) const;
+
+    // Record the "fhv" a peer's latest payload carried (0 if absent).
+    // Files to peers at TreeHash::kVersion or above are announced with
+    // a tree root and sent with per-chunk proofs.
+    void notePeerFileHash(const std::string& peerIdB64u, int version);
+    bool peerReadsTreeHash(const std::string& peerIdB64u) const;
+
     // ── Callbacks ─────────────────────────────────────────────────────
     std::function<void(const std::string& from, const std::string& transferId,
                        const std::string& fileName, int64_t fileSize)>
@@ -168,12 +193,19 @@ public:
 
 private:
     std::string myId() const;  // base64url(identityPub)
+    Bytes encodePayload(const std::string& peerIdB64u,
+                         const nlohmann::json& payload) const;
 
     CryptoEngine&        m_crypto;
     SessionSealer&       m_sealer;
     FileTransferManager& m_ftm;
     SessionManager*      m_sessionMgr   = nullptr;
     SendEnvelopeFn       m_sendEnvelope;
+    EncodePayloadFn      m_encodePayload;
+    DirectPathFn         m_directPath;
+
+    // chunkMax to advertise in a file_key to this peer.
+    int64_t offeredChunkBytes(const std::string& peerIdB64u, int64_t fileSize) const;
 
     // State owned by FileProtocol.
     std::map<std::string, Bytes>           m_fileKeys;
@@ -185,6 +217,11 @@ private:
     // can fan out across all members.
     std::map<std::string, std::vector<std::string>> m_groupFileMembers;
 
+    // Peers whose latest payload advertised TreeHash::kVersion.
+    // In-memory only: after a restart files go out sequentially hashed
+    // until the peer speaks again.
+    std::set<std::string> m_peersReadingTreeHash;
+
     // Consent policy.  Readable + writable via the accessors above.
     // The two thresholds must differ — `autoAccept < size <= hardMax`
     // is the prompt range, so equal values leave a dead prompt and
@@ -0,0 +1,70 @@
+#pragma once
+
+#include "types.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <fstream>
+#include <memory>
+#include <string>
+
+/*
+ * FileSource — read-only byte source for an outbound file.
+ *
+ * On POSIX view() preads the range into a scratch buffer that is reused
+ * from one view to the next, so streaming a file costs one allocation
+ * and one read syscall per chunk, and the kernel's read-ahead (asked
+ * for with a sequential-access hint at open()) keeps the next chunk
+ * warm while this one is encrypted.  Elsewhere the range is read
+ * through an ifstream into the same buffer.
+ *
+ * The file is never mapped, so a file truncated under the sender can't
+ * fault the process: the read comes back short and view() returns
+ * nullptr.  Each view() also re-checks the file's size and mtime
+ * against open() and fails once either moved, so a rewrite that keeps
+ * the size doesn't hand out bytes the announced hash no longer covers.
+ *
+ * A view is valid until the next view() call or until the FileSource is
+ * destroyed.  view() and prefetch() are not thread-safe; read() is when
+ * concurrentReads() says so (TreeHash::build hashes windows in parallel
+ * through it).
+ */
+class FileSource {
+public:
+    // nullptr if the file can't be opened.
+    static std::shared_ptr<FileSource> open(const std::string& path);
+
+    ~FileSource();
+    FileSource(const FileSource&) = delete;
+    FileSource& operator=(const FileSource&) = delete;
+
+    const std::string& path() const { return m_path; }
+    int64_t size() const { return m_size; }
+    // True when read() may be called from several threads at once.
+    bool    concurrentReads() const { return m_fd >= 0; }
+
+    // [offset, offset + len) of the file, or nullptr when the range runs
+    // past the end, the read comes back short, or the file changed since
+    // open().  len == 0 returns a non-null pointer.
+    const uint8_t* view(int64_t offset, size_t len);
+
+    // Same range checks as view(), read into the caller's buffer.
+    bool read(int64_t offset, size_t len, uint8_t* dst);
+
+    // Start reading [offset, offset + len) in ahead of its view().
+    void prefetch(int64_t offset, size_t len);
+
+private:
+    FileSource() = default;
+    // False once the file's size or mtime differs from open()'s.
+    bool unchanged() const;
+
+    std::string m_path;
+    int64_t     m_size = 0;
+
+    int     m_fd      = -1;          // POSIX
+    int64_t m_mtimeNs = 0;
+
+    std::ifstream m_stream;          // Windows
+    Bytes         m_scratch;
+};
@@ -1,6 +1,9 @@
 #include "FileTransferManager.hpp"
 #include "CryptoEngine.hpp"
+#include "FileSource.hpp"
 #include "SqlCipherDb.hpp"
+#include "TreeHash.hpp"
+#include "shared.hpp"
 
 #include <sodium.h>
 #include <nlohmann/json.hpp>
@@ -122,11 +125,33 @@ FileTransferManager::FileTransferManager(CryptoEngine& crypto)
     m_partialDir = dl.empty() ? std::string(".partial") : dl + "/Peer2Pear/.partial";
 }
 
+FileTransferManager::~FileTransferManager()
+{
+    for (auto& [tid, xferPtr] : m_incomingTransfers) {
+        if (xferPtr && xferPtr->partialFile && xferPtr->unsyncedChunks > 0)
+            syncIncoming(tid, *xferPtr);
+    }
+}
+
 void FileTransferManager::setPartialFileDir(const std::string& dir)
 {
     m_partialDir = dir;
 }
 
+// ── Chunk-size policy ───────────────────────────────────────────────────────
+
+int64_t FileTransferManager::negotiateChunkBytes(int64_t fileSize,
+                                                 int64_t offeredMax,
+                                                 bool directPath)
+{
+    if (!directPath || offeredMax <= kChunkBytes || fileSize <= kChunkBytes)
+        return kChunkBytes;
+    // Rounded down to whole tree leaves; kChunkBytes is itself a
+    // multiple, so the result never drops below it.
+    const int64_t pick = std::min(offeredMax, kMaxP2PChunkBytes);
+    return pick - pick % TreeHash::kLeafBytes;
+}
+
 // ── BLAKE2b-256 helpers ─────────────────────────────────────────────────────
 
 Bytes FileTransferManager::blake2b256(const Bytes& data)
@@ -141,30 +166,31 @@ Bytes FileTransferManager::blake2b256(const Bytes& data)
 
 Bytes FileTransferManager::blake2b256File(const std::string& filePath)
 {
-    std::ifstream f(filePath, std::ios::binary);
-    if (!f.is_open()) {
+    auto src = FileSource::open(filePath);
+    if (!src) {
         P2P_WARN("[FileTransfer] blake2b256File: cannot open"
                    << filePath);
         return {};
     }
+    return blake2b256(*src);
+}
 
+Bytes FileTransferManager::blake2b256(FileSource& source)
+{
     crypto_generichash_state st;
     crypto_generichash_init(&st, nullptr, 0, 32);
 
-    // 64 KB read buffer — bounded RAM regardless of file size.
-    std::vector<char> buf(64 * 1024);
-    while (f.good() && !f.eof()) {
-        f.read(buf.data(), static_cast<std::streamsize>(buf.size()));
-        const std::streamsize n = f.gcount();
-        if (n <= 0) break;
-        crypto_generichash_update(&st,
-            reinterpret_cast<const unsigned char*>(buf.data()),
-            static_cast<unsigned long long>(n));
-    }
-    if (f.bad()) {
-        P2P_WARN("[FileTransfer] blake2b256File: read error on"
-                   << filePath);
-        return {};
+    // 1 MB windows through the source's reused buffer: constant RAM.
+    constexpr int64_t kWindow = 1024 * 1024;
+    for (int64_t off = 0; off < source.size(); off += kWindow) {
+        const size_t n = size_t(std::min<int64_t>(kWindow, source.size() - off));
+        const uint8_t* p = source.view(off, n);
+        if (!p) {
+            P2P_WARN("[FileTransfer] blake2b256: read error on"
+                       << source.path());
+            return {};
+        }
+        crypto_generichash_update(&st, p, static_cast<unsigned long long>(n));
     }
 
     Bytes hash(32, 0);
@@ -194,15 +220,37 @@ std::string FileTransferManager::finalPathFor(const std::string& fileName,
     return baseDir + "/" + safe;
 }
 
+// ── Seal one chunk ──────────────────────────────────────────────────────────
+
+Bytes FileTransferManager::sealChunkPayload(const Bytes& key32,
+                                            const std::string& metaJson,
+                                            const uint8_t* chunk,
+                                            size_t chunkLen) const
+{
+    constexpr size_t kAeadOverhead = crypto_aead_xchacha20poly1305_ietf_NPUBBYTES
+                                   + crypto_aead_xchacha20poly1305_ietf_ABYTES;
+
+    // Inner payload: <4-byte metaLen><encMeta><encChunk>
+    Bytes inner;
+    inner.reserve(4 + metaJson.size() + chunkLen + 2 * kAeadOverhead);
+    appendBE32(inner, uint32_t(metaJson.size() + kAeadOverhead));
+    if (!m_crypto.aeadEncryptAppend(key32,
+                                    reinterpret_cast<const uint8_t*>(metaJson.data()),
+                                    metaJson.size(), inner) ||
+        !m_crypto.aeadEncryptAppend(key32, chunk, chunkLen, inner)) return {};
+    return inner;
+}
+
 // ── Send one chunk with routing mode ────────────────────────────────────────
 
 bool FileTransferManager::dispatchChunk(const std::string& /*senderIdB64u*/,
                                          const std::string& peerIdB64u,
+                                         const std::string& transferId,
                                          const Bytes& innerPayload,
                                          RoutingMode mode)
 {
     // 1. Try P2P QUIC file stream (reliable, framed, congestion-controlled).
-    if (m_p2pFileSendFn && m_p2pFileSendFn(peerIdB64u, innerPayload))
+    if (m_p2pFileSendFn && m_p2pFileSendFn(peerIdB64u, transferId, innerPayload))
         return true;
 
     // P2POnly mode: refuse relay fallback, drop the chunk.
@@ -242,28 +290,40 @@ void FileTransferManager::sendChunkEnvelopes(const std::string& senderIdB64u,
                                               int64_t ts,
                                               RoutingMode mode,
                                               const std::string& groupId,
-                                              const std::string& groupName)
+                                              const std::string& groupName,
+                                              int64_t chunkBytes,
+                                              std::shared_ptr<const TreeHash> tree)
 {
-    std::ifstream src(filePath, std::ios::binary);
-    if (!src.is_open()) {
+    // Opened only now, once the receiver has accepted: a transfer waiting
+    // on consent holds no descriptor.
+    auto source = FileSource::open(filePath);
+    if (!source) {
         P2P_WARN("[FileTransfer] Cannot open"
                    << filePath << "for streaming");
         if (onStatus) onStatus(std::string("Cannot read file: ") + fileName);
         return;
     }
+    if (source->size() != fileSize) {
+        P2P_WARN("[FileTransfer]" << filePath << "changed size since it was announced");
+        if (onStatus) onStatus(std::string("File changed before sending: ") + fileName);
+        return;
+    }
 
-    const int totalChunks = int((fileSize + kChunkBytes - 1) / kChunkBytes);
-
-    Bytes chunk;  // reused buffer — one allocation for the whole loop
-    chunk.reserve(size_t(kChunkBytes));
+    const int totalChunks = chunkCountFor(fileSize, chunkBytes);
+    // Keep the progress stride roughly constant in bytes when the
+    // negotiated chunk is larger than the relay default.
+    const int progressStride =
+        std::max<int>(1, int(kSenderProgressChunkStride * kChunkBytes / chunkBytes));
 
+    bool interrupted = false;
     for (int i = 0; i < totalChunks; ++i) {
         // Sender-side cancel check.
         if (m_abortedTransfers.count(transferId)) {
             P2P_LOG("[FileTransfer] aborted mid-stream at chunk" << i
                      << "of" << idPrefix(transferId));
             m_abortedTransfers.erase(transferId);
-            return;
+            interrupted = true;
+            break;
         }
 
         // Live privacy-level upgrade.
@@ -272,19 +332,19 @@ void FileTransferManager::sendChunkEnvelopes(const std::string& senderIdB64u,
                 ? RoutingMode::P2POnly
                 : mode;
 
-        const int64_t offset    = int64_t(i) * kChunkBytes;
+        const int64_t offset    = int64_t(i) * chunkBytes;
         const int64_t remaining = fileSize - offset;
-        const int64_t toRead    = std::min<int64_t>(kChunkBytes, remaining);
+        const int64_t toRead    = std::min<int64_t>(chunkBytes, remaining);
 
-        // Seek + read this chunk only.
-        src.seekg(offset);
-        chunk.assign(size_t(toRead), 0);
-        src.read(reinterpret_cast<char*>(chunk.data()), std::streamsize(toRead));
-        if (src.gcount() != toRead) {
+        // Read into the source's reused buffer; the kernel reads the next
+        // chunk in while this one is encrypted and dispatched.
+        const uint8_t* chunk = source->view(offset, size_t(toRead));
+        if (!chunk) {
             P2P_WARN("[FileTransfer] Short read at chunk" << i
                        << "of" << idPrefix(transferId));
             break;
         }
+        source->prefetch(offset + toRead, size_t(chunkBytes));
 
         json meta;
         meta["from"]        = senderIdB64u;
@@ -296,28 +356,21 @@ void FileTransferManager::sendChunkEnvelopes(const std::string& senderIdB64u,
         meta["fileSize"]    = fileSize;
         meta["ts"]          = ts;
         meta["fileHash"]    = fileHashB64u;
+        if (tree) meta["proof"] = CryptoEngine::toBase64Url(tree->rangeProof(offset, toRead));
         if (!groupId.empty()) {
             meta["groupId"]   = groupId;
             meta["groupName"] = groupName;
         }
 
-        const std::string metaJsonStr = meta.dump();
-        const Bytes metaJson(metaJsonStr.begin(), metaJsonStr.end());
-        const Bytes encMeta  = m_crypto.aeadEncrypt(key32, metaJson);
-        const Bytes encChunk = m_crypto.aeadEncrypt(key32, chunk);
-
-        // Inner payload: <4-byte metaLen><encMeta><encChunk>
-        Bytes innerPayload;
-        innerPayload.reserve(4 + encMeta.size() + encChunk.size());
-        appendBE32(innerPayload, uint32_t(encMeta.size()));
-        innerPayload.insert(innerPayload.end(), encMeta.begin(), encMeta.end());
-        innerPayload.insert(innerPayload.end(), encChunk.begin(), encChunk.end());
+        const Bytes innerPayload =
+            sealChunkPayload(key32, meta.dump(), chunk, size_t(toRead));
 
-        if (!dispatchChunk(senderIdB64u, peerIdB64u, innerPayload, effectiveMode)) {
+        if (!dispatchChunk(senderIdB64u, peerIdB64u, transferId, innerPayload, effectiveMode)) {
             P2P_WARN("[FileTransfer] P2P lost mid-stream at chunk" << i
                        << "— aborting transfer" << idPrefix(transferId));
             if (onStatus) onStatus(std::string("Transfer interrupted: direct connection lost."));
-            return;
+            interrupted = true;
+            break;
         }
 
         // Sender-side progress emission.  Throttled — see the stride
@@ -328,7 +381,7 @@ void FileTransferManager::sendChunkEnvelopes(const std::string& senderIdB64u,
             const int sent = i + 1;
             const bool isFirst  = (i == 0);
             const bool isLast   = (sent == totalChunks);
-            const bool onStride = (sent % kSenderProgressChunkStride) == 0;
+            const bool onStride = (sent % progressStride) == 0;
             if (isFirst || isLast || onStride) {
                 onFileChunkSent(peerIdB64u, transferId, fileName, fileSize,
                                 sent, totalChunks, ts, groupId, groupName);
@@ -336,6 +389,9 @@ void FileTransferManager::sendChunkEnvelopes(const std::string& senderIdB64u,
         }
     }
 
+    if (onOutboundStreamEnded) onOutboundStreamEnded(peerIdB64u, transferId);
+    if (interrupted) return;
+
     // Kick off P2P for future messages
     if (onWantP2PConnection) onWantP2PConnection(peerIdB64u);
 }
@@ -373,7 +429,7 @@ std::string FileTransferManager::sendFileWithKey(const std::string& senderIdB64u
 
     const int64_t     ts           = nowSecs();
     const std::string fileHashB64u = CryptoEngine::toBase64Url(fileHash);
-    const int         totalChunks  = int((fileSize + kChunkBytes - 1) / kChunkBytes);
+    const int         totalChunks  = chunkCountFor(fileSize);
 
     sendChunkEnvelopes(senderIdB64u, peerIdB64u, fileKey, filePath, fileSize,
                        transferId, fileName, fileHashB64u, ts,
@@ -398,17 +454,22 @@ bool FileTransferManager::announceIncoming(const std::string& fromId,
                                             const Bytes& fileKey,
                                             int64_t announcedTsSecs,
                                             const std::string& groupId,
-                                            const std::string& groupName)
+                                            const std::string& groupName,
+                                            int64_t chunkBytes,
+                                            bool treeHash)
 {
+    // A tree-hashed chunk has to cover whole leaves to be checkable.
     if (transferId.empty() || totalChunks <= 0 ||
         fileSize <= 0 || fileSize > kMaxFileBytes ||
-        fileHash.size() != 32 || fileKey.size() != 32) {
+        fileHash.size() != 32 || fileKey.size() != 32 ||
+        !isValidChunkBytes(chunkBytes) ||
+        (treeHash && chunkBytes % TreeHash::kLeafBytes != 0)) {
         P2P_WARN("[FileTransfer] announceIncoming: invalid args for"
                    << idPrefix(transferId));
         return false;
     }
 
-    const int expectedChunks = int((fileSize + kChunkBytes - 1) / kChunkBytes);
+    const int expectedChunks = chunkCountFor(fileSize, chunkBytes);
     if (totalChunks != expectedChunks) {
         P2P_WARN("[FileTransfer] announceIncoming: totalChunks"
                    << totalChunks << "doesn't match fileSize"
@@ -434,18 +495,23 @@ bool FileTransferManager::announceIncoming(const std::string& fromId,
     xfer.fileName     = safeName;
     xfer.fileSize     = fileSize;
     xfer.totalChunks  = totalChunks;
+    xfer.chunkBytes   = chunkBytes;
     xfer.tsSecs       = announcedTsSecs > 0 ? announcedTsSecs : nowSecs();
     xfer.fileHash     = fileHash;
+    xfer.treeHash     = treeHash;
     xfer.groupId      = groupId;
     xfer.groupName    = groupName;
     xfer.createdSecs  = nowSecs();
     xfer.partialPath  = partialPathFor(transferId);
     xfer.finalPath    = finalPathFor(xfer.fileName, transferId);
     xfer.receivedChunks.assign(size_t(totalChunks), false);
+    xfer.lastSyncMs   = p2p::steadyMs();
 
-    xfer.partialFile = std::make_unique<std::fstream>(xfer.partialPath,
-        std::ios::in | std::ios::out | std::ios::binary | std::ios::trunc);
-    if (!xfer.partialFile->is_open()) {
+    // Preallocated at the full size; chunks are pwritten into place.
+    // Tree-hashed chunks are verified on arrival, so no running hash.
+    xfer.partialFile = PartialFile::create(xfer.partialPath, fileSize, chunkBytes,
+                                           &m_writerPool, /*sequentialHash=*/!treeHash);
+    if (!xfer.partialFile) {
         P2P_WARN("[FileTransfer] announceIncoming: cannot open partial file"
                    << xfer.partialPath);
         if (onStatus) onStatus(std::string("Cannot write to disk: ") + xfer.fileName);
@@ -543,18 +609,22 @@ bool FileTransferManager::handleFileEnvelope(const std::string& fromId,
         return true;
     }
 
-    // Per-chunk dedup: "<transferId>:<chunkIndex>"
+    // Per-chunk dedup: "<transferId>:<chunkIndex>".  A tree-hashed chunk
+    // is only marked once it passes its proof, so the copy re-sent after
+    // a rejection isn't dropped as a replay; the bitmap check below
+    // still drops duplicates of a good one.
     const std::string dedupKey = transferId + ":" + std::to_string(chunkIndex);
-    if (!markSeen(dedupKey)) return true;
+    if (!xfer.treeHash && !markSeen(dedupKey)) return true;
 
-    const Bytes chunkData = m_crypto.aeadDecrypt(key32, encChunk);
+    Bytes chunkData = m_crypto.aeadDecrypt(key32, encChunk);
     if (chunkData.empty()) return true;
 
-    // Each plaintext chunk except possibly the last must equal kChunkBytes.
+    // Each plaintext chunk except possibly the last must equal the
+    // transfer's negotiated chunk size.
     const int64_t expectedLen =
         (chunkIndex == xfer.totalChunks - 1)
-            ? (xfer.fileSize - int64_t(chunkIndex) * kChunkBytes)
-            : kChunkBytes;
+            ? (xfer.fileSize - int64_t(chunkIndex) * xfer.chunkBytes)
+            : xfer.chunkBytes;
     if (int64_t(chunkData.size()) != expectedLen) {
         P2P_WARN("[FileTransfer] chunk" << chunkIndex << "has wrong plaintext size"
                    << int64_t(chunkData.size()) << "(expected" << int64_t(expectedLen) << ")");
@@ -562,7 +632,7 @@ bool FileTransferManager::handleFileEnvelope(const std::string& fromId,
     }
 
     // Guard against the partial file being closed (e.g., after completion).
-    if (!xfer.partialFile || !xfer.partialFile->is_open()) {
+    if (!xfer.partialFile) {
         P2P_WARN("[FileTransfer] chunk for closed partial file"
                    << idPrefix(transferId) << "— dropped");
         return true;
@@ -573,27 +643,54 @@ bool FileTransferManager::handleFileEnvelope(const std::string& fromId,
         return true;
     }
 
-    // Write chunk at its correct offset — no RAM accumulation.
-    const int64_t offset = int64_t(chunkIndex) * kChunkBytes;
-    xfer.partialFile->seekp(std::streamoff(offset));
-    xfer.partialFile->write(reinterpret_cast<const char*>(chunkData.data()),
-                             std::streamsize(chunkData.size()));
-    if (!xfer.partialFile->good()) {
+    // Tree mode: check the chunk against the announced root before it
+    // touches the disk, and ask for it again if it doesn't match.
+    if (xfer.treeHash) {
+        const Bytes proof = CryptoEngine::fromBase64Url(meta.value("proof", std::string()));
+        if (!TreeHash::verifyRange(xfer.fileHash, xfer.fileSize,
+                                   int64_t(chunkIndex) * xfer.chunkBytes,
+                                   chunkData.data(), chunkData.size(), proof)) {
+            P2P_WARN("[FileTransfer] chunk" << chunkIndex << "of" << idPrefix(transferId)
+                       << "fails its tree proof — dropped");
+            if (++xfer.corruptChunks > kMaxCorruptChunks) {
+                if (onStatus) onStatus("File '" + xfer.fileName
+                                       + "' integrity check FAILED — discarded.");
+                cancelInboundTransfer(transferId);
+                return true;
+            }
+            if (onChunkRejected) onChunkRejected(fromId, transferId, uint32_t(chunkIndex));
+            return true;
+        }
+        if (!markSeen(dedupKey)) return true;
+    }
+
+    // Queue a positional write at the chunk's offset — no RAM
+    // accumulation beyond the writer pool's bound.
+    if (!xfer.partialFile->writeChunk(chunkIndex, std::move(chunkData))) {
         P2P_WARN("[FileTransfer] Write failed for chunk" << chunkIndex
                    << "of" << idPrefix(transferId));
+        if (onStatus) onStatus(std::string("Cannot write to disk: ") + xfer.fileName);
+        cancelInboundTransfer(transferId);
         return true;
     }
-    xfer.partialFile->flush();
     xfer.receivedChunks[chunkIndex] = true;
     xfer.chunksReceivedCount++;
-
-    // Update DB bitmap after each successful write so we can resume.
-    persistIncomingFull(transferId, xfer, key32);
+    xfer.unsyncedChunks++;
 
     const int received    = xfer.chunksReceivedCount;
     const int totalOfXfer = xfer.totalChunks;
 
     if (received < totalOfXfer) {
+        // Batched durability: fdatasync + bitmap row once per window.
+        if (xfer.unsyncedChunks >= kProgressSyncChunks ||
+            p2p::steadyMs() - xfer.lastSyncMs >= kProgressSyncMs) {
+            if (!syncIncoming(transferId, xfer)) {
+                if (onStatus) onStatus(std::string("Cannot write to disk: ") + xfer.fileName);
+                cancelInboundTransfer(transferId);
+                return true;
+            }
+        }
+
         if (onFileChunkReceived) onFileChunkReceived(fromId, transferId, xfer.fileName,
                                xfer.fileSize, received, totalOfXfer,
                                std::string{}, xfer.tsSecs,
@@ -602,6 +699,16 @@ bool FileTransferManager::handleFileEnvelope(const std::string& fromId,
     }
 
     // ── All chunks received ─────────────────────────────────────────────────
+    // Durable before the rename; the row is about to go, so no bitmap
+    // update.  The hash was accumulated as chunks landed — or, tree
+    // mode, every chunk already matched the root on arrival.
+    if (!xfer.partialFile->sync()) {
+        P2P_WARN("[FileTransfer] Flush failed completing" << idPrefix(transferId));
+        if (onStatus) onStatus(std::string("Cannot write to disk: ") + xfer.fileName);
+        cancelInboundTransfer(transferId);
+        return true;
+    }
+    const Bytes actual = xfer.treeHash ? xfer.fileHash : xfer.partialFile->finishHash();
     xfer.partialFile->close();
 
     // Capture values we need before removing the entry.
@@ -617,9 +724,8 @@ bool FileTransferManager::handleFileEnvelope(const std::string& fromId,
     m_incomingTransfers.erase(itXfer);
     if (onTransferCompleted) onTransferCompleted(transferId);  // let ChatController zero the key
 
-    // Verify integrity by streaming the completed file from disk.
+    // Verify integrity against the hash accumulated while receiving.
     if (!expected.empty()) {
-        const Bytes actual = blake2b256File(partialPath);
         if (actual != expected) {
             std::error_code ec;
             fs::remove(partialPath, ec);
@@ -654,6 +760,28 @@ bool FileTransferManager::handleFileEnvelope(const std::string& fromId,
     return true;
 }
 
+// ── Progress durability ──────────────────────────────────────────────────────
+
+void FileTransferManager::flushIncomingProgress()
+{
+    // The per-chunk check only runs when a chunk arrives; a transfer
+    // that stalls mid-window would otherwise keep those chunks unsynced
+    // until the next one or shutdown.
+    const int64_t now = p2p::steadyMs();
+    std::vector<std::string> failed;
+    for (auto& [tid, xferPtr] : m_incomingTransfers) {
+        if (!xferPtr || !xferPtr->partialFile || xferPtr->unsyncedChunks == 0) continue;
+        if (now - xferPtr->lastSyncMs < kProgressSyncMs) continue;
+        if (!syncIncoming(tid, *xferPtr)) failed.push_back(tid);
+    }
+    for (const std::string& tid : failed) {
+        auto it = m_incomingTransfers.find(tid);
+        if (it == m_incomingTransfers.end()) continue;
+        if (onStatus) onStatus(std::string("Cannot write to disk: ") + it->second->fileName);
+        cancelInboundTransfer(tid);
+    }
+}
+
 // ── Stale transfer purge ─────────────────────────────────────────────────────
 
 void FileTransferManager::purgeStaleTransfers()
@@ -698,7 +826,9 @@ void FileTransferManager::queueOutboundFile(const std::string& senderIdB64u,
                                              int64_t fileSize,
                                              const Bytes& fileHash,
                                              const std::string& groupId,
-                                             const std::string& groupName)
+                                             const std::string& groupName,
+                                             int64_t offeredChunkBytes,
+                                             std::shared_ptr<const TreeHash> tree)
 {
     if (fileKey.size() != 32 || fileHash.size() != 32) {
         P2P_WARN("[FileTransfer] queueOutboundFile: bad key/hash length");
@@ -715,13 +845,17 @@ void FileTransferManager::queueOutboundFile(const std::string& senderIdB64u,
     out.groupId    = groupId;
     out.groupName  = groupName;
     out.queuedSecs = nowSecs();
+    out.offeredChunkBytes = isValidChunkBytes(offeredChunkBytes) ? offeredChunkBytes
+                                                                 : kChunkBytes;
+    out.tree       = std::move(tree);
     m_outboundPending[transferId] = std::move(out);
 }
 
 bool FileTransferManager::startOutboundStream(const std::string& transferId,
                                                 bool requireP2P,
                                                 bool senderRequiresP2P,
-                                                bool p2pReadyNow)
+                                                bool p2pReadyNow,
+                                                int64_t chunkBytes)
 {
     auto it = m_outboundPending.find(transferId);
     if (it == m_outboundPending.end()) {
@@ -730,6 +864,17 @@ bool FileTransferManager::startOutboundStream(const std::string& transferId,
         return false;
     }
 
+    // The receiver has already locked its chunk count at this size, so
+    // a value we never offered can't be streamed on the legacy size
+    // either — abandon rather than send chunks it will drop.
+    if (chunkBytes < kChunkBytes || chunkBytes > it->second.offeredChunkBytes) {
+        P2P_WARN("[FileTransfer] startOutboundStream: receiver picked chunk size"
+                   << int64_t(chunkBytes) << "outside offer for" << idPrefix(transferId));
+        abandonOutboundTransfer(transferId);
+        return false;
+    }
+    it->second.chunkBytes = chunkBytes;
+
     if (!fs::exists(it->second.filePath)) {
         const std::string name = it->second.fileName;
         const std::string peer = it->second.peerId;
@@ -740,26 +885,29 @@ bool FileTransferManager::startOutboundStream(const std::string& transferId,
         return false;
     }
 
-    const bool requiresP2P = requireP2P || senderRequiresP2P;
+    // Chunks above kChunkBytes don't fit a relay envelope, so a
+    // negotiated size pins the transfer to the direct path.
+    const bool bigChunks   = chunkBytes > kChunkBytes;
+    const bool requiresP2P = requireP2P || senderRequiresP2P || bigChunks;
     const bool isLarge     = it->second.fileSize > kLargeFileBytes;
 
-    if (!isLarge) {
+    if (!isLarge && !bigChunks) {
         OutboundTransfer out = std::move(it->second);
         m_outboundPending.erase(it);
 
         const int64_t     ts           = nowSecs();
         const std::string fileHashB64u = CryptoEngine::toBase64Url(out.fileHash);
-        const int         totalChunks  = int((out.fileSize + kChunkBytes - 1) / kChunkBytes);
+        const int         totalChunks  = chunkCountFor(out.fileSize);
 
         registerSentTransfer(out.senderId, out.peerId, transferId, out.fileName,
                              out.filePath, out.fileSize, out.fileHash, out.fileKey,
-                             out.groupId, out.groupName);
+                             out.groupId, out.groupName, kChunkBytes, out.tree);
 
         sendChunkEnvelopes(out.senderId, out.peerId, out.fileKey,
                            out.filePath, out.fileSize,
                            transferId, out.fileName, fileHashB64u, ts,
                            RoutingMode::Auto,
-                           out.groupId, out.groupName);
+                           out.groupId, out.groupName, kChunkBytes, out.tree);
 
         if (out.groupId.empty()) {
             if (onStatus) onStatus("'" + out.fileName + "' streamed in "
@@ -769,7 +917,7 @@ bool FileTransferManager::startOutboundStream(const std::string& transferId,
         return true;
     }
 
-    // Large file path — record the transport policy first.
+    // Large-file / big-chunk path — record the transport policy first.
     it->second.receiverRequiresP2P = requireP2P;
     it->second.senderRequiresP2P   = senderRequiresP2P;
 
@@ -779,19 +927,19 @@ bool FileTransferManager::startOutboundStream(const std::string& transferId,
 
         const int64_t     ts           = nowSecs();
         const std::string fileHashB64u = CryptoEngine::toBase64Url(out.fileHash);
-        const int         totalChunks  = int((out.fileSize + kChunkBytes - 1) / kChunkBytes);
+        const int         totalChunks  = chunkCountFor(out.fileSize, out.chunkBytes);
 
         const RoutingMode mode = requiresP2P ? RoutingMode::P2POnly : RoutingMode::Auto;
 
         registerSentTransfer(out.senderId, out.peerId, transferId, out.fileName,
                              out.filePath, out.fileSize, out.fileHash, out.fileKey,
-                             out.groupId, out.groupName);
+                             out.groupId, out.groupName, out.chunkBytes, out.tree);
 
         sendChunkEnvelopes(out.senderId, out.peerId, out.fileKey,
                            out.filePath, out.fileSize,
                            transferId, out.fileName, fileHashB64u, ts,
                            mode,
-                           out.groupId, out.groupName);
+                           out.groupId, out.groupName, out.chunkBytes, out.tree);
 
         if (out.groupId.empty()) {
             if (onStatus) onStatus("'" + out.fileName + "' streamed in "
@@ -801,7 +949,7 @@ bool FileTransferManager::startOutboundStream(const std::string& transferId,
         return true;
     }
 
-    // Large file + no P2P yet → park in WaitingForP2P state.
+    // Large file or big chunks + no P2P yet → park in WaitingForP2P state.
     it->second.stage           = OutboundStage::WaitingForP2P;
     it->second.waitStartedSecs = nowSecs();
 
@@ -829,20 +977,21 @@ FileTransferManager::notifyP2PReady(const std::string& peerIdB64u)
 
         const int64_t     ts           = nowSecs();
         const std::string fileHashB64u = CryptoEngine::toBase64Url(out.fileHash);
-        const int         totalChunks  = int((out.fileSize + kChunkBytes - 1) / kChunkBytes);
+        const int         totalChunks  = chunkCountFor(out.fileSize, out.chunkBytes);
 
-        const bool requiresP2P = out.receiverRequiresP2P || out.senderRequiresP2P;
+        const bool requiresP2P = out.receiverRequiresP2P || out.senderRequiresP2P
+                              || out.chunkBytes > kChunkBytes;
         const RoutingMode mode = requiresP2P ? RoutingMode::P2POnly : RoutingMode::Auto;
 
         registerSentTransfer(out.senderId, out.peerId, tid, out.fileName,
                              out.filePath, out.fileSize, out.fileHash, out.fileKey,
-                             out.groupId, out.groupName);
+                             out.groupId, out.groupName, out.chunkBytes, out.tree);
 
         sendChunkEnvelopes(out.senderId, out.peerId, out.fileKey,
                            out.filePath, out.fileSize,
                            tid, out.fileName, fileHashB64u, ts,
                            mode,
-                           out.groupId, out.groupName);
+                           out.groupId, out.groupName, out.chunkBytes, out.tree);
 
         if (out.groupId.empty()) {
             if (onStatus) onStatus("'" + out.fileName + "' streamed in "
@@ -898,6 +1047,21 @@ std::string FileTransferManager::outboundPeerFor(const std::string& transferId)
     return (it == m_outboundPending.end()) ? std::string() : it->second.peerId;
 }
 
+std::set<std::string> FileTransferManager::outboundPendingPeers() const
+{
+    std::set<std::string> peers;
+    for (const auto& [tid, out] : m_outboundPending) peers.insert(out.peerId);
+    return peers;
+}
+
+std::set<std::string> FileTransferManager::outboundAcceptedPeers() const
+{
+    std::set<std::string> peers;
+    for (const auto& [tid, out] : m_outboundPending)
+        if (out.stage == OutboundStage::WaitingForP2P) peers.insert(out.peerId);
+    return peers;
+}
+
 std::string FileTransferManager::inboundPeerFor(const std::string& transferId) const
 {
     auto it = m_incomingTransfers.find(transferId);
@@ -947,7 +1111,7 @@ void FileTransferManager::purgeStaleOutbound()
                                out.filePath, out.fileSize,
                                tid, out.fileName, fileHashB64u, ts,
                                RoutingMode::Auto,
-                               out.groupId, out.groupName);
+                               out.groupId, out.groupName, kChunkBytes);
             CryptoEngine::secureZero(out.fileKey);
             continue;
         }
@@ -1019,19 +1183,70 @@ void FileTransferManager::ensurePhase4Tables()
         "  created_secs  INTEGER NOT NULL"
         ");"
     );
+
+    // Negotiated chunk size (NULL / 0 → kChunkBytes).  Added after the
+    // tables shipped; on DBs that already have the column the ALTER
+    // fails and exec quietly returns false.
+    q.exec("ALTER TABLE file_transfers_in ADD COLUMN chunk_bytes INTEGER;");
+    q.exec("ALTER TABLE file_transfers_out ADD COLUMN chunk_bytes INTEGER;");
+    // Integrity mode, added the same way: NULL / 0 → file_hash is the
+    // sequential BLAKE2b-256, TreeHash::kVersion → it's a tree root.
+    q.exec("ALTER TABLE file_transfers_in ADD COLUMN hash_mode INTEGER;");
+    q.exec("ALTER TABLE file_transfers_out ADD COLUMN hash_mode INTEGER;");
+}
+
+// Rows written before chunk_bytes existed read back as 0.
+static int64_t storedChunkBytes(int64_t v)
+{
+    return FileTransferManager::isValidChunkBytes(v) ? v : FileTransferManager::kChunkBytes;
+}
+
+// Serialize a std::vector<bool> to a compact blob, in one of two formats:
+//   bitmap: [4-byte bit count BE][packed bytes, LSB first] — byte-compatible
+//           with the prior QBitArray-based format so existing rows decode.
+//   ranges: [kRangesTag][4-byte bit count BE] then one [4-byte first BE]
+//           [4-byte count BE] per run of set bits.
+// A bitmap's first byte is the top byte of a chunk count, always 0 under
+// kMaxFileBytes, so the tag can't be mistaken for one.  Chunks mostly land
+// in order, so a transfer's progress is one or two runs — 13 or 21 bytes
+// however large the file; whichever encoding is shorter is written.
+static constexpr uint8_t kRangesTag = 0xFF;
+
+static void putBE32(Bytes& out, uint32_t v)
+{
+    out.push_back(uint8_t((v >> 24) & 0xFF));
+    out.push_back(uint8_t((v >> 16) & 0xFF));
+    out.push_back(uint8_t((v >>  8) & 0xFF));
+    out.push_back(uint8_t( v        & 0xFF));
+}
+
+static uint32_t getBE32(const uint8_t* p)
+{
+    return (uint32_t(p[0]) << 24) | (uint32_t(p[1]) << 16) |
+           (uint32_t(p[2]) <<  8) |  uint32_t(p[3]);
 }
 
-// Serialize a std::vector<bool> to a compact blob.  Format:
-//   [4-byte bit count BE][packed bytes].  Byte-compatible with the prior
-//   QBitArray-based format so existing DB rows decode cleanly.
 static Bytes bitArrayToBlob(const std::vector<bool>& bits)
 {
-    Bytes blob(4 + (bits.size() + 7) / 8, 0);
     const uint32_t n = uint32_t(bits.size());
-    blob[0] = uint8_t((n >> 24) & 0xFF);
-    blob[1] = uint8_t((n >> 16) & 0xFF);
-    blob[2] = uint8_t((n >>  8) & 0xFF);
-    blob[3] = uint8_t( n        & 0xFF);
+    Bytes ranges;
+    ranges.push_back(kRangesTag);
+    putBE32(ranges, n);
+    for (uint32_t i = 0; i < n; ) {
+        if (!bits[i]) { ++i; continue; }
+        const uint32_t first = i;
+        while (i < n && bits[i]) ++i;
+        putBE32(ranges, first);
+        putBE32(ranges, i - first);
+    }
+
+    const size_t bitmapSize = 4 + (bits.size() + 7) / 8;
+    if (ranges.size() <= bitmapSize) return ranges;
+
+    Bytes blob;
+    blob.reserve(bitmapSize);
+    putBE32(blob, n);
+    blob.resize(bitmapSize, 0);
     for (size_t i = 0; i < bits.size(); ++i) {
         if (bits[i])
             blob[4 + i / 8] = uint8_t(blob[4 + i / 8] | (1u << (i % 8)));
@@ -1041,11 +1256,21 @@ static Bytes bitArrayToBlob(const std::vector<bool>& bits)
 
 static std::vector<bool> blobToBitArray(const Bytes& blob)
 {
+    if (!blob.empty() && blob[0] == kRangesTag) {
+        if (blob.size() < 5 || (blob.size() - 5) % 8 != 0) return {};
+        const uint32_t n = getBE32(&blob[1]);
+        std::vector<bool> bits(n, false);
+        for (size_t p = 5; p < blob.size(); p += 8) {
+            const uint32_t first = getBE32(&blob[p]);
+            const uint32_t count = getBE32(&blob[p + 4]);
+            if (first > n || count > n - first) return {};
+            std::fill(bits.begin() + first, bits.begin() + first + count, true);
+        }
+        return bits;
+    }
+
     if (blob.size() < 4) return {};
-    const uint32_t n = (uint32_t(blob[0]) << 24) |
-                       (uint32_t(blob[1]) << 16) |
-                       (uint32_t(blob[2]) <<  8) |
-                        uint32_t(blob[3]);
+    const uint32_t n = getBE32(blob.data());
     if (blob.size() < 4 + size_t((n + 7) / 8)) return {};
     std::vector<bool> bits(n, false);
     for (uint32_t i = 0; i < n; ++i) {
@@ -1066,9 +1291,9 @@ void FileTransferManager::persistIncomingFull(const std::string& transferId,
         "INSERT OR REPLACE INTO file_transfers_in "
         "(transfer_id, peer_id, file_name, file_size, total_chunks, file_hash, "
         " file_key, group_id, group_name, partial_path, final_path, "
-        " received_bitmap, created_secs, ts_secs) "
+        " received_bitmap, created_secs, ts_secs, chunk_bytes, hash_mode) "
         "VALUES (:tid, :peer, :name, :size, :chunks, :hash, :key, :gid, :gname, "
-        "        :ppath, :fpath, :bmap, :created, :ts);")) return;
+        "        :ppath, :fpath, :bmap, :created, :ts, :cbytes, :hmode);")) return;
     q.bindValue(":tid",     transferId);
     q.bindValue(":peer",    xfer.fromId);
     q.bindValue(":name",    xfer.fileName);
@@ -1095,9 +1320,37 @@ void FileTransferManager::persistIncomingFull(const std::string& transferId,
     q.bindValue(":bmap",    bitArrayToBlob(xfer.receivedChunks));
     q.bindValue(":created", int64_t(xfer.createdSecs));
     q.bindValue(":ts",      int64_t(xfer.tsSecs));
+    q.bindValue(":cbytes",  int64_t(xfer.chunkBytes));
+    q.bindValue(":hmode",   xfer.treeHash ? TreeHash::kVersion : 0);
     q.exec();
 }
 
+void FileTransferManager::persistIncomingProgress(const std::string& transferId,
+                                                  const IncomingTransfer& xfer) const
+{
+    if (!m_dbPtr || !m_dbPtr->isOpen()) return;
+    SqlCipherQuery q(*m_dbPtr);
+    if (!q.prepare("UPDATE file_transfers_in SET received_bitmap=:bmap "
+                   "WHERE transfer_id=:tid;")) return;
+    q.bindValue(":bmap", bitArrayToBlob(xfer.receivedChunks));
+    q.bindValue(":tid",  transferId);
+    q.exec();
+}
+
+bool FileTransferManager::syncIncoming(const std::string& transferId,
+                                       IncomingTransfer& xfer)
+{
+    if (!xfer.partialFile || !xfer.partialFile->sync()) {
+        P2P_WARN("[FileTransfer] Flush failed for" << idPrefix(transferId));
+        return false;
+    }
+    // Only now are the window's chunks safe to list as received.
+    persistIncomingProgress(transferId, xfer);
+    xfer.unsyncedChunks = 0;
+    xfer.lastSyncMs     = p2p::steadyMs();
+    return true;
+}
+
 void FileTransferManager::deleteIncomingRow(const std::string& transferId) const
 {
     if (!m_dbPtr || !m_dbPtr->isOpen()) return;
@@ -1154,7 +1407,9 @@ void FileTransferManager::registerSentTransfer(const std::string& senderIdB64u,
                                                  const Bytes& fileHash,
                                                  const Bytes& fileKey,
                                                  const std::string& groupId,
-                                                 const std::string& groupName)
+                                                 const std::string& groupName,
+                                                 int64_t chunkBytes,
+                                                 std::shared_ptr<const TreeHash> tree)
 {
     SentTransfer s;
     s.senderId     = senderIdB64u;
@@ -1167,6 +1422,9 @@ void FileTransferManager::registerSentTransfer(const std::string& senderIdB64u,
     s.groupId      = groupId;
     s.groupName    = groupName;
     s.createdSecs  = nowSecs();
+    s.chunkBytes   = chunkBytes;
+    s.treeHash     = tree != nullptr;
+    s.tree         = std::move(tree);
     m_sentTransfers[transferId] = s;
 
     if (m_dbPtr && m_dbPtr->isOpen()) {
@@ -1174,9 +1432,10 @@ void FileTransferManager::registerSentTransfer(const std::string& senderIdB64u,
         if (q.prepare(
             "INSERT OR REPLACE INTO file_transfers_out "
             "(transfer_id, sender_id, peer_id, file_name, file_path, file_size, "
-            " file_hash, file_key, group_id, group_name, created_secs) "
+            " file_hash, file_key, group_id, group_name, created_secs, chunk_bytes, "
+            " hash_mode) "
             "VALUES (:tid, :sid, :peer, :name, :path, :size, :hash, :key, "
-            "        :gid, :gname, :created);")) {
+            "        :gid, :gname, :created, :cbytes, :hmode);")) {
             q.bindValue(":tid",     transferId);
             q.bindValue(":sid",     senderIdB64u);
             q.bindValue(":peer",    peerIdB64u);
@@ -1192,6 +1451,8 @@ void FileTransferManager::registerSentTransfer(const std::string& senderIdB64u,
             q.bindValue(":gid",     groupId);
             q.bindValue(":gname",   groupName);
             q.bindValue(":created", int64_t(s.createdSecs));
+            q.bindValue(":cbytes",  int64_t(chunkBytes));
+            q.bindValue(":hmode",   s.treeHash ? TreeHash::kVersion : 0);
             q.exec();
         }
     }
@@ -1206,7 +1467,8 @@ void FileTransferManager::loadPersistedTransfers()
         SqlCipherQuery q(*m_dbPtr);
         if (q.prepare("SELECT transfer_id, peer_id, file_name, file_size, total_chunks, "
                       "       file_hash, file_key, group_id, group_name, partial_path, "
-                      "       final_path, received_bitmap, created_secs, ts_secs "
+                      "       final_path, received_bitmap, created_secs, ts_secs, "
+                      "       chunk_bytes, hash_mode "
                       "FROM file_transfers_in;") && q.exec()) {
             while (q.next()) {
                 const std::string tid      = q.valueText(0);
@@ -1231,6 +1493,8 @@ void FileTransferManager::loadPersistedTransfers()
                 const Bytes       bmap     = q.valueBlob(11);
                 const int64_t     created  = q.valueInt64(12);
                 const int64_t     tsSecs   = q.valueInt64(13);
+                const int64_t     cbytes   = storedChunkBytes(q.valueInt64(14));
+                const bool        tree     = q.valueInt(15) == TreeHash::kVersion;
 
                 if (!fs::exists(ppath)) {
                     deleteIncomingRow(tid);
@@ -1242,7 +1506,9 @@ void FileTransferManager::loadPersistedTransfers()
                 xferPtr->fileName       = fname;
                 xferPtr->fileSize       = fsize;
                 xferPtr->totalChunks    = chunks;
+                xferPtr->chunkBytes     = cbytes;
                 xferPtr->fileHash       = fhash;
+                xferPtr->treeHash       = tree;
                 xferPtr->groupId        = gid;
                 xferPtr->groupName      = gname;
                 xferPtr->partialPath    = ppath;
@@ -1255,10 +1521,15 @@ void FileTransferManager::loadPersistedTransfers()
                 for (bool b : xferPtr->receivedChunks) if (b) ++set;
                 xferPtr->chunksReceivedCount = set;
 
-                // Re-open partial file R/W without truncation.
-                xferPtr->partialFile = std::make_unique<std::fstream>(ppath,
-                    std::ios::in | std::ios::out | std::ios::binary);
-                if (!xferPtr->partialFile->is_open()) {
+                xferPtr->lastSyncMs = p2p::steadyMs();
+
+                // Re-open partial file R/W without truncation.  Tree-mode
+                // chunks on disk were checked before they were written.
+                xferPtr->partialFile = PartialFile::reopen(ppath, fsize, cbytes,
+                                                           xferPtr->receivedChunks,
+                                                           &m_writerPool,
+                                                           /*sequentialHash=*/!tree);
+                if (!xferPtr->partialFile) {
                     P2P_WARN("[FileTransfer] loadPersisted: cannot reopen"
                                << ppath);
                     deleteIncomingRow(tid);
@@ -1280,7 +1551,8 @@ void FileTransferManager::loadPersistedTransfers()
         SqlCipherQuery q(*m_dbPtr);
         if (q.prepare("SELECT transfer_id, sender_id, peer_id, file_name, file_path, "
                       "       file_size, file_hash, file_key, group_id, group_name, "
-                      "       created_secs FROM file_transfers_out;") && q.exec()) {
+                      "       created_secs, chunk_bytes, hash_mode "
+                      "FROM file_transfers_out;") && q.exec()) {
             while (q.next()) {
                 const std::string tid = q.valueText(0);
                 SentTransfer s;
@@ -1301,6 +1573,8 @@ void FileTransferManager::loadPersistedTransfers()
                 s.groupId     = q.valueText(8);
                 s.groupName   = q.valueText(9);
                 s.createdSecs = q.valueInt64(10);
+                s.chunkBytes  = storedChunkBytes(q.valueInt64(11));
+                s.treeHash    = q.valueInt(12) == TreeHash::kVersion;
 
                 if (!fs::exists(s.filePath) || s.fileKey.size() != 32) {
                     deleteSentRow(tid);
@@ -1347,31 +1621,43 @@ bool FileTransferManager::resendChunks(const std::string& transferId,
         return false;
     }
 
-    std::ifstream src(s.filePath, std::ios::binary);
-    if (!src.is_open()) {
+    auto src = FileSource::open(s.filePath);
+    if (!src) {
         P2P_WARN("[FileTransfer] resendChunks: cannot open"
                    << s.filePath);
         return false;
     }
 
-    const int totalChunks = int((s.fileSize + kChunkBytes - 1) / kChunkBytes);
+    // Only the root survives a restart.  Rebuild the tree for the
+    // proofs; a file that no longer hashes to the announced root would
+    // only produce chunks the receiver rejects.
+    if (s.treeHash && !s.tree) {
+        auto tree = TreeHash::build(*src);
+        if (!tree || tree->root() != s.fileHash) {
+            P2P_WARN("[FileTransfer] resendChunks: source file changed since announce"
+                       << s.filePath);
+            return false;
+        }
+        s.tree = std::move(tree);
+    }
+
+    const int totalChunks = chunkCountFor(s.fileSize, s.chunkBytes);
     const std::string fileHashB64u = CryptoEngine::toBase64Url(s.fileHash);
     const int64_t ts = nowSecs();
-
-    Bytes chunk;
-    chunk.reserve(size_t(kChunkBytes));
+    // Negotiated big chunks can't ride the relay; if the direct path is
+    // down they're dropped and the receiver asks again later.
+    const RoutingMode mode = s.chunkBytes > kChunkBytes ? RoutingMode::P2POnly
+                                                        : RoutingMode::Auto;
 
     for (uint32_t i : chunkIndices) {
         if (int(i) >= totalChunks) continue;
 
-        const int64_t offset    = int64_t(i) * kChunkBytes;
+        const int64_t offset    = int64_t(i) * s.chunkBytes;
         const int64_t remaining = s.fileSize - offset;
-        const int64_t toRead    = std::min<int64_t>(kChunkBytes, remaining);
+        const int64_t toRead    = std::min<int64_t>(s.chunkBytes, remaining);
 
-        src.seekg(offset);
-        chunk.assign(size_t(toRead), 0);
-        src.read(reinterpret_cast<char*>(chunk.data()), std::streamsize(toRead));
-        if (src.gcount() != toRead) {
+        const uint8_t* chunk = src->view(offset, size_t(toRead));
+        if (!chunk) {
             P2P_WARN("[FileTransfer] resendChunks: short read at chunk" << i);
             break;
         }
@@ -1386,25 +1672,20 @@ bool FileTransferManager::resendChunks(const std::string& transferId,
         meta["fileSize"]    = s.fileSize;
         meta["ts"]          = ts;
         meta["fileHash"]    = fileHashB64u;
+        if (s.tree) meta["proof"] = CryptoEngine::toBase64Url(s.tree->rangeProof(offset, toRead));
         if (!s.groupId.empty()) {
             meta["groupId"]   = s.groupId;
             meta["groupName"] = s.groupName;
         }
 
-        const std::string metaJsonStr = meta.dump();
-        const Bytes metaJson(metaJsonStr.begin(), metaJsonStr.end());
-        const Bytes encMeta  = m_crypto.aeadEncrypt(s.fileKey, metaJson);
-        const Bytes encChunk = m_crypto.aeadEncrypt(s.fileKey, chunk);
-
-        Bytes inner;
-        inner.reserve(4 + encMeta.size() + encChunk.size());
-        appendBE32(inner, uint32_t(encMeta.size()));
-        inner.insert(inner.end(), encMeta.begin(), encMeta.end());
-        inner.insert(inner.end(), encChunk.begin(), encChunk.end());
+        const Bytes inner =
+            sealChunkPayload(s.fileKey, meta.dump(), chunk, size_t(toRead));
 
-        dispatchChunk(s.senderId, s.peerId, inner, RoutingMode::Auto);
+        dispatchChunk(s.senderId, s.peerId, transferId, inner, mode);
     }
 
+    if (onOutboundStreamEnded) onOutboundStreamEnded(s.peerId, transferId);
+    if (mode == RoutingMode::P2POnly && onWantP2PConnection) onWantP2PConnection(s.peerId);
     return true;
 }
 
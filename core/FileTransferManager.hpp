@@ -1,6 +1,7 @@
 #pragma once
 
 #include "types.hpp"
+#include "PartialFile.hpp"
 
 #include <cstdint>
 #include <deque>
@@ -8,26 +9,33 @@
 #include <functional>
 #include <map>
 #include <memory>
+#include <set>
 #include <string>
 #include <unordered_set>
 #include <vector>
 
 class CryptoEngine;
+class FileSource;
 class SqlCipherDb;
+class TreeHash;
 
 /*
  * FileTransferManager — handles chunked, encrypted file transfers.
  *
  * Outbound: streams a file from disk in <= 240 KB chunks, encrypts each with
  *           a per-file ratchet-derived key, and dispatches via P2P or sealed
- *           relay. Includes BLAKE2b-256 integrity hash for verification.
- *           Never holds the full file in RAM.
+ *           relay. Includes BLAKE2b-256 integrity hash for verification —
+ *           or, toward peers that read it, a TreeHash root plus a
+ *           per-chunk range proof.  Never holds the full file in RAM.
  *
  * Inbound:  parses file-chunk envelopes, decrypts, writes each chunk directly
- *           to a disk-backed partial file at its correct offset, tracks
- *           received indices in a bitmap. On completion verifies integrity
- *           hash and renames the partial file to its final name. Never holds
- *           the full file in RAM.
+ *           to a preallocated partial file at its correct offset, tracks
+ *           received indices in a bitmap (synced + persisted in batches).
+ *           The integrity hash is accumulated as chunks land; on completion
+ *           it's checked and the partial file renamed to its final name.
+ *           Tree-hashed transfers check each chunk against the root as it
+ *           arrives and ask the sender again for any that fail.
+ *           Never holds the full file in RAM.
  *
  * Supports both 1-to-1 and group file transfers.
  *
@@ -44,10 +52,15 @@ public:
     using SendFn = std::function<void(const std::string& peerIdB64u,
                                       const Bytes& env)>;
     /// Try to send a chunk over a P2P QUIC stream. Returns true on success.
+    /// `transferId` lets the transport keep each transfer on its own stream.
     using SendFileP2PFn = std::function<bool(const std::string& peerIdB64u,
+                                             const std::string& transferId,
                                              const Bytes& chunk)>;
 
     explicit FileTransferManager(CryptoEngine& crypto);
+    // Syncs + records the progress of in-flight incoming transfers, so a
+    // clean shutdown resumes without re-requesting anything.
+    ~FileTransferManager();
 
     void setSendFn(SendFn fn)              { m_sendFn = std::move(fn); }
     void setSealFn(SealFn fn)              { m_sealFn = std::move(fn); }
@@ -87,7 +100,9 @@ public:
                                const Bytes& fileHash,
                                const Bytes& fileKey,
                                const std::string& groupId = {},
-                               const std::string& groupName = {});
+                               const std::string& groupName = {},
+                               int64_t chunkBytes = kChunkBytes,
+                               std::shared_ptr<const TreeHash> tree = nullptr);
 
     /// Sender drops its record of a delivered transfer.
     void forgetSentTransfer(const std::string& transferId);
@@ -103,6 +118,28 @@ public:
     static constexpr int64_t kMaxFileBytes   = 100LL * 1024 * 1024;
     static constexpr int64_t kLargeFileBytes = 5LL * 1024 * 1024;
 
+    // Route-aware chunking.  kChunkBytes is sized for the relay's 256 KiB
+    // envelope bucket and stays the default.  When both peers hold a
+    // direct QUIC path, the file_key offers up to kMaxP2PChunkBytes and
+    // the receiver's file_accept echoes the size it picked; a transfer
+    // negotiated above kChunkBytes is P2P-only, because the relay can't
+    // carry its chunks.
+    static constexpr int64_t kMaxP2PChunkBytes = 4LL * 1024 * 1024;
+
+    static int chunkCountFor(int64_t fileSize, int64_t chunkBytes = kChunkBytes)
+    { return int((fileSize + chunkBytes - 1) / chunkBytes); }
+
+    static bool isValidChunkBytes(int64_t chunkBytes)
+    { return chunkBytes >= kChunkBytes && chunkBytes <= kMaxP2PChunkBytes; }
+
+    /// Receiver-side pick for a file_key offering `offeredMax`.  Returns
+    /// kChunkBytes unless the offer is above it, the receiver has a
+    /// direct path to the sender, and the file spans more than one
+    /// relay-sized chunk.  Always a whole number of TreeHash leaves, so
+    /// a chunk can be checked against a tree root on its own.
+    static int64_t negotiateChunkBytes(int64_t fileSize, int64_t offeredMax,
+                                       bool directPath);
+
     // Throttle for onFileChunkSent.  One callback per 4 chunks (~960 KB)
     // caps UI update rate to ~25 Hz on a 100 Mbps link — SwiftUI / Qt
     // can't redraw faster than a few times per second anyway, and the
@@ -125,6 +162,21 @@ public:
     static constexpr int64_t kSentTransferMaxAgeSecs     = 12LL * 60 * 60;
     static constexpr int64_t kPartialFileMaxAgeSecs      = 3LL * 24 * 60 * 60;
 
+    // Receiver durability batching.  Chunks are fdatasync'd and the
+    // bitmap row updated once per kProgressSyncChunks chunks or
+    // kProgressSyncMs, whichever comes first — not per chunk (a stalled
+    // transfer is caught by flushIncomingProgress()).  A crash loses at
+    // most that window, which pendingResumptions() re-requests.  The
+    // bitmap is stored as runs of received chunks, so each update is a
+    // few bytes rather than a bit per chunk.
+    static constexpr int     kProgressSyncChunks = 16;
+    static constexpr int64_t kProgressSyncMs     = 2000;
+
+    // Tree-hashed transfers: chunks that fail their range proof are
+    // re-requested; past this many the file is treated as changed or
+    // corrupt at the source and the transfer fails.
+    static constexpr int     kMaxCorruptChunks   = 8;
+
     /// Send a file to a single peer using a pre-derived per-file ratchet key.
     std::string sendFileWithKey(const std::string& senderIdB64u,
                                  const std::string& peerIdB64u,
@@ -147,12 +199,18 @@ public:
                            int64_t fileSize,
                            const Bytes& fileHash,
                            const std::string& groupId = {},
-                           const std::string& groupName = {});
+                           const std::string& groupName = {},
+                           int64_t offeredChunkBytes = kChunkBytes,
+                           std::shared_ptr<const TreeHash> tree = nullptr);
 
+    /// `chunkBytes` is the size the receiver's file_accept settled on.
+    /// Anything outside [kChunkBytes, offeredChunkBytes] abandons the
+    /// transfer, since the receiver has already locked its chunk count.
     bool startOutboundStream(const std::string& transferId,
                              bool requireP2P,
                              bool senderRequiresP2P,
-                             bool p2pReadyNow);
+                             bool p2pReadyNow,
+                             int64_t chunkBytes = kChunkBytes);
 
     std::vector<std::string> notifyP2PReady(const std::string& peerIdB64u);
 
@@ -161,10 +219,16 @@ public:
     void cancelInboundTransfer(const std::string& transferId);
 
     std::string outboundPeerFor(const std::string& transferId) const;
+    /// Peers with an outbound transfer waiting on file_accept or on P2P.
+    std::set<std::string> outboundPendingPeers() const;
+    /// Subset of those whose receiver has accepted (waiting on P2P).
+    std::set<std::string> outboundAcceptedPeers() const;
     std::string inboundPeerFor(const std::string& transferId) const;
 
     void purgeStaleOutbound();
 
+    /// `treeHash`: `fileHash` is a TreeHash root and every chunk must
+    /// carry a range proof against it.
     bool announceIncoming(const std::string& fromId,
                            const std::string& transferId,
                            const std::string& fileName,
@@ -174,7 +238,9 @@ public:
                            const Bytes& fileKey,
                            int64_t announcedTsSecs,
                            const std::string& groupId = {},
-                           const std::string& groupName = {});
+                           const std::string& groupName = {},
+                           int64_t chunkBytes = kChunkBytes,
+                           bool treeHash = false);
 
     bool handleFileEnvelope(const std::string& fromId,
                             const Bytes& payload,
@@ -183,12 +249,19 @@ public:
 
     void purgeStaleTransfers();
 
+    /// Sync any transfer whose unsynced chunks are older than
+    /// kProgressSyncMs — for transfers that stalled mid-window.
+    void flushIncomingProgress();
+
     /// One-shot BLAKE2b-256 of a byte buffer (used for small data).
     static Bytes blake2b256(const Bytes& data);
 
     /// Streaming BLAKE2b-256 of a file on disk. One pass, constant RAM.
     static Bytes blake2b256File(const std::string& filePath);
 
+    /// Same, over an open FileSource.  {} on a short read.
+    static Bytes blake2b256(FileSource& source);
+
     // ── Event callbacks — set from outside; fire on the main/event thread ──
     //
     // Callers assign directly:
@@ -207,10 +280,24 @@ public:
     std::function<void(const std::string& transferId,
                        const std::string& peerId)>     onOutboundAbandoned;
 
+    /// Fires when a sender-side pass over a transfer's chunks stops —
+    /// all dispatched, cancelled, or the direct path lost — so the
+    /// transport can release whatever it dedicated to the transfer.  A
+    /// later resendChunks() is a new pass and fires it again.
+    std::function<void(const std::string& peerId,
+                       const std::string& transferId)> onOutboundStreamEnded;
+
     /// Fires when an inbound transfer is canceled mid-stream.
     std::function<void(const std::string& transferId,
                        const std::string& peerId)>     onInboundCanceled;
 
+    /// A tree-hashed chunk failed its range proof and was dropped; the
+    /// owner asks the sender for it again (file_request), batching the
+    /// indices per transfer.
+    std::function<void(const std::string& fromPeerIdB64u,
+                       const std::string& transferId,
+                       uint32_t           chunkIndex)> onChunkRejected;
+
     /// Outbound blocked by P2P-only policy.
     std::function<void(const std::string& transferId,
                        const std::string& peerId,
@@ -265,17 +352,25 @@ private:
         std::string fileName;
         int64_t     fileSize    = 0;
         int         totalChunks = 0;
+        int64_t     chunkBytes  = kChunkBytes;
         int64_t     tsSecs      = 0;
-        Bytes       fileHash;           // BLAKE2b-256 of original plaintext
+        Bytes       fileHash;           // BLAKE2b-256 of original plaintext,
+                                        // or the TreeHash root when treeHash
+        bool        treeHash    = false;
+        int         corruptChunks = 0;  // failed range proofs so far
         std::string groupId;
         std::string groupName;
         int64_t     createdSecs = 0;
 
         std::string partialPath;        // <partialDir>/<transferId>.partial
         std::string finalPath;          // destination after rename on completion
-        std::unique_ptr<std::fstream> partialFile;
+        std::unique_ptr<PartialFile> partialFile;
         std::vector<bool> receivedChunks;  // bitmap, size == totalChunks
         int               chunksReceivedCount = 0;
+        // Chunks written since the last fdatasync + bitmap update.  Not
+        // yet in the persisted bitmap, so a crash re-requests them.
+        int               unsyncedChunks = 0;
+        int64_t           lastSyncMs     = 0;
 
         IncomingTransfer() = default;
         IncomingTransfer(const IncomingTransfer&) = delete;
@@ -300,16 +395,27 @@ private:
                             int64_t ts,
                             RoutingMode mode,
                             const std::string& groupId = {},
-                            const std::string& groupName = {});
+                            const std::string& groupName = {},
+                            int64_t chunkBytes = kChunkBytes,
+                            std::shared_ptr<const TreeHash> tree = nullptr);
+
+    // <4-byte metaLen><AEAD(meta)><AEAD(chunk)>, the chunk sealed straight
+    // from `chunk` (a FileSource view) into the payload.
+    Bytes sealChunkPayload(const Bytes& key32, const std::string& metaJson,
+                           const uint8_t* chunk, size_t chunkLen) const;
 
     bool dispatchChunk(const std::string& senderIdB64u,
                        const std::string& peerIdB64u,
+                       const std::string& transferId,
                        const Bytes& innerPayload,
                        RoutingMode mode);
 
     std::string partialPathFor(const std::string& transferId);
     std::string finalPathFor(const std::string& fileName, const std::string& transferId);
 
+    // Declared before m_incomingTransfers: a PartialFile's destructor
+    // waits on writes queued here, so the pool has to outlive it.
+    ChunkWriterPool m_writerPool;
     std::map<std::string, std::shared_ptr<IncomingTransfer>> m_incomingTransfers;
     static constexpr int kMaxConcurrentTransfers = 50;
 
@@ -328,6 +434,10 @@ private:
         std::string groupId;
         std::string groupName;
         int64_t     queuedSecs = 0;
+        int64_t     offeredChunkBytes = kChunkBytes;   // chunkMax in our file_key
+        int64_t     chunkBytes        = kChunkBytes;   // settled by file_accept
+        // Set when fileHash is its root; chunks carry range proofs.
+        std::shared_ptr<const TreeHash> tree;
 
         OutboundStage stage = OutboundStage::Queued;
         bool    receiverRequiresP2P = false;
@@ -361,6 +471,11 @@ private:
         std::string groupId;
         std::string groupName;
         int64_t     createdSecs = 0;
+        int64_t     chunkBytes  = kChunkBytes;
+        bool        treeHash    = false;    // fileHash is a TreeHash root
+        // Only the root is persisted; after a restart the tree is
+        // rebuilt from the file on the first resend.
+        std::shared_ptr<const TreeHash> tree;
     };
     std::map<std::string, SentTransfer> m_sentTransfers;
 
@@ -371,6 +486,12 @@ private:
     void persistIncomingFull(const std::string& transferId,
                               const IncomingTransfer& xfer,
                               const Bytes& fileKey) const;
+    // Bitmap-only update of an existing file_transfers_in row.
+    void persistIncomingProgress(const std::string& transferId,
+                                 const IncomingTransfer& xfer) const;
+    // fdatasync the partial file, then record its chunks as received.
+    // false on a write error.
+    bool syncIncoming(const std::string& transferId, IncomingTransfer& xfer);
     void deleteIncomingRow(const std::string& transferId) const;
     void deleteSentRow(const std::string& transferId) const;
 
@@ -0,0 +1,70 @@
+#include "FrameReassembler.hpp"
+
+#include <algorithm>
+
+static inline uint32_t read_u32_be(const uint8_t* src) {
+    return (static_cast<uint32_t>(src[0]) << 24) |
+           (static_cast<uint32_t>(src[1]) << 16) |
+           (static_cast<uint32_t>(src[2]) <<  8) |
+            static_cast<uint32_t>(src[3]);
+}
+
+bool FrameReassembler::feed(const uint8_t* data, size_t len, const FrameFn& onFrame)
+{
+    while (len > 0) {
+        if (!m_carry.empty()) {
+            // Finish the header of a frame that straddled the last feed.
+            if (m_carryNeed == 0) {
+                const size_t take = std::min(kHeaderSize - m_carry.size(), len);
+                m_carry.insert(m_carry.end(), data, data + take);
+                data += take;
+                len  -= take;
+                if (m_carry.size() < kHeaderSize) return true;
+
+                const uint32_t frameLen = read_u32_be(m_carry.data());
+                if (frameLen > m_maxFrame) { reset(); return false; }
+                m_carryNeed = kHeaderSize + frameLen;
+                m_carry.reserve(m_carryNeed);
+            }
+
+            const size_t take = std::min(m_carryNeed - m_carry.size(), len);
+            m_carry.insert(m_carry.end(), data, data + take);
+            data += take;
+            len  -= take;
+            if (m_carry.size() < m_carryNeed) return true;
+
+            if (onFrame) onFrame(m_carry.data() + kHeaderSize, m_carryNeed - kHeaderSize);
+            m_carry.clear();   // keeps capacity for the next straddler
+            m_carryNeed = 0;
+            continue;
+        }
+
+        // Fast path: parse frames in place while they fit in `data`.
+        if (len < kHeaderSize) {
+            m_carry.assign(data, data + len);
+            return true;
+        }
+        const uint32_t frameLen = read_u32_be(data);
+        if (frameLen > m_maxFrame) { reset(); return false; }
+
+        const size_t total = kHeaderSize + frameLen;
+        if (len >= total) {
+            if (onFrame) onFrame(data + kHeaderSize, frameLen);
+            data += total;
+            len  -= total;
+            continue;
+        }
+
+        m_carryNeed = total;
+        m_carry.reserve(total);
+        m_carry.assign(data, data + len);
+        return true;
+    }
+    return true;
+}
+
+void FrameReassembler::reset()
+{
+    m_carry.clear();
+    m_carryNeed = 0;
+}
@@ -0,0 +1,49 @@
+#pragma once
+
+#include "types.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+
+/*
+ * FrameReassembler — splits a byte stream into [4-byte BE length][payload]
+ * frames, the framing QuicConnection puts on its QUIC streams.
+ *
+ * Receive buffers are only borrowed: a frame that lies wholly inside the
+ * buffer passed to feed() is handed to the callback as a view into that
+ * buffer, with no copy.  Only a frame that straddles two feed() calls is
+ * copied, into a carry buffer sized for it once when its header arrives.
+ * The carry buffer is reused across frames and is never shifted, so a
+ * burst of N frames costs O(N) regardless of how the transport slices it.
+ *
+ * The view passed to the callback is valid only for the duration of the
+ * call; callers that keep the bytes copy them.
+ *
+ * Not thread-safe.  One instance per stream, fed from that stream's
+ * receive callback.
+ */
+class FrameReassembler {
+public:
+    using FrameFn = std::function<void(const uint8_t* data, size_t len)>;
+
+    static constexpr size_t kHeaderSize = 4;
+
+    explicit FrameReassembler(uint32_t maxFrame) : m_maxFrame(maxFrame) {}
+
+    // Consume one receive buffer, invoking `onFrame` for every frame it
+    // completes.  Returns false if a header announced a frame larger than
+    // maxFrame; the partial state and the rest of `data` are discarded.
+    bool feed(const uint8_t* data, size_t len, const FrameFn& onFrame);
+
+    // Drop any partially received frame.
+    void reset();
+
+    // Bytes of the straddling frame received so far (header included).
+    size_t pending() const { return m_carry.size(); }
+
+private:
+    uint32_t m_maxFrame;
+    Bytes    m_carry;          // header + body of the frame that straddles feeds
+    size_t   m_carryNeed = 0;  // total bytes that frame needs; 0 = header incomplete
+};
@@ -27,6 +27,16 @@ std::string GroupProtocol::myId() const
     return CryptoEngine::toBase64Url(m_crypto.identityPub());
 }
 
+std::vector<GroupProtocol::Bytes> GroupProtocol::fanOut(const SealedBatch& batch)
+{
+    if (m_sendSealedBatch) return m_sendSealedBatch(batch);
+
+    std::vector<Bytes> out;
+    out.reserve(batch.size());
+    for (const auto& item : batch) out.push_back(m_sendSealed(item.first, item.second));
+    return out;
+}
+
 // ── Outbound actions ──────────────────────────────────────────────────────
 
 void GroupProtocol::sendText(const std::string& groupId,
@@ -45,16 +55,34 @@ void GroupProtocol::sendText(const std::string& groupId,
     // compromise would still read every group's full member list and
     // display name out of the plaintext outer envelope.  Outer now
     // carries only routing-critical fields.
-    json membersArray = json::array();
+    //
+    // One ciphertext serves every recipient, so the roster rides along
+    // whenever ANY of them hasn't seen this version yet (or can't read
+    // a hash-only message); otherwise the hash alone keeps the payload
+    // constant-size.
+    const Bytes rosterVer = noteOutboundRoster(groupId, groupName, memberPeerIds);
+    bool rosterDue = false;
     for (const std::string& key : memberPeerIds) {
-        if (trimmed(key) == me) continue;
-        membersArray.push_back(key);
+        const std::string peerId = trimmed(key);
+        if (!peerId.empty() && peerId != me
+            && rosterDueFor(groupId, peerId, rosterVer)) {
+            rosterDue = true;
+            break;
+        }
     }
 
     json plaintext = json::object();
-    plaintext["text"]      = text;
-    plaintext["groupName"] = groupName;
-    plaintext["members"]   = membersArray;
+    plaintext["text"]   = text;
+    plaintext["roster"] = CryptoEngine::toBase64Url(rosterVer);
+    if (rosterDue) {
+        json membersArray = json::array();
+        for (const std::string& key : memberPeerIds) {
+            if (trimmed(key) == me) continue;
+            membersArray.push_back(key);
+        }
+        plaintext["groupName"] = groupName;
+        plaintext["members"]   = membersArray;
+    }
     GroupCiphertext enc = encryptForGroup(
         "group_msg", groupId, memberPeerIds, plaintext);
     if (enc.ciphertextB64.empty()) return;
@@ -62,21 +90,27 @@ void GroupProtocol::sendText(const std::string& groupId,
     const int64_t     ts    = nowSecs();
     const std::string msgId = p2p::makeUuid();
 
+    json payload = json::object();
+    payload["from"]       = me;
+    payload["type"]       = "group_msg";
+    payload["groupId"]    = groupId;
+    payload["skey_epoch"] = enc.epoch;
+    payload["skey_idx"]   = enc.idx;
+    payload["ciphertext"] = enc.ciphertextB64;
+    payload["ts"]         = ts;
+    payload["msgId"]      = msgId;
+
+    SealedBatch batch;
     for (const std::string& peerIdRaw : memberPeerIds) {
         const std::string peerId = trimmed(peerIdRaw);
         if (peerId.empty() || peerId == me) continue;
-
-        json payload = json::object();
-        payload["from"]       = me;
-        payload["type"]       = "group_msg";
-        payload["groupId"]    = groupId;
-        payload["skey_epoch"] = enc.epoch;
-        payload["skey_idx"]   = enc.idx;
-        payload["ciphertext"] = enc.ciphertextB64;
-        payload["ts"]         = ts;
-        payload["msgId"]      = msgId;
-
-        m_sendSealed(peerId, payload);
+        batch.emplace_back(peerId, payload);
+    }
+    const std::vector<Bytes> sealed = fanOut(batch);
+    if (rosterDue) {
+        // Only recipients the envelope actually went to have the roster.
+        for (size_t i = 0; i < batch.size() && i < sealed.size(); ++i)
+            if (!sealed[i].empty()) m_rosterSent[{groupId, batch[i].first}] = rosterVer;
     }
 }
 
@@ -84,11 +118,12 @@ void GroupProtocol::sendText(const std::string& groupId,
 //
 // Replaces the SenderChain encryption layer with a per-(recipient,
 // group, session_id) monotonic counter + prev_hash chain.  After
-// every successful seal, the sealed bytes are cached in
-// group_replay_cache so a later gap_request can replay them
-// byte-identical, and group_send_state is bumped so the next send
-// continues the chain.  See core/CausallyLinkedPairwise.hpp for the
-// full wire-format spec.
+// every successful seal, the replay cache learns enough to answer a
+// later gap_request — the recipient-independent payload once plus a
+// chain-link ref per recipient that reads re-sealed replays, the
+// whole sealed envelope for anyone else — and group_send_state is
+// bumped so the next send continues the chain.  See
+// core/CausallyLinkedPairwise.hpp for the full wire-format spec.
 
 void GroupProtocol::sendTextV2(const std::string& groupId,
                                  const std::string& groupName,
@@ -110,11 +145,15 @@ void GroupProtocol::sendTextV2(const std::string& groupId,
     const std::string me = myId();
 
     // Member roster excluding self — same shape as legacy sendText.
+    // Only sent to recipients that haven't had this roster version;
+    // everyone else gets the 16-byte hash.
     nlohmann::json membersArray = nlohmann::json::array();
     for (const std::string& key : memberPeerIds) {
         if (trimmed(key) == me) continue;
         membersArray.push_back(key);
     }
+    const Bytes rosterVer = noteOutboundRoster(groupId, groupName, memberPeerIds);
+    const std::string rosterB64 = CryptoEngine::toBase64Url(rosterVer);
 
     const int64_t     ts    = nowSecs();
     const std::string msgId = p2p::makeUuid();
@@ -130,6 +169,43 @@ void GroupProtocol::sendTextV2(const std::string& groupId,
     const Bytes bundleId   = m_appData->ensureBundleIdForGroup(groupId);
     const std::string bundleB64 = CryptoEngine::toBase64Url(bundleId);
 
+    // Build every recipient's payload first so the fan-out can be
+    // sealed as one batch (one shared signature where peers support
+    // it), then advance each chain on its own result.  Send states
+    // come from one query and go back in one transaction.
+    auto sendStates = m_appData->loadSendStates(groupId);
+    if (auto it = m_unsavedSendStates.find(groupId); it != m_unsavedSendStates.end()) {
+        for (const auto& [key, st] : it->second)
+            sendStates[key] = { st.nextCounter, st.lastHash };
+    }
+    struct Pending {
+        std::string            peerId;
+        Bytes                  sessionId;
+        AppDataStore::SendState st;
+        bool                   rosterDue = false;
+    };
+
+    // Everything every recipient gets.  Field names match the spec.
+    // Phase 2.0 transition: emit BOTH `bundle` (new wire id) and
+    // `groupId` (legacy, still consulted by pv=2 receivers that
+    // haven't learned this group's bundle yet).  Phase 2.1 drops
+    // `groupId` from the wire entirely.  This is also the payload the
+    // replay cache keeps once for the whole fan-out.
+    nlohmann::json shared = nlohmann::json::object();
+    shared["pv"]      = 2;
+    shared["from"]    = me;
+    shared["type"]    = "group_msg";
+    shared["bundle"]  = bundleB64;
+    shared["groupId"] = groupId;
+    shared["roster"]  = rosterB64;
+    shared["text"]    = text;
+    shared["ts"]      = ts;
+    shared["msgId"]   = msgId;
+    shared[kReplayLevelField] = kReplayLevel;
+
+    std::vector<Pending> pending;
+    SealedBatch batch;
+
     for (const std::string& peerIdRaw : memberPeerIds) {
         const std::string peerId = trimmed(peerIdRaw);
         if (peerId.empty() || peerId == me) continue;
@@ -145,47 +221,44 @@ void GroupProtocol::sendTextV2(const std::string& groupId,
             continue;
         }
 
-        // Pull current chain state (counter + last_hash).  Missing row
-        // returns the default — counter=1, empty lastHash for the
-        // first message of the session.
+        // Current chain state (counter + last_hash).  Missing row is
+        // the default — counter=1, empty lastHash for the first
+        // message of the session.
         AppDataStore::SendState st;
-        m_appData->loadSendState(peerId, groupId, sessionId, st);
-
-        // Build the v2 inner payload.  Field names match the spec.
-        nlohmann::json payload = nlohmann::json::object();
-        payload["pv"]        = 2;
-        payload["from"]      = me;
-        payload["type"]      = "group_msg";
-        // Phase 2.0 transition: emit BOTH `bundle` (new wire id) and
-        // `groupId` (legacy, still consulted by pv=2 receivers that
-        // haven't learned this group's bundle yet).  Phase 2.1 drops
-        // `groupId` from the wire entirely.
-        payload["bundle"]    = bundleB64;
-        payload["groupId"]   = groupId;
-        payload["groupName"] = groupName;
-        payload["members"]   = membersArray;
+        if (auto it = sendStates.find({peerId, sessionId}); it != sendStates.end())
+            st = std::move(it->second);
+
+        // Per-recipient half of the v2 inner payload.
+        nlohmann::json payload = shared;
+        const bool rosterDue = rosterDueFor(groupId, peerId, rosterVer);
+        if (rosterDue) {
+            payload["groupName"] = groupName;
+            payload["members"]   = membersArray;
+        }
         payload["session"]   = CryptoEngine::toBase64Url(sessionId);
         payload["ctr"]       = st.nextCounter;
         payload["prev"]      = CryptoEngine::toBase64Url(st.lastHash);
-        payload["text"]      = text;
-        payload["ts"]        = ts;
-        payload["msgId"]     = msgId;
 
-        // Hand to ChatController to seal + dispatch.  Returns the
-        // sealed envelope bytes (or empty on seal failure).
-        const Bytes sealedEnv = m_sendSealed(peerId, payload);
+        batch.emplace_back(peerId, std::move(payload));
+        pending.push_back({peerId, sessionId, std::move(st), rosterDue});
+    }
+
+    // Hand to ChatController to seal + dispatch.  Returns the sealed
+    // envelope bytes per recipient (empty on seal failure).
+    const std::vector<Bytes> sealed = fanOut(batch);
+
+    std::vector<AppDataStore::GroupSendRecord> records;
+    records.reserve(pending.size());
+    for (size_t i = 0; i < pending.size(); ++i) {
+        Pending& p = pending[i];
+        const Bytes& sealedEnv = sealed[i];
         if (sealedEnv.empty()) {
             // Don't advance the chain — the relay never saw this
             // counter, so the next attempt should reuse it.  Replay
             // cache stays untouched.
             continue;
         }
-
-        // Cache the sealed bytes for future gap_request replay.
-        // Wrapped form (with relay routing header) — that's what the
-        // relay client expects to forward byte-identically.
-        m_appData->addReplayCacheEntry(peerId, groupId, sessionId,
-                                         st.nextCounter, sealedEnv, ts);
+        if (p.rosterDue) m_rosterSent[{groupId, p.peerId}] = rosterVer;
 
         // Compute the prev_hash for the next send: BLAKE2b-128 of the
         // INNER sealed envelope (post-routing-strip).  Receiver-side
@@ -199,12 +272,90 @@ void GroupProtocol::sendTextV2(const std::string& groupId,
                             innerForHash.data(), innerForHash.size(),
                             nullptr, 0);
 
-        // Advance and persist.  After the bump, the next send will
-        // pick up counter+1 + this hash as its prev.
-        st.nextCounter += 1;
-        st.lastHash     = std::move(nextHash);
-        m_appData->saveSendState(peerId, groupId, sessionId, st);
+        // Remember enough for a future gap_request and advance: the
+        // next send picks up counter+1 + this hash as its prev.  A
+        // recipient that reads re-sealed replays only needs the chain
+        // links (the shared payload is stored once); anyone else gets
+        // the sealed bytes cached in wrapped form (with relay routing
+        // header), which is what the relay client forwards
+        // byte-identically.
+        AppDataStore::GroupSendRecord rec;
+        rec.peerId           = p.peerId;
+        rec.sessionId        = p.sessionId;
+        rec.counter          = p.st.nextCounter;
+        if (!peerReadsResealedReplay(p.peerId))
+            rec.sealedEnvelope = sealedEnv;
+        rec.prevHash         = p.st.lastHash;
+        rec.next.nextCounter = p.st.nextCounter + 1;
+        rec.next.lastHash    = std::move(nextHash);
+        records.push_back(std::move(rec));
     }
+
+    // One transaction for the whole fan-out.  The envelopes may already
+    // be on their way (a SendBatch only holds them at privacy level 0),
+    // so a failed write must not hand these counters out again: keep
+    // the advanced states in memory until a later commit persists them.
+    // The replay cache misses this send, so gap requests for it go
+    // unanswered.
+    if (m_appData->commitGroupSend(groupId, records, ts, msgId, shared.dump())) {
+        if (auto it = m_unsavedSendStates.find(groupId); it != m_unsavedSendStates.end()) {
+            for (const auto& rec : records) it->second.erase({rec.peerId, rec.sessionId});
+            if (it->second.empty()) m_unsavedSendStates.erase(it);
+        }
+    } else {
+        P2P_WARN("[GroupProto v2] failed to persist send state for "
+                 << p2p::peerPrefix(groupId) << "... ("
+                 << records.size() << " recipients) — continuing in memory");
+        auto& unsaved = m_unsavedSendStates[groupId];
+        for (const auto& rec : records)
+            unsaved[{rec.peerId, rec.sessionId}] = { rec.next.nextCounter, rec.next.lastHash };
+    }
+}
+
+// ── Adaptive mode ───────────────────────────────────────────────────────────
+
+GroupProtocol::SendMode GroupProtocol::sendModeFor(const std::string& gid) const
+{
+    auto it = m_sendModes.find(gid);
+    return it != m_sendModes.end() ? it->second : SendMode::Pairwise;
+}
+
+void GroupProtocol::sendTextAuto(const std::string& groupId,
+                                   const std::string& groupName,
+                                   const std::vector<std::string>& memberPeerIds,
+                                   const std::string& text)
+{
+    if (groupId.empty()) return;
+
+    std::set<std::string> roster;
+    roster.insert(myId());
+    for (const std::string& key : memberPeerIds) {
+        const std::string t = trimmed(key);
+        if (!t.empty()) roster.insert(t);
+    }
+    const size_t size = roster.size();
+
+    auto it = m_sendModes.find(groupId);
+    const bool known = it != m_sendModes.end();
+    SendMode mode = size >= m_senderChainThreshold ? SendMode::SenderChain
+                                                   : SendMode::Pairwise;
+    if (known && it->second == SendMode::SenderChain
+        && size >= m_senderChainThreshold / 2)
+        mode = SendMode::SenderChain;
+
+    if (known && it->second != mode) {
+        P2P_LOG("[GroupProto] " << p2p::peerPrefix(groupId) << "... switching to "
+                << (mode == SendMode::SenderChain ? "sender-chain" : "pairwise")
+                << " at " << size << " members");
+        if (mode == SendMode::SenderChain)
+            rotateMyChain(groupId, memberPeerIds);
+    }
+    m_sendModes[groupId] = mode;
+
+    if (mode == SendMode::SenderChain)
+        sendText(groupId, groupName, memberPeerIds, text);
+    else
+        sendTextV2(groupId, groupName, memberPeerIds, text);
 }
 
 // ── gap_request: receiver asks sender for missed counters ──────────────────
@@ -236,6 +387,7 @@ void GroupProtocol::sendGapRequest(const std::string& targetPeerId,
     payload["to_ctr"]   = toCtr;
     payload["ts"]       = nowSecs();
     payload["msgId"]    = p2p::makeUuid();
+    payload[kReplayLevelField] = kReplayLevel;
 
     // Discard the sealed-bytes return value — we don't need to chain
     // the gap_request itself (it's a control message, not part of the
@@ -249,27 +401,51 @@ void GroupProtocol::handleGapRequest(const std::string& requestorPeerId,
                                        int64_t fromCtr,
                                        int64_t toCtr)
 {
-    if (!m_appData || !m_replayRelay) {
-        P2P_WARN("[GroupProto v2] handleGapRequest: missing AppDataStore "
-                  "or replay-relay callback; ignoring request");
+    if (!m_appData) {
+        P2P_WARN("[GroupProto v2] handleGapRequest: missing AppDataStore; "
+                  "ignoring request");
         return;
     }
     if (requestorPeerId.empty() || groupId.empty() || sessionId.empty()) return;
     if (toCtr < fromCtr || fromCtr < 1) return;
 
-    // Load every cached envelope in [fromCtr, toCtr] (counter-ascending
-    // order) and re-dispatch raw to the relay.  Missing rows (cache TTL
-    // expired, or no such counter ever cached) are silently skipped —
-    // the requestor's retry timer eventually surfaces the unfilled gap
-    // as "K messages lost during reconnection" UI.
+    // Deduplicated rows: rebuild the original payload from the shared
+    // half plus this recipient's chain links and re-seal it through
+    // the live session.  "eh" carries the hash of the envelope that
+    // originally went out, so the requestor's prev_hash chain continues
+    // from the bytes it never saw.  Counters come back ascending, same
+    // as the full-envelope path below; missing rows (evicted, TTL
+    // expired, or never cached) are silently skipped — the requestor's
+    // retry timer eventually surfaces the unfilled gap as "K messages
+    // lost during reconnection" UI.
     int replayed = 0;
-    m_appData->loadReplayCacheRange(
-        requestorPeerId, groupId, sessionId, fromCtr, toCtr,
-        [&](int64_t /*ctr*/, const Bytes& sealed) {
-            if (sealed.empty()) return;
-            m_replayRelay(sealed);
-            ++replayed;
-        });
+    std::set<int64_t> served;
+    if (m_sendSealed) {
+        m_appData->loadReplayRefRange(
+            requestorPeerId, groupId, sessionId, fromCtr, toCtr,
+            [&](const AppDataStore::ReplayRef& ref) {
+                nlohmann::json payload = nlohmann::json::parse(ref.payload, nullptr, false);
+                if (!payload.is_object()) return;
+                payload["session"] = CryptoEngine::toBase64Url(sessionId);
+                payload["ctr"]     = ref.counter;
+                payload["prev"]    = CryptoEngine::toBase64Url(ref.prevHash);
+                payload["eh"]      = CryptoEngine::toBase64Url(ref.envHash);
+                if (m_sendSealed(requestorPeerId, payload).empty()) return;
+                served.insert(ref.counter);
+                ++replayed;
+            });
+    }
+
+    // Full-envelope rows: re-dispatch raw to the relay.
+    if (m_replayRelay) {
+        m_appData->loadReplayCacheRange(
+            requestorPeerId, groupId, sessionId, fromCtr, toCtr,
+            [&](int64_t ctr, const Bytes& sealed) {
+                if (sealed.empty() || served.count(ctr)) return;
+                m_replayRelay(sealed);
+                ++replayed;
+            });
+    }
 
     P2P_LOG("[GroupProto v2] handleGapRequest replayed " << replayed
               << " envelope(s) to " << p2p::peerPrefix(requestorPeerId)
@@ -277,6 +453,30 @@ void GroupProtocol::handleGapRequest(const std::string& requestorPeerId,
               << " range [" << fromCtr << "," << toCtr << "]");
 }
 
+void GroupProtocol::notePeerReplayLevel(const std::string& peerId, int level)
+{
+    if (peerId.empty()) return;
+    if (level >= kReplayLevel) m_peersReadingResealedReplay.insert(peerId);
+    else                       m_peersReadingResealedReplay.erase(peerId);
+}
+
+bool GroupProtocol::peerReadsResealedReplay(const std::string& peerId) const
+{
+    return m_peersReadingResealedReplay.count(peerId) > 0;
+}
+
+void GroupProtocol::notePeerRosterHash(const std::string& peerId, int version)
+{
+    if (peerId.empty()) return;
+    if (version >= kRosterHashVersion) m_peersReadingRosterHash.insert(peerId);
+    else                               m_peersReadingRosterHash.erase(peerId);
+}
+
+bool GroupProtocol::peerReadsRosterHash(const std::string& peerId) const
+{
+    return m_peersReadingRosterHash.count(peerId) > 0;
+}
+
 // ── pv=2 receiver state machine ─────────────────────────────────────────────
 //
 // State per (group, sender):
@@ -302,7 +502,8 @@ GroupProtocol::ReceiveResult GroupProtocol::dispatchGroupMessageV2(
     const std::string& senderName,
     int64_t ts,
     const std::string& msgId,
-    const Bytes& sealedEnvelope)
+    const Bytes& sealedEnvelope,
+    const Bytes& chainHash)
 {
     ReceiveResult r;
     r.status = ReceiveStatus::Dropped;
@@ -317,14 +518,19 @@ GroupProtocol::ReceiveResult GroupProtocol::dispatchGroupMessageV2(
 
     AppDataStore::ChainState st;
     const bool hadState = m_appData->loadChainState(
-        groupId, senderPeerId, st);
+        groupId, senderPeerId, st, sessionId);
 
     // 16B BLAKE2b of the sealed envelope — becomes our lastHash on
-    // accept, and the next message's expected prev_hash.
+    // accept, and the next message's expected prev_hash.  A re-sealed
+    // replay names the hash of the envelope it stands in for.
     Bytes thisHash(16);
-    crypto_generichash(thisHash.data(), thisHash.size(),
-                        sealedEnvelope.data(), sealedEnvelope.size(),
-                        nullptr, 0);
+    if (chainHash.size() == thisHash.size()) {
+        thisHash = chainHash;
+    } else {
+        crypto_generichash(thisHash.data(), thisHash.size(),
+                            sealedEnvelope.data(), sealedEnvelope.size(),
+                            nullptr, 0);
+    }
 
     // ── Session reset detection ────────────────────────────────────
     bool sessionChanged = false;
@@ -365,7 +571,9 @@ GroupProtocol::ReceiveResult GroupProtocol::dispatchGroupMessageV2(
         // counter (still expectedNext); gapTo grows as later out-of-
         // order rows arrive.
         if (!st.blockedSince) {
-            st.blockedSince = ts;
+            // ts is the sender's; 0 means "not blocked" here, so a
+            // sender stamping 0 must not leave the buffer undrained.
+            st.blockedSince = std::max<int64_t>(ts, 1);
             st.gapFrom      = st.expectedNext;
         }
         st.gapTo = std::max<int64_t>(st.gapTo, counter - 1);
@@ -408,8 +616,11 @@ GroupProtocol::ReceiveResult GroupProtocol::dispatchGroupMessageV2(
     // Each iteration: look up the row at expectedNext, verify its
     // prev_hash against our just-updated lastHash, deliver, advance.
     // sealedEnvHash from the buffered row becomes the new lastHash so
-    // the chain can extend transitively.
-    while (true) {
+    // the chain can extend transitively.  Rows are only ever buffered
+    // while the stream is blocked, and blocked only clears once the
+    // buffer is empty — so an unblocked stream (the steady state) has
+    // nothing to drain and skips the lookup.
+    while (st.blockedSince) {
         std::vector<AppDataStore::BufferedMessage> next;
         m_appData->loadBufferRange(groupId, senderPeerId, sessionId,
                                     st.expectedNext, st.expectedNext,
@@ -513,22 +724,23 @@ void GroupProtocol::sendLeave(const std::string& groupId,
     const int64_t     ts    = nowSecs();
     const std::string msgId = p2p::makeUuid();
 
+    json payload = json::object();
+    payload["from"]       = me;
+    payload["type"]       = "group_leave";
+    payload["groupId"]    = groupId;
+    payload["skey_epoch"] = enc.epoch;
+    payload["skey_idx"]   = enc.idx;
+    payload["ciphertext"] = enc.ciphertextB64;
+    payload["ts"]         = ts;
+    payload["msgId"]      = msgId;
+
+    SealedBatch batch;
     for (const std::string& peerIdRaw : memberPeerIds) {
         const std::string peerId = trimmed(peerIdRaw);
         if (peerId.empty() || peerId == me) continue;
-
-        json payload = json::object();
-        payload["from"]       = me;
-        payload["type"]       = "group_leave";
-        payload["groupId"]    = groupId;
-        payload["skey_epoch"] = enc.epoch;
-        payload["skey_idx"]   = enc.idx;
-        payload["ciphertext"] = enc.ciphertextB64;
-        payload["ts"]         = ts;
-        payload["msgId"]      = msgId;
-
-        m_sendSealed(peerId, payload);
+        batch.emplace_back(peerId, payload);
     }
+    fanOut(batch);
 }
 
 void GroupProtocol::sendRename(const std::string& groupId,
@@ -540,6 +752,7 @@ void GroupProtocol::sendRename(const std::string& groupId,
 
     const std::string me       = myId();
     const json        plaintext = { {"newName", newName} };
+    setGroupName(groupId, newName);
 
     GroupCiphertext enc = encryptForGroup(
         "group_rename", groupId, memberKeys, plaintext);
@@ -558,11 +771,13 @@ void GroupProtocol::sendRename(const std::string& groupId,
     payload["msgId"]      = msgId;
     payload["ts"]         = ts;
 
+    SealedBatch batch;
     for (const std::string& peerIdRaw : memberKeys) {
         const std::string peerId = trimmed(peerIdRaw);
         if (peerId.empty() || peerId == me) continue;
-        m_sendSealed(peerId, payload);
+        batch.emplace_back(peerId, payload);
     }
+    fanOut(batch);
 }
 
 void GroupProtocol::sendAvatar(const std::string& groupId,
@@ -592,11 +807,13 @@ void GroupProtocol::sendAvatar(const std::string& groupId,
     payload["msgId"]      = msgId;
     payload["ts"]         = ts;
 
+    SealedBatch batch;
     for (const std::string& peerIdRaw : memberKeys) {
         const std::string peerId = trimmed(peerIdRaw);
         if (peerId.empty() || peerId == me) continue;
-        m_sendSealed(peerId, payload);
+        batch.emplace_back(peerId, payload);
     }
+    fanOut(batch);
 }
 
 void GroupProtocol::sendMemberUpdate(const std::string& groupId,
@@ -686,30 +903,282 @@ void GroupProtocol::sendMemberUpdate(const std::string& groupId,
     // just lazy-created (or, for add-only, the one announced to new
     // members moments before).  Plaintext envelope carries only
     // routing-critical fields.
+    const Bytes rosterVer = noteOutboundRoster(groupId, groupName, memberKeys);
+
     json plaintext = json::object();
     plaintext["groupName"] = groupName;
     plaintext["members"]   = membersArray;
+    plaintext["roster"]    = CryptoEngine::toBase64Url(rosterVer);
 
     GroupCiphertext enc = encryptForGroup(
         "group_member_update", groupId, memberKeys, plaintext);
     if (enc.ciphertextB64.empty()) return;
 
+    json payload = json::object();
+    payload["from"]       = me;
+    payload["type"]       = "group_member_update";
+    payload["groupId"]    = groupId;
+    payload["skey_epoch"] = enc.epoch;
+    payload["skey_idx"]   = enc.idx;
+    payload["ciphertext"] = enc.ciphertextB64;
+    payload["msgId"]      = msgId;
+    payload["ts"]         = nowSecs();
+
+    SealedBatch batch;
     for (const std::string& peerIdRaw : memberKeys) {
         const std::string peerId = trimmed(peerIdRaw);
         if (peerId.empty() || peerId == me) continue;
+        batch.emplace_back(peerId, payload);
+    }
+    const std::vector<Bytes> sealed = fanOut(batch);
+    for (size_t i = 0; i < batch.size() && i < sealed.size(); ++i)
+        if (!sealed[i].empty()) m_rosterSent[{groupId, batch[i].first}] = rosterVer;
+}
 
-        json payload = json::object();
-        payload["from"]       = me;
-        payload["type"]       = "group_member_update";
-        payload["groupId"]    = groupId;
-        payload["skey_epoch"] = enc.epoch;
-        payload["skey_idx"]   = enc.idx;
-        payload["ciphertext"] = enc.ciphertextB64;
-        payload["msgId"]      = msgId;
-        payload["ts"]         = nowSecs();
+// ── Roster versioning ─────────────────────────────────────────────────────
+
+GroupProtocol::Bytes GroupProtocol::rosterHash(
+    const std::string& groupName, const std::vector<std::string>& members)
+{
+    std::set<std::string> sorted;
+    for (const std::string& m : members) {
+        std::string t = trimmed(m);
+        if (!t.empty()) sorted.insert(std::move(t));
+    }
+
+    // name || 0x00 || (id || '\n')*  — ids are base64url, so neither
+    // separator can occur inside one.
+    crypto_generichash_state st;
+    crypto_generichash_init(&st, nullptr, 0, 16);
+    crypto_generichash_update(
+        &st, reinterpret_cast<const uint8_t*>(groupName.data()), groupName.size());
+    const uint8_t nul = 0x00, nl = '\n';
+    crypto_generichash_update(&st, &nul, 1);
+    for (const std::string& id : sorted) {
+        crypto_generichash_update(
+            &st, reinterpret_cast<const uint8_t*>(id.data()), id.size());
+        crypto_generichash_update(&st, &nl, 1);
+    }
+    Bytes out(16);
+    crypto_generichash_final(&st, out.data(), out.size());
+    return out;
+}
+
+GroupProtocol::Bytes GroupProtocol::noteOutboundRoster(
+    const std::string& gid,
+    const std::string& groupName,
+    const std::vector<std::string>& memberPeerIds)
+{
+    const std::string me = myId();
+    OutboundRoster& r = m_outboundRoster[gid];
+    r.groupName = groupName;
+    r.members.clear();
+    bool sawMe = false;
+    for (const std::string& k : memberPeerIds) {
+        std::string t = trimmed(k);
+        if (t.empty()) continue;
+        if (t == me) sawMe = true;
+        r.members.push_back(std::move(t));
+    }
+    if (!sawMe) r.members.push_back(me);
+    r.hash = rosterHash(groupName, r.members);
+    setGroupName(gid, groupName);
+    return r.hash;
+}
+
+bool GroupProtocol::rosterDueFor(const std::string& gid,
+                                  const std::string& peerId,
+                                  const Bytes& hash) const
+{
+    if (!peerReadsRosterHash(peerId)) return true;
+    auto it = m_rosterSent.find({gid, peerId});
+    return it == m_rosterSent.end() || it->second != hash;
+}
+
+std::string GroupProtocol::groupName(const std::string& gid) const
+{
+    auto it = m_groupNames.find(gid);
+    if (it != m_groupNames.end()) return it->second;
+    if (m_appData) {
+        AppDataStore::Conversation c;
+        if (m_appData->loadConversation(gid, c)) return c.groupName;
+    }
+    return {};
+}
+
+void GroupProtocol::setGroupName(const std::string& gid, const std::string& name)
+{
+    if (gid.empty() || name.empty()) return;
+    m_groupNames[gid] = name;
+}
 
-        m_sendSealed(peerId, payload);
+GroupProtocol::InboundRoster GroupProtocol::resolveInboundRoster(
+    const std::string& gid,
+    const std::string& senderId,
+    const json& payload)
+{
+    InboundRoster r;
+    const std::string rosterB64 = payload.value("roster", std::string());
+    const Bytes advertised = rosterB64.empty()
+        ? Bytes{} : CryptoEngine::fromBase64Url(rosterB64);
+
+    // Full roster on the wire — legacy senders, or the first message of
+    // a new roster version.  Remember which version it was so later
+    // hash-only messages at that version count as in sync.
+    if (payload.contains("members") && payload["members"].is_array()) {
+        for (const auto& v : payload["members"])
+            if (v.is_string()) r.members.push_back(v.get<std::string>());
+        r.groupName = payload.value("groupName", std::string());
+        r.full      = true;
+        setGroupName(gid, r.groupName);
+        if (!advertised.empty()) {
+            m_rosterSynced[{gid, senderId}] = advertised;
+            m_rosterRequests.erase({gid, senderId});
+        }
+        return r;
+    }
+
+    // Hash only: hand up our own view (minus the sender, matching the
+    // group_msg member convention).
+    r.groupName = groupName(gid);
+    const std::string me = myId();
+    std::vector<std::string> full;
+    auto mit = m_members.find(gid);
+    if (mit != m_members.end()) {
+        for (const std::string& p : mit->second) {
+            full.push_back(p);
+            if (p != senderId) r.members.push_back(p);
+        }
+    }
+    if (mit == m_members.end() || mit->second.count(me) == 0) {
+        full.push_back(me);
+        r.members.push_back(me);
     }
+    full.push_back(senderId);
+
+    if (advertised.empty()) return r;  // pre-versioning payload, no hash
+
+    auto sit = m_rosterSynced.find({gid, senderId});
+    if ((sit != m_rosterSynced.end() && sit->second == advertised)
+        || rosterHash(r.groupName, full) == advertised) {
+        return r;
+    }
+
+    r.inSync = false;
+    const int64_t now = nowSecs();
+    RosterRequest& req = m_rosterRequests[{gid, senderId}];
+    if (req.hash != advertised || now - req.sentAt >= kRosterRequestRetrySecs) {
+        req.hash   = advertised;
+        req.sentAt = now;
+        sendRosterRequest(senderId, gid, advertised);
+    }
+    return r;
+}
+
+void GroupProtocol::sendRosterRequest(const std::string& targetPeerId,
+                                       const std::string& gid,
+                                       const Bytes& wanted)
+{
+    if (!m_sendSealed) return;
+
+    json payload = json::object();
+    payload["type"]    = "group_roster_request";
+    payload["from"]    = myId();
+    payload["groupId"] = gid;
+    if (m_appData) {
+        const Bytes bid = m_appData->bundleIdForGroup(gid);
+        if (!bid.empty()) payload["bundle"] = CryptoEngine::toBase64Url(bid);
+    }
+    payload["roster"]  = CryptoEngine::toBase64Url(wanted);
+    payload["ts"]      = nowSecs();
+    payload["msgId"]   = p2p::makeUuid();
+
+    P2P_LOG("[GroupProto] roster out of sync with "
+            << p2p::peerPrefix(targetPeerId) << " for " << p2p::peerPrefix(gid)
+            << " — requesting");
+    m_sendSealed(targetPeerId, payload);
+}
+
+void GroupProtocol::handleRosterRequest(const std::string& requestorPeerId,
+                                         const std::string& gid)
+{
+    if (!m_sendSealed || requestorPeerId.empty() || gid.empty()) return;
+
+    // Answer with what we announce; fall back to the authorization
+    // roster for groups we've only received in.
+    OutboundRoster roster;
+    auto oit = m_outboundRoster.find(gid);
+    if (oit != m_outboundRoster.end()) {
+        roster = oit->second;
+    } else {
+        auto mit = m_members.find(gid);
+        if (mit == m_members.end()) return;
+        roster.groupName = groupName(gid);
+        roster.members.assign(mit->second.begin(), mit->second.end());
+        roster.members.push_back(myId());
+        roster.hash = rosterHash(roster.groupName, roster.members);
+    }
+    if (std::find(roster.members.begin(), roster.members.end(), requestorPeerId)
+        == roster.members.end()) {
+        P2P_WARN("[GroupProto] ignoring roster request from non-member "
+                 << p2p::peerPrefix(requestorPeerId));
+        return;
+    }
+
+    const std::string me = myId();
+    json membersArray = json::array();
+    for (const std::string& m : roster.members)
+        if (m != me) membersArray.push_back(m);
+
+    json payload = json::object();
+    payload["type"]      = "group_roster";
+    payload["from"]      = me;
+    payload["groupId"]   = gid;
+    if (m_appData) {
+        const Bytes bid = m_appData->bundleIdForGroup(gid);
+        if (!bid.empty()) payload["bundle"] = CryptoEngine::toBase64Url(bid);
+    }
+    payload["groupName"] = roster.groupName;
+    payload["members"]   = membersArray;
+    payload["roster"]    = CryptoEngine::toBase64Url(roster.hash);
+    payload["ts"]        = nowSecs();
+    payload["msgId"]     = p2p::makeUuid();
+
+    if (!m_sendSealed(requestorPeerId, payload).empty())
+        m_rosterSent[{gid, requestorPeerId}] = roster.hash;
+}
+
+bool GroupProtocol::applyRosterResponse(const std::string& senderId,
+                                         const std::string& gid,
+                                         const json& payload,
+                                         InboundRoster& out)
+{
+    // Unsolicited rosters are dropped: the only way a peer gets to
+    // reshape our view outside group_member_update is by answering us.
+    if (m_rosterRequests.find({gid, senderId}) == m_rosterRequests.end()) {
+        P2P_WARN("[GroupProto] dropping unsolicited group_roster from "
+                 << p2p::peerPrefix(senderId));
+        return false;
+    }
+    if (!payload.contains("members") || !payload["members"].is_array())
+        return false;
+
+    InboundRoster r = resolveInboundRoster(gid, senderId, payload);
+    if (!payload.contains("roster")) {
+        std::vector<std::string> full = r.members;
+        full.push_back(senderId);
+        m_rosterSynced[{gid, senderId}] = rosterHash(r.groupName, full);
+    }
+    m_rosterRequests.erase({gid, senderId});
+
+    // The responder vouches for itself by answering, so a group we
+    // had no roster for bootstraps with them in it.
+    std::vector<std::string> withSender = r.members;
+    withSender.push_back(senderId);
+    upsertMembersFromTrustedMessage(gid, senderId, withSender);
+
+    out = std::move(r);
+    return true;
 }
 
 // ── Roster ────────────────────────────────────────────────────────────────
@@ -1221,6 +1690,7 @@ void GroupProtocol::sendSkeyAnnounce(const std::string& gid,
     const std::string me = myId();
     const int64_t     ts = nowSecs();
 
+    SealedBatch batch;
     for (const std::string& peerIdRaw : recipients) {
         const std::string peerId = trimmed(peerIdRaw);
         if (peerId.empty() || peerId == me) continue;
@@ -1238,6 +1708,7 @@ void GroupProtocol::sendSkeyAnnounce(const std::string& gid,
         payload["ts"]      = ts;
         payload["msgId"]   = p2p::makeUuid();
 
-        m_sendSealed(peerId, payload);
+        batch.emplace_back(peerId, std::move(payload));
     }
+    fanOut(batch);
 }
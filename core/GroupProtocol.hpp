@@ -23,8 +23,12 @@ class AppDataStore;
  *
  * Fan-out is client-side: groups exist only in the clients (the relay
  * is memberless).  Each `send*` method wraps a payload and hands it to
- * a `SendSealedFn` callback for every group member; the callback
- * routes it through SessionSealer + RelayClient.
+ * a `SendSealedFn` callback for every group member (or the whole
+ * batch to `SendSealedBatchFn` when wired); the callback routes it
+ * through SessionSealer + RelayClient.  ChatController wraps each
+ * fan-out in a RelayClient::SendBatch, so at privacy level 0 the N
+ * envelopes leave as one /v1/send-batch request per relay; they are
+ * signed once where the members read multi-recipient envelopes.
  *
  * Roster authorization: inbound group control messages (rename /
  * avatar / leave / member_update) must check `isAuthorizedSender`
@@ -58,6 +62,13 @@ public:
     using SendSealedFn = std::function<Bytes(const std::string& peerId,
                                               const nlohmann::json& payload)>;
 
+    /// One fan-out's worth of (peerId, payload) pairs, sealed together
+    /// so the sender signs once for the whole batch (see
+    /// SessionSealer::sealForPeers).  Returns the sealed envelopes in
+    /// input order, empty where sealing failed.
+    using SealedBatch       = std::vector<std::pair<std::string, nlohmann::json>>;
+    using SendSealedBatchFn = std::function<std::vector<Bytes>(const SealedBatch&)>;
+
     /// Re-dispatch a pre-sealed envelope (no re-encryption).  Used by
     /// the gap_request handler to replay byte-identical sealed bytes
     /// from group_replay_cache when a peer asks for messages they
@@ -72,6 +83,10 @@ public:
     // to sendSealedPayload (seal + relay send).
     void setSendSealedFn(SendSealedFn fn) { m_sendSealed = std::move(fn); }
 
+    // Optional batch route for multi-recipient fan-outs.  Unset, every
+    // fan-out falls back to one SendSealedFn call per recipient.
+    void setSendSealedBatchFn(SendSealedBatchFn fn) { m_sendSealedBatch = std::move(fn); }
+
     /// Wire the per-user app data store so the v2 sender can persist
     /// its monotonic counter (group_send_state) and cache sealed
     /// envelopes for gap_request replay (group_replay_cache).  Required
@@ -88,6 +103,28 @@ public:
     /// handleGapRequest can do anything (logs + no-ops otherwise).
     void setReplayRelayFn(ReplayRelayFn fn) { m_replayRelay = std::move(fn); }
 
+    /// Replay form this build reads: 1 = a gap replay may arrive
+    /// re-sealed, carrying the original envelope's chain hash as "eh".
+    /// Advertised as "grv" on pv=2 group_msg and gap_request payloads.
+    static constexpr int         kReplayLevel      = 1;
+    static constexpr const char* kReplayLevelField = "grv";
+
+    /// Record the replay level a peer advertised.  Recipients at
+    /// kReplayLevel get deduplicated replay-cache rows (one shared
+    /// payload per message, re-sealed on request); everyone else keeps
+    /// byte-identical envelopes.
+    void notePeerReplayLevel(const std::string& peerId, int level);
+    bool peerReadsResealedReplay(const std::string& peerId) const;
+
+    /// Roster form this build reads: 1 = a group_msg may carry only the
+    /// roster hash.  ChatController stamps it into every outbound
+    /// payload as "rhv".  Older receivers replace their roster with
+    /// whatever list a group_msg carries, so peers that haven't
+    /// advertised it get the full roster on every message.
+    static constexpr int kRosterHashVersion = 1;
+    void notePeerRosterHash(const std::string& peerId, int version);
+    bool peerReadsRosterHash(const std::string& peerId) const;
+
     // ── Outbound actions ──────────────────────────────────────────────
     void sendText(const std::string& groupId, const std::string& groupName,
                   const std::vector<std::string>& memberPeerIds,
@@ -107,6 +144,36 @@ public:
                      const std::vector<std::string>& memberPeerIds,
                      const std::string& text);
 
+    /// How a group's text messages go out.  Pairwise = sendTextV2
+    /// (per-member ratchet payload + replay cache + send-state row);
+    /// SenderChain = sendText (one sender-chain ciphertext fanned out,
+    /// seed distributed over the pairwise sessions).
+    enum class SendMode { Pairwise, SenderChain };
+
+    /// Members (self included) at which a group switches to SenderChain.
+    /// Below it the pairwise path's per-member cost is small and buys
+    /// gap recovery; above it that cost dominates every send.
+    static constexpr size_t kDefaultSenderChainThreshold = 32;
+    void   setSenderChainThreshold(size_t members) { m_senderChainThreshold = members; }
+    size_t senderChainThreshold() const            { return m_senderChainThreshold; }
+
+    /// Mode the last sendTextAuto used for `gid` (Pairwise if none yet).
+    SendMode sendModeFor(const std::string& gid) const;
+
+    /// Adaptive group text: picks sendTextV2 or sendText by roster size.
+    /// A group enters SenderChain at the threshold and only drops back
+    /// to Pairwise below half of it, so a group hovering at the line
+    /// doesn't flip on every join / leave.  Entering SenderChain opens a
+    /// new epoch (rotateMyChain) so the seed in use has reached exactly
+    /// the current roster — the chain may have sat idle through adds
+    /// while the group ran pairwise.  Leaving needs no boundary: pv=2
+    /// messages never touch the chain.  In-memory: after a restart the
+    /// first send picks by size and keeps any restored chain.
+    void sendTextAuto(const std::string& groupId,
+                      const std::string& groupName,
+                      const std::vector<std::string>& memberPeerIds,
+                      const std::string& text);
+
     // ── Receive side (pv=2) ───────────────────────────────────────────
 
     /// One message ready to surface to the application — either the
@@ -160,16 +227,18 @@ public:
                          int64_t fromCtr,
                          int64_t toCtr);
 
-    /// Handle an incoming gap_request from `requestorPeerId`.  Loads
-    /// each cached sealed envelope in [fromCtr, toCtr] from
-    /// group_replay_cache and re-dispatches via the raw replay-relay
-    /// callback (no re-seal).  Missing rows (cache TTL expired, or
-    /// no such counter) are silently skipped — the requestor's UI
-    /// surfaces the unfilled gap as a "lost messages" event after
-    /// its own retry timeout.
+    /// Handle an incoming gap_request from `requestorPeerId`.  Counters
+    /// in [fromCtr, toCtr] cached in deduplicated form are rebuilt
+    /// from the shared payload and re-sealed through the send callback
+    /// with the original chain hash attached; counters cached as full
+    /// envelopes go out byte-identical via the raw replay-relay
+    /// callback.  Missing rows (evicted, TTL expired, or no such
+    /// counter) are silently skipped — the requestor's UI surfaces the
+    /// unfilled gap as a "lost messages" event after its own retry
+    /// timeout.
     ///
-    /// Requires setAppDataStore() AND setReplayRelayFn() to have been
-    /// called; otherwise logs a warn and does nothing.
+    /// Requires setAppDataStore(); otherwise logs a warn and does
+    /// nothing.
     void handleGapRequest(const std::string& requestorPeerId,
                             const std::string& groupId,
                             const Bytes& sessionId,
@@ -179,8 +248,10 @@ public:
     /// Run the pv=2 receiver state machine for one decrypted group_msg.
     /// `sealedEnvelope` is the OUTER sealed bytes — needed for the
     /// prev_hash chain (we hash these bytes as the lastHash for the
-    /// next received message).  All other params are the parsed
-    /// fields from the inner payload.
+    /// next received message).  A re-sealed gap replay instead passes
+    /// the original envelope's hash it carried as `chainHash`, which
+    /// then stands in for the hash of `sealedEnvelope`.  All other
+    /// params are the parsed fields from the inner payload.
     ///
     /// Returns a struct describing what the application should do:
     ///   - deliver any messages in `result.deliver` (in counter order)
@@ -200,7 +271,8 @@ public:
         const std::string& senderName,
         int64_t ts,
         const std::string& msgId,
-        const Bytes& sealedEnvelope);
+        const Bytes& sealedEnvelope,
+        const Bytes& chainHash = {});
 
     void sendLeave(const std::string& groupId, const std::string& groupName,
                    const std::vector<std::string>& memberPeerIds);
@@ -214,6 +286,61 @@ public:
     void sendMemberUpdate(const std::string& groupId, const std::string& groupName,
                           const std::vector<std::string>& memberKeys);
 
+    // ── Roster versioning ─────────────────────────────────────────────
+    //
+    // group_msg carries a 16-byte roster hash ("roster") instead of the
+    // group name + member list.  The full roster rides along only on the
+    // first message to each recipient after it changes (and always on
+    // group_member_update); a receiver whose local view hashes
+    // differently asks the sender with group_roster_request and gets a
+    // group_roster back on the 1:1 path.
+
+    // BLAKE2b-128 over the group name and the sorted, de-duplicated,
+    // trimmed member ids.  `members` must be the FULL roster (sender
+    // and every recipient) — both ends hash the same set.
+    static Bytes rosterHash(const std::string& groupName,
+                            const std::vector<std::string>& members);
+
+    // Roster facts the inbound dispatcher hands to the application.
+    // `members` follows the group_msg convention: everyone except the
+    // sender.  `full` is true when the payload carried the list itself
+    // (callers may persist it); otherwise it is our local view.
+    struct InboundRoster {
+        std::string              groupName;
+        std::vector<std::string> members;
+        bool                     full   = false;
+        bool                     inSync = true;
+    };
+
+    // Resolve the roster for one decrypted group payload (the pv=2 inner
+    // object, or the v1 / member_update sender-chain plaintext).  When
+    // the payload carries only a hash that doesn't match our view, fires
+    // a group_roster_request to `senderId` — at most once per advertised
+    // hash per kRosterRequestRetrySecs.
+    InboundRoster resolveInboundRoster(const std::string& gid,
+                                       const std::string& senderId,
+                                       const nlohmann::json& payload);
+
+    // Answer a group_roster_request with the roster we last sent for
+    // `gid`.  Ignored unless `requestorPeerId` is in that roster.
+    void handleRosterRequest(const std::string& requestorPeerId,
+                             const std::string& gid);
+
+    // Apply a group_roster answer.  Only accepted from a peer we have an
+    // outstanding request to; returns false (and `out` untouched)
+    // otherwise.
+    bool applyRosterResponse(const std::string& senderId,
+                             const std::string& gid,
+                             const nlohmann::json& payload,
+                             InboundRoster& out);
+
+    // Display name we know for a group: the last one sent or received,
+    // else the persisted conversation name.  Empty when unknown.
+    std::string groupName(const std::string& gid) const;
+    void setGroupName(const std::string& gid, const std::string& name);
+
+    static constexpr int64_t kRosterRequestRetrySecs = 30;
+
     // ── Roster authorization ──────────────────────────────────────────
     void setKnownMembers(const std::string& groupId,
                          const std::vector<std::string>& members);
@@ -402,9 +529,50 @@ private:
                             const Bytes& seed,
                             const std::vector<std::string>& recipients);
 
+    // Record the roster this client is announcing for `gid` (what
+    // handleRosterRequest answers with) and return its hash.
+    Bytes noteOutboundRoster(const std::string& gid,
+                             const std::string& groupName,
+                             const std::vector<std::string>& memberPeerIds);
+
+    // True when `peerId` hasn't been handed roster version `hash` yet,
+    // or can't read a hash-only group_msg at all.
+    bool rosterDueFor(const std::string& gid, const std::string& peerId,
+                      const Bytes& hash) const;
+
+    void sendRosterRequest(const std::string& targetPeerId,
+                           const std::string& gid,
+                           const Bytes& wanted);
+
+    // Seal + dispatch a fan-out through m_sendSealedBatch, or through
+    // m_sendSealed per recipient when no batch route is wired.
+    std::vector<Bytes> fanOut(const SealedBatch& batch);
+
     CryptoEngine& m_crypto;
     SendSealedFn  m_sendSealed;
 
+    // sendTextAuto state — see its comment.
+    size_t                          m_senderChainThreshold = kDefaultSenderChainThreshold;
+    std::map<std::string, SendMode> m_sendModes;
+    SendSealedBatchFn m_sendSealedBatch;
+
+    // Peers that advertised kReplayLevel — see notePeerReplayLevel.
+    std::set<std::string> m_peersReadingResealedReplay;
+    // v2 send states whose commitGroupSend failed, gid -> (peer,
+    // session) -> state.  Those envelopes may already be out, so later
+    // sends continue from here until a commit for that recipient lands.
+    // (Mirrors AppDataStore::SendState, which is only forward-declared here.)
+    struct UnsavedSendState {
+        int64_t nextCounter = 1;
+        Bytes   lastHash;
+    };
+    std::map<std::string,
+             std::map<std::pair<std::string, Bytes>, UnsavedSendState>>
+        m_unsavedSendStates;
+    // Peers that advertised kRosterHashVersion.  In memory only: after a
+    // restart everyone gets the full roster until they send again.
+    std::set<std::string> m_peersReadingRosterHash;
+
     // Per-group outbound monotonic counter + per-(group,sender) last-
     // seen inbound seq.  Not consumed by the current `group_msg` path
     // (skey_idx supplies the same guarantee inside each SenderChain);
@@ -418,6 +586,28 @@ private:
     // isAuthorizedSender for control-message authorization.
     std::map<std::string, std::set<std::string>> m_members;
 
+    // ── Roster versioning state (in memory; a restart costs one full
+    // roster per recipient, or one request per sender) ──────────────
+    struct OutboundRoster {
+        std::string              groupName;
+        std::vector<std::string> members;  // full roster, self included
+        Bytes                    hash;
+    };
+    struct RosterRequest {
+        Bytes   hash;
+        int64_t sentAt = 0;
+    };
+    using GroupPeer = std::pair<std::string, std::string>;  // (gid, peerId)
+
+    std::map<std::string, OutboundRoster> m_outboundRoster;  // gid ->
+    std::map<std::string, std::string>    m_groupNames;      // gid -> name
+    // Roster hash each recipient last received from us in full.
+    std::map<GroupPeer, Bytes>            m_rosterSent;
+    // Roster hash each sender last gave us in full — a later message
+    // advertising it is in sync even when our merge-only view differs.
+    std::map<GroupPeer, Bytes>            m_rosterSynced;
+    std::map<GroupPeer, RosterRequest>    m_rosterRequests;
+
     // ── Sender-chain state ───────────────────────────────────────────
 
     struct OutboundGroupState {
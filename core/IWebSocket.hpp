@@ -42,6 +42,13 @@ public:
     /// Send a UTF-8 text frame (used for auth and presence JSON messages).
     virtual void sendTextMessage(const std::string& message) = 0;
 
+    /// Send a binary frame (used by RelayClient's optional WS send path).
+    /// Returns false if this transport can't send binary frames at all —
+    /// e.g. a C-API platform that didn't wire ws_send_binary — so the
+    /// caller can fall back to HTTP.  A true return only means the frame
+    /// was handed to the platform, not that it reached the relay.
+    virtual bool sendBinaryMessage(const Bytes& data) = 0;
+
     // ── Callbacks (set by RelayClient before open()) ────────────────────────
 
     /// Called when the WebSocket connection is established.
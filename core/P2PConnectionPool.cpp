@@ -0,0 +1,167 @@
+#include "P2PConnectionPool.hpp"
+
+#include <algorithm>
+
+std::vector<std::string> P2PConnectionPool::admit(const std::string& peerIdB64u,
+                                                  int64_t nowMs,
+                                                  const PinnedFn& pinned,
+                                                  bool warmup)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    Entry& e = m_entries[peerIdB64u];
+    e = Entry{};
+    e.createdMs  = nowMs;
+    e.lastUsedMs = nowMs;
+    ++m_stats.setups;
+    if (warmup) ++m_stats.warmups;
+
+    std::vector<std::string> victims;
+    while (m_entries.size() - victims.size() > m_limits.maxConnections) {
+        const std::string* lru = nullptr;
+        int64_t lruUsed = 0;
+        for (const auto& [peer, entry] : m_entries) {
+            if (peer == peerIdB64u) continue;
+            if (std::find(victims.begin(), victims.end(), peer) != victims.end()) continue;
+            if (pinned && pinned(peer)) continue;
+            if (!lru || entry.lastUsedMs < lruUsed) {
+                lru     = &peer;
+                lruUsed = entry.lastUsedMs;
+            }
+        }
+        if (!lru) break;   // everything else is pinned — run over the cap
+        victims.push_back(*lru);
+    }
+    for (const std::string& peer : victims) m_entries.erase(peer);
+    m_stats.evictedLru += victims.size();
+    return victims;
+}
+
+bool P2PConnectionPool::contains(const std::string& peerIdB64u) const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_entries.count(peerIdB64u) != 0;
+}
+
+size_t P2PConnectionPool::size() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_entries.size();
+}
+
+void P2PConnectionPool::noteReady(const std::string& peerIdB64u, int64_t nowMs)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_redials.erase(peerIdB64u);
+    auto it = m_entries.find(peerIdB64u);
+    if (it == m_entries.end() || it->second.readyMs != 0) return;
+
+    Entry& e = it->second;
+    e.readyMs    = std::max<int64_t>(nowMs, 1);
+    e.lastUsedMs = nowMs;
+    const uint64_t setupMs = uint64_t(std::max<int64_t>(0, nowMs - e.createdMs));
+    ++m_stats.setupsReady;
+    m_stats.setupMsTotal += setupMs;
+    m_stats.setupMsMax    = std::max(m_stats.setupMsMax, setupMs);
+}
+
+void P2PConnectionPool::noteUse(const std::string& peerIdB64u, int64_t nowMs, bool hit)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (hit) ++m_stats.reuseHits;
+    else     ++m_stats.reuseMisses;
+    auto it = m_entries.find(peerIdB64u);
+    if (it != m_entries.end()) it->second.lastUsedMs = nowMs;
+}
+
+void P2PConnectionPool::noteActivity(const std::string& peerIdB64u, int64_t nowMs)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    auto it = m_entries.find(peerIdB64u);
+    if (it != m_entries.end()) it->second.lastUsedMs = nowMs;
+}
+
+void P2PConnectionPool::remove(const std::string& peerIdB64u)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_entries.erase(peerIdB64u);
+}
+
+bool P2PConnectionPool::claimRedial(const std::string& peerIdB64u, int64_t nowMs)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    Redial& r = m_redials[peerIdB64u];
+    if (r.attempts > 0 && nowMs < r.nextMs) {
+        ++m_stats.redialsDeferred;
+        return false;
+    }
+    const int shift = std::min(r.attempts, 20);
+    const int64_t backoffSecs = std::min(m_limits.redialBackoffSecs << shift,
+                                         m_limits.redialBackoffMaxSecs);
+    ++r.attempts;
+    r.nextMs = nowMs + backoffSecs * 1000;
+    return true;
+}
+
+P2PConnectionPool::Sweep P2PConnectionPool::sweep(int64_t nowMs,
+                                                  const ReadyFn& isReady,
+                                                  const PinnedFn& pinned)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    Sweep out;
+
+    const int64_t graceMs     = m_limits.setupGraceSecs * 1000;
+    const int64_t keepAliveMs = m_limits.keepAliveWindowSecs * 1000;
+    const int64_t idleMs      = m_limits.idleEvictSecs * 1000;
+
+    for (auto it = m_entries.begin(); it != m_entries.end();) {
+        const std::string& peer = it->first;
+        Entry& e = it->second;
+        const bool ready    = isReady && isReady(peer);
+        const bool isPinned = pinned && pinned(peer);
+        const int64_t idle  = nowMs - e.lastUsedMs;
+
+        bool evict = false;
+        if (!ready && e.readyMs == 0) {
+            if (nowMs - e.createdMs >= graceMs) { evict = true; ++m_stats.evictedStale; }
+        } else if (!ready) {
+            evict = true; ++m_stats.evictedDead;
+        } else if (!isPinned && idle >= idleMs) {
+            evict = true; ++m_stats.evictedIdle;
+        }
+
+        if (evict) {
+            out.evict.push_back(peer);
+            it = m_entries.erase(it);
+            continue;
+        }
+
+        if (ready) {
+            // Ready without a noteReady (raw-ICE fallback reports late):
+            // remember it so a later drop counts as dead, not stale.
+            if (e.readyMs == 0) e.readyMs = std::max<int64_t>(nowMs, 1);
+
+            const bool want = isPinned || idle < keepAliveMs;
+            if (want != e.keepAlive) {
+                e.keepAlive = want;
+                (want ? out.keepAliveOn : out.keepAliveOff).push_back(peer);
+            }
+        }
+        ++it;
+    }
+
+    // Backoff nobody has claimed for a full max step: the peer stopped
+    // being dialed, so forget it rather than keep it forever.
+    const int64_t forgetMs = m_limits.redialBackoffMaxSecs * 1000;
+    for (auto it = m_redials.begin(); it != m_redials.end();) {
+        if (nowMs - it->second.nextMs >= forgetMs) it = m_redials.erase(it);
+        else ++it;
+    }
+    return out;
+}
+
+P2PConnectionPool::Stats P2PConnectionPool::stats() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_stats;
+}
@@ -0,0 +1,131 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <string>
+#include <vector>
+
+/*
+ * P2PConnectionPool — lifecycle policy + metrics for ChatController's
+ * per-peer direct connections.
+ *
+ * The pool doesn't own connections (QuicConnection lives in the desktop
+ * target, which core can't link); ChatController owns them and reports
+ * events here, then acts on what admit() and sweep() return:
+ *
+ *   - Bounded: admitting a connection past maxConnections evicts the
+ *     least-recently-used one.  Pinned peers (outbound files queued to
+ *     them) are never picked.
+ *   - Stale:   a connection that hasn't reached ready within
+ *     setupGraceSecs is evicted.
+ *   - Dead:    a connection that was ready and no longer is (QUIC idle
+ *     timeout, peer shutdown) is evicted so the next send re-dials
+ *     instead of finding a corpse in the map.
+ *   - Idle:    a ready connection unused for idleEvictSecs is closed,
+ *     unless pinned.
+ *   - Keepalive: ready connections used within keepAliveWindowSecs, or
+ *     pinned, get transport keepalive so they outlive the QUIC idle
+ *     timeout; sweep() reports only the on/off transitions.
+ *   - Redial:  background re-dials (the sweep's warm-up for pinned
+ *     peers) go through claimRedial(), which backs off per peer from
+ *     redialBackoffSecs, doubling up to redialBackoffMaxSecs, until the
+ *     peer reaches ready.  A peer that can't be reached is dialed a
+ *     handful of times an hour, not on every sweep.
+ *
+ * Setup latency (admit → ready) and reuse hits/misses (did a send find
+ * a ready connection?) are counted in Stats.
+ *
+ * Times are caller-supplied milliseconds on a monotonic clock.  Thread-
+ * safe: ready/activity events arrive on the ICE / msquic threads while
+ * sweeps run on the maintenance timer.
+ */
+class P2PConnectionPool {
+public:
+    struct Limits {
+        size_t  maxConnections      = 32;
+        int64_t setupGraceSecs      = 120;
+        int64_t keepAliveWindowSecs = 5 * 60;
+        int64_t idleEvictSecs       = 10 * 60;
+        int64_t redialBackoffSecs    = 30;
+        int64_t redialBackoffMaxSecs = 15 * 60;
+    };
+
+    struct Stats {
+        uint64_t setups          = 0;   // connections admitted
+        uint64_t setupsReady     = 0;   // ... that reached ready
+        uint64_t setupMsTotal    = 0;   // sum of admit → ready latency
+        uint64_t setupMsMax      = 0;
+        uint64_t reuseHits       = 0;   // send found a ready connection
+        uint64_t reuseMisses     = 0;   // send fell back to the relay
+        uint64_t warmups         = 0;   // setups started ahead of any send
+        uint64_t evictedStale    = 0;
+        uint64_t evictedDead     = 0;
+        uint64_t evictedIdle     = 0;
+        uint64_t evictedLru      = 0;
+        uint64_t redialsDeferred = 0;   // claimRedial() said not yet
+
+        uint64_t averageSetupMs() const
+        { return setupsReady ? setupMsTotal / setupsReady : 0; }
+    };
+
+    struct Sweep {
+        std::vector<std::string> evict;
+        std::vector<std::string> keepAliveOn;
+        std::vector<std::string> keepAliveOff;
+    };
+
+    using PinnedFn = std::function<bool(const std::string& peerIdB64u)>;
+    using ReadyFn  = std::function<bool(const std::string& peerIdB64u)>;
+
+    P2PConnectionPool() = default;
+    explicit P2PConnectionPool(const Limits& limits) : m_limits(limits) {}
+
+    // Register a new connection.  Returns peers the caller must close to
+    // stay within maxConnections (never `peerIdB64u` or a pinned peer).
+    // `warmup` marks a setup started ahead of any send.
+    std::vector<std::string> admit(const std::string& peerIdB64u, int64_t nowMs,
+                                   const PinnedFn& pinned = {}, bool warmup = false);
+
+    bool contains(const std::string& peerIdB64u) const;
+    size_t size() const;
+
+    void noteReady(const std::string& peerIdB64u, int64_t nowMs);
+    // A send looked for a ready connection; `hit` says whether it found one.
+    void noteUse(const std::string& peerIdB64u, int64_t nowMs, bool hit);
+    // Inbound traffic keeps a connection as warm as outbound does.
+    void noteActivity(const std::string& peerIdB64u, int64_t nowMs);
+    void remove(const std::string& peerIdB64u);
+
+    // True when a background re-dial to `peerIdB64u` may start now, and
+    // books the next backoff step.  Reaching ready resets the backoff.
+    bool claimRedial(const std::string& peerIdB64u, int64_t nowMs);
+
+    // Decide evictions and keepalive transitions.  `isReady` is the
+    // connection's live state; evicted peers are dropped from the pool.
+    Sweep sweep(int64_t nowMs, const ReadyFn& isReady, const PinnedFn& pinned = {});
+
+    Stats stats() const;
+    const Limits& limits() const { return m_limits; }
+
+private:
+    struct Entry {
+        int64_t createdMs  = 0;
+        int64_t readyMs    = 0;    // 0 until first ready
+        int64_t lastUsedMs = 0;
+        bool    keepAlive  = false;
+    };
+
+    struct Redial {
+        int     attempts = 0;
+        int64_t nextMs   = 0;
+    };
+
+    Limits                        m_limits;
+    mutable std::mutex            m_mutex;
+    std::map<std::string, Entry>  m_entries;
+    std::map<std::string, Redial> m_redials;
+    Stats                         m_stats;
+};
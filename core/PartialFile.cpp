@@ -0,0 +1,316 @@
+#include "PartialFile.hpp"
+
+#include <algorithm>
+#include <cerrno>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+// ── ChunkWriterPool ──────────────────────────────────────────────────────────
+
+ChunkWriterPool::ChunkWriterPool(size_t threads, size_t maxQueuedBytes)
+    : m_threadCount(std::max<size_t>(1, threads))
+    , m_maxQueuedBytes(maxQueuedBytes)
+{}
+
+ChunkWriterPool::~ChunkWriterPool()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stop = true;
+    }
+    m_cv.notify_all();
+    for (auto& t : m_threads) t.join();
+}
+
+void ChunkWriterPool::submit(std::function<void()> job, size_t bytes)
+{
+    std::unique_lock<std::mutex> lock(m_mutex);
+    if (m_threads.empty()) {
+        for (size_t i = 0; i < m_threadCount; ++i)
+            m_threads.emplace_back([this] { run(); });
+    }
+    m_spaceCv.wait(lock, [&] {
+        return m_jobs.empty() || m_queuedBytes + bytes <= m_maxQueuedBytes;
+    });
+    m_jobs.push_back({std::move(job), bytes});
+    m_queuedBytes += bytes;
+    lock.unlock();
+    m_cv.notify_one();
+}
+
+void ChunkWriterPool::run()
+{
+    for (;;) {
+        Job job;
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_cv.wait(lock, [this] { return m_stop || !m_jobs.empty(); });
+            if (m_jobs.empty()) return;   // stopping, queue drained
+            job = std::move(m_jobs.front());
+            m_jobs.pop_front();
+            m_queuedBytes -= job.bytes;
+        }
+        m_spaceCv.notify_all();
+        job.fn();
+    }
+}
+
+// ── PartialFile ──────────────────────────────────────────────────────────────
+
+std::unique_ptr<PartialFile> PartialFile::create(const std::string& path,
+                                                 int64_t fileSize,
+                                                 int64_t chunkBytes,
+                                                 ChunkWriterPool* pool,
+                                                 bool sequentialHash)
+{
+    if (fileSize <= 0 || chunkBytes <= 0) return nullptr;
+    std::unique_ptr<PartialFile> f(new PartialFile());
+    f->m_size        = fileSize;
+    f->m_chunkBytes  = chunkBytes;
+    f->m_totalChunks = int((fileSize + chunkBytes - 1) / chunkBytes);
+    f->m_pool        = pool;
+    f->m_written.assign(size_t(f->m_totalChunks), false);
+    crypto_generichash_init(&f->m_hash, nullptr, 0, 32);
+    f->m_hashDone    = !sequentialHash;
+
+    if (!f->openFile(path, /*truncate=*/true) || !f->preallocate()) return nullptr;
+    return f;
+}
+
+std::unique_ptr<PartialFile> PartialFile::reopen(const std::string& path,
+                                                 int64_t fileSize,
+                                                 int64_t chunkBytes,
+                                                 const std::vector<bool>& received,
+                                                 ChunkWriterPool* pool,
+                                                 bool sequentialHash)
+{
+    if (fileSize <= 0 || chunkBytes <= 0) return nullptr;
+    std::unique_ptr<PartialFile> f(new PartialFile());
+    f->m_size        = fileSize;
+    f->m_chunkBytes  = chunkBytes;
+    f->m_totalChunks = int((fileSize + chunkBytes - 1) / chunkBytes);
+    f->m_pool        = pool;
+    f->m_written.assign(size_t(f->m_totalChunks), false);
+    for (size_t i = 0; i < received.size() && i < f->m_written.size(); ++i)
+        f->m_written[i] = received[i];
+    crypto_generichash_init(&f->m_hash, nullptr, 0, 32);
+    f->m_hashDone    = !sequentialHash;
+
+    // Partial files written before preallocation are shorter than the
+    // transfer; preallocate() extends them.
+    if (!f->openFile(path, /*truncate=*/false) || !f->preallocate()) return nullptr;
+    return f;
+}
+
+PartialFile::~PartialFile()
+{
+    close();
+}
+
+bool PartialFile::openFile(const std::string& path, bool truncate)
+{
+    m_path = path;
+#ifndef _WIN32
+    const int flags = O_RDWR | O_CLOEXEC | (truncate ? (O_CREAT | O_TRUNC) : 0);
+    m_fd = ::open(path.c_str(), flags, 0600);
+    return m_fd >= 0;
+#else
+    auto mode = std::ios::in | std::ios::out | std::ios::binary;
+    if (truncate) mode |= std::ios::trunc;
+    m_stream.open(path, mode);
+    return m_stream.is_open();
+#endif
+}
+
+bool PartialFile::preallocate()
+{
+#ifndef _WIN32
+    struct stat st {};
+    if (::fstat(m_fd, &st) != 0) return false;
+    if (int64_t(st.st_size) >= m_size) return true;
+#if defined(__linux__)
+    // Reserve the blocks up front; filesystems without fallocate (tmpfs
+    // on old kernels, some FUSE mounts) fall through to a sparse extend.
+    if (::fallocate(m_fd, 0, 0, off_t(m_size)) == 0) return true;
+#endif
+    return ::ftruncate(m_fd, off_t(m_size)) == 0;
+#else
+    m_stream.seekp(std::streamoff(m_size - 1));
+    m_stream.put('\0');
+    m_stream.flush();
+    return m_stream.good();
+#endif
+}
+
+int64_t PartialFile::chunkLen(int index) const
+{
+    const int64_t offset = int64_t(index) * m_chunkBytes;
+    return std::min<int64_t>(m_chunkBytes, m_size - offset);
+}
+
+bool PartialFile::writeAt(int64_t offset, const Bytes& data)
+{
+#ifndef _WIN32
+    size_t done = 0;
+    while (done < data.size()) {
+        const ssize_t n = ::pwrite(m_fd, data.data() + done, data.size() - done,
+                                   off_t(offset + int64_t(done)));
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            return false;
+        }
+        done += size_t(n);
+    }
+    return true;
+#else
+    std::lock_guard<std::mutex> lock(m_streamMutex);
+    m_stream.seekp(std::streamoff(offset));
+    m_stream.write(reinterpret_cast<const char*>(data.data()),
+                   std::streamsize(data.size()));
+    return m_stream.good();
+#endif
+}
+
+bool PartialFile::readAt(int64_t offset, size_t len, Bytes& out)
+{
+    out.resize(len);
+#ifndef _WIN32
+    size_t done = 0;
+    while (done < len) {
+        const ssize_t n = ::pread(m_fd, out.data() + done, len - done,
+                                  off_t(offset + int64_t(done)));
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) return false;
+        done += size_t(n);
+    }
+    return true;
+#else
+    std::lock_guard<std::mutex> lock(m_streamMutex);
+    m_stream.seekg(std::streamoff(offset));
+    m_stream.read(reinterpret_cast<char*>(out.data()), std::streamsize(len));
+    return m_stream.gcount() == std::streamsize(len);
+#endif
+}
+
+void PartialFile::waitIdle()
+{
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_idleCv.wait(lock, [this] { return m_inflight == 0; });
+}
+
+bool PartialFile::writeChunk(int index, Bytes data)
+{
+    if (index < 0 || index >= m_totalChunks ||
+        int64_t(data.size()) != chunkLen(index)) return false;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (m_failed) return false;
+    }
+
+    const int64_t offset = int64_t(index) * m_chunkBytes;
+    auto shared = std::make_shared<const Bytes>(std::move(data));
+
+    // Hash before handing the bytes to the writer: the prefix is
+    // extended from memory, not from what lands on disk.
+    m_written[size_t(index)] = true;
+    if (!m_hashDone && index == m_hashNext) {
+        crypto_generichash_update(&m_hash, shared->data(), shared->size());
+        ++m_hashNext;
+    } else if (!m_hashDone && index > m_hashNext &&
+               m_earlyBytes + shared->size() <= kReorderBudgetBytes) {
+        m_early[index] = shared;
+        m_earlyBytes += shared->size();
+    }
+
+    if (m_pool) {
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            ++m_inflight;
+        }
+        m_pool->submit([this, offset, shared] {
+            const bool ok = writeAt(offset, *shared);
+            std::lock_guard<std::mutex> lock(m_mutex);
+            if (!ok) m_failed = true;
+            if (--m_inflight == 0) m_idleCv.notify_all();
+        }, shared->size());
+    } else if (!writeAt(offset, *shared)) {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_failed = true;
+        return false;
+    }
+
+    advanceHash();
+    return true;
+}
+
+void PartialFile::advanceHash()
+{
+    while (!m_hashDone && m_hashNext < m_totalChunks &&
+           m_written[size_t(m_hashNext)]) {
+        auto it = m_early.find(m_hashNext);
+        if (it != m_early.end()) {
+            crypto_generichash_update(&m_hash, it->second->data(), it->second->size());
+            m_earlyBytes -= it->second->size();
+            m_early.erase(it);
+        } else {
+            // Overflowed the reorder buffer or predates a restart: read
+            // it back once its write has landed.
+            waitIdle();
+            Bytes buf;
+            const int64_t len = chunkLen(m_hashNext);
+            if (!readAt(int64_t(m_hashNext) * m_chunkBytes, size_t(len), buf)) return;
+            crypto_generichash_update(&m_hash, buf.data(), buf.size());
+            m_rereadBytes += len;
+        }
+        ++m_hashNext;
+    }
+}
+
+bool PartialFile::sync()
+{
+    waitIdle();
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (m_failed) return false;
+#ifndef _WIN32
+#if defined(__APPLE__)
+    if (::fsync(m_fd) != 0) m_failed = true;
+#else
+    if (::fdatasync(m_fd) != 0) m_failed = true;
+#endif
+#else
+    std::lock_guard<std::mutex> streamLock(m_streamMutex);
+    m_stream.flush();
+    if (!m_stream.good()) m_failed = true;
+#endif
+    return !m_failed;
+}
+
+Bytes PartialFile::finishHash()
+{
+    if (m_hashDone) return {};
+    advanceHash();
+    if (m_hashNext != m_totalChunks) return {};
+    m_hashDone = true;
+    m_early.clear();
+    m_earlyBytes = 0;
+    Bytes hash(32, 0);
+    crypto_generichash_final(&m_hash, hash.data(), 32);
+    return hash;
+}
+
+void PartialFile::close()
+{
+    waitIdle();
+#ifndef _WIN32
+    if (m_fd >= 0) {
+        ::close(m_fd);
+        m_fd = -1;
+    }
+#else
+    if (m_stream.is_open()) m_stream.close();
+#endif
+}
@@ -0,0 +1,163 @@
+#pragma once
+
+#include "types.hpp"
+
+#include <sodium.h>
+
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <fstream>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+/*
+ * ChunkWriterPool — a few threads that run positional chunk writes off
+ * the receive path, so decrypting chunk N+1 overlaps writing chunk N.
+ *
+ * Bounded: submit() blocks while more than maxQueuedBytes of chunk data
+ * is waiting, so a fast sender against a slow disk backs up into the
+ * transport instead of into RAM.  A job bigger than the bound is still
+ * admitted once the queue is empty.  Threads start on first submit().
+ */
+class ChunkWriterPool {
+public:
+    explicit ChunkWriterPool(size_t threads = 2,
+                             size_t maxQueuedBytes = 16 * 1024 * 1024);
+    ~ChunkWriterPool();   // runs what's queued, then joins
+
+    ChunkWriterPool(const ChunkWriterPool&) = delete;
+    ChunkWriterPool& operator=(const ChunkWriterPool&) = delete;
+
+    void submit(std::function<void()> job, size_t bytes);
+
+private:
+    void run();
+
+    struct Job {
+        std::function<void()> fn;
+        size_t                bytes = 0;
+    };
+
+    const size_t m_threadCount;
+    const size_t m_maxQueuedBytes;
+
+    std::mutex               m_mutex;
+    std::condition_variable  m_cv;        // workers: job or stop
+    std::condition_variable  m_spaceCv;   // submitters: room in the queue
+    std::deque<Job>          m_jobs;
+    size_t                   m_queuedBytes = 0;
+    bool                     m_stop = false;
+    std::vector<std::thread> m_threads;
+};
+
+/*
+ * PartialFile — the receiver's on-disk copy of an incoming transfer.
+ *
+ *   - Preallocated: created at its final size (fallocate on Linux), so
+ *     chunk writes never extend the file and the filesystem can lay it
+ *     out contiguously.
+ *   - Positional writes: writeChunk() queues a pwrite at the chunk's
+ *     offset on the ChunkWriterPool; no shared seek pointer, so writes
+ *     to one file can run concurrently.  Without a pool the write runs
+ *     inline.
+ *   - sync() waits for queued writes and fdatasyncs.  The caller batches
+ *     it and only records chunks as received once a sync covering them
+ *     has succeeded.
+ *   - Incremental hash: BLAKE2b-256 is sequential, so chunks are hashed
+ *     as the contiguous prefix grows — straight from memory for in-order
+ *     arrivals, held in a bounded reorder buffer for early ones.  Only
+ *     chunks that overflowed that buffer, or were written before a
+ *     restart, are read back from disk.  finishHash() therefore needs no
+ *     second pass over the file in the common case.
+ *
+ * A write error is sticky: every later writeChunk() / sync() returns
+ * false.  Owned and driven by FileTransferManager on its own thread; the
+ * pool threads only touch the write path.
+ */
+class PartialFile {
+public:
+    // Create (truncating) at `fileSize` bytes.  nullptr on failure.
+    // `sequentialHash` false skips the running BLAKE2b-256 (and its
+    // reorder buffer) for transfers verified per chunk instead.
+    static std::unique_ptr<PartialFile> create(const std::string& path,
+                                               int64_t fileSize,
+                                               int64_t chunkBytes,
+                                               ChunkWriterPool* pool,
+                                               bool sequentialHash = true);
+    // Reopen after a restart.  `received` marks chunks already on disk;
+    // the hash picks them up (reading them back) as the prefix reaches
+    // them.  nullptr if the file is missing.
+    static std::unique_ptr<PartialFile> reopen(const std::string& path,
+                                               int64_t fileSize,
+                                               int64_t chunkBytes,
+                                               const std::vector<bool>& received,
+                                               ChunkWriterPool* pool,
+                                               bool sequentialHash = true);
+    ~PartialFile();   // waits for queued writes, closes
+
+    PartialFile(const PartialFile&) = delete;
+    PartialFile& operator=(const PartialFile&) = delete;
+
+    // Queue chunk `index` (exactly its expected length) for writing and
+    // feed it to the running hash.  false on a bad index / length or a
+    // previous write error.
+    bool writeChunk(int index, Bytes data);
+
+    // Wait for queued writes and flush them to stable storage.
+    bool sync();
+
+    // BLAKE2b-256 of the whole file once every chunk has been written;
+    // {} if chunks are missing, a read-back fails, or the file was
+    // opened without the sequential hash.  One-shot.
+    Bytes finishHash();
+
+    void close();
+
+    int64_t size() const { return m_size; }
+    // Bytes finishHash() / the cursor had to read back from disk.
+    int64_t rereadBytes() const { return m_rereadBytes; }
+
+    // Early chunks buffered for the hash, per file.
+    static constexpr size_t kReorderBudgetBytes = 8 * 1024 * 1024;
+
+private:
+    PartialFile() = default;
+    bool openFile(const std::string& path, bool truncate);
+    bool preallocate();
+    int64_t chunkLen(int index) const;
+    bool writeAt(int64_t offset, const Bytes& data);
+    bool readAt(int64_t offset, size_t len, Bytes& out);
+    void waitIdle();
+    void advanceHash();
+
+    std::string m_path;
+    int64_t     m_size       = 0;
+    int64_t     m_chunkBytes = 0;
+    int         m_totalChunks = 0;
+    ChunkWriterPool* m_pool  = nullptr;
+
+    int          m_fd = -1;           // POSIX
+    std::fstream m_stream;            // fallback where pwrite isn't available
+    std::mutex   m_streamMutex;       // serializes seek + write on m_stream
+
+    std::mutex              m_mutex;  // m_inflight, m_failed
+    std::condition_variable m_idleCv;
+    int                     m_inflight = 0;
+    bool                    m_failed   = false;
+
+    // Hash cursor: chunks [0, m_hashNext) are in m_hash.
+    crypto_generichash_state m_hash;
+    int                      m_hashNext = 0;
+    bool                     m_hashDone = false;
+    std::vector<bool>        m_written;                       // on disk (or queued)
+    std::map<int, std::shared_ptr<const Bytes>> m_early;      // ahead of the cursor
+    size_t                   m_earlyBytes  = 0;
+    int64_t                  m_rereadBytes = 0;
+};
@@ -0,0 +1,338 @@
+#include "PayloadCodec.hpp"
+#include "CryptoEngine.hpp"
+
+#include <zlib.h>
+
+#include <cstdio>
+#include <cstring>
+#include <string>
+
+using json = nlohmann::json;
+
+// CBOR tag 37 is the IANA-registered "binary UUID" tag; nlohmann
+// carries it as the byte string's subtype.
+static constexpr uint8_t kUuidSubtype = 37;
+
+// Wire codes for "type".  Append-only: a code, once shipped, keeps its
+// meaning forever.  0 is reserved so a zeroed field never aliases a
+// real type.
+static constexpr const char* kTypeCodes[] = {
+    nullptr,
+    "text",                  //  1
+    "avatar",                //  2
+    "kem_pub_announce",      //  3
+    "ice_offer",             //  4
+    "ice_answer",            //  5
+    "file_key",              //  6
+    "file_accept",           //  7
+    "file_decline",          //  8
+    "file_cancel",           //  9
+    "file_request",          // 10
+    "file_ack",              // 11
+    "group_msg",             // 12
+    "group_leave",           // 13
+    "group_rename",          // 14
+    "group_avatar",          // 15
+    "group_member_update",   // 16
+    "group_skey_announce",   // 17
+    "group_gap_request",     // 18
+    "group_roster_request",  // 19
+    "group_roster",          // 20
+};
+static constexpr size_t kTypeCodeCount = sizeof(kTypeCodes) / sizeof(kTypeCodes[0]);
+
+// Preset deflate dictionary, id 1.  Built from the payloads this client
+// actually sends: JSON keys and type names (also matched inside the
+// compact form, where CBOR keeps keys as plain text), ICE SDP lines and
+// common avatar prefixes.  deflate reaches the tail of the dictionary
+// with the shortest distances, so the most frequent strings go last.
+// Frozen once shipped: a changed dictionary needs a new id.
+static constexpr uint8_t kDictId = 1;
+static const char kDictV1[] =
+    "a=candidate:1 1 UDP 2015363327 192.168.1.2 54321 typ host\r\n"
+    "a=candidate:2 1 UDP 1679819007 203.0.113.7 54321 typ srflx raddr 192.168.1.2 rport 54321\r\n"
+    "a=candidate:3 1 UDP 4294967295 198.51.100.9 3478 typ relay raddr 203.0.113.7 rport 54321\r\n"
+    "a=ice-ufrag:a=ice-pwd:a=ice-options:trickle\r\nm=application 9 UDP/DTLS/SCTP webrtc-datachannel\r\n"
+    "c=IN IP4 0.0.0.0\r\nv=0\r\no=- 0 0 IN IP4 127.0.0.1\r\ns=-\r\nt=0 0\r\n"
+    "data:image/jpeg;base64,/9j/4AAQSkZJRgABAQAAAQABAAD/2wBDAA"
+    "data:image/png;base64,iVBORw0KGgoAAAANSUhEUgAA"
+    "{\"type\":\"ice_offer\",\"sdp\":\"{\"type\":\"ice_answer\",\"sdp\":\""
+    "\"quic\":true,\"quic_fingerprint\":\""
+    "{\"type\":\"kem_pub_announce\",\"kem_pub_b64u\":\""
+    "{\"type\":\"file_request\",\"fileName\":\"\",\"fileSize\":\"fileHash\":\"\"chunkCount\":"
+    "{\"type\":\"file_accept\",{\"type\":\"file_decline\",{\"type\":\"file_cancel\",{\"type\":\"file_ack\","
+    "{\"type\":\"file_key\",\"transferId\":\""
+    "{\"type\":\"avatar\",\"name\":\"\",\"avatar\":\""
+    "{\"type\":\"group_avatar\",{\"type\":\"group_rename\",{\"type\":\"group_leave\","
+    "{\"type\":\"group_member_update\",{\"type\":\"group_skey_announce\",\"seed\":\"\"epoch\":"
+    "{\"type\":\"group_gap_request\",\"from_ctr\":\"to_ctr\":"
+    "\"groupName\":\"\",\"members\":[\""
+    "{\"type\":\"group_msg\",\"groupId\":\"\",\"pv\":2,\"session\":\"\",\"ctr\":\"prev\":\""
+    "\",\"skey_epoch\":\"skey_idx\":\"ciphertext\":\""
+    "\",\"dsak\":\"\",\"pcv\":2}"
+    "{\"type\":\"text\",\"from\":\"\",\"msgId\":\"\",\"ts\":17\",\"text\":\"";
+
+enum class FieldKind { Text, Base64Url, Uuid };
+
+// Fields whose values are base64url-encoded keys, hashes or opaque
+// blobs.  Anything not listed stays text.
+static FieldKind kindFor(const std::string& key)
+{
+    static const char* const kBase64Url[] = {
+        "from", "session", "prev", "bundle", "seed", "fileHash",
+        "kem_pub_b64u", "ciphertext", "members", "dsak", "roster",
+    };
+    static const char* const kUuid[] = { "msgId", "transferId", "groupId" };
+
+    for (const char* k : kBase64Url) if (key == k) return FieldKind::Base64Url;
+    for (const char* k : kUuid)      if (key == k) return FieldKind::Uuid;
+    return FieldKind::Text;
+}
+
+static int hexNibble(char c)
+{
+    if (c >= '0' && c <= '9') return c - '0';
+    if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+    return -1;
+}
+
+// Parses the lowercase 8-4-4-4-12 form p2p::makeUuid emits.  Anything
+// else (uppercase, braces, wrong length) is left as text so the
+// round trip stays byte-exact.
+static bool parseUuid(const std::string& s, Bytes& out)
+{
+    if (s.size() != 36) return false;
+    out.assign(16, 0);
+    size_t o = 0;
+    for (size_t i = 0; i < s.size();) {
+        if (i == 8 || i == 13 || i == 18 || i == 23) {
+            if (s[i] != '-') return false;
+            ++i;
+            continue;
+        }
+        const int hi = hexNibble(s[i]);
+        const int lo = hexNibble(s[i + 1]);
+        if (hi < 0 || lo < 0) return false;
+        out[o++] = static_cast<uint8_t>((hi << 4) | lo);
+        i += 2;
+    }
+    return o == 16;
+}
+
+static std::string formatUuid(const json::binary_t& b)
+{
+    char buf[37];
+    std::snprintf(buf, sizeof(buf),
+        "%02x%02x%02x%02x-%02x%02x-%02x%02x-%02x%02x-%02x%02x%02x%02x%02x%02x",
+        b[0], b[1], b[2],  b[3],  b[4],  b[5],  b[6],  b[7],
+        b[8], b[9], b[10], b[11], b[12], b[13], b[14], b[15]);
+    return std::string(buf);
+}
+
+static void packValue(json& v, FieldKind kind)
+{
+    if (v.is_array()) {
+        for (json& e : v) packValue(e, kind);
+        return;
+    }
+    if (v.is_object()) {
+        for (auto it = v.begin(); it != v.end(); ++it)
+            packValue(it.value(), kindFor(it.key()));
+        return;
+    }
+    if (!v.is_string() || kind == FieldKind::Text) return;
+
+    const std::string& s = v.get_ref<const std::string&>();
+    if (kind == FieldKind::Uuid) {
+        Bytes raw;
+        if (parseUuid(s, raw)) v = json::binary(std::move(raw), kUuidSubtype);
+        return;
+    }
+    if (s.empty()) return;
+    Bytes raw = CryptoEngine::fromBase64Url(s);
+    if (raw.empty() || CryptoEngine::toBase64Url(raw) != s) return;
+    v = json::binary(std::move(raw));
+}
+
+// Inverse of packValue.  Driven by the value's CBOR type rather than
+// the key: the encoder only ever emits byte strings for the fields it
+// packed, so every binary value maps back to text.
+static bool unpackValue(json& v)
+{
+    if (v.is_array() || v.is_object()) {
+        for (json& e : v)
+            if (!unpackValue(e)) return false;
+        return true;
+    }
+    if (!v.is_binary()) return true;
+
+    const json::binary_t& b = v.get_binary();
+    if (b.has_subtype()) {
+        if (b.subtype() != kUuidSubtype || b.size() != 16) return false;
+        v = formatUuid(b);
+        return true;
+    }
+    v = CryptoEngine::toBase64Url(Bytes(b.begin(), b.end()));
+    return true;
+}
+
+Bytes PayloadCodec::encode(const json& payload, bool compact)
+{
+    if (!payload.is_object()) return {};
+
+    if (!compact) {
+        json advertised = payload;
+        advertised[kCapabilityField] = kCodecLevel;
+        const std::string s = advertised.dump();
+        return Bytes(s.begin(), s.end());
+    }
+
+    json packed = payload;
+    for (auto it = packed.begin(); it != packed.end(); ++it) {
+        if (it.key() == "type" && it.value().is_string()) {
+            const std::string& t = it.value().get_ref<const std::string&>();
+            for (size_t i = 1; i < kTypeCodeCount; ++i) {
+                if (t == kTypeCodes[i]) { it.value() = i; break; }
+            }
+            continue;
+        }
+        packValue(it.value(), kindFor(it.key()));
+    }
+
+    Bytes out;
+    out.reserve(256);
+    out.push_back(kCompactVersion);
+    json::to_cbor(packed, out);
+    return out;
+}
+
+// [0x02][dictId][rawLen u32 BE][raw deflate]
+static constexpr size_t kCompressedHeaderLen = 1 + 1 + 4;
+
+Bytes PayloadCodec::compress(const Bytes& encoded)
+{
+    if (encoded.empty() || encoded.size() > kMaxDecompressed) return {};
+    if (encoded[0] == kCompressedVersion) return {};  // never nest
+
+    z_stream zs{};
+    // Raw deflate (negative window bits): the framing above already
+    // carries the length, so zlib's header + adler32 would be dead weight.
+    if (deflateInit2(&zs, Z_BEST_COMPRESSION, Z_DEFLATED, -15, 9,
+                     Z_DEFAULT_STRATEGY) != Z_OK)
+        return {};
+    if (deflateSetDictionary(&zs, reinterpret_cast<const Bytef*>(kDictV1),
+                             sizeof(kDictV1) - 1) != Z_OK) {
+        deflateEnd(&zs);
+        return {};
+    }
+
+    const uLong bound = deflateBound(&zs, static_cast<uLong>(encoded.size()));
+    Bytes out(kCompressedHeaderLen + bound);
+    out[0] = kCompressedVersion;
+    out[1] = kDictId;
+    const uint32_t rawLen = static_cast<uint32_t>(encoded.size());
+    out[2] = static_cast<uint8_t>(rawLen >> 24);
+    out[3] = static_cast<uint8_t>(rawLen >> 16);
+    out[4] = static_cast<uint8_t>(rawLen >> 8);
+    out[5] = static_cast<uint8_t>(rawLen);
+
+    zs.next_in   = const_cast<Bytef*>(encoded.data());
+    zs.avail_in  = static_cast<uInt>(encoded.size());
+    zs.next_out  = out.data() + kCompressedHeaderLen;
+    zs.avail_out = static_cast<uInt>(bound);
+    const int rc = deflate(&zs, Z_FINISH);
+    const size_t produced = zs.total_out;
+    deflateEnd(&zs);
+    if (rc != Z_STREAM_END) return {};
+
+    out.resize(kCompressedHeaderLen + produced);
+    if (out.size() >= encoded.size()) return {};
+    return out;
+}
+
+static Bytes inflatePayload(const uint8_t* data, size_t len)
+{
+    if (len <= kCompressedHeaderLen || data[1] != kDictId) return {};
+    const size_t rawLen = (size_t(data[2]) << 24) | (size_t(data[3]) << 16) |
+                          (size_t(data[4]) << 8)  |  size_t(data[5]);
+    if (rawLen == 0 || rawLen > PayloadCodec::kMaxDecompressed) return {};
+
+    z_stream zs{};
+    if (inflateInit2(&zs, -15) != Z_OK) return {};
+    // Raw streams take the dictionary up front, not on Z_NEED_DICT.
+    if (inflateSetDictionary(&zs, reinterpret_cast<const Bytef*>(kDictV1),
+                             sizeof(kDictV1) - 1) != Z_OK) {
+        inflateEnd(&zs);
+        return {};
+    }
+
+    Bytes out(rawLen);
+    zs.next_in   = const_cast<Bytef*>(data + kCompressedHeaderLen);
+    zs.avail_in  = static_cast<uInt>(len - kCompressedHeaderLen);
+    zs.next_out  = out.data();
+    zs.avail_out = static_cast<uInt>(rawLen);
+    const int rc = inflate(&zs, Z_FINISH);
+    const bool exact = rc == Z_STREAM_END && zs.total_out == rawLen
+                       && zs.avail_in == 0;
+    inflateEnd(&zs);
+    if (!exact) return {};
+    return out;
+}
+
+json PayloadCodec::decode(const uint8_t* data, size_t len)
+{
+    if (!data || len == 0) return json(json::value_t::discarded);
+
+    if (data[0] == kCompressedVersion) {
+        const Bytes inner = inflatePayload(data, len);
+        if (inner.empty() || inner[0] == kCompressedVersion)
+            return json(json::value_t::discarded);
+        return decode(inner.data(), inner.size());
+    }
+
+    if (data[0] == '{') {
+        json o = json::parse(data, data + len,
+                             /*cb=*/nullptr, /*allow_exceptions=*/false);
+        if (!o.is_object()) return json(json::value_t::discarded);
+        return o;
+    }
+
+    if (data[0] != kCompactVersion) return json(json::value_t::discarded);
+
+    json o = json::from_cbor(data + 1, data + len,
+                             /*strict=*/true, /*allow_exceptions=*/false,
+                             json::cbor_tag_handler_t::store);
+    if (!o.is_object()) return json(json::value_t::discarded);
+
+    auto typeIt = o.find("type");
+    if (typeIt != o.end() && typeIt->is_number_unsigned()) {
+        const uint64_t code = typeIt->get<uint64_t>();
+        if (code == 0 || code >= kTypeCodeCount) return json(json::value_t::discarded);
+        *typeIt = kTypeCodes[code];
+    }
+    if (!unpackValue(o)) return json(json::value_t::discarded);
+    return o;
+}
+
+bool PayloadCodec::advertisesCompact(const json& payload, bool arrivedCompact)
+{
+    if (arrivedCompact) return true;
+    return advertisedLevel(payload, 0) >= kCompactVersion;
+}
+
+uint8_t PayloadCodec::advertisedLevel(const json& payload, uint8_t firstByte)
+{
+    uint8_t level = 0;
+    if (firstByte == kCompactVersion || firstByte == kCompressedVersion)
+        level = firstByte;
+    if (!payload.is_object()) return level;
+    auto it = payload.find(kCapabilityField);
+    if (it != payload.end() && it->is_number_integer() && it->get<int64_t>() > 0) {
+        const uint64_t pcv = it->get<uint64_t>();
+        // Clamp: a peer newer than us advertises forms we can't produce
+        // anyway, and those are all we'd use the level for.
+        const uint8_t v = static_cast<uint8_t>(pcv > kCodecLevel ? kCodecLevel : pcv);
+        if (v > level) level = v;
+    }
+    return level;
+}
@@ -0,0 +1,100 @@
+#pragma once
+
+#include "types.hpp"
+
+#include <cstddef>
+#include <cstdint>
+
+#include <nlohmann/json.hpp>
+
+/*
+ * Inner-payload codec — the bytes that go INTO SessionSealer.sealForPeer.
+ *
+ * Two encodings share the same slot:
+ *
+ *   JSON       '{' ...                     — legacy; every client reads it
+ *   Compact    [version(1=0x01)][CBOR map] — opt-in, per peer
+ *   Compressed [version(1=0x02)][dictId(1)][rawLen(4 BE)][raw deflate]
+ *                                          — opt-in, per peer; wraps one
+ *                                            of the two forms above
+ *
+ * The first byte disambiguates: a JSON object always starts with '{'
+ * (0x7B), so the version bytes can never collide with it.
+ *
+ * Compact form is the same object tree with three substitutions:
+ *   - "type" is a small unsigned code from a fixed, append-only table.
+ *   - Fields that carry base64url keys / hashes / ids (from, session,
+ *     prev, fileHash, members[], ...) become CBOR byte strings.  Only
+ *     strings that round-trip canonically are converted, so a malformed
+ *     field survives unchanged as text.
+ *   - Fields that carry RFC 4122 UUIDs (msgId, transferId, groupId)
+ *     become 16-byte byte strings tagged with kUuidSubtype.
+ * decode() undoes all three, so dispatchers see the same json they
+ * always did regardless of which form arrived.
+ *
+ * Compressed form is raw deflate primed with a preset dictionary built
+ * from the payload shapes this client sends (keys, type names, SDP
+ * lines), so even short control JSON shrinks.  dictId names the
+ * dictionary; new ones get new ids and old ids stay readable.  Whether
+ * to compress is the caller's call — ChatController only does it when
+ * the result lands in a smaller padding bucket, since anything else
+ * costs CPU and changes nothing on the wire.
+ *
+ * Negotiation: payloads carry "pcv": kCodecLevel, the highest version
+ * byte this build reads.  A receiver that sees pcv >= N (or a payload
+ * whose version byte is N) may answer that peer in form N.  Old
+ * clients ignore the extra field.
+ *
+ * Types:
+ *   bytes → std::vector<uint8_t>       (plaintext handed to the sealer)
+ *   json  → nlohmann::json             (the payload object)
+ */
+class PayloadCodec {
+public:
+    static constexpr uint8_t     kCompactVersion    = 0x01;
+    static constexpr uint8_t     kCompressedVersion = 0x02;
+    static constexpr uint8_t     kCodecLevel        = kCompressedVersion;
+    static constexpr const char* kCapabilityField   = "pcv";
+
+    // Decompression bound.  Far above anything that fits the largest
+    // padding bucket compressed, far below anything that hurts.
+    static constexpr size_t kMaxDecompressed = 4 * 1024 * 1024;
+
+    // Encode `payload` for sealing.  `compact` selects the CBOR form;
+    // otherwise the payload is dumped as JSON with the capability
+    // advertisement stamped in.  Returns empty if `payload` isn't an
+    // object.
+    static Bytes encode(const nlohmann::json& payload, bool compact);
+
+    // Wrap an encode() result in the compressed form.  Returns empty if
+    // deflate fails or the output isn't smaller than the input.
+    static Bytes compress(const Bytes& encoded);
+
+    // Decode any form straight out of the caller's buffer (no
+    // intermediate copy of the plaintext outside the compressed form).
+    // Returns a discarded json (is_discarded() == true) on malformed
+    // input, unknown version or dictionary, a compressed body that
+    // doesn't inflate to its stated length, unknown type code, or a top
+    // level that isn't an object.
+    static nlohmann::json decode(const uint8_t* data, size_t len);
+    static nlohmann::json decode(const Bytes& data)
+    { return decode(data.data(), data.size()); }
+
+    // True when `data` starts with the compact version byte.
+    static bool isCompact(const uint8_t* data, size_t len)
+    { return len > 0 && data[0] == kCompactVersion; }
+
+    static bool isCompressed(const uint8_t* data, size_t len)
+    { return len > 0 && data[0] == kCompressedVersion; }
+
+    // True when the decoded payload says its sender can read compact
+    // form — either it arrived compact or it carried the advertisement.
+    static bool advertisesCompact(const nlohmann::json& payload,
+                                   bool arrivedCompact);
+
+    // Highest form the sender of `payload` says it reads: the "pcv"
+    // advertisement, or the version byte it arrived in (`firstByte` of
+    // the encoded plaintext), whichever is higher.  0 = JSON only.
+    static uint8_t advertisedLevel(const nlohmann::json& payload,
+                                   uint8_t firstByte);
+};
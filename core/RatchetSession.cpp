@@ -2,6 +2,7 @@
 #include "CryptoEngine.hpp"
 #include "binary_io.hpp"
 #include "log.hpp"
+#include "shared.hpp"
 #include <sodium.h>
 #include <cstring>
 #include <algorithm>
@@ -54,7 +55,7 @@ inline void zeroBytes(Bytes& b) {
 
 Bytes RatchetHeader::serialize() const {
     Bytes out;
-    out.reserve(kClassicalSize + (kemPub.empty() ? 0 : 2 + kemCt.size() + kemPub.size()));
+    out.reserve(kClassicalSize + 2 + kemCt.size() + kemPub.size());
 
     // Classical fields: dhPub(32) + prevChainLen(4) + messageNum(4)
     append(out, dhPub);
@@ -68,20 +69,35 @@ Bytes RatchetHeader::serialize() const {
     out.push_back(static_cast<uint8_t>((messageNum >>  8) & 0xFF));
     out.push_back(static_cast<uint8_t>( messageNum        & 0xFF));
 
-    // Hybrid PQ fields: kemCtLen(2) + kemCt(0..1088) + kemPub(0..1184)
-    if (!kemPub.empty()) {
+    // Pre-cadence PQ fields: kemCtLen(2) + kemCt(0..1088) + kemPub(1184)
+    if (legacyPq) {
         const uint16_t ctLen = static_cast<uint16_t>(kemCt.size());
         out.push_back(static_cast<uint8_t>((ctLen >> 8) & 0xFF));
         out.push_back(static_cast<uint8_t>( ctLen       & 0xFF));
         if (!kemCt.empty())
             append(out, kemCt);
         append(out, kemPub);
+        return out;
+    }
+
+    // PQ fields: flags(1) + [kemCt(1088)] + [kemPub(1184)]
+    if (pq) {
+        uint8_t flags = kFlagMarker;
+        if (!kemPub.empty())  flags |= kFlagKemPub;
+        if (!kemCt.empty())   flags |= kFlagKemCt;
+        if (holdsPeerKemPub)  flags |= kFlagHoldsKemPub;
+        out.push_back(flags);
+        if (!kemCt.empty())
+            append(out, kemCt);
+        if (!kemPub.empty())
+            append(out, kemPub);
     }
 
     return out;
 }
 
-RatchetHeader RatchetHeader::deserialize(const Bytes& data, size_t& bytesRead) {
+RatchetHeader RatchetHeader::deserialize(const Bytes& data, size_t& bytesRead,
+                                         bool hybrid) {
     RatchetHeader h;
     bytesRead = 0;
     if (data.size() < static_cast<size_t>(kClassicalSize)) return h;
@@ -99,7 +115,34 @@ RatchetHeader RatchetHeader::deserialize(const Bytes& data, size_t& bytesRead) {
          static_cast<uint32_t>(data[39]);
     bytesRead = kClassicalSize;  // 40
 
-    // Check for hybrid PQ extension: kemCtLen(2) + kemCt + kemPub
+    if (!hybrid || data.size() <= bytesRead) return h;
+
+    const uint8_t first = data[bytesRead];
+
+    if (first & kFlagMarker) {
+        constexpr uint8_t kKnown =
+            kFlagMarker | kFlagKemPub | kFlagKemCt | kFlagHoldsKemPub;
+        if (first & ~kKnown) { bytesRead = 0; return h; }  // reject unknown flags
+
+        const size_t ctLen  = (first & kFlagKemCt)  ? kKemCtLen  : 0;
+        const size_t pubLen = (first & kFlagKemPub) ? kKemPubLen : 0;
+        if (data.size() < bytesRead + 1 + ctLen + pubLen) { bytesRead = 0; return h; }
+
+        h.pq = true;
+        h.holdsPeerKemPub = (first & kFlagHoldsKemPub) != 0;
+        bytesRead += 1;
+        if (ctLen) {
+            h.kemCt = slice(data, bytesRead, ctLen);
+            bytesRead += ctLen;
+        }
+        if (pubLen) {
+            h.kemPub = slice(data, bytesRead, pubLen);
+            bytesRead += pubLen;
+        }
+        return h;
+    }
+
+    // Pre-cadence hybrid extension: kemCtLen(2) + kemCt + kemPub
     if (data.size() >= bytesRead + 2) {
         const uint16_t ctLen =
             (static_cast<uint16_t>(data[bytesRead]) << 8) |
@@ -110,6 +153,7 @@ RatchetHeader RatchetHeader::deserialize(const Bytes& data, size_t& bytesRead) {
 
         const size_t pqSize = 2 + ctLen + kKemPubLen;
         if (data.size() >= bytesRead + pqSize) {
+            h.legacyPq = true;
             bytesRead += 2;
             if (ctLen > 0) {
                 h.kemCt = slice(data, bytesRead, ctLen);
@@ -213,6 +257,7 @@ RatchetSession RatchetSession::initAsInitiator(const Bytes& rootKey,
         auto kp = CryptoEngine::generateKemKeypair();
         s.m_kemPub  = std::move(kp.first);
         s.m_kemPriv = std::move(kp.second);
+        s.m_offerKemPub = true;
     }
 
     // Reject all-zeros remote pubkey (low-order check is also performed
@@ -300,6 +345,7 @@ RatchetSession RatchetSession::initAsResponder(const Bytes& rootKey,
         auto kp = CryptoEngine::generateKemKeypair();
         s.m_kemPub  = std::move(kp.first);
         s.m_kemPriv = std::move(kp.second);
+        s.m_offerKemPub = true;
     }
 
     if (crypto_scalarmult(shared,
@@ -329,7 +375,8 @@ RatchetSession RatchetSession::initAsResponder(const Bytes& rootKey,
 // ---------------------------
 
 void RatchetSession::dhRatchetStep(const Bytes& remoteDhPub,
-                                    const Bytes& kemCt) {
+                                    const Bytes& kemCt,
+                                    bool preCadenceKemMix) {
     // Reject all-zeros or low-order remote DH pubkeys.  Without this
     // check a peer (or malicious relay swapping bytes in the header)
     // could force the scalarmult to land on a known shared secret.
@@ -356,13 +403,32 @@ void RatchetSession::dhRatchetStep(const Bytes& remoteDhPub,
     Bytes dhOutput(shared, shared + sizeof(shared));
     sodium_memzero(shared, sizeof(shared));
 
-    // Hybrid: if the peer included a KEM ciphertext, decapsulate and combine with DH
+    // Hybrid: if the peer included a KEM ciphertext, decapsulate and combine with DH.
+    // The ciphertext was encapsulated to our current KEM pub, which is now spent:
+    // rotate, and offer the new pub until the peer acknowledges it.
     if (m_hybrid && !kemCt.empty() && !m_kemPriv.empty()) {
         Bytes kemSS = CryptoEngine::kemDecaps(kemCt, m_kemPriv);
-        if (!kemSS.empty()) {
+        if (!kemSS.empty() && preCadenceKemMix) {
+            // Pre-cadence senders ran HKDF(ss, root, "ratchet-kem") over
+            // the root before their sending-chain KDF.  Our root here is
+            // theirs at that point, so the same call lands on their chain.
+            Bytes augmented = CryptoEngine::hkdf(
+                kemSS, m_rootKey,
+                Bytes{'r','a','t','c','h','e','t','-','k','e','m'}, 32);
+            if (!augmented.empty()) {
+                zeroBytes(m_rootKey);
+                m_rootKey = std::move(augmented);
+            }
+            CryptoEngine::secureZero(kemSS);
+        } else if (!kemSS.empty()) {
             dhOutput = concat(dhOutput, kemSS);  // DH || KEM combined input
             CryptoEngine::secureZero(kemSS);
         }
+        zeroBytes(m_kemPriv);
+        auto kp = CryptoEngine::generateKemKeypair();
+        m_kemPub  = std::move(kp.first);
+        m_kemPriv = std::move(kp.second);
+        m_offerKemPub = true;
     }
 
     auto [rk1, recvChain] = kdfRootKey(m_rootKey, dhOutput);
@@ -380,29 +446,22 @@ void RatchetSession::dhRatchetStep(const Bytes& remoteDhPub,
         m_dhPriv = std::move(kp.second);
     }
 
-    // Hybrid: generate new KEM keypair and encapsulate to peer's KEM pub
-    m_pendingKemCt.clear();
+    // Hybrid: on a KEM step, encapsulate to the peer's fresh KEM pub and
+    // feed the shared secret into the sending chain exactly as the peer
+    // will on its receiving side.  The ciphertext rides in every header
+    // of this chain so losing the first message doesn't strand the peer.
+    m_sendKemCt.clear();
+    Bytes kemSS;
     if (m_hybrid) {
-        zeroBytes(m_kemPriv);
-        {
-            auto kp = CryptoEngine::generateKemKeypair();
-            m_kemPub  = std::move(kp.first);
-            m_kemPriv = std::move(kp.second);
-        }
-
-        // Encapsulate to the peer's KEM pub (received in their last header)
-        // Store the ciphertext — it will be included in our next message header
-        if (m_remoteKemPub.size() == kKemPubLen) {
+        ++m_dhStepsSinceKem;
+        if (kemStepDue()) {
             KemEncapsResult kemResult = CryptoEngine::kemEncaps(m_remoteKemPub);
             if (!kemResult.ciphertext.empty()) {
-                m_pendingKemCt = std::move(kemResult.ciphertext);
-                // Mix KEM SS into root key (peer will decaps and do the same)
-                Bytes augmented = CryptoEngine::hkdf(
-                    kemResult.sharedSecret, m_rootKey,
-                    Bytes{'r','a','t','c','h','e','t','-','k','e','m'}, 32);
-                CryptoEngine::secureZero(kemResult.sharedSecret);
-                if (!augmented.empty())
-                    m_rootKey = std::move(augmented);
+                m_sendKemCt = std::move(kemResult.ciphertext);
+                kemSS = std::move(kemResult.sharedSecret);
+                m_remoteKemPubFresh = false;
+                m_dhStepsSinceKem = 0;
+                m_lastKemSecs = p2p::nowSecs();
             }
         }
     }
@@ -410,10 +469,16 @@ void RatchetSession::dhRatchetStep(const Bytes& remoteDhPub,
     // DH with new private + remote public -> sending chain
     if (crypto_scalarmult(shared,
                           m_dhPriv.data(),
-                          remoteDhPub.data()) != 0)
+                          remoteDhPub.data()) != 0) {
+        zeroBytes(kemSS);
         return;
+    }
     dhOutput.assign(shared, shared + sizeof(shared));
     sodium_memzero(shared, sizeof(shared));
+    if (!kemSS.empty()) {
+        dhOutput = concat(dhOutput, kemSS);
+        zeroBytes(kemSS);
+    }
 
     auto [rk2, sendChain] = kdfRootKey(m_rootKey, dhOutput);
     zeroBytes(dhOutput);
@@ -424,6 +489,30 @@ void RatchetSession::dhRatchetStep(const Bytes& remoteDhPub,
     zeroBytes(sendChain);
 }
 
+bool RatchetSession::kemStepDue() const {
+    if (!m_remoteKemPubFresh || m_remoteKemPub.size() != kKemPubLen) return false;
+    if (m_kemEveryDhSteps > 0 && m_dhStepsSinceKem >= m_kemEveryDhSteps) return true;
+    return m_kemMaxIntervalSecs > 0 &&
+           p2p::nowSecs() - m_lastKemSecs >= m_kemMaxIntervalSecs;
+}
+
+void RatchetSession::notePeerKemPub(const Bytes& kemPub) {
+    if (kemPub.size() != kKemPubLen || kemPub == m_remoteKemPub) return;
+    m_remoteKemPub = kemPub;
+    m_remoteKemPubFresh = true;
+}
+
+void RatchetSession::notePeerKemHeader(int version) {
+    if (version >= kKemHeaderVersion) m_peerReadsKemFlags = true;
+}
+
+void RatchetSession::setKemCadence(uint32_t everyDhSteps, int64_t maxIntervalSecs) {
+    if (maxIntervalSecs < 0) maxIntervalSecs = 0;
+    if (everyDhSteps == 0 && maxIntervalSecs == 0) everyDhSteps = 1;
+    m_kemEveryDhSteps    = everyDhSteps;
+    m_kemMaxIntervalSecs = maxIntervalSecs;
+}
+
 // ---------------------------
 // Encrypt
 // ---------------------------
@@ -453,13 +542,22 @@ Bytes RatchetSession::encrypt(const Bytes& plaintext) {
     header.prevChainLen = m_prevChainLen;
     header.messageNum   = m_sendMsgNum++;
 
-    // Hybrid: include our KEM pub so the peer can encapsulate back on their next
-    // DH ratchet step. We do NOT encapsulate here — KEM encaps/decaps happens only
-    // during dhRatchetStep() to stay synchronized with the DH ratchet pace.
-    if (m_hybrid && !m_kemPub.empty()) {
-        header.kemPub = m_kemPub;
-        header.kemCt  = m_pendingKemCt;  // set during our last dhRatchetStep, if any
-        m_pendingKemCt.clear();          // consume — don't send same ciphertext twice
+    // Hybrid: KEM fields ride only when there's something to say — our pub
+    // until the peer acks it, the chain's ciphertext on a KEM step.  We do
+    // NOT encapsulate here — KEM encaps/decaps happens only during
+    // dhRatchetStep() to stay synchronized with the DH ratchet pace.
+    // A peer that may predate the flagged layout gets the pre-cadence
+    // one, which it can only parse with our pub present.
+    if (m_hybrid) {
+        header.kemCt = m_sendKemCt;
+        if (m_peerReadsKemFlags) {
+            header.pq = true;
+            if (m_offerKemPub) header.kemPub = m_kemPub;
+            header.holdsPeerKemPub = m_remoteKemPubFresh;
+        } else {
+            header.legacyPq = true;
+            header.kemPub   = m_kemPub;
+        }
     }
 
     P2P_LOG("[Ratchet] encrypt: msgNum=" << header.messageNum
@@ -578,7 +676,7 @@ Bytes RatchetSession::decrypt(const Bytes& headerAndCiphertext) {
     }
 
     size_t headerLen = 0;
-    RatchetHeader header = RatchetHeader::deserialize(headerAndCiphertext, headerLen);
+    RatchetHeader header = RatchetHeader::deserialize(headerAndCiphertext, headerLen, m_hybrid);
     if (headerLen == 0) {
         P2P_WARN("[Ratchet] decrypt: header deserialize failed");
         return {};
@@ -592,20 +690,51 @@ Bytes RatchetSession::decrypt(const Bytes& headerAndCiphertext) {
     Bytes skippedResult = trySkippedKeys(header, ciphertext);
     if (!skippedResult.empty()) return skippedResult;
 
+    // A pre-cadence sender mixed its KEM secret into the root key instead
+    // of the DH input (see dhRatchetStep).  Only a chain it opens with a
+    // ciphertext, in the pre-cadence layout, can need that; if our
+    // derivation doesn't authenticate such a message, rewind and try its.
+    const bool maybePreCadence = m_hybrid && !m_peerReadsKemFlags &&
+                                 header.legacyPq && !header.kemCt.empty() &&
+                                 header.dhPub != m_remoteDhPub;
+    if (!maybePreCadence)
+        return ratchetAndDecrypt(header, ciphertext, false);
+
+    const RatchetSession before = *this;
+    Bytes pt = ratchetAndDecrypt(header, ciphertext, false);
+    if (!pt.empty()) return pt;
+
+    *this = before;
+    pt = ratchetAndDecrypt(header, ciphertext, true);
+    if (pt.empty()) {
+        *this = before;
+        return {};
+    }
+    P2P_LOG("[Ratchet] decrypt: peer uses pre-cadence KEM mixing");
+    return pt;
+}
+
+Bytes RatchetSession::ratchetAndDecrypt(const RatchetHeader& header,
+                                        const Bytes& ciphertext,
+                                        bool preCadenceKemMix) {
     // If the DH key changed, perform a DH ratchet step
-    if (header.dhPub != m_remoteDhPub) {
+    const bool dhStep = header.dhPub != m_remoteDhPub;
+    if (dhStep) {
         P2P_LOG("[Ratchet] DH ratchet step " << (m_hybrid ? "(hybrid PQ)" : ""));
         // Skip any remaining messages in the current receiving chain
         if (!skipMessageKeys(m_remoteDhPub, header.prevChainLen))
             return {};
+    }
 
-        // Hybrid: store the peer's KEM pub for our next dhRatchetStep to encaps to
-        if (m_hybrid && header.kemPub.size() == kKemPubLen) {
-            m_remoteKemPub = header.kemPub;
-        }
+    // Hybrid: store the peer's KEM pub before stepping so the step can
+    // already encapsulate to it.  Only headers on this path count —
+    // skipped-key messages belong to older chains and may carry a pub
+    // we've since spent.
+    if (m_hybrid) notePeerKemPub(header.kemPub);
 
+    if (dhStep) {
         // Pass KEM ciphertext to dhRatchetStep — it handles decaps + root key mixing
-        dhRatchetStep(header.dhPub, header.kemCt);
+        dhRatchetStep(header.dhPub, header.kemCt, preCadenceKemMix);
         P2P_LOG("[Ratchet] ratchet step complete");
     }
 
@@ -643,6 +772,14 @@ Bytes RatchetSession::decrypt(const Bytes& headerAndCiphertext) {
 
     pt.resize(plen);
 
+    // The peer holds our current KEM pub: stop spending header bytes on
+    // it.  Not on a KEM step — that header predates our rotation.
+    if (m_hybrid && header.holdsPeerKemPub && !(dhStep && !header.kemCt.empty()))
+        m_offerKemPub = false;
+
+    // Only a client that reads the flagged layout writes it.
+    if (m_hybrid && header.pq) m_peerReadsKemFlags = true;
+
     // Store the message key before zeroing
     m_lastMessageKey = Bytes(msgKey.begin(), msgKey.end());
     zeroBytes(msgKey);
@@ -661,7 +798,11 @@ Bytes RatchetSession::serialize() const {
     //   v2: + hybrid PQ state (kem keys, remote kem pub, pending kem ct)
     //   v3: + m_initialRootKey at the end so sessionId() round-trips
     //        across persistence (Phase 1 Causally-Linked Pairwise dep)
-    w.u8(3);
+    //   v4: + KEM cadence state (offer / fresh flags, steps + time since
+    //        the last KEM step); the "pending kem ct" slot now holds the
+    //        current chain's ciphertext
+    //   v5: + peer-reads-flagged-header latch
+    w.u8(5);
     w.bytes(m_rootKey);
     w.bytes(m_sendChainKey);
     w.bytes(m_recvChainKey);
@@ -685,11 +826,20 @@ Bytes RatchetSession::serialize() const {
     w.bytes(m_kemPub);
     w.bytes(m_kemPriv);
     w.bytes(m_remoteKemPub);
-    w.bytes(m_pendingKemCt);
+    w.bytes(m_sendKemCt);
 
     // v3: handshake-time root key (stable sessionId source)
     w.bytes(m_initialRootKey);
 
+    // v4: KEM cadence state
+    w.boolean(m_offerKemPub);
+    w.boolean(m_remoteKemPubFresh);
+    w.u32(m_dhStepsSinceKem);
+    w.u64(static_cast<uint64_t>(m_lastKemSecs));
+
+    // v5: flagged-header capability
+    w.boolean(m_peerReadsKemFlags);
+
     return w.take();
 }
 
@@ -698,7 +848,7 @@ RatchetSession RatchetSession::deserialize(const Bytes& data) {
     p2p::BinaryReader r(data);
 
     const uint8_t version = r.u8();
-    if (version < 1 || version > 3) return s;
+    if (version < 1 || version > 5) return s;
 
     s.m_rootKey      = r.bytes();
     s.m_sendChainKey = r.bytes();
@@ -724,14 +874,14 @@ RatchetSession RatchetSession::deserialize(const Bytes& data) {
         s.m_kemPub       = r.bytes();
         s.m_kemPriv      = r.bytes();
         s.m_remoteKemPub = r.bytes();
-        s.m_pendingKemCt = r.bytes();
+        s.m_sendKemCt    = r.bytes();
 
         // Validate PQ key sizes — reject corrupted state
         if (s.m_hybrid) {
             if ((!s.m_kemPub.empty() && s.m_kemPub.size() != kKemPubLen) ||
                 (!s.m_kemPriv.empty() && s.m_kemPriv.size() != 2400) ||
                 (!s.m_remoteKemPub.empty() && s.m_remoteKemPub.size() != kKemPubLen) ||
-                (!s.m_pendingKemCt.empty() && s.m_pendingKemCt.size() != kKemCtLen)) {
+                (!s.m_sendKemCt.empty() && s.m_sendKemCt.size() != kKemCtLen)) {
                 return RatchetSession{};  // corrupted — return invalid
             }
         }
@@ -747,6 +897,25 @@ RatchetSession RatchetSession::deserialize(const Bytes& data) {
         s.m_initialRootKey = r.bytes();
     }
 
+    // v4: KEM cadence state.  Older sessions re-offer our pub and treat
+    // the stored remote pub as spent — pre-v4 peers may already have
+    // been encapsulated to, and a spare round trip is cheaper than a
+    // desynced chain.
+    if (version >= 4) {
+        s.m_offerKemPub       = r.boolean();
+        s.m_remoteKemPubFresh = r.boolean();
+        s.m_dhStepsSinceKem   = r.u32();
+        s.m_lastKemSecs       = static_cast<int64_t>(r.u64());
+    } else {
+        s.m_offerKemPub = s.m_hybrid && !s.m_kemPub.empty();
+        s.m_sendKemCt.clear();
+    }
+
+    // v5: older sessions fall back to the pre-cadence header until the
+    // peer shows it reads flags again — one message, at worst.
+    if (version >= 5)
+        s.m_peerReadsKemFlags = r.boolean();
+
     if (!r.ok()) return RatchetSession{};
     return s;
 }
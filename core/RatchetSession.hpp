@@ -13,8 +13,8 @@
  * Initialized from the output of a Noise handshake (root key + DH keys).
  * Provides forward secrecy and post-compromise security via:
  *   - DH ratchet: new ephemeral X25519 keypair on each reply
- *   - KEM ratchet (hybrid): ML-KEM-768 encaps/decaps mixed into root key,
- *     runs one step behind the DH ratchet for PQ protection
+ *   - KEM ratchet (hybrid): ML-KEM-768 encaps/decaps mixed into root key
+ *     alongside a DH step, at a configurable cadence (see setKemCadence)
  *   - Symmetric ratchet: KDF chain for per-message keys
  *
  * Skipped message keys are cached (bounded) for out-of-order delivery.
@@ -30,13 +30,40 @@ struct RatchetHeader {
 
     // PQ hybrid fields (may be empty for classical sessions)
     Bytes kemPub;            // 1184 bytes — sender's current KEM ratchet public key
-    Bytes kemCt;             // 1088 bytes — KEM ciphertext encapsulated to peer's last KEM pub
-                             //              (empty if we haven't received peer's KEM pub yet)
+                             //              (only while the peer hasn't acknowledged it)
+    Bytes kemCt;             // 1088 bytes — KEM ciphertext encapsulated to peer's KEM pub
+                             //              (only on chains that performed a KEM step)
+    bool  holdsPeerKemPub = false;  // sender holds a KEM pub of ours it hasn't used yet
+
+    // Hybrid sessions always carry the PQ extension, even when both
+    // KEM fields are absent.  Wire layout after the 40 classical bytes:
+    //
+    //   flags(1) [kemCt(1088)] [kemPub(1184)]
+    //
+    // flags = kFlagMarker | kFlagKemPub? | kFlagKemCt? | kFlagHoldsKemPub?
+    //
+    // Pre-cadence clients wrote ctLen(2) + kemCt + kemPub(1184) with the
+    // pub always present.  Their first byte is 0x00 or 0x04, never with
+    // the marker bit set, so the two layouts can't be confused.
+    // `legacyPq` records which one was parsed so serialize() reproduces
+    // the exact bytes the AEAD authenticated; a sender sets it while the
+    // peer isn't known to read the flagged layout (see
+    // RatchetSession::notePeerKemHeader).
+    bool pq       = false;
+    bool legacyPq = false;
 
     Bytes serialize() const;
-    static RatchetHeader deserialize(const Bytes& data, size_t& bytesRead);
+    // `hybrid` = false parses the classical 40 bytes only; the PQ
+    // extension is never looked for on classical sessions.
+    static RatchetHeader deserialize(const Bytes& data, size_t& bytesRead,
+                                     bool hybrid = true);
 
     static constexpr int kClassicalSize = 32 + 4 + 4; // 40 bytes
+
+    static constexpr uint8_t kFlagMarker      = 0x80;
+    static constexpr uint8_t kFlagKemPub      = 0x01;
+    static constexpr uint8_t kFlagKemCt       = 0x02;
+    static constexpr uint8_t kFlagHoldsKemPub = 0x04;
 };
 
 class RatchetSession {
@@ -84,6 +111,35 @@ public:
 
     bool isValid() const { return m_rootKey.size() == 32; }
 
+    // KEM ratchet cadence (hybrid sessions only).  A KEM step — encaps
+    // to the peer's latest KEM pub, mixed into the next sending chain —
+    // runs on the DH step where either
+    //   - `everyDhSteps` DH steps have passed since the last KEM step, or
+    //   - `maxIntervalSecs` (> 0) seconds have passed since it,
+    // provided the peer has offered a KEM pub we haven't used yet.
+    // Between KEM steps headers carry no KEM fields, so short messages
+    // stay in the smallest padding bucket.
+    //
+    // PCS bound: once the peer's fresh KEM pub has arrived, PQ entropy
+    // enters the root key within `everyDhSteps` of our DH steps (or
+    // `maxIntervalSecs`, whichever comes first).  Default 1 = every DH
+    // step that can carry one.  0 disables the step trigger; passing 0
+    // for both falls back to 1.  Not persisted: the owner re-applies it
+    // after loading (SessionManager does).
+    void setKemCadence(uint32_t everyDhSteps, int64_t maxIntervalSecs = 0);
+    uint32_t kemEveryDhSteps() const    { return m_kemEveryDhSteps; }
+    int64_t  kemMaxIntervalSecs() const { return m_kemMaxIntervalSecs; }
+
+    // Flagged-header capability (hybrid sessions only).  A pre-cadence
+    // client can't parse the flagged layout, so encrypt() writes the
+    // pre-cadence one — KEM pub on every message — until the peer is
+    // known to read it: a flagged header from the peer decrypts, or the
+    // owner passes on the version the peer advertised ("khv" in app
+    // payloads, see ChatController::encodePayload).  Latches; persisted.
+    static constexpr int kKemHeaderVersion = 1;
+    void notePeerKemHeader(int version);
+    bool peerReadsKemFlags() const { return m_peerReadsKemFlags; }
+
     /// Stable per-session identifier derived from the initial root key
     /// at handshake time.  Both sides of the same DR session compute
     /// identical bytes (8B BLAKE2b of the initial rootKey).  Re-running
@@ -113,8 +169,24 @@ private:
 
     // Perform a DH ratchet step when we receive a new remote DH key
     // kemCt: KEM ciphertext from the peer (empty if peer hasn't sent one)
+    // preCadenceKemMix: derive the receiving chain the way pre-cadence
+    //   senders did (KEM secret folded into the root key, not the DH input)
     void dhRatchetStep(const Bytes& remoteDhPub,
-                       const Bytes& kemCt = {});
+                       const Bytes& kemCt = {},
+                       bool preCadenceKemMix = false);
+
+    // decrypt() past the skipped-key lookup: ratchet to the header's
+    // chain and open the message.  Mutates state even on failure.
+    Bytes ratchetAndDecrypt(const RatchetHeader& header,
+                            const Bytes& ciphertext,
+                            bool preCadenceKemMix);
+
+    // Whether the DH step in progress should also be a KEM step.
+    bool kemStepDue() const;
+
+    // Record a KEM pub offered in a peer header.  A pub we've already
+    // encapsulated to stays spent even if the peer repeats it.
+    void notePeerKemPub(const Bytes& kemPub);
 
     // Try to decrypt using a skipped message key
     Bytes trySkippedKeys(const RatchetHeader& header,
@@ -140,9 +212,17 @@ private:
     bool  m_hybrid = false;
     Bytes m_kemPub;           // 1184 — our current KEM ratchet pub
     Bytes m_kemPriv;          // 2400 — our current KEM ratchet priv
-    Bytes m_remoteKemPub;     // 1184 — peer's current KEM ratchet pub (for encaps on next send)
-    Bytes m_pendingKemCt;     // 1088 — KEM ciphertext to include in next message header
-                              //         (produced during dhRatchetStep, consumed during encrypt)
+    Bytes m_remoteKemPub;     // 1184 — peer's latest KEM ratchet pub (for encaps on a KEM step)
+    Bytes m_sendKemCt;        // 1088 — KEM ciphertext carried by every message of the
+                              //         current sending chain (empty between KEM steps)
+    bool  m_offerKemPub = false;       // put m_kemPub in headers until the peer acks it
+    bool  m_remoteKemPubFresh = false; // m_remoteKemPub not yet encapsulated to
+    bool  m_peerReadsKemFlags = false; // peer parses the flagged header layout
+
+    uint32_t m_kemEveryDhSteps = 1;
+    int64_t  m_kemMaxIntervalSecs = 0;
+    uint32_t m_dhStepsSinceKem = 0;
+    int64_t  m_lastKemSecs = 0;        // Unix seconds of our last KEM step
 
     uint32_t m_sendMsgNum = 0;   // messages sent in current chain
     uint32_t m_recvMsgNum = 0;   // messages received in current chain
@@ -87,6 +87,13 @@ int64_t nowMs() {
         std::chrono::system_clock::now().time_since_epoch()).count();
 }
 
+// Monotonic milliseconds — used for POST round-trip timing so a wall-
+// clock jump mid-request can't produce a negative or huge latency sample.
+int64_t steadyMs() {
+    return std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
 std::string peerPrefix(const std::string& id) {
     const size_t n = std::min<size_t>(8, id.size());
     return id.substr(0, n) + "…";
@@ -113,11 +120,20 @@ RelayClient::RelayClient(IWebSocketFactory& wsFactory, IHttpClient& http,
     m_reconnectTimer = m_timers.create();
     m_retryTimer     = m_timers.create();
     m_coverTimer     = m_timers.create();
+    m_wsSendAckTimer = m_timers.create();
+    m_sendPumpTimer  = m_timers.create();
+    m_sendSlotTimer  = m_timers.create();
+    m_constantRateTimer = m_timers.create();
 }
 
 RelayClient::~RelayClient()
 {
     m_intentionalDisconnect = true;
+    // Drop pending WS sends rather than letting onWsDisconnected spill
+    // them to HTTP mid-teardown — same fate as the retry queue.
+    m_wsSendQueue.clear();
+    m_wsSendInFlight.clear();
+    for (ClassQueue& q : m_sendQueues) q.pending.clear();
     if (m_ws) m_ws->close();
     // Slave subscribers must be torn down before m_timers (timer
     // factory) and m_wsFactory (which may release platform
@@ -233,6 +249,9 @@ void RelayClient::onWsDisconnected()
 
     P2P_LOG("[Relay] WebSocket disconnected");
 
+    // Whatever was riding the WS send path goes out over HTTP instead.
+    spillWsSendsToHttp();
+
     if (onDisconnected) onDisconnected();
 
     if (!m_intentionalDisconnect)
@@ -285,6 +304,11 @@ void RelayClient::onWsTextMessage(const std::string& message)
         if (m_coverIntervalSec > 0) scheduleCoverTimer();
         refreshRelayInfo();
 
+        // Relays that accept send frames advertise their ack window
+        // here; older relays omit it and we stay on HTTP.
+        m_wsSendWindow = std::clamp(obj.value("ws_send_window", 0),
+                                    0, kWsSendMaxWindow);
+
         // Replay any pending push-token registration on this fresh
         // authenticated WS.  The cached (platform, token) pair is
         // whatever the app last told us — includes the "unregister"
@@ -324,6 +348,13 @@ void RelayClient::onWsTextMessage(const std::string& message)
         }
     }
 
+    if (type == "send_ack") {
+        if (!obj.contains("seq")) return;
+        onWsSendAck(obj.value("seq", uint32_t(0)), obj.value("status", 0),
+                    obj.value("error", std::string()));
+        return;
+    }
+
     if (type == "pong") return;
 }
 
@@ -331,28 +362,62 @@ void RelayClient::onWsTextMessage(const std::string& message)
 
 void RelayClient::sendEnvelope(const Bytes& sealedEnvelope, TrafficClass cls)
 {
-    if (m_coverIntervalSec > 0 && m_burstRemaining <= 0 && isConnected()) {
+    if (m_coverIntervalSec > 0 && m_constantRateMs <= 0
+        && m_burstRemaining <= 0 && isConnected()) {
         const int precover = 1 + int(randombytes_uniform(2));
         for (int i = 0; i < precover; i++)
             sendCoverEnvelope();
     }
     onRealActivity();
 
-    auto retryCb = [this, sealedEnvelope](const IHttpClient::Response& r) {
-        if (r.error.empty()) return;
+    ClassQueue& q = m_sendQueues[size_t(cls)];
 
-        if (r.status == 413) {
-            emitStatus("Envelope too large for relay — rejected.");
-            return;
+    // Sent inside a SendBatch scope: skip the queue so the envelope
+    // can join this scope's batch.  It still takes a slot, so a backlog
+    // queued before the scope waits for the batch like anything else.
+    if (sendBatchActive() && m_constantRateMs <= 0) {
+        q.sent      += 1;
+        q.sentBytes += sealedEnvelope.size();
+        dispatchEnvelope(sealedEnvelope, cls);
+        return;
+    }
+
+    q.pending.push_back({ sealedEnvelope, steadyMs() });
+    q.bytes    += sealedEnvelope.size();
+    q.peakDepth = std::max(q.peakDepth, q.pending.size());
+    pumpSendQueues();
+}
+
+void RelayClient::dispatchEnvelope(const Bytes& sealedEnvelope, TrafficClass cls)
+{
+    ++m_sendsInFlight;
+
+    // Fan-out copies share `released`, so the first answer frees the
+    // envelope's scheduler slot and later ones don't free it twice.  A
+    // slot from before the last stall reset was already freed there.
+    auto released = std::make_shared<bool>(false);
+    const uint64_t epoch = m_sendSlotEpoch;
+    auto retryCb = [this, sealedEnvelope, released, epoch](const IHttpClient::Response& r) {
+        if (!*released) {
+            *released = true;
+            if (epoch == m_sendSlotEpoch) releaseSendSlot();
         }
 
-        if (static_cast<int>(m_retryQueue.size()) < kMaxRetryQueue)
-            m_retryQueue.push_back({ sealedEnvelope, 0 });
-        if (!m_retryTimer->isActive())
-            scheduleRetry();
+        if (r.error.empty()) {
+            // Delivered — nothing to retry.
+        } else if (r.status == 413) {
+            emitStatus("Envelope too large for relay — rejected.");
+        } else {
+            if (static_cast<int>(m_retryQueue.size()) < kMaxRetryQueue)
+                m_retryQueue.push_back({ sealedEnvelope, 0 });
+            if (!m_retryTimer->isActive())
+                scheduleRetry();
 
-        if (r.status != 429)
-            emitStatus("relay send error: " + r.error + " — will retry");
+            if (r.status != 429)
+                emitStatus("relay send error: " + r.error + " — will retry");
+        }
+
+        pumpSendQueues();
     };
 
     // Routing priority:
@@ -360,16 +425,17 @@ void RelayClient::sendEnvelope(const Bytes& sealedEnvelope, TrafficClass cls)
     //      Parallel fan-out is incompatible: each onion ciphertext is
     //      addressed to one specific entry relay, broadcasting it to
     //      others would leak the routing structure.
-    //   2. Parallel fan-out (redundancy) — only for Message class.
+    //   2. Parallel fan-out (redundancy) — not for FileChunk class.
     //      File chunks are too large to multiply across relays.
-    //   3. Single-relay rotation — existing behaviour.
+    //   3. WS send path (throughput) — opt-in, primary relay only.
+    //   4. Single-relay rotation — existing behaviour.
     if (m_multiHop && m_sendRelays.size() >= 2) {
         const std::string via = pickSendRelay();
         std::string to        = pickSendRelay();
         if (to == via) to = m_relayUrl;
         forwardEnvelope(via, to, sealedEnvelope, std::move(retryCb));
     } else if (m_parallelFanOut
-               && cls == TrafficClass::Message
+               && cls != TrafficClass::FileChunk
                && m_sendRelays.size() >= 2) {
         const auto relays = pickKSendRelays(m_parallelFanOutK);
         // Share retryCb across copies — only the first failure enqueues
@@ -379,9 +445,473 @@ void RelayClient::sendEnvelope(const Bytes& sealedEnvelope, TrafficClass cls)
         for (const std::string& r : relays) {
             postEnvelope(r, sealedEnvelope, retryCb);
         }
+    } else if (wsSendActive() && sealedEnvelope.size() <= kWsSendMaxEnvelope) {
+        wsSendEnvelope(sealedEnvelope, std::move(retryCb));
     } else {
         postEnvelope(pickSendRelay(), sealedEnvelope, std::move(retryCb));
     }
+
+    if (m_sendsInFlight > 0 && !m_sendSlotTimer->isActive()) {
+        m_sendSlotTimer->startSingleShot(kSendSlotTimeoutMs,
+                                         [this] { onSendSlotTimeout(); });
+    }
+}
+
+void RelayClient::releaseSendSlot()
+{
+    --m_sendsInFlight;
+
+    // Any answer is progress: restart the stall timer while slots are
+    // still taken.
+    m_sendSlotTimer->stop();
+    if (m_sendsInFlight > 0) {
+        m_sendSlotTimer->startSingleShot(kSendSlotTimeoutMs,
+                                         [this] { onSendSlotTimeout(); });
+    }
+}
+
+void RelayClient::onSendSlotTimeout()
+{
+    if (m_sendsInFlight == 0) return;
+    P2P_WARN("[Relay] no send answered for " << kSendSlotTimeoutMs << "ms — "
+             << "freeing " << m_sendsInFlight << " scheduler slot(s)");
+
+    // The transport may never call back; don't let that wedge the
+    // queues.  Late answers see a stale epoch and leave the count alone.
+    m_sendsInFlight = 0;
+    ++m_sendSlotEpoch;
+    pumpSendQueues();
+}
+
+// ── Send scheduler ───────────────────────────────────────────────────────────
+
+double RelayClient::TokenBucket::available(int64_t now) const
+{
+    if (rate <= 0) return 0.0;
+    const double refill = double(std::max<int64_t>(0, now - lastMs)) * double(rate) / 1000.0;
+    return std::min(double(rate), tokens + refill);
+}
+
+void RelayClient::TokenBucket::charge(int64_t now, size_t bytes)
+{
+    if (rate <= 0) return;
+    tokens = available(now) - double(bytes);
+    lastMs = now;
+}
+
+void RelayClient::setBandwidthCaps(int64_t globalBytesPerSec, int64_t perRelayBytesPerSec)
+{
+    const int64_t now = steadyMs();
+    m_globalBudget.rate   = std::max<int64_t>(0, globalBytesPerSec);
+    m_globalBudget.tokens = double(m_globalBudget.rate);
+    m_globalBudget.lastMs = now;
+    m_relayCapBps = std::max<int64_t>(0, perRelayBytesPerSec);
+    m_relayBudgets.clear();
+
+    m_sendPumpTimer->stop();
+    pumpSendQueues();
+}
+
+std::vector<RelayClient::SendQueueStats> RelayClient::sendQueueStats() const
+{
+    std::vector<SendQueueStats> out;
+    out.reserve(kTrafficClassCount);
+    for (int i = 0; i < kTrafficClassCount; ++i) {
+        const ClassQueue& q = m_sendQueues[size_t(i)];
+        SendQueueStats s;
+        s.cls       = TrafficClass(i);
+        s.depth     = q.pending.size();
+        s.bytes     = q.bytes;
+        s.peakDepth = q.peakDepth;
+        s.sent      = q.sent;
+        s.sentBytes = q.sentBytes;
+        s.maxWaitMs = q.maxWaitMs;
+        out.push_back(s);
+    }
+    return out;
+}
+
+int RelayClient::sendWindow() const
+{
+    // The WS path pipelines up to the relay's advertised window; don't
+    // let the scheduler be the narrower pipe there.
+    if (wsSendActive()) return std::max(kMaxSendsInFlight, m_wsSendWindow);
+    return kMaxSendsInFlight;
+}
+
+bool RelayClient::relayHasBudget(const std::string& relayUrl, int64_t now) const
+{
+    if (m_relayCapBps <= 0) return true;
+    const auto it = m_relayBudgets.find(baseOf(relayUrl));
+    return it == m_relayBudgets.end() || it->second.available(now) > 0.0;
+}
+
+int RelayClient::budgetWaitMs(int64_t now) const
+{
+    auto waitFor = [now](const TokenBucket& b) -> int64_t {
+        if (b.rate <= 0) return 0;
+        const double avail = b.available(now);
+        if (avail > 0.0) return 0;
+        return int64_t((1.0 - avail) * 1000.0 / double(b.rate)) + 1;
+    };
+
+    int64_t wait = waitFor(m_globalBudget);
+    if (m_relayCapBps > 0) {
+        // Any one relay with budget is enough — selection skips the
+        // ones in debt (see healthyRelays).
+        const std::vector<std::string> pool =
+            m_sendRelays.empty() ? std::vector<std::string>{ m_relayUrl } : m_sendRelays;
+        int64_t best = -1;
+        for (const std::string& url : pool) {
+            const auto it = m_relayBudgets.find(baseOf(url));
+            const int64_t w = (it == m_relayBudgets.end()) ? 0 : waitFor(it->second);
+            if (best < 0 || w < best) best = w;
+        }
+        wait = std::max(wait, best);
+    }
+    return int(std::min<int64_t>(wait, 60 * 1000));
+}
+
+void RelayClient::chargeBandwidth(const std::string& relayUrl, size_t bytes)
+{
+    const int64_t now = steadyMs();
+    m_globalBudget.charge(now, bytes);
+    if (m_relayCapBps <= 0 || relayUrl.empty()) return;
+
+    auto [it, inserted] = m_relayBudgets.try_emplace(baseOf(relayUrl));
+    if (inserted) {
+        it->second.rate   = m_relayCapBps;
+        it->second.tokens = double(m_relayCapBps);
+        it->second.lastMs = now;
+    }
+    it->second.charge(now, bytes);
+}
+
+int RelayClient::nextSendClass()
+{
+    if (m_sendsInFlight >= sendWindow()) return -1;
+
+    constexpr int kControl = int(TrafficClass::Control);
+    constexpr int kMessage = int(TrafficClass::Message);
+    constexpr int kFile    = int(TrafficClass::FileChunk);
+
+    if (!m_sendQueues[kControl].pending.empty()) return kControl;
+
+    const bool haveMsg  = !m_sendQueues[kMessage].pending.empty();
+    const bool haveFile = !m_sendQueues[kFile].pending.empty();
+    if (!haveMsg && !haveFile) return -1;
+
+    if (const int waitMs = budgetWaitMs(steadyMs()); waitMs > 0) {
+        if (!m_sendPumpTimer->isActive())
+            m_sendPumpTimer->startSingleShot(waitMs, [this] { pumpSendQueues(); });
+        return -1;
+    }
+
+    if (!haveFile) return kMessage;
+    if (!haveMsg)  return kFile;
+
+    // Start-time fair queueing: the smallest virtual start tag goes
+    // next (ties to chat).  A class that sat idle restarts from the
+    // current virtual time rather than cashing in the gap.
+    const double msgStart  = std::max(m_wfqVirtualTime, m_sendQueues[kMessage].lastFinish);
+    const double fileStart = std::max(m_wfqVirtualTime, m_sendQueues[kFile].lastFinish);
+    return msgStart <= fileStart ? kMessage : kFile;
+}
+
+void RelayClient::pumpSendQueues()
+{
+    // In constant-rate mode only the tick takes envelopes off the queues.
+    if (m_constantRateMs > 0) return;
+    for (int idx = nextSendClass(); idx >= 0; idx = nextSendClass())
+        dispatchFromQueue(idx);
+}
+
+void RelayClient::dispatchFromQueue(int idx, size_t padTo)
+{
+    ClassQueue& q = m_sendQueues[size_t(idx)];
+    QueuedSend qs = std::move(q.pending.front());
+    q.pending.pop_front();
+
+    const size_t size = qs.envelope.size();
+    q.bytes     -= size;
+    q.sent      += 1;
+    q.sentBytes += size;
+    q.maxWaitMs  = std::max(q.maxWaitMs, steadyMs() - qs.enqueuedMs);
+
+    const TrafficClass cls = TrafficClass(idx);
+    if (cls != TrafficClass::Control) {
+        const int weight = (cls == TrafficClass::Message) ? kMessageWeight
+                                                          : kFileChunkWeight;
+        const double start = std::max(m_wfqVirtualTime, q.lastFinish);
+        q.lastFinish     = start + double(size) / double(weight);
+        m_wfqVirtualTime = start;
+    }
+
+    if (padTo) SealedEnvelope::padRelayTo(qs.envelope, padTo);
+    dispatchEnvelope(qs.envelope, cls);
+}
+
+// ── WS send path ─────────────────────────────────────────────────────────────
+
+void RelayClient::setWsSendEnabled(bool enabled)
+{
+    m_wsSendEnabled = enabled;
+    if (enabled) return;
+
+    // Frames already on the wire still get their acks; anything not
+    // yet sent goes over HTTP.
+    std::deque<WsSendFrame> queued;
+    queued.swap(m_wsSendQueue);
+    for (WsSendFrame& f : queued)
+        postEnvelope(pickSendRelay(), f.envelope, std::move(f.cb));
+}
+
+bool RelayClient::wsSendActive() const
+{
+    return m_wsSendEnabled && m_wsSendWindow > 0 && isConnected();
+}
+
+void RelayClient::wsSendEnvelope(const Bytes& envelope, IHttpClient::Callback cb)
+{
+    // No jitter here: jitter is a timing-unlinkability measure, and
+    // this path has already traded unlinkability for throughput.
+    WsSendFrame f;
+    f.seq      = m_wsSendSeq++;
+    f.envelope = envelope;
+    f.cb       = std::move(cb);
+    m_wsSendQueue.push_back(std::move(f));
+    pumpWsSendQueue();
+}
+
+void RelayClient::pumpWsSendQueue()
+{
+    while (!m_wsSendQueue.empty()
+           && static_cast<int>(m_wsSendInFlight.size()) < m_wsSendWindow) {
+        WsSendFrame f = std::move(m_wsSendQueue.front());
+        m_wsSendQueue.pop_front();
+
+        Bytes frame;
+        frame.reserve(kWsSendHeaderLen + f.envelope.size());
+        frame.push_back(kWsSendFrameTag);
+        frame.push_back(uint8_t(f.seq >> 24));
+        frame.push_back(uint8_t(f.seq >> 16));
+        frame.push_back(uint8_t(f.seq >> 8));
+        frame.push_back(uint8_t(f.seq));
+        frame.insert(frame.end(), f.envelope.begin(), f.envelope.end());
+
+        if (!m_ws->sendBinaryMessage(frame)) {
+            // Platform shim has no binary send — that won't change
+            // mid-session, so turn the feature off outright.
+            P2P_WARN("[Relay] WS send: platform can't send binary frames — "
+                     "staying on HTTP");
+            m_wsSendEnabled = false;
+            m_wsSendQueue.push_front(std::move(f));
+            spillWsSendsToHttp();
+            return;
+        }
+
+        chargeBandwidth(m_relayUrl, frame.size());
+        f.sentAtMs = steadyMs();
+        const uint32_t seq = f.seq;
+        m_wsSendInFlight.emplace(seq, std::move(f));
+    }
+
+    if (!m_wsSendInFlight.empty() && !m_wsSendAckTimer->isActive()) {
+        m_wsSendAckTimer->startSingleShot(kWsSendAckTimeoutMs,
+                                          [this] { onWsSendAckTimeout(); });
+    }
+}
+
+void RelayClient::onWsSendAck(uint32_t seq, int status, const std::string& error)
+{
+    const auto it = m_wsSendInFlight.find(seq);
+    if (it == m_wsSendInFlight.end()) return;  // late ack after a spill
+    WsSendFrame f = std::move(it->second);
+    m_wsSendInFlight.erase(it);
+
+    IHttpClient::Response r;
+    r.status = status;
+    if (status < 200 || status >= 300)
+        r.error = error.empty() ? "HTTP " + std::to_string(status) : error;
+    recordRelayOutcome(m_relayUrl, steadyMs() - f.sentAtMs, r);
+
+    // Ack progress resets the stall timer; pump re-arms it if frames
+    // are still outstanding.
+    m_wsSendAckTimer->stop();
+    pumpWsSendQueue();
+
+    if (f.cb) f.cb(r);
+}
+
+void RelayClient::onWsSendAckTimeout()
+{
+    if (m_wsSendInFlight.empty()) return;
+    P2P_WARN("[Relay] WS send: no ack for " << kWsSendAckTimeoutMs
+             << "ms — falling back to HTTP until reconnect");
+
+    IHttpClient::Response r;
+    r.error = "ws send ack timeout";
+    recordRelayOutcome(m_relayUrl, kWsSendAckTimeoutMs, r);
+    spillWsSendsToHttp();
+}
+
+void RelayClient::spillWsSendsToHttp()
+{
+    m_wsSendWindow = 0;
+    m_wsSendAckTimer->stop();
+
+    // In-flight first (std::map iterates in seq order), then queued,
+    // so the HTTP path sees roughly the original send order.
+    std::vector<WsSendFrame> pending;
+    pending.reserve(m_wsSendInFlight.size() + m_wsSendQueue.size());
+    for (auto& [seq, f] : m_wsSendInFlight) pending.push_back(std::move(f));
+    for (WsSendFrame& f : m_wsSendQueue)    pending.push_back(std::move(f));
+    m_wsSendInFlight.clear();
+    m_wsSendQueue.clear();
+
+    if (pending.empty()) return;
+    P2P_LOG("[Relay] WS send: re-sending " << pending.size()
+            << " envelope(s) over HTTP");
+    for (WsSendFrame& f : pending)
+        postEnvelope(pickSendRelay(), f.envelope, std::move(f.cb));
+}
+
+// ── Batched sends ────────────────────────────────────────────────────────────
+
+void RelayClient::beginSendBatch()
+{
+    ++m_sendBatchDepth;
+}
+
+void RelayClient::endSendBatch()
+{
+    if (m_sendBatchDepth <= 0) return;
+    if (--m_sendBatchDepth == 0) flushSendBatch();
+}
+
+void RelayClient::flushSendBatch()
+{
+    std::map<std::string, std::vector<BatchedEnvelope>> pending;
+    pending.swap(m_sendBatch);
+
+    for (auto& [relayUrl, list] : pending) {
+        // One batch per jitter slot, in post order within the slot.
+        // With jitter off every envelope lands in slot 0.
+        std::map<int, std::vector<BatchedEnvelope>> slots;
+        for (BatchedEnvelope& e : list)
+            slots[e.jitterMs / kBatchSlotMs].push_back(std::move(e));
+
+        for (auto& [slot, entries] : slots) {
+            int delayMs = entries.front().jitterMs;
+            for (const BatchedEnvelope& e : entries) delayMs = std::min(delayMs, e.jitterMs);
+
+            // Split into request-sized pieces — the relay caps both the
+            // envelope count and the body size of one batch.
+            std::vector<BatchedEnvelope> piece;
+            size_t pieceBytes = 0;
+            for (BatchedEnvelope& e : entries) {
+                const size_t sz = 4 + e.envelope.size();
+                if (!piece.empty() && (piece.size() >= kMaxBatchEnvelopes ||
+                                       pieceBytes + sz > kMaxBatchBytes)) {
+                    postBatch(relayUrl, std::move(piece), delayMs);
+                    piece.clear();
+                    pieceBytes = 0;
+                }
+                pieceBytes += sz;
+                piece.push_back(std::move(e));
+            }
+            if (!piece.empty()) postBatch(relayUrl, std::move(piece), delayMs);
+        }
+    }
+}
+
+void RelayClient::postBatch(const std::string& relayUrl,
+                             std::vector<BatchedEnvelope> batch, int delayMs)
+{
+    if (batch.size() == 1) {
+        // The envelope already drew its jitter; don't let postEnvelope
+        // draw a second one.
+        BatchedEnvelope& e = batch.front();
+        chargeBandwidth(relayUrl, e.envelope.size());
+        const std::string sendUrl = urlWithPath(relayUrl, "/v1/send");
+        if (delayMs <= 0) {
+            m_http.post(sendUrl, e.envelope, {}, withHealthProbe(relayUrl, std::move(e.cb)));
+            return;
+        }
+        m_timers.singleShot(delayMs,
+            [this, relayUrl, sendUrl, envelope = std::move(e.envelope),
+             cb = std::move(e.cb)]() mutable {
+                m_http.post(sendUrl, envelope, {}, withHealthProbe(relayUrl, std::move(cb)));
+            });
+        return;
+    }
+
+    Bytes body;
+    size_t total = 0;
+    for (const BatchedEnvelope& e : batch) total += 4 + e.envelope.size();
+    body.reserve(total);
+    for (const BatchedEnvelope& e : batch) {
+        const uint32_t n = static_cast<uint32_t>(e.envelope.size());
+        body.push_back(uint8_t(n >> 24));
+        body.push_back(uint8_t(n >> 16));
+        body.push_back(uint8_t(n >> 8));
+        body.push_back(uint8_t(n));
+        body.insert(body.end(), e.envelope.begin(), e.envelope.end());
+    }
+
+    // shared_ptr so the (copyable) IHttpClient::Callback can own the
+    // per-envelope callbacks.
+    auto entries = std::make_shared<std::vector<BatchedEnvelope>>(std::move(batch));
+    IHttpClient::Callback onDone =
+        [this, relayUrl, entries](const IHttpClient::Response& r) {
+        if (r.status == 404 || r.status == 405) {
+            P2P_LOG("[Relay] " << baseOf(relayUrl)
+                    << " has no /v1/send-batch — sending individually");
+            m_noBatchRelays.insert(baseOf(relayUrl));
+            for (BatchedEnvelope& e : *entries)
+                postEnvelope(relayUrl, e.envelope, std::move(e.cb));
+            return;
+        }
+
+        json results = json::array();
+        if (r.error.empty()) {
+            try {
+                const json doc = json::parse(std::string(r.body.begin(), r.body.end()));
+                if (doc.is_object() && doc.contains("results") && doc["results"].is_array())
+                    results = doc["results"];
+            } catch (...) {}
+        }
+
+        for (size_t i = 0; i < entries->size(); ++i) {
+            IHttpClient::Response er;
+            if (!r.error.empty()) {
+                // Whole request failed — every envelope shares the fate.
+                er.status = r.status;
+                er.error  = r.error;
+            } else if (i < results.size() && results[i].is_object()) {
+                er.status = results[i].value("status", 0);
+                if (er.status < 200 || er.status >= 300) {
+                    er.error = results[i].value("error",
+                                                "HTTP " + std::to_string(er.status));
+                }
+            } else {
+                er.error = "relay batch response missing result";
+            }
+            if ((*entries)[i].cb) (*entries)[i].cb(er);
+        }
+    };
+
+    chargeBandwidth(relayUrl, body.size());
+    const std::string batchUrl = urlWithPath(relayUrl, "/v1/send-batch");
+    if (delayMs <= 0) {
+        m_http.post(batchUrl, body, {}, withHealthProbe(relayUrl, std::move(onDone)));
+        return;
+    }
+    m_timers.singleShot(delayMs,
+        [this, relayUrl, batchUrl, body = std::move(body),
+         onDone = std::move(onDone)]() mutable {
+            m_http.post(batchUrl, body, {}, withHealthProbe(relayUrl, std::move(onDone)));
+        });
 }
 
 // ── Presence ─────────────────────────────────────────────────────────────────
@@ -464,8 +994,9 @@ void RelayClient::processRetryQueue()
     m_retryQueue.erase(m_retryQueue.begin());
 
     const std::string sendUrl = urlWithPath(m_relayUrl, "/v1/send");
+    chargeBandwidth(m_relayUrl, pe.data.size());
 
-    m_http.post(sendUrl, pe.data, {},
+    m_http.post(sendUrl, pe.data, {}, withHealthProbe(m_relayUrl,
                 [this, pe](const IHttpClient::Response& r) {
         m_retryInFlight = false;
 
@@ -487,7 +1018,7 @@ void RelayClient::processRetryQueue()
         } else {
             emitStatus("Gave up delivering envelope after max retries.");
         }
-    });
+    }));
 }
 
 // ── DAITA ────────────────────────────────────────────────────────────────────
@@ -509,7 +1040,7 @@ void RelayClient::setCoverTrafficInterval(int seconds)
 
 void RelayClient::onRealActivity()
 {
-    if (m_coverIntervalSec <= 0) return;
+    if (m_coverIntervalSec <= 0 || m_constantRateMs > 0) return;
 
     if (m_burstRemaining > 0) {
         --m_burstRemaining;
@@ -523,7 +1054,7 @@ void RelayClient::onRealActivity()
 
 void RelayClient::scheduleCoverTimer()
 {
-    if (m_coverIntervalSec <= 0) return;
+    if (m_coverIntervalSec <= 0 || m_constantRateMs > 0) return;
 
     if (m_burstRemaining > 0) {
         const int delayMs = 1000 + int(randombytes_uniform(4000));
@@ -545,6 +1076,15 @@ void RelayClient::sendCoverEnvelope()
 {
     if (!isConnected()) return;
 
+    const Bytes env = makeCoverEnvelope();
+    if (!env.empty()) postCoverEnvelope(env);
+
+    if (m_burstRemaining > 0) --m_burstRemaining;
+    scheduleCoverTimer();
+}
+
+Bytes RelayClient::makeCoverEnvelope() const
+{
     std::vector<std::string> onlinePool;
     onlinePool.reserve(m_knownPeers.size());
     for (const std::string& pid : m_knownPeers)
@@ -567,11 +1107,7 @@ void RelayClient::sendCoverEnvelope()
     } else if (m_crypto) {
         recipientPub = m_crypto->identityPub();
     }
-    if (recipientPub.size() != 32) {
-        if (m_burstRemaining > 0) --m_burstRemaining;
-        scheduleCoverTimer();
-        return;
-    }
+    if (recipientPub.size() != 32) return {};
 
     const bool hybrid = randombytes_uniform(10) == 0;
     const int baseMin = hybrid
@@ -591,29 +1127,32 @@ void RelayClient::sendCoverEnvelope()
     //   UniformBuckets  : 34 / 33 / 33 — every user's cover histogram
     //                     is identical regardless of real-send shape.
     //                     Roughly 3x the bandwidth of the biased mode.
+    //
+    // Constant-rate mode always fills its one tick bucket instead.
     constexpr size_t kSmallMax  =   2 * 1024 - 37;  //  2011
     constexpr size_t kMediumMax =  16 * 1024 - 37;  // 16347
     constexpr size_t kLargeMax  = 256 * 1024 - 37;  // 262107
 
-    const uint32_t roll = randombytes_uniform(100);
-    uint32_t bucketProb[3];  // small / medium / large cutpoints in 0..99
-    if (m_coverSizeMode == CoverSizeMode::UniformBuckets) {
-        bucketProb[0] = 34;  // 0..33  → small
-        bucketProb[1] = 67;  // 34..66 → medium
-        bucketProb[2] = 100; // 67..99 → large
+    std::array<uint32_t, 3> mix;  // small / medium / large weights
+    if (m_constantRateMs > 0) {
+        mix = { m_constantRateBytes ==   2 * 1024 ? 1u : 0u,
+                m_constantRateBytes ==  16 * 1024 ? 1u : 0u,
+                m_constantRateBytes == 256 * 1024 ? 1u : 0u };
+    } else if (m_coverSizeMode == CoverSizeMode::UniformBuckets) {
+        mix = { 34, 33, 33 };
     } else {
-        bucketProb[0] = 60;  // 0..59  → small
-        bucketProb[1] = 90;  // 60..89 → medium
-        bucketProb[2] = 100; // 90..99 → large
+        mix = { 60, 30, 10 };
     }
+    const uint32_t total = mix[0] + mix[1] + mix[2];
+    const uint32_t roll  = total ? randombytes_uniform(total) : 0;
 
     size_t innerSize;
-    if (roll < bucketProb[0]) {
+    if (total == 0 || roll < mix[0]) {
         const size_t span = (kSmallMax > size_t(baseMin))
             ? kSmallMax - size_t(baseMin) : 0;
         innerSize = size_t(baseMin) +
                     (span ? size_t(randombytes_uniform(uint32_t(span))) : 0);
-    } else if (roll < bucketProb[1]) {
+    } else if (roll < mix[0] + mix[1]) {
         // Span: (2 KiB .. 16 KiB) — skip the small bucket entirely.
         const size_t lo   = kSmallMax + 1;
         const size_t span = kMediumMax - lo;
@@ -629,13 +1168,11 @@ void RelayClient::sendCoverEnvelope()
     randombytes_buf(body.data(), innerSize);
     body[0] = hybrid ? uint8_t(0x03) : uint8_t(0x02);
 
-    Bytes env = SealedEnvelope::wrapForRelay(recipientPub, body);
-    if (env.empty()) {
-        if (m_burstRemaining > 0) --m_burstRemaining;
-        scheduleCoverTimer();
-        return;
-    }
+    return SealedEnvelope::wrapForRelay(recipientPub, body);
+}
 
+void RelayClient::postCoverEnvelope(const Bytes& env)
+{
     auto noop = [](const IHttpClient::Response&) {};
     if (m_multiHop && m_sendRelays.size() >= 2) {
         const std::string via = pickSendRelay();
@@ -645,9 +1182,50 @@ void RelayClient::sendCoverEnvelope()
     } else {
         postEnvelope(pickSendRelay(), env, noop);
     }
+}
 
-    if (m_burstRemaining > 0) --m_burstRemaining;
-    scheduleCoverTimer();
+// ── Constant-rate shaping ───────────────────────────────────────────────────
+
+void RelayClient::setConstantRate(int intervalMs, TickBucket bucket)
+{
+    const bool wasOn = m_constantRateMs > 0;
+    m_constantRateMs    = std::max(0, intervalMs);
+    m_constantRateBytes = bucket == TickBucket::Small ?   2 * 1024
+                        : bucket == TickBucket::Large ? 256 * 1024
+                                                      :  16 * 1024;
+    m_constantRateTimer->stop();
+
+    if (m_constantRateMs > 0) {
+        // The tick stream replaces both the idle cover timer and the
+        // pre-send bursts.
+        m_coverTimer->stop();
+        m_burstRemaining = 0;
+        m_constantRateTimer->startSingleShot(m_constantRateMs,
+                                             [this] { onConstantRateTick(); });
+        return;
+    }
+
+    if (wasOn) {
+        if (m_coverIntervalSec > 0 && isConnected()) scheduleCoverTimer();
+        pumpSendQueues();  // release whatever was waiting for a tick
+    }
+}
+
+void RelayClient::onConstantRateTick()
+{
+    // Re-arm first so the cadence doesn't drift by the send's cost.
+    m_constantRateTimer->startSingleShot(m_constantRateMs,
+                                         [this] { onConstantRateTick(); });
+
+    const int idx = nextSendClass();
+    if (idx >= 0) {
+        // Same size as the cover this tick would otherwise carry.
+        dispatchFromQueue(idx, m_constantRateBytes);
+        return;
+    }
+    if (!isConnected()) return;
+    const Bytes env = makeCoverEnvelope();
+    if (!env.empty()) postCoverEnvelope(env);
 }
 
 // ── Multi-relay routing ─────────────────────────────────────────────────────
@@ -798,21 +1376,20 @@ std::vector<std::string> RelayClient::pickKSendRelays(int k) const
 {
     if (m_sendRelays.empty()) return {};
 
-    const int total = static_cast<int>(m_sendRelays.size());
-    if (k <= 0 || k >= total) return m_sendRelays;
+    std::vector<std::string> pool = healthyRelays(m_sendRelays);
+    const int total = static_cast<int>(pool.size());
+    if (k <= 0 || k >= total) return pool;
 
-    // Fisher-Yates partial shuffle: pick K unique without replacement.
-    // Crypto-grade RNG (libsodium) — same rationale as pickSendRelay:
-    // observers can't predict future fan-out targets from past ones.
-    std::vector<std::string> pool = m_sendRelays;
+    // Weighted sampling without replacement: K successive weighted
+    // picks, each removing the winner from the pool.  Crypto-grade RNG
+    // (libsodium) — same rationale as pickSendRelay: observers can't
+    // predict future fan-out targets from past ones.
     std::vector<std::string> picked;
     picked.reserve(static_cast<size_t>(k));
     for (int i = 0; i < k; ++i) {
-        const uint32_t span = static_cast<uint32_t>(pool.size());
-        const uint32_t idx  = randombytes_uniform(span);
-        picked.push_back(std::move(pool[idx]));
-        pool[idx] = std::move(pool.back());
-        pool.pop_back();
+        std::string next = weightedPick(pool);
+        pool.erase(std::find(pool.begin(), pool.end(), next));
+        picked.push_back(std::move(next));
     }
     return picked;
 }
@@ -843,25 +1420,224 @@ bool RelayClient::isDuplicateEnvelope(const Bytes& sealed)
 
 std::string RelayClient::pickSendRelay()
 {
-    // Pick uniformly at random rather than strict round-robin.
-    // Deterministic rotation lets a traffic analyst observing multiple
-    // relays fingerprint a single client by matching the N-step pattern.
-    // Uniform random sampling over the configured relays removes that
-    // signal; the expected per-relay load is the same as round-robin,
-    // just without the identifying cadence.
+    // Pick at random rather than strict round-robin.  Deterministic
+    // rotation lets a traffic analyst observing multiple relays
+    // fingerprint a single client by matching the N-step pattern.
+    // Random sampling over the configured relays removes that signal.
+    // The draw is weighted by relay health so slow / failing relays
+    // shed load; with no health history every relay carries the same
+    // prior weight and this degrades to the old uniform pick.
     //
     // Uses randombytes_uniform from libsodium — crypto-grade RNG (not
     // math/rand) so observers can't predict future picks from past ones.
     if (m_sendRelays.empty()) return m_relayUrl;
-    const uint32_t idx = randombytes_uniform(
-        static_cast<uint32_t>(m_sendRelays.size()));
-    m_sendRelayIdx = idx;  // kept for diagnostics / compat; no longer load-bearing
-    return m_sendRelays[idx];
+    const std::string pick = weightedPick(healthyRelays(m_sendRelays));
+    const auto it = std::find(m_sendRelays.begin(), m_sendRelays.end(), pick);
+    m_sendRelayIdx = size_t(it - m_sendRelays.begin());  // kept for diagnostics / compat
+    return pick;
+}
+
+// ── Relay health ────────────────────────────────────────────────────────────
+
+RelayClient::RelayHealth& RelayClient::healthFor(const std::string& relayUrl)
+{
+    return m_relayHealth[baseOf(relayUrl)];
+}
+
+double RelayClient::relayWeight(const std::string& relayUrl) const
+{
+    const auto it = m_relayHealth.find(baseOf(relayUrl));
+    if (it == m_relayHealth.end()) {
+        // No history yet — neutral prior (latency == reference).
+        return 0.5;
+    }
+    const RelayHealth& h = it->second;
+    // Latency term is 1/2 at the prior and falls off hyperbolically, so
+    // a relay at 4x the reference latency carries ~1/4 the weight of one
+    // at the reference.  Errors are penalised harder than 429s: a
+    // throttling relay is alive, just busy.
+    const double latencyScore =
+        kLatencyPriorMs / (kLatencyPriorMs + std::max(0.0, h.ewmaLatencyMs));
+    const double w = latencyScore
+                   * (1.0 - h.ewmaErrorRate)
+                   * (1.0 - 0.5 * h.ewmaThrottleRate);
+    return std::max(kMinRelayWeight, w);
+}
+
+std::vector<std::string>
+RelayClient::healthyRelays(const std::vector<std::string>& pool) const
+{
+    std::vector<std::string> out;
+    out.reserve(pool.size());
+    for (const std::string& url : pool) {
+        const auto it = m_relayHealth.find(baseOf(url));
+        if (it != m_relayHealth.end() && it->second.ejected) continue;
+        out.push_back(url);
+    }
+    // Every relay ejected: keep sending (uniformly, via equal-ish
+    // weights) rather than stalling delivery until a probe timer fires.
+    if (out.empty()) out = pool;
+
+    // Relays over their bandwidth cap sit out while another has budget.
+    if (m_relayCapBps > 0) {
+        const int64_t now = steadyMs();
+        std::vector<std::string> funded;
+        for (const std::string& url : out)
+            if (relayHasBudget(url, now)) funded.push_back(url);
+        if (!funded.empty()) return funded;
+    }
+    return out;
+}
+
+std::string RelayClient::weightedPick(const std::vector<std::string>& pool) const
+{
+    if (pool.empty()) return m_relayUrl;
+    if (pool.size() == 1) return pool.front();
+
+    // Quantise to integer weights so the draw can use
+    // randombytes_uniform (unbiased over [0, total)).
+    constexpr double kScale = 10000.0;
+    std::vector<uint32_t> weights;
+    weights.reserve(pool.size());
+    uint32_t total = 0;
+    for (const std::string& url : pool) {
+        const uint32_t w = std::max<uint32_t>(
+            1, static_cast<uint32_t>(relayWeight(url) * kScale));
+        weights.push_back(w);
+        total += w;
+    }
+    uint32_t roll = randombytes_uniform(total);
+    for (size_t i = 0; i < pool.size(); ++i) {
+        if (roll < weights[i]) return pool[i];
+        roll -= weights[i];
+    }
+    return pool.back();
+}
+
+IHttpClient::Callback RelayClient::withHealthProbe(const std::string& relayUrl,
+                                                    IHttpClient::Callback cb)
+{
+    const int64_t startMs = steadyMs();
+    return [this, relayUrl, startMs, cb = std::move(cb)](const IHttpClient::Response& r) {
+        recordRelayOutcome(relayUrl, steadyMs() - startMs, r);
+        if (cb) cb(r);
+    };
+}
+
+void RelayClient::recordRelayOutcome(const std::string& relayUrl, int64_t latencyMs,
+                                     const IHttpClient::Response& r)
+{
+    if (relayUrl.empty()) return;
+    RelayHealth& h = healthFor(relayUrl);
+
+    // 413 is the envelope's fault, not the relay's — count the round
+    // trip (the relay answered) but don't move the error / throttle
+    // rates or the failure streak.
+    const bool throttled = (r.status == 429);
+    const bool oversize  = (r.status == 413);
+    const bool failed    = !r.error.empty() && !throttled && !oversize;
+
+    const double a = kHealthEwmaAlpha;
+    h.ewmaLatencyMs    = (1.0 - a) * h.ewmaLatencyMs + a * double(std::max<int64_t>(0, latencyMs));
+    h.ewmaErrorRate    = (1.0 - a) * h.ewmaErrorRate    + a * (failed    ? 1.0 : 0.0);
+    h.ewmaThrottleRate = (1.0 - a) * h.ewmaThrottleRate + a * (throttled ? 1.0 : 0.0);
+    ++h.sent;
+    if (failed)    ++h.failed;
+    if (throttled) ++h.throttled;
+
+    if (oversize) return;
+
+    if (!failed && !throttled) {
+        if (h.probing) {
+            P2P_LOG("[Relay] health: " << baseOf(relayUrl) << " probe succeeded, re-admitted");
+            h.probing    = false;
+            h.ejectCount = 0;
+        }
+        h.consecutiveFailures = 0;
+        return;
+    }
+
+    ++h.consecutiveFailures;
+    if (h.ejected) return;
+    if (h.probing || h.consecutiveFailures >= kEjectAfterFailures)
+        ejectRelay(relayUrl, h);
+}
+
+void RelayClient::ejectRelay(const std::string& relayUrl, RelayHealth& h)
+{
+    const int shift   = std::min(h.ejectCount, 5);
+    const int delayMs = std::min(kEjectBaseMs << shift, kEjectMaxMs);
+    ++h.ejectCount;
+    h.ejected = true;
+    h.probing = false;
+
+    P2P_WARN("[Relay] health: ejecting " << baseOf(relayUrl) << " for "
+             << (delayMs / 1000) << "s after " << h.consecutiveFailures
+             << " consecutive failures");
+
+    if (!h.probeTimer) h.probeTimer = m_timers.create();
+    if (!h.probeTimer) return;
+    const std::string key = baseOf(relayUrl);
+    h.probeTimer->startSingleShot(delayMs, [this, key] {
+        auto it = m_relayHealth.find(key);
+        if (it == m_relayHealth.end()) return;
+        RelayHealth& rh = it->second;
+        // Half-open: back in the pool with fresh priors so the old
+        // EWMA doesn't starve the probe of traffic.  The next outcome
+        // either clears the backoff or re-ejects immediately.
+        rh.ejected             = false;
+        rh.probing             = true;
+        rh.consecutiveFailures = 0;
+        rh.ewmaLatencyMs       = kLatencyPriorMs;
+        rh.ewmaErrorRate       = 0.0;
+        rh.ewmaThrottleRate    = 0.0;
+        P2P_LOG("[Relay] health: probing " << key);
+    });
+}
+
+std::vector<RelayClient::RelayHealthStats> RelayClient::relayHealthStats() const
+{
+    // Report every relay we'd actually send to (primary + send pool),
+    // including ones with no traffic yet, followed by any relay that
+    // only has history (e.g. removed from the pool by privacy level 0).
+    std::vector<std::string> keys;
+    auto addKey = [&keys](const std::string& url) {
+        if (url.empty()) return;
+        const std::string k = baseOf(url);
+        if (std::find(keys.begin(), keys.end(), k) == keys.end()) keys.push_back(k);
+    };
+    addKey(m_relayUrl);
+    for (const std::string& url : m_sendRelays) addKey(url);
+    for (const auto& kv : m_relayHealth) addKey(kv.first);
+
+    std::vector<RelayHealthStats> out;
+    out.reserve(keys.size());
+    for (const std::string& k : keys) {
+        RelayHealthStats s;
+        s.url       = k;
+        s.latencyMs = kLatencyPriorMs;
+        const auto it = m_relayHealth.find(k);
+        if (it != m_relayHealth.end()) {
+            const RelayHealth& h = it->second;
+            s.latencyMs    = h.ewmaLatencyMs;
+            s.errorRate    = h.ewmaErrorRate;
+            s.throttleRate = h.ewmaThrottleRate;
+            s.sent         = h.sent;
+            s.failed       = h.failed;
+            s.throttled    = h.throttled;
+            s.ejected      = h.ejected;
+            s.probing      = h.probing;
+        }
+        s.weight = s.ejected ? 0.0 : relayWeight(k);
+        out.push_back(std::move(s));
+    }
+    return out;
 }
 
 int RelayClient::pickJitterMs() const
 {
-    if (m_jitterMaxMs <= 0) return 0;
+    // Constant-rate ticks are the schedule; jitter would only blur it.
+    if (m_jitterMaxMs <= 0 || m_constantRateMs > 0) return 0;
     const int span = m_jitterMaxMs - m_jitterMinMs;
     if (span <= 0) return m_jitterMinMs;
     return m_jitterMinMs + int(randombytes_uniform(uint32_t(span + 1)));
@@ -870,17 +1646,24 @@ int RelayClient::pickJitterMs() const
 void RelayClient::postEnvelope(const std::string& relayUrl, const Bytes& envelope,
                                 IHttpClient::Callback cb)
 {
+    if (sendBatchActive() && !m_noBatchRelays.count(baseOf(relayUrl))) {
+        m_sendBatch[relayUrl].push_back({ envelope, std::move(cb), pickJitterMs() });
+        return;
+    }
+
     const std::string sendUrl = urlWithPath(relayUrl, "/v1/send");
+    chargeBandwidth(relayUrl, envelope.size());
 
     const int jitterMs = pickJitterMs();
     if (jitterMs <= 0) {
-        m_http.post(sendUrl, envelope, {}, std::move(cb));
+        m_http.post(sendUrl, envelope, {}, withHealthProbe(relayUrl, std::move(cb)));
         return;
     }
 
     m_timers.singleShot(jitterMs,
-        [this, sendUrl, envelope, cb = std::move(cb)]() mutable {
-            m_http.post(sendUrl, envelope, {}, std::move(cb));
+        [this, relayUrl, sendUrl, envelope, cb = std::move(cb)]() mutable {
+            m_http.post(sendUrl, envelope, {},
+                        withHealthProbe(relayUrl, std::move(cb)));
         });
 }
 
@@ -898,14 +1681,20 @@ void RelayClient::forwardEnvelope(const std::string& viaRelay, const std::string
 
         if (!onion.empty()) {
             const std::string fwdUrl = urlWithPath(viaRelay, "/v1/forward-onion");
+            chargeBandwidth(viaRelay, onion.size());
 
+            // Health is attributed to the entry relay — it's the one
+            // we actually talk to; the exit hop's outcome only shows
+            // up inside the entry relay's response.
             const int jitterMs = pickJitterMs();
             if (jitterMs <= 0) {
-                m_http.post(fwdUrl, onion, {}, std::move(cb));
+                m_http.post(fwdUrl, onion, {},
+                            withHealthProbe(viaRelay, std::move(cb)));
             } else {
                 m_timers.singleShot(jitterMs,
-                    [this, fwdUrl, onion, cb = std::move(cb)]() mutable {
-                        m_http.post(fwdUrl, onion, {}, std::move(cb));
+                    [this, viaRelay, fwdUrl, onion, cb = std::move(cb)]() mutable {
+                        m_http.post(fwdUrl, onion, {},
+                                    withHealthProbe(viaRelay, std::move(cb)));
                     });
             }
             return;
@@ -981,6 +1770,7 @@ void RelayClient::setPrivacyLevel(int level)
         setMultiHopEnabled(false);
         setParallelFanOut(true);
         setParallelFanOutK(0);  // 0 = all configured relays
+        setWsSendEnabled(false);  // WS sends are attributable to us
         m_coverSizeMode = CoverSizeMode::BandwidthBiased;
         break;
     case 2:
@@ -994,6 +1784,7 @@ void RelayClient::setPrivacyLevel(int level)
         // redundancy story as level 1 for that window.
         setParallelFanOut(true);
         setParallelFanOutK(0);
+        setWsSendEnabled(false);
         m_coverSizeMode = CoverSizeMode::UniformBuckets;
         break;
     }
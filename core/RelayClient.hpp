@@ -23,7 +23,8 @@ class CryptoEngine;
  * RelayClient — unified relay transport
  *
  * Replaces MailboxClient + RendezvousClient with a single class that:
- *   - Sends envelopes anonymously via HTTP POST /v1/send (no sender identity)
+ *   - Sends envelopes anonymously via HTTP POST /v1/send (no sender identity),
+ *     or — opt-in — pipelined over the authenticated WS (setWsSendEnabled)
  *   - Receives envelopes via authenticated WebSocket /v1/receive (push-based)
  *   - Handles presence via WS messages (subscribe + push, no polling)
  *   - Supports retry queue for failed sends
@@ -58,19 +59,114 @@ public:
     bool isConnected() const;
 
     // Tags an envelope's logical payload class so the transport can
-    // apply per-class policy.  Today only parallel fan-out cares about
-    // this — file chunks are large enough that broadcasting each one
-    // to multiple relays burns bandwidth disproportionate to the
-    // redundancy gain, so chunks stay on the single-relay path even
-    // when fan-out is enabled for messages.
-    enum class TrafficClass { Message, FileChunk };
-
-    // Send a sealed envelope anonymously via HTTP POST /v1/send.
-    // The recipient is parsed from the envelope header (bytes 1-32).
+    // apply per-class policy:
+    //   Control   — handshake responses, key / KEM announces, ICE
+    //               signalling, file-transfer and group-membership
+    //               control.  Small and latency-critical.
+    //   Message   — chat content (1:1 text, group messages, avatars).
+    //   FileChunk — bulk file data.  Also skips parallel fan-out: at
+    //               240 KB per chunk, broadcasting each one to several
+    //               relays costs more than the redundancy is worth.
+    // The send scheduler (see setBandwidthCaps) orders the queues by
+    // class.
+    enum class TrafficClass { Control, Message, FileChunk };
+
+    // Send a sealed envelope anonymously via HTTP POST /v1/send (or the
+    // WS send path when enabled — see setWsSendEnabled).  The recipient
+    // is parsed from the envelope header (bytes 1-32).
     // `cls` selects per-class transport policy; defaults to Message.
     void sendEnvelope(const Bytes& sealedEnvelope,
                       TrafficClass cls = TrafficClass::Message);
 
+    // ── Send scheduler ──────────────────────────────────────────────────────
+    //
+    // sendEnvelope doesn't hand envelopes to the transport in submission
+    // order.  It queues them per TrafficClass and keeps at most
+    // kMaxSendsInFlight outstanding (the relay's ws_send_window instead
+    // when the WS send path is active), so the backlog of a 100 MB
+    // transfer sits in our queues rather than in the platform's FIFO
+    // HTTP queue, where a text would have to wait behind all of it.
+    //
+    //   - Control is strict priority: it takes the next free slot ahead
+    //     of anything queued and is never held back by a bandwidth cap
+    //     (it's still charged against them).
+    //   - Message and FileChunk share what's left by weighted fair
+    //     queueing on bytes, kMessageWeight : kFileChunkWeight, so chat
+    //     stays responsive during a transfer without starving it.
+    //
+    // Envelopes sent inside a SendBatch scope skip the queues so the
+    // batch goes out as one request; they still take slots, so anything
+    // queued before the scope stays behind the window.  In constant-rate
+    // mode (setConstantRate) the queues are drained one envelope per
+    // tick instead.  Retries and cover envelopes bypass the queues but
+    // are charged against the caps.
+    //
+    // A slot is freed when its send is answered.  If nothing is answered
+    // for kSendSlotTimeoutMs every slot is freed, so a transport that
+    // drops a callback can't stall the queues for good.
+    //
+    // Bandwidth caps are token buckets in bytes per second (0 = no cap),
+    // one global and one per relay (applied to each relay separately),
+    // each with one second of burst.  An envelope may take its bucket
+    // into debt; the queues then wait for it to refill.  A relay over
+    // its cap is skipped by relay selection while another has budget.
+    void setBandwidthCaps(int64_t globalBytesPerSec, int64_t perRelayBytesPerSec);
+
+    struct SendQueueStats {
+        TrafficClass cls        = TrafficClass::Message;
+        size_t       depth      = 0;   // envelopes waiting
+        size_t       bytes      = 0;   // bytes waiting
+        size_t       peakDepth  = 0;   // high-water mark of depth
+        uint64_t     sent       = 0;   // envelopes handed to the transport
+        uint64_t     sentBytes  = 0;
+        int64_t      maxWaitMs  = 0;   // longest time an envelope sat queued
+    };
+    // One entry per TrafficClass, in enum order.
+    std::vector<SendQueueStats> sendQueueStats() const;
+    int sendsInFlight() const { return m_sendsInFlight; }
+
+    // ── Batched sends ───────────────────────────────────────────────────────
+    //
+    // A group message is N independently-sealed envelopes, one per
+    // member.  Between beginSendBatch() and the matching endSendBatch(),
+    // HTTP sends are collected per relay instead of posted; the
+    // outermost endSendBatch() flushes each relay's list as one
+    // POST /v1/send-batch whose body is repeated
+    //
+    //   u32 BE length || sealed envelope
+    //
+    // Envelopes keep their own padding bucket and their own outcome: the
+    // relay answers {"results":[{"status":S[,"error":...]}, ...]} in
+    // body order, and each entry is fed to that envelope's callback as
+    // if it were a /v1/send response (retry queue, 413 handling).  Cover
+    // envelopes emitted inside the scope ride in the same request.
+    //
+    // Jitter still applies per envelope.  Each one draws its delay as
+    // if posted alone; at flush, a relay's envelopes are grouped into
+    // kBatchSlotMs-wide slots of that delay and each slot goes out as
+    // one request when the earliest delay in it elapses.  No envelope
+    // leaves before its own jitter or more than a slot after it, and a
+    // group send under jitter is spread over several requests rather
+    // than tied together in one.
+    //
+    // A relay that answers 404/405 predates the endpoint: its batch is
+    // re-sent as individual POSTs and it isn't batched to again.  A
+    // relay with only one pending envelope gets a plain /v1/send.
+    // Scopes nest.  Multi-hop (onion) and WS sends are never batched.
+    void beginSendBatch();
+    void endSendBatch();
+
+    // RAII scope over beginSendBatch / endSendBatch.
+    class SendBatch {
+    public:
+        explicit SendBatch(RelayClient& rc) : m_rc(rc) { m_rc.beginSendBatch(); }
+        ~SendBatch() { m_rc.endSendBatch(); }
+        SendBatch(const SendBatch&)            = delete;
+        SendBatch& operator=(const SendBatch&) = delete;
+    private:
+        RelayClient& m_rc;
+    };
+
     // Presence: subscribe to online/offline updates for a set of peers.
     void subscribePresence(const std::vector<std::string>& peerIds);
 
@@ -91,6 +187,31 @@ public:
     void setCoverTrafficInterval(int seconds);
     void setKnownPeers(const std::vector<std::string>& peerIds);
 
+    // Constant-rate shaping.  Interval cover traffic and the pre-send
+    // bursts are extra envelopes on top of real traffic.  With
+    // intervalMs > 0, RelayClient instead emits exactly one envelope
+    // every intervalMs: the next one the send scheduler would pick if
+    // anything is queued, a cover envelope otherwise.  Real traffic
+    // takes cover slots rather than adding to them, so bandwidth and
+    // CPU stay fixed and the relay sees the same cadence busy or idle.
+    //
+    // Every tick's envelope, real or cover, is padded to the same
+    // bucket (small 2 KiB / medium 16 KiB / large 256 KiB), so the size
+    // doesn't tell a real send from cover.  A real envelope already
+    // larger than the bucket keeps its own, so pick the bucket for the
+    // traffic expected — large for users who send files through the
+    // relay, or those file chunks stand out.
+    //
+    // While enabled, interval cover, pre-send bursts and send jitter
+    // are off; the scheduler's class order still decides which queued
+    // envelope a tick carries.  Retries keep their own backoff timer.
+    // Throughput is capped at one envelope per tick, so a file transfer
+    // through the relay takes (chunks × intervalMs).  intervalMs = 0
+    // turns it off and releases anything still queued.
+    enum class TickBucket { Small, Medium, Large };
+    void setConstantRate(int intervalMs, TickBucket bucket = TickBucket::Medium);
+    bool constantRateActive() const { return m_constantRateMs > 0; }
+
     // ── Multi-relay routing ─────────────────────────────────────────────────
     void addSendRelay(const std::string& url);
     void setMultiHopEnabled(bool enabled);
@@ -139,10 +260,72 @@ public:
     void setParallelFanOut(bool enabled);
 
     // K = 0 means "all configured send relays" (full broadcast).
-    // K > 0 picks K random relays uniformly without replacement;
-    // values >= m_sendRelays.size() collapse to "all".
+    // K > 0 picks K random relays without replacement, weighted by
+    // relay health (see relayHealthStats); values >= m_sendRelays.size()
+    // collapse to "all".
     void setParallelFanOutK(int k);
 
+    // ── WS send path (throughput, NOT anonymity) ────────────────────────────
+    //
+    // POST /v1/send is anonymous but costs a full HTTP request (headers,
+    // often a fresh connection) per envelope.  When enabled, envelopes
+    // that would take the single-relay path are instead pipelined as
+    // binary frames over the primary WS that's already authenticated
+    // for /v1/receive:
+    //
+    //   frame = kWsSendFrameTag || seq (u32 BE) || sealed envelope
+    //
+    // Up to m_wsSendWindow frames are in flight; the relay answers each
+    // with {"type":"send_ack","seq":N,"status":S[,"error":...]}, which is
+    // fed to the envelope's callback as if it were the HTTP response —
+    // so the retry queue and relay health see the same outcomes.
+    //
+    // The price is sender unlinkability: the relay knows which peer sent
+    // each envelope.  Off by default; setPrivacyLevel(1|2) turns it off,
+    // and multi-hop / parallel fan-out always stay on HTTP.
+    //
+    // Only engaged once the relay advertises ws_send_window in auth_ok
+    // (older relays would silently drop the frames).  Whatever is queued
+    // or unacked when the WS drops, or when an ack stalls for
+    // kWsSendAckTimeoutMs, is re-sent over HTTP; receive-side dedup
+    // absorbs the duplicate if the relay had already taken it.
+    void setWsSendEnabled(bool enabled);
+    bool wsSendActive() const;
+
+    // ── Relay health scoring ────────────────────────────────────────────────
+    //
+    // Every HTTP POST to a relay (/v1/send, /v1/forward-onion, retries,
+    // cover) feeds a per-relay score: EWMA of round-trip latency, EWMA
+    // of the error rate (network failures + non-429 HTTP errors), and
+    // EWMA of the 429 rate.  pickSendRelay / pickKSendRelays sample
+    // relays with probability proportional to that score, so a slow or
+    // half-broken relay gets a shrinking share of traffic instead of
+    // 1/N of it.  Sampling stays crypto-random — the weights bias the
+    // distribution but don't reintroduce a predictable cadence.
+    //
+    // kEjectAfterFailures consecutive failures (429 counts) eject a
+    // relay for kEjectBaseMs, doubling per repeat ejection up to
+    // kEjectMaxMs.  When the eject timer fires the relay is re-admitted
+    // in "probing" state with fresh priors; the next outcome decides —
+    // success clears the backoff, failure ejects it again straight away.
+    // If every configured relay is ejected we fall back to uniform
+    // selection over all of them rather than going silent.
+    //
+    // Keyed by relay base URL (scheme://host[:port]).
+    struct RelayHealthStats {
+        std::string url;
+        double      latencyMs    = 0.0;   // EWMA of POST round-trip
+        double      errorRate    = 0.0;   // EWMA in [0,1]
+        double      throttleRate = 0.0;   // EWMA in [0,1] (HTTP 429)
+        uint64_t    sent         = 0;     // completed POSTs
+        uint64_t    failed       = 0;
+        uint64_t    throttled    = 0;
+        double      weight       = 0.0;   // current selection weight
+        bool        ejected      = false;
+        bool        probing      = false;
+    };
+    std::vector<RelayHealthStats> relayHealthStats() const;
+
     /// Set the privacy level (preset matrix over the four orthogonal
     /// dials: jitter, cover traffic, parallel fan-out, multi-hop).
     ///   0 = Standard:  padding only — no jitter, no cover, no multi-relay
@@ -150,7 +333,8 @@ public:
     ///   2 = Maximum:   jitter (100-500ms) + cover (10s) + parallel fan-out + multi-hop
     /// Parallel fan-out and multi-hop are independent in spec but
     /// multi-hop wins in the send dispatcher when both are enabled
-    /// (see sendEnvelope).
+    /// (see sendEnvelope).  Levels 1 and 2 also switch off the WS send
+    /// path; level 0 leaves it as configured.
     void setPrivacyLevel(int level);
 
     // ── Event callbacks — set from outside before connecting ─────────────
@@ -200,13 +384,54 @@ private:
     void sendCoverEnvelope();
     void scheduleCoverTimer();
     void onRealActivity();
+    // Random-bodied, bucket-padded envelope addressed to an online peer
+    // (or to ourselves); empty if there's no usable recipient.
+    Bytes makeCoverEnvelope() const;
+    void postCoverEnvelope(const Bytes& env);
+    void onConstantRateTick();
 
     std::string pickSendRelay();
 
-    // Pick K relays from m_sendRelays without replacement.  K==0 or
-    // K >= size() returns the full list.  Used by parallel fan-out.
+    // Pick K relays from m_sendRelays without replacement, weighted by
+    // health.  K==0 or K >= size() returns every non-ejected relay.
+    // Used by parallel fan-out.
     std::vector<std::string> pickKSendRelays(int k) const;
 
+    // ── Relay health (see relayHealthStats) ─────────────────────────────────
+    struct RelayHealth {
+        double   ewmaLatencyMs       = kLatencyPriorMs;
+        double   ewmaErrorRate       = 0.0;
+        double   ewmaThrottleRate    = 0.0;
+        uint64_t sent                = 0;
+        uint64_t failed              = 0;
+        uint64_t throttled           = 0;
+        int      consecutiveFailures = 0;
+        int      ejectCount          = 0;   // drives the eject backoff
+        bool     ejected             = false;
+        bool     probing             = false;
+        std::unique_ptr<ITimer> probeTimer;
+    };
+    static constexpr double  kLatencyPriorMs     = 250.0;
+    static constexpr double  kHealthEwmaAlpha    = 0.2;
+    static constexpr double  kMinRelayWeight     = 0.01;
+    static constexpr int     kEjectAfterFailures = 3;
+    static constexpr int     kEjectBaseMs        = 30 * 1000;
+    static constexpr int     kEjectMaxMs         = 15 * 60 * 1000;
+
+    RelayHealth& healthFor(const std::string& relayUrl);
+    double relayWeight(const std::string& relayUrl) const;
+    std::vector<std::string> healthyRelays(const std::vector<std::string>& pool) const;
+    std::string weightedPick(const std::vector<std::string>& pool) const;
+    void recordRelayOutcome(const std::string& relayUrl, int64_t latencyMs,
+                            const IHttpClient::Response& r);
+    void ejectRelay(const std::string& relayUrl, RelayHealth& h);
+
+    // Wrap `cb` so the outcome of the POST that's about to be issued
+    // lands in the relay's health record.  Call immediately before
+    // m_http.post — the round-trip clock starts here.
+    IHttpClient::Callback withHealthProbe(const std::string& relayUrl,
+                                          IHttpClient::Callback cb);
+
     // BLAKE2b-128 of the sealed envelope bytes.  Stable across relays
     // (content hash, not relay-assigned ID), so a single envelope
     // posted to multiple relays + delivered through multiple WS
@@ -215,6 +440,90 @@ private:
     // the hash was already in the LRU; inserts otherwise.
     bool isDuplicateEnvelope(const Bytes& sealed);
 
+    // ── WS send path (see setWsSendEnabled) ─────────────────────────────────
+    struct WsSendFrame {
+        uint32_t              seq = 0;
+        Bytes                 envelope;
+        IHttpClient::Callback cb;
+        int64_t               sentAtMs = 0;
+    };
+    static constexpr uint8_t kWsSendFrameTag     = 0x53;  // 'S'
+    static constexpr size_t  kWsSendHeaderLen    = 1 + 4;
+    static constexpr int     kWsSendMaxWindow    = 64;
+    static constexpr int     kWsSendAckTimeoutMs = 10 * 1000;
+    static constexpr size_t  kWsSendMaxEnvelope  = 256 * 1024;
+
+    void wsSendEnvelope(const Bytes& envelope, IHttpClient::Callback cb);
+    void pumpWsSendQueue();
+    void onWsSendAck(uint32_t seq, int status, const std::string& error);
+    void onWsSendAckTimeout();
+    // Stop using the WS for sends on this connection and hand every
+    // queued + unacked envelope to postEnvelope, oldest first.
+    void spillWsSendsToHttp();
+
+    // ── Batched sends (see beginSendBatch) ──────────────────────────────────
+    struct BatchedEnvelope {
+        Bytes                 envelope;
+        IHttpClient::Callback cb;
+        int                   jitterMs = 0;
+    };
+    static constexpr size_t kMaxBatchEnvelopes = 64;
+    static constexpr size_t kMaxBatchBytes     = 4 * 1024 * 1024;
+    static constexpr int    kBatchSlotMs       = 25;
+
+    bool sendBatchActive() const { return m_sendBatchDepth > 0; }
+    void flushSendBatch();
+    // Posts after delayMs (the slot's earliest jitter).
+    void postBatch(const std::string& relayUrl, std::vector<BatchedEnvelope> batch,
+                   int delayMs);
+
+    // ── Send scheduler (see setBandwidthCaps) ───────────────────────────────
+    struct QueuedSend {
+        Bytes   envelope;
+        int64_t enqueuedMs = 0;
+    };
+    struct ClassQueue {
+        std::deque<QueuedSend> pending;
+        size_t   bytes      = 0;
+        size_t   peakDepth  = 0;
+        uint64_t sent       = 0;
+        uint64_t sentBytes  = 0;
+        int64_t  maxWaitMs  = 0;
+        double   lastFinish = 0.0;   // virtual finish tag of the last send
+    };
+    // Bytes-per-second bucket, refilled lazily from the steady clock.
+    struct TokenBucket {
+        int64_t rate     = 0;     // 0 = uncapped
+        double  tokens   = 0.0;   // may go negative (debt)
+        int64_t lastMs   = 0;
+        double  available(int64_t now) const;
+        void    charge(int64_t now, size_t bytes);
+    };
+    static constexpr int kTrafficClassCount = 3;
+    // Roughly the per-host connection limit of platform HTTP stacks, so
+    // the transport never builds a FIFO backlog of its own.
+    static constexpr int kMaxSendsInFlight  = 6;
+    static constexpr int kSendSlotTimeoutMs = 60 * 1000;
+    static constexpr int kMessageWeight     = 8;
+    static constexpr int kFileChunkWeight   = 1;
+
+    void pumpSendQueues();
+    // padTo > 0: grow a wrapForRelay envelope to that size first.
+    void dispatchFromQueue(int idx, size_t padTo = 0);
+    // Index of the class whose head goes out next, or -1 if nothing may
+    // go now (empty, window full, or over budget — the pump timer is
+    // armed for the latter).
+    int  nextSendClass();
+    void dispatchEnvelope(const Bytes& envelope, TrafficClass cls);
+    void releaseSendSlot();
+    void onSendSlotTimeout();
+    int  sendWindow() const;
+    bool relayHasBudget(const std::string& relayUrl, int64_t now) const;
+    // Milliseconds until the global bucket and at least one send relay
+    // are out of debt; 0 if they already are.
+    int  budgetWaitMs(int64_t now) const;
+    void chargeBandwidth(const std::string& relayUrl, size_t bytes);
+
     int         pickJitterMs() const;
     void postEnvelope(const std::string& relayUrl, const Bytes& envelope,
                       IHttpClient::Callback cb);
@@ -286,6 +595,11 @@ private:
     enum class CoverSizeMode { BandwidthBiased, UniformBuckets };
     CoverSizeMode           m_coverSizeMode    = CoverSizeMode::BandwidthBiased;
 
+    // Constant-rate shaping (see setConstantRate).  0 = off.
+    int                     m_constantRateMs   = 0;
+    size_t                  m_constantRateBytes = 16 * 1024;   // tick bucket
+    std::unique_ptr<ITimer> m_constantRateTimer;
+
     std::vector<std::string> m_knownPeers;
     std::set<std::string>    m_onlinePeers;
 
@@ -308,6 +622,40 @@ private:
 
     std::map<std::string, Bytes> m_relayX25519Pubs;
 
+    // Per-relay health, keyed by baseOf(url).  Entries are created on
+    // first POST and never erased — a relay removed from the send pool
+    // keeps its history in case it's re-added.
+    std::map<std::string, RelayHealth> m_relayHealth;
+
+    // WS send path.  m_wsSendWindow is what the relay advertised on the
+    // current connection (clamped to kWsSendMaxWindow); 0 = not usable.
+    bool                          m_wsSendEnabled = false;
+    int                           m_wsSendWindow  = 0;
+    uint32_t                      m_wsSendSeq     = 0;
+    std::deque<WsSendFrame>       m_wsSendQueue;
+    std::map<uint32_t, WsSendFrame> m_wsSendInFlight;
+    std::unique_ptr<ITimer>       m_wsSendAckTimer;
+
+    // Batched sends.  Pending lists are keyed by the relay URL the
+    // envelope was headed for; m_noBatchRelays holds baseOf() of relays
+    // that rejected /v1/send-batch.
+    int                                                  m_sendBatchDepth = 0;
+    std::map<std::string, std::vector<BatchedEnvelope>>  m_sendBatch;
+    std::set<std::string>                                m_noBatchRelays;
+
+    // Send scheduler.  m_sendQueues is indexed by TrafficClass;
+    // m_wfqVirtualTime is the start tag of the last WFQ pick.  Relay
+    // buckets are keyed by baseOf(url) and share m_relayCapBps.
+    std::array<ClassQueue, kTrafficClassCount> m_sendQueues;
+    int                                  m_sendsInFlight   = 0;
+    uint64_t                             m_sendSlotEpoch   = 0;
+    std::unique_ptr<ITimer>              m_sendSlotTimer;
+    double                               m_wfqVirtualTime  = 0.0;
+    TokenBucket                          m_globalBudget;
+    int64_t                              m_relayCapBps     = 0;
+    std::map<std::string, TokenBucket>   m_relayBudgets;
+    std::unique_ptr<ITimer>              m_sendPumpTimer;
+
     // Slave subscribers (multi-relay receive).  Created via
     // m_wsFactory; managed wholly by RelayClient.
     std::vector<std::unique_ptr<Slave>> m_slaves;
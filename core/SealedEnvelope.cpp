@@ -8,6 +8,10 @@
 // Version bytes for wire format (v2 — recipient-bound AAD + envelope-id)
 static constexpr uint8_t kVersionClassicalV2 = 0x02;
 static constexpr uint8_t kVersionHybridV2    = 0x03;
+// Multi-recipient variants: same outer layout, plaintext carries a
+// Merkle path and the signatures cover the tree root (see sealMulti).
+static constexpr uint8_t kVersionClassicalMulti = 0x04;
+static constexpr uint8_t kVersionHybridMulti    = 0x05;
 
 // Domain-separation label mixed into the envelope-key derivation as the
 // BLAKE2b *key*.  Without a protocol binding, any future variant that
@@ -20,12 +24,45 @@ static constexpr uint8_t kVersionHybridV2    = 0x03;
 static constexpr char   kEnvelopeKeyLabel[]   = "Peer2Pear-SealedEnvelope-v2";
 static constexpr size_t kEnvelopeKeyLabelLen  = sizeof(kEnvelopeKeyLabel) - 1;
 
+// Key for the multi-recipient commitment tree's BLAKE2b and prefix of
+// the bytes its signatures cover.  Wire constant, like the label above.
+static constexpr char   kMultiTreeLabel[]  = "Peer2Pear-SealedMulti-v1";
+static constexpr size_t kMultiTreeLabelLen = sizeof(kMultiTreeLabel) - 1;
+static constexpr size_t kMerkleHashLen     = 32;
+
 // ML-KEM-768 ciphertext size (from liboqs)
 static constexpr int kKemCtLen = 1088;
 
 // Random id used for receiver-side replay dedup.
 static constexpr int kEnvelopeIdLen = 16;
 
+static_assert(kMultiTreeLabelLen > kEnvelopeIdLen,
+              "multi-recipient label must be longer than an envelopeId");
+
+// True for the one envelopeId a single-recipient envelope may not carry:
+// the prefix of kMultiTreeLabel (see multiSignedBytes()).
+static bool isMultiLabelPrefix(const uint8_t* envelopeId)
+{
+    return std::memcmp(envelopeId, kMultiTreeLabel, kEnvelopeIdLen) == 0;
+}
+
+// dsaPubLen sentinel for the by-reference form: the ML-DSA pub is
+// replaced by its kDsaKeyIdLen-byte id.  Not a valid key length, so
+// pre-reference clients fail closed on it.
+static constexpr uint16_t kDsaKeyRefMarker = 0xFFFF;
+
+// ML-DSA signature length for a given public-key length, or 0 for an
+// unrecognised parameter set.
+static size_t dsaSigLenFor(size_t dsaPubLen)
+{
+    switch (dsaPubLen) {
+    case 1312: return 2420;   // ML-DSA-44
+    case 1952: return 3309;   // ML-DSA-65
+    case 2592: return 4627;   // ML-DSA-87
+    default:   return 0;
+    }
+}
+
 // Build AAD: ephPub(32) || recipientEdPub(32).  Binds the routing recipient
 // cryptographically so a malicious relay can't re-route the sealed blob.
 static Bytes buildAAD(const Bytes& ephPub, const Bytes& recipientEdPub)
@@ -68,45 +105,51 @@ static inline void append(Bytes& dst, const uint8_t* src, size_t n) {
     dst.insert(dst.end(), src, src + n);
 }
 
-// ── seal ────────────────────────────────────────────────────────────────────
+Bytes SealedEnvelope::dsaKeyId(const Bytes& dsaPub)
+{
+    if (dsaPub.empty()) return {};
+    Bytes id(kDsaKeyIdLen);
+    (void)crypto_generichash(id.data(), id.size(),
+                             dsaPub.data(), dsaPub.size(), nullptr, 0);
+    return id;
+}
 
-Bytes SealedEnvelope::seal(const Bytes& recipientCurvePub,
-                            const Bytes& recipientEdPub,
-                            const Bytes& senderEdPub,
-                            const Bytes& senderEdPriv,
-                            const Bytes& innerPayload,
-                            const Bytes& recipientKemPub,
-                            const Bytes& senderDsaPub,
-                            const Bytes& senderDsaPriv) {
-    if (recipientCurvePub.size() != 32) return {};
-    if (recipientEdPub.size() != 32) return {};
-    if (senderEdPub.size() != crypto_sign_PUBLICKEYBYTES) return {};
-    if (senderEdPriv.size() != crypto_sign_SECRETKEYBYTES) return {};
+// ── seal ────────────────────────────────────────────────────────────────────
 
-    const bool hybrid = !recipientKemPub.empty();
+// Steps shared by seal() and sealMulti(): fresh ephemeral X25519 (+ ML-KEM
+// encaps when recipientKemPub is set) → keyed BLAKE2b envelope key.
+// Returns false with `envelopeKey` zeroed on any failure.
+static bool deriveSealKey(const Bytes& recipientCurvePub,
+                          const Bytes& recipientKemPub,
+                          Bytes& ephPub, Bytes& kemCt,
+                          unsigned char envelopeKey[32])
+{
+    sodium_memzero(envelopeKey, 32);
 
     // 1. Generate ephemeral X25519 keypair.
-    auto [ephPub, ephPriv] = CryptoEngine::generateEphemeralX25519();
+    auto eph = CryptoEngine::generateEphemeralX25519();
+    ephPub = std::move(eph.first);
+    Bytes& ephPriv = eph.second;
 
     // 2. ECDH: ephPriv × recipientCurvePub → classical shared secret
     unsigned char ecdhShared[crypto_scalarmult_BYTES];
     if (crypto_scalarmult(ecdhShared,
                           ephPriv.data(),
                           recipientCurvePub.data()) != 0) {
-        return {};
+        sodium_memzero(ephPriv.data(), ephPriv.size());
+        return false;
     }
     sodium_memzero(ephPriv.data(), ephPriv.size());
 
     // 3. If hybrid, also do ML-KEM-768 encapsulation
-    Bytes kemCt;
     Bytes combinedIkm;
 
-    if (hybrid) {
+    if (!recipientKemPub.empty()) {
         KemEncapsResult kemResult = CryptoEngine::kemEncaps(recipientKemPub);
         if (kemResult.ciphertext.empty()) {
             CryptoEngine::secureZero(kemResult.sharedSecret);
             sodium_memzero(ecdhShared, sizeof(ecdhShared));
-            return {};
+            return false;
         }
         kemCt = std::move(kemResult.ciphertext);
 
@@ -124,17 +167,103 @@ Bytes SealedEnvelope::seal(const Bytes& recipientCurvePub,
 
     // 4. Derive envelope key: keyed BLAKE2b-256(label, ecdh [|| kem]).
     //    Label keys the hash — see kEnvelopeKeyLabel comment above.
-    unsigned char envelopeKey[32];
     (void)crypto_generichash(envelopeKey, 32,
                              combinedIkm.data(),
                              combinedIkm.size(),
                              reinterpret_cast<const unsigned char*>(kEnvelopeKeyLabel),
                              kEnvelopeKeyLabelLen);
     sodium_memzero(combinedIkm.data(), combinedIkm.size());
+    return true;
+}
+
+// dsaPubLen(2) || [dsaPub | dsaKeyId] || [dsaSig] — a zero length when
+// the envelope carries no ML-DSA signature.
+static void appendDsaBlock(Bytes& envPlaintext, const Bytes& senderDsaPub,
+                           const Bytes& dsaSig, bool dsaPubByRef)
+{
+    if (!dsaSig.empty() && dsaPubByRef) {
+        uint8_t markerBE[2];
+        write_u16_be(markerBE, kDsaKeyRefMarker);
+        append(envPlaintext, markerBE, 2);
+        append(envPlaintext, SealedEnvelope::dsaKeyId(senderDsaPub));
+        append(envPlaintext, dsaSig);
+    } else if (!dsaSig.empty()) {
+        uint8_t dpLenBE[2];
+        write_u16_be(dpLenBE, static_cast<uint16_t>(senderDsaPub.size()));
+        append(envPlaintext, dpLenBE, 2);
+        append(envPlaintext, senderDsaPub);
+        append(envPlaintext, dsaSig);
+    } else {
+        // No DSA signature — write 0 length marker
+        uint8_t zero[2] = {0, 0};
+        append(envPlaintext, zero, 2);
+    }
+}
+
+// AEAD-encrypt the envelope plaintext and lay out the wire form:
+//   version(1) || ephPub(32) || [kemCt(1088)] || nonce || ct
+// Zeroes `envelopeKey`.
+static Bytes encryptEnvelope(uint8_t version, const Bytes& ephPub,
+                             const Bytes& kemCt, const Bytes& recipientEdPub,
+                             unsigned char envelopeKey[32],
+                             const Bytes& envPlaintext)
+{
+    const Bytes aad = buildAAD(ephPub, recipientEdPub);
+
+    unsigned char nonce[crypto_aead_xchacha20poly1305_ietf_NPUBBYTES];
+    randombytes_buf(nonce, sizeof(nonce));
+
+    Bytes ct(sizeof(nonce) + envPlaintext.size() + crypto_aead_xchacha20poly1305_ietf_ABYTES);
+    unsigned long long clen = 0;
+
+    crypto_aead_xchacha20poly1305_ietf_encrypt(
+        ct.data() + sizeof(nonce), &clen,
+        envPlaintext.data(),
+        envPlaintext.size(),
+        aad.data(),
+        aad.size(),
+        nullptr, nonce, envelopeKey);
+
+    std::memcpy(ct.data(), nonce, sizeof(nonce));
+    ct.resize(sizeof(nonce) + clen);
+    sodium_memzero(envelopeKey, 32);
+
+    Bytes out;
+    out.reserve(1 + ephPub.size() + kemCt.size() + ct.size());
+    out.push_back(version);
+    append(out, ephPub);
+    append(out, kemCt);
+    append(out, ct);
+    return out;
+}
+
+Bytes SealedEnvelope::seal(const Bytes& recipientCurvePub,
+                            const Bytes& recipientEdPub,
+                            const Bytes& senderEdPub,
+                            const Bytes& senderEdPriv,
+                            const Bytes& innerPayload,
+                            const Bytes& recipientKemPub,
+                            const Bytes& senderDsaPub,
+                            const Bytes& senderDsaPriv,
+                            bool dsaPubByRef) {
+    if (recipientCurvePub.size() != 32) return {};
+    if (recipientEdPub.size() != 32) return {};
+    if (senderEdPub.size() != crypto_sign_PUBLICKEYBYTES) return {};
+    if (senderEdPriv.size() != crypto_sign_SECRETKEYBYTES) return {};
+
+    const bool hybrid = !recipientKemPub.empty();
+
+    // 1-4. Ephemeral ECDH [+ KEM] → envelope key.
+    Bytes ephPub, kemCt;
+    unsigned char envelopeKey[32];
+    if (!deriveSealKey(recipientCurvePub, recipientKemPub, ephPub, kemCt, envelopeKey))
+        return {};
 
     // 5. Generate a random 16-byte envelopeId for receiver-side replay dedup.
     Bytes envelopeId(kEnvelopeIdLen);
-    randombytes_buf(envelopeId.data(), static_cast<size_t>(kEnvelopeIdLen));
+    do {
+        randombytes_buf(envelopeId.data(), static_cast<size_t>(kEnvelopeIdLen));
+    } while (isMultiLabelPrefix(envelopeId.data()));
 
     // 6. Sign (envelopeId || innerPayload) with sender's Ed25519 key.
     Bytes signedBytes;
@@ -162,60 +291,229 @@ Bytes SealedEnvelope::seal(const Bytes& recipientCurvePub,
 
     // 7. Build plaintext:
     //   envelopeId(16) || senderEdPub(32) || edSig(64)
-    //     || dsaPubLen(2) || [dsaPub || dsaSig] || innerPayload
+    //     || dsaPubLen(2) || [dsaPub | dsaKeyId] || [dsaSig] || innerPayload
     Bytes envPlaintext;
     append(envPlaintext, envelopeId);
     append(envPlaintext, senderEdPub);
     append(envPlaintext, edSig, crypto_sign_BYTES);
+    appendDsaBlock(envPlaintext, senderDsaPub, dsaSig, dsaPubByRef);
+    append(envPlaintext, innerPayload);
 
-    if (hybridSig && !dsaSig.empty()) {
-        uint8_t dpLenBE[2];
-        write_u16_be(dpLenBE, static_cast<uint16_t>(senderDsaPub.size()));
-        append(envPlaintext, dpLenBE, 2);
-        append(envPlaintext, senderDsaPub);
-        append(envPlaintext, dsaSig);
-    } else {
-        // No DSA signature — write 0 length marker
-        uint8_t zero[2] = {0, 0};
-        append(envPlaintext, zero, 2);
-    }
+    // 8-9. AEAD encrypt + wire format.
+    return encryptEnvelope(hybrid ? kVersionHybridV2 : kVersionClassicalV2,
+                           ephPub, kemCt, recipientEdPub, envelopeKey, envPlaintext);
+}
 
-    append(envPlaintext, innerPayload);
+// ── sealMulti ───────────────────────────────────────────────────────────────
 
-    // 8. AEAD encrypt with envelope key.
-    const Bytes aad = buildAAD(ephPub, recipientEdPub);
+// Leaf / interior hash of the multi-recipient commitment tree.
+static void merkleHash(uint8_t out[kMerkleHashLen], uint8_t tag,
+                       const uint8_t* a, size_t aLen,
+                       const uint8_t* b, size_t bLen,
+                       const uint8_t* c = nullptr, size_t cLen = 0,
+                       const uint8_t* d = nullptr, size_t dLen = 0)
+{
+    crypto_generichash_state st;
+    crypto_generichash_init(&st,
+                            reinterpret_cast<const unsigned char*>(kMultiTreeLabel),
+                            kMultiTreeLabelLen, kMerkleHashLen);
+    crypto_generichash_update(&st, &tag, 1);
+    crypto_generichash_update(&st, a, aLen);
+    crypto_generichash_update(&st, b, bLen);
+    if (cLen) crypto_generichash_update(&st, c, cLen);
+    if (dLen) crypto_generichash_update(&st, d, dLen);
+    crypto_generichash_final(&st, out, kMerkleHashLen);
+}
 
-    unsigned char nonce[crypto_aead_xchacha20poly1305_ietf_NPUBBYTES];
-    randombytes_buf(nonce, sizeof(nonce));
+static Bytes merkleLeaf(const Bytes& recipientEdPub, const Bytes& envelopeId,
+                        const uint8_t* inner, size_t innerLen)
+{
+    Bytes leaf(kMerkleHashLen);
+    merkleHash(leaf.data(), 0x00,
+               recipientEdPub.data(), recipientEdPub.size(),
+               envelopeId.data(), envelopeId.size(),
+               inner, innerLen);
+    return leaf;
+}
 
-    Bytes ct(sizeof(nonce) + envPlaintext.size() + crypto_aead_xchacha20poly1305_ietf_ABYTES);
-    unsigned long long clen = 0;
+// Number of sibling hashes on the path from leaf `index` to the root of
+// a `count`-leaf tree.  An odd trailing node is promoted to the next
+// level unhashed, so it contributes no sibling at that level.
+static size_t merklePathLen(size_t index, size_t count)
+{
+    size_t len = 0;
+    while (count > 1) {
+        if ((index ^ 1) < count) ++len;
+        index >>= 1;
+        count = (count + 1) >> 1;
+    }
+    return len;
+}
 
-    crypto_aead_xchacha20poly1305_ietf_encrypt(
-        ct.data() + sizeof(nonce), &clen,
-        envPlaintext.data(),
-        envPlaintext.size(),
-        aad.data(),
-        aad.size(),
-        nullptr, nonce, envelopeKey);
+// Root of the tree over `level` (consumed), recording each leaf's
+// authentication path into `paths`.
+static Bytes merkleBuild(std::vector<Bytes> level, std::vector<Bytes>& paths)
+{
+    std::vector<size_t> pos(level.size());
+    for (size_t i = 0; i < pos.size(); ++i) pos[i] = i;
+    paths.assign(level.size(), Bytes{});
+
+    while (level.size() > 1) {
+        for (size_t leaf = 0; leaf < pos.size(); ++leaf) {
+            const size_t sib = pos[leaf] ^ 1;
+            if (sib < level.size()) append(paths[leaf], level[sib]);
+            pos[leaf] >>= 1;
+        }
+        std::vector<Bytes> next((level.size() + 1) / 2);
+        for (size_t i = 0; i < next.size(); ++i) {
+            if (2 * i + 1 < level.size()) {
+                next[i].resize(kMerkleHashLen);
+                merkleHash(next[i].data(), 0x01,
+                           level[2 * i].data(), kMerkleHashLen,
+                           level[2 * i + 1].data(), kMerkleHashLen);
+            } else {
+                next[i] = std::move(level[2 * i]);
+            }
+        }
+        level = std::move(next);
+    }
+    return level.empty() ? Bytes{} : level.front();
+}
 
-    std::memcpy(ct.data(), nonce, sizeof(nonce));
-    ct.resize(sizeof(nonce) + clen);
-    sodium_memzero(envelopeKey, sizeof(envelopeKey));
+// Recompute the root from a leaf and its path.  `path` must hold
+// merklePathLen(index, count) hashes.
+static Bytes merkleRootFromPath(Bytes node, size_t index, size_t count,
+                                const uint8_t* path)
+{
+    Bytes parent(kMerkleHashLen);
+    while (count > 1) {
+        const size_t sib = index ^ 1;
+        if (sib < count) {
+            if (index & 1)
+                merkleHash(parent.data(), 0x01, path, kMerkleHashLen,
+                           node.data(), kMerkleHashLen);
+            else
+                merkleHash(parent.data(), 0x01, node.data(), kMerkleHashLen,
+                           path, kMerkleHashLen);
+            node.swap(parent);
+            path += kMerkleHashLen;
+        }
+        index >>= 1;
+        count = (count + 1) >> 1;
+    }
+    return node;
+}
 
-    // 9. Wire format: version(1) || ephPub(32) || [kemCt(1088)] || AEAD
+// What the shared signatures cover: label || leafCount(2 BE) || root.
+// Single-recipient signatures cover envelopeId || inner with no tag of
+// their own, so on its own the label separates nothing: these bytes also
+// parse as envelopeId = label[0, 16) plus inner = the rest.  unseal()
+// therefore rejects a single-recipient envelope whose id is the label's
+// first kEnvelopeIdLen bytes (seal() never draws it), and a random id
+// can't start with the full label the other way round.
+//
+// That check lives in the receiver, so it only protects clients that
+// have it.  A member holding a multi-recipient copy can still re-seal
+// the shared signature as a 0x02 / 0x03 envelope to a client that
+// predates this code, and that client accepts the signature.  What it
+// then decrypts is fixed: label[16, 24) || leafCount || root, which no
+// ratchet session opens, so the forgery gets no chosen content in.
+// A domain tag on single-recipient signatures wouldn't close this
+// either, because those older clients would still verify the untagged
+// form.
+static Bytes multiSignedBytes(size_t count, const Bytes& root)
+{
     Bytes out;
-    if (hybrid) {
-        out.reserve(1 + 32 + kemCt.size() + ct.size());
-        out.push_back(kVersionHybridV2);
-        append(out, ephPub);
-        append(out, kemCt);
-    } else {
-        out.reserve(1 + 32 + ct.size());
-        out.push_back(kVersionClassicalV2);
-        append(out, ephPub);
+    out.reserve(kMultiTreeLabelLen + 2 + root.size());
+    append(out, reinterpret_cast<const uint8_t*>(kMultiTreeLabel), kMultiTreeLabelLen);
+    uint8_t countBE[2];
+    write_u16_be(countBE, static_cast<uint16_t>(count));
+    append(out, countBE, 2);
+    append(out, root);
+    return out;
+}
+
+std::vector<Bytes> SealedEnvelope::sealMulti(const std::vector<MultiRecipient>& recipients,
+                                              const Bytes& senderEdPub,
+                                              const Bytes& senderEdPriv,
+                                              const Bytes& senderDsaPub,
+                                              const Bytes& senderDsaPriv)
+{
+    std::vector<Bytes> out(recipients.size());
+    if (senderEdPub.size() != crypto_sign_PUBLICKEYBYTES) return out;
+    if (senderEdPriv.size() != crypto_sign_SECRETKEYBYTES) return out;
+
+    // Malformed recipients get no leaf — the rest still go out.
+    std::vector<size_t> live;
+    live.reserve(recipients.size());
+    for (size_t i = 0; i < recipients.size(); ++i) {
+        const MultiRecipient& r = recipients[i];
+        if (r.curvePub.size() == 32 && r.edPub.size() == 32) live.push_back(i);
+    }
+    if (live.empty() || live.size() > kMaxMultiRecipients) return out;
+
+    // 1. Per-recipient envelopeId + leaf commitment.
+    std::vector<Bytes> envelopeIds(live.size(), Bytes(kEnvelopeIdLen));
+    std::vector<Bytes> leaves(live.size());
+    for (size_t k = 0; k < live.size(); ++k) {
+        const MultiRecipient& r = recipients[live[k]];
+        randombytes_buf(envelopeIds[k].data(), static_cast<size_t>(kEnvelopeIdLen));
+        leaves[k] = merkleLeaf(r.edPub, envelopeIds[k],
+                               r.innerPayload.data(), r.innerPayload.size());
+    }
+
+    // 2. One tree, one Ed25519 signature, at most one ML-DSA signature.
+    std::vector<Bytes> paths;
+    const Bytes root = merkleBuild(std::move(leaves), paths);
+    const Bytes signedBytes = multiSignedBytes(live.size(), root);
+
+    unsigned char edSig[crypto_sign_BYTES];
+    crypto_sign_detached(edSig, nullptr,
+                         signedBytes.data(),
+                         signedBytes.size(),
+                         senderEdPriv.data());
+
+    bool anyDsa = false;
+    for (size_t idx : live) anyDsa = anyDsa || recipients[idx].signDsa;
+    Bytes dsaSig;
+    if (anyDsa && !senderDsaPub.empty() && !senderDsaPriv.empty()) {
+        dsaSig = CryptoEngine::dsaSign(signedBytes, senderDsaPriv);
+        // Fail-closed, same as seal(): DSA keys but no signature → nothing.
+        if (dsaSig.empty()) return out;
+    }
+    static const Bytes kNone;
+
+    // 3. Per-recipient ECDH [+ KEM] and AEAD — the only per-peer work.
+    for (size_t k = 0; k < live.size(); ++k) {
+        const MultiRecipient& r = recipients[live[k]];
+
+        Bytes ephPub, kemCt;
+        unsigned char envelopeKey[32];
+        if (!deriveSealKey(r.curvePub, r.kemPub, ephPub, kemCt, envelopeKey))
+            continue;
+
+        // envelopeId || senderEdPub || edSig || dsaBlock
+        //   || leafIndex(2) || leafCount(2) || path || innerPayload
+        Bytes envPlaintext;
+        envPlaintext.reserve(kEnvelopeIdLen + 32 + crypto_sign_BYTES + 2
+                             + (r.signDsa ? senderDsaPub.size() + dsaSig.size() : 0)
+                             + 4 + paths[k].size() + r.innerPayload.size());
+        append(envPlaintext, envelopeIds[k]);
+        append(envPlaintext, senderEdPub);
+        append(envPlaintext, edSig, crypto_sign_BYTES);
+        appendDsaBlock(envPlaintext, senderDsaPub, r.signDsa ? dsaSig : kNone,
+                       r.dsaPubByRef);
+        uint8_t posBE[4];
+        write_u16_be(posBE,     static_cast<uint16_t>(k));
+        write_u16_be(posBE + 2, static_cast<uint16_t>(live.size()));
+        append(envPlaintext, posBE, 4);
+        append(envPlaintext, paths[k]);
+        append(envPlaintext, r.innerPayload);
+
+        out[live[k]] = encryptEnvelope(
+            r.kemPub.empty() ? kVersionClassicalMulti : kVersionHybridMulti,
+            ephPub, kemCt, r.edPub, envelopeKey, envPlaintext);
     }
-    append(out, ct);
     return out;
 }
 
@@ -237,6 +535,28 @@ static size_t paddedSize(size_t rawSize)
     return rawSize;  // exceeds largest bucket — no padding
 }
 
+size_t SealedEnvelope::relayPaddedSize(size_t sealedSize)
+{
+    return paddedSize(kHeaderSize + sealedSize);
+}
+
+size_t SealedEnvelope::relaySealedSize(const Bytes& relayEnvelope)
+{
+    if (relayEnvelope.size() < kHeaderSize || relayEnvelope[0] != kRoutingVersion)
+        return 0;
+    const size_t innerLen = read_u32_be(relayEnvelope.data() + 33);
+    return innerLen <= relayEnvelope.size() - kHeaderSize ? innerLen : 0;
+}
+
+bool SealedEnvelope::padRelayTo(Bytes& relayEnvelope, size_t total)
+{
+    if (relaySealedSize(relayEnvelope) == 0 || relayEnvelope.size() > total) return false;
+    const size_t head = relayEnvelope.size();
+    relayEnvelope.resize(total);
+    randombytes_buf(relayEnvelope.data() + head, total - head);
+    return true;
+}
+
 Bytes SealedEnvelope::wrapForRelay(const Bytes& recipientEdPub,
                                     const Bytes& sealedBytes)
 {
@@ -282,7 +602,9 @@ Bytes SealedEnvelope::wrapForRelay(const Bytes& recipientEdPub,
 //
 //   wire:  [innerLen u32 BE][payload][random pad to bucket]
 //
-// Buckets are the same 2 / 16 / 256 KiB set (§3.1.1).  There's no
+// Buckets are the same 2 / 16 / 256 KiB set (§3.1.1); payloads past
+// the largest bucket (negotiated multi-megabyte file chunks, which only
+// travel P2P) round up to a multiple of it.  There's no
 // routing header because the QUIC connection itself is already
 // peer-addressed.  No routing version byte either — if we ever need
 // a second P2P framing version we can add one; the current format is
@@ -294,7 +616,9 @@ Bytes SealedEnvelope::padForP2P(const Bytes& payload)
 {
     if (payload.empty()) return {};
     const size_t raw       = kP2PLenHeaderSize + payload.size();
-    const size_t padded    = paddedSize(raw);
+    const size_t padded    = raw <= size_t(kBucketLarge)
+        ? paddedSize(raw)
+        : (raw + kBucketLarge - 1) / kBucketLarge * kBucketLarge;
     const size_t padLen    = padded - raw;
 
     Bytes out;
@@ -311,13 +635,13 @@ Bytes SealedEnvelope::padForP2P(const Bytes& payload)
     return out;
 }
 
-Bytes SealedEnvelope::unpadFromP2P(const Bytes& padded)
+Bytes SealedEnvelope::unpadFromP2P(const uint8_t* padded, size_t len)
 {
-    if (padded.size() < kP2PLenHeaderSize + 1) return {};
-    const uint32_t innerLen = read_u32_be(padded.data());
-    if (innerLen == 0 || innerLen > padded.size() - kP2PLenHeaderSize) return {};
-    return Bytes(padded.begin() + kP2PLenHeaderSize,
-                 padded.begin() + kP2PLenHeaderSize + innerLen);
+    if (len < kP2PLenHeaderSize + 1) return {};
+    const uint32_t innerLen = read_u32_be(padded);
+    if (innerLen == 0 || innerLen > len - kP2PLenHeaderSize) return {};
+    return Bytes(padded + kP2PLenHeaderSize,
+                 padded + kP2PLenHeaderSize + innerLen);
 }
 
 Bytes SealedEnvelope::unwrapFromRelay(const Bytes& relayEnvelope,
@@ -358,7 +682,8 @@ Bytes SealedEnvelope::stripRoutingIfWrapped(const Bytes& relayEnvelope)
 UnsealResult SealedEnvelope::unseal(const Bytes& recipientCurvePriv,
                                      const Bytes& recipientEdPub,
                                      const Bytes& sealedBytes,
-                                     const Bytes& recipientKemPriv) {
+                                     const Bytes& recipientKemPriv,
+                                     const DsaKeyLookup& lookupDsaPub) {
     UnsealResult result;
 
     const size_t kPubLen   = 32;
@@ -370,19 +695,17 @@ UnsealResult SealedEnvelope::unseal(const Bytes& recipientCurvePriv,
     if (recipientEdPub.size()     != 32) return result;
     if (sealedBytes.size() < 2) return result;
 
-    // Only v2 format accepted.
+    // Only v2 format (single or multi-recipient) accepted.
     const uint8_t firstByte = sealedBytes[0];
-    const size_t hybridMinSize    = 1 + kPubLen + kKemCtLen + kNonceLen + kEnvelopeIdLen + kPubLen + kSigLen + 2 + kTagLen;
-    const size_t classicalMinSize = 1 + kPubLen + kNonceLen + kEnvelopeIdLen + kPubLen + kSigLen + 2 + kTagLen;
-
-    bool hybrid = false;
-    if (firstByte == kVersionHybridV2 && sealedBytes.size() >= hybridMinSize) {
-        hybrid = true;
-    } else if (firstByte == kVersionClassicalV2 && sealedBytes.size() >= classicalMinSize) {
-        // versioned classical v2
-    } else {
-        return result;  // unknown / old / truncated
-    }
+    const bool hybrid = firstByte == kVersionHybridV2 || firstByte == kVersionHybridMulti;
+    const bool multi  = firstByte == kVersionClassicalMulti || firstByte == kVersionHybridMulti;
+    if (!hybrid && !multi && firstByte != kVersionClassicalV2)
+        return result;  // unknown / old
+
+    const size_t minSize = 1 + kPubLen + (hybrid ? kKemCtLen : 0) + kNonceLen
+                         + kEnvelopeIdLen + kPubLen + kSigLen + 2 + (multi ? 4 : 0)
+                         + kTagLen;
+    if (sealedBytes.size() < minSize) return result;  // truncated
 
     size_t offset = 1;
 
@@ -470,6 +793,10 @@ UnsealResult SealedEnvelope::unseal(const Bytes& recipientCurvePriv,
     // 6. Parse envelope plaintext
     if (pt.size() < kEnvelopeIdLen + kPubLen + kSigLen + 2) return result;
 
+    // Signed bytes starting with the multi-recipient label are a
+    // sealMulti() signature, not one over (envelopeId || inner).
+    if (!multi && isMultiLabelPrefix(pt.data())) return result;
+
     Bytes envelopeId(pt.begin(), pt.begin() + kEnvelopeIdLen);
     result.senderEdPub.assign(pt.begin() + kEnvelopeIdLen,
                                pt.begin() + kEnvelopeIdLen + kPubLen);
@@ -477,38 +804,74 @@ UnsealResult SealedEnvelope::unseal(const Bytes& recipientCurvePriv,
                 pt.begin() + kEnvelopeIdLen + kPubLen + kSigLen);
     size_t parseOffset = kEnvelopeIdLen + kPubLen + kSigLen;
 
-    // dsaPubLen must be one of the recognized ML-DSA pub sizes (or 0).
+    // dsaPubLen must be one of the recognized ML-DSA pub sizes, 0, or
+    // the by-reference marker.
     const uint16_t dsaPubLen = read_u16_be(pt.data() + parseOffset);
     parseOffset += 2;
 
-    const bool knownDsaLen = (dsaPubLen == 0 || dsaPubLen == 1312 ||
-                              dsaPubLen == 1952 || dsaPubLen == 2592);
-    if (!knownDsaLen) return result;  // fail-closed on unrecognized length
-
     Bytes dsaPub, dsaSig;
-    if (dsaPubLen > 0) {
-        size_t dsaSigLen = 0;
-        if (dsaPubLen == 1952)      dsaSigLen = 3309;
-        else if (dsaPubLen == 1312) dsaSigLen = 2420;
-        else if (dsaPubLen == 2592) dsaSigLen = 4627;
-
-        if (dsaSigLen == 0 || pt.size() < parseOffset + dsaPubLen + dsaSigLen) {
+    bool dsaInline = false;
+    if (dsaPubLen == kDsaKeyRefMarker) {
+        if (pt.size() < parseOffset + kDsaKeyIdLen) return result;
+        const Bytes keyId(pt.begin() + parseOffset,
+                          pt.begin() + parseOffset + kDsaKeyIdLen);
+        parseOffset += kDsaKeyIdLen;
+
+        // Resolve + re-derive the id so a lookup that returns the wrong
+        // key can't make us verify against it.
+        if (lookupDsaPub) dsaPub = lookupDsaPub(result.senderEdPub, keyId);
+        const size_t dsaSigLen = dsaSigLenFor(dsaPub.size());
+        if (dsaSigLen == 0 || dsaKeyId(dsaPub) != keyId) {
+            result.senderEdPub.clear();
+            result.unknownDsaKey = true;
+            return result;
+        }
+        if (pt.size() < parseOffset + dsaSigLen) return result;
+        dsaSig.assign(pt.begin() + parseOffset, pt.begin() + parseOffset + dsaSigLen);
+        parseOffset += dsaSigLen;
+    } else if (dsaPubLen > 0) {
+        const size_t dsaSigLen = dsaSigLenFor(dsaPubLen);
+        if (dsaSigLen == 0) return result;  // fail-closed on unrecognized length
+        if (pt.size() < parseOffset + dsaPubLen + dsaSigLen) {
             return result;  // fail-closed on malformed DSA extension
         }
         dsaPub.assign(pt.begin() + parseOffset, pt.begin() + parseOffset + dsaPubLen);
         parseOffset += dsaPubLen;
         dsaSig.assign(pt.begin() + parseOffset, pt.begin() + parseOffset + dsaSigLen);
         parseOffset += dsaSigLen;
+        dsaInline = true;
+    }
+
+    // 6b. Multi-recipient: leafIndex(2) || leafCount(2) || path.  The
+    //     signatures cover the tree root, rebuilt here from our own leaf.
+    Bytes signedBytes;
+    if (multi) {
+        if (pt.size() < parseOffset + 4) return result;
+        const size_t leafIndex = read_u16_be(pt.data() + parseOffset);
+        const size_t leafCount = read_u16_be(pt.data() + parseOffset + 2);
+        parseOffset += 4;
+        if (leafIndex >= leafCount) return result;
+        const size_t pathLen = merklePathLen(leafIndex, leafCount) * kMerkleHashLen;
+        if (pt.size() < parseOffset + pathLen) return result;
+        const uint8_t* path = pt.data() + parseOffset;
+        parseOffset += pathLen;
+
+        const Bytes leaf = merkleLeaf(recipientEdPub, envelopeId,
+                                      pt.data() + parseOffset, pt.size() - parseOffset);
+        signedBytes = multiSignedBytes(
+            leafCount, merkleRootFromPath(leaf, leafIndex, leafCount, path));
     }
 
     result.innerPayload.assign(pt.begin() + parseOffset, pt.end());
     result.envelopeId = envelopeId;
 
-    // 7. Verify Ed25519 signature over (envelopeId || innerPayload).
-    Bytes signedBytes;
-    signedBytes.reserve(envelopeId.size() + result.innerPayload.size());
-    append(signedBytes, envelopeId);
-    append(signedBytes, result.innerPayload);
+    // 7. Verify Ed25519 signature over (envelopeId || innerPayload), or
+    //    over the tree root for multi-recipient envelopes.
+    if (!multi) {
+        signedBytes.reserve(envelopeId.size() + result.innerPayload.size());
+        append(signedBytes, envelopeId);
+        append(signedBytes, result.innerPayload);
+    }
 
     if (!CryptoEngine::verifySignature(edSig, signedBytes, result.senderEdPub)) {
         result.senderEdPub.clear();
@@ -526,6 +889,7 @@ UnsealResult SealedEnvelope::unseal(const Bytes& recipientCurvePriv,
             result.envelopeId.clear();
             return result;
         }
+        if (dsaInline) result.senderDsaPub = std::move(dsaPub);
     }
 
     result.valid = true;
@@ -3,6 +3,7 @@
 #include "types.hpp"
 
 #include <cstdint>
+#include <functional>
 #include <vector>
 
 /*
@@ -21,6 +22,33 @@
  *                                              envelopeId(16) || senderEdPub(32) || sig(64) || innerCt)
  *   envelopeKey = BLAKE2b-256(key="Peer2Pear-SealedEnvelope-v2", ecdhShared || kemShared)
  *
+ * Envelope plaintext:
+ *   envelopeId(16) || senderEdPub(32) || edSig(64) || dsaPubLen(2 BE)
+ *     || [dsaPub || dsaSig]            — dsaPubLen = 1312 / 1952 / 2592
+ *     || [dsaKeyId(16) || dsaSig]      — dsaPubLen = 0xFFFF (key by reference)
+ *     || innerPayload
+ *
+ * The by-reference form replaces the ~2 KB ML-DSA public key with its
+ * 16-byte id once the recipient has cached the key; the recipient
+ * resolves the id through the lookup passed to unseal().  Older
+ * clients reject 0xFFFF, so senders only use it for peers that have
+ * acknowledged holding the key (see SessionSealer).
+ *
+ * Multi-recipient wire format (versions 0x04 classical / 0x05 hybrid):
+ *   same outer layout and key derivation as 0x02 / 0x03; the plaintext
+ *   gains a commitment-tree position ahead of the inner payload:
+ *     envelopeId(16) || senderEdPub(32) || edSig(64) || dsaPubLen(2) || [...]
+ *       || leafIndex(2 BE) || leafCount(2 BE) || path(32 × depth) || innerPayload
+ *   leaf = BLAKE2b-256(key="Peer2Pear-SealedMulti-v1",
+ *                      0x00 || recipientEdPub || envelopeId || innerPayload)
+ *   node = BLAKE2b-256(key="Peer2Pear-SealedMulti-v1", 0x01 || left || right)
+ *   An odd trailing node moves up a level unhashed, so depth follows from
+ *   (leafIndex, leafCount) and isn't carried.  edSig / dsaSig cover
+ *   "Peer2Pear-SealedMulti-v1" || leafCount(2 BE) || root, so a group
+ *   fan-out pays for ONE Ed25519 and ONE ML-DSA signature however many
+ *   members it reaches; each recipient sees only its own leaf and the
+ *   sibling hashes, not the other members' ciphertexts.
+ *
  * The sender signs (envelopeId || innerPayload) with their Ed25519 key.
  * Binding recipientEdPub into the AEAD AAD prevents a malicious relay from
  * re-routing the sealed blob to a different recipient.
@@ -34,7 +62,12 @@ struct UnsealResult {
     Bytes senderEdPub;   // 32 bytes — sender's Ed25519 public key
     Bytes innerPayload;  // decrypted inner ciphertext
     Bytes envelopeId;    // 16 bytes — unique per-envelope id, for replay dedup
+    Bytes senderDsaPub;  // ML-DSA pub when carried inline (and verified); else empty
     bool  valid = false;
+    // Set when the envelope referenced an ML-DSA key by id that the
+    // lookup couldn't resolve.  The envelope is rejected either way;
+    // the flag just lets the caller log why.
+    bool  unknownDsaKey = false;
 };
 
 // Inner-wire prefixes prepended to a sealed envelope before it's
@@ -57,6 +90,32 @@ inline constexpr const char kSealedFCPrefix[] = "SEALEDFC:";
 
 class SealedEnvelope {
 public:
+    // Resolves a sender's ML-DSA public key from its 16-byte id.
+    // Returns empty when the key isn't cached.
+    using DsaKeyLookup = std::function<Bytes(const Bytes& senderEdPub,
+                                             const Bytes& dsaKeyId)>;
+
+    static constexpr size_t kDsaKeyIdLen = 16;
+
+    // leafCount is a 2-byte field.
+    static constexpr size_t kMaxMultiRecipients = 0xFFFF;
+
+    // One recipient of sealMulti().  Keys are as for seal(); `signDsa`
+    // attaches the shared ML-DSA signature to this recipient's copy,
+    // `dsaPubByRef` carries it by key id.
+    struct MultiRecipient {
+        Bytes curvePub;      // X25519 (32)
+        Bytes edPub;         // Ed25519 (32) — AAD + leaf binding
+        Bytes kemPub;        // ML-KEM-768 (1184, optional → classical)
+        Bytes innerPayload;
+        bool  signDsa     = false;
+        bool  dsaPubByRef = false;
+    };
+
+    // BLAKE2b-128 of an ML-DSA public key — the id used by the
+    // by-reference envelope form.
+    static Bytes dsaKeyId(const Bytes& dsaPub);
+
     // Seal a payload so only the recipient can read it and learn the sender.
     //
     // If recipientKemPub is non-empty (1184 bytes), a hybrid X25519 + ML-KEM-768
@@ -74,6 +133,8 @@ public:
     // recipientKemPub:   recipient's ML-KEM-768 public key (1184, optional)
     // senderDsaPub:      sender's ML-DSA-65 public key (1952, optional)
     // senderDsaPriv:     sender's ML-DSA-65 private key (4032, optional)
+    // dsaPubByRef:       carry dsaKeyId(senderDsaPub) instead of the full
+    //                    pub — only for recipients known to cache it
     static Bytes seal(const Bytes& recipientCurvePub,
                       const Bytes& recipientEdPub,
                       const Bytes& senderEdPub,
@@ -81,7 +142,21 @@ public:
                       const Bytes& innerPayload,
                       const Bytes& recipientKemPub = {},
                       const Bytes& senderDsaPub = {},
-                      const Bytes& senderDsaPriv = {});
+                      const Bytes& senderDsaPriv = {},
+                      bool dsaPubByRef = false);
+
+    // Seal a distinct payload to each recipient under one shared
+    // signature over a commitment tree of all of them (format 0x04 /
+    // 0x05 above).  The result lines up with `recipients`; an entry is
+    // empty if that recipient's keys were malformed or its ECDH / KEM
+    // step failed.  All entries are empty if the sender keys are
+    // malformed or ML-DSA signing fails.  Recipients must be able to
+    // read the multi form — callers gate on the peer's advertisement.
+    static std::vector<Bytes> sealMulti(const std::vector<MultiRecipient>& recipients,
+                                        const Bytes& senderEdPub,
+                                        const Bytes& senderEdPriv,
+                                        const Bytes& senderDsaPub = {},
+                                        const Bytes& senderDsaPriv = {});
 
     // Wrap a sealed envelope with a routing header + padding for relay transport.
     // Format: 0x01 || recipientEdPub(32) || innerLen(4 BE) || sealedBytes || randomPadding
@@ -90,6 +165,18 @@ public:
     static Bytes wrapForRelay(const Bytes& recipientEdPub,
                               const Bytes& sealedBytes);
 
+    // Total size wrapForRelay pads a `sealedSize`-byte envelope up to.
+    static size_t relayPaddedSize(size_t sealedSize);
+
+    // Grow a wrapForRelay output to `total` bytes with more random
+    // padding (constant-rate ticks pad every envelope to one bucket).
+    // False, envelope untouched, if it is malformed or already larger.
+    static bool padRelayTo(Bytes& relayEnvelope, size_t total);
+
+    // innerLen from a wrapForRelay output's routing header (the sealed
+    // envelope's size before padding), or 0 if the header is malformed.
+    static size_t relaySealedSize(const Bytes& relayEnvelope);
+
     // Strip the routing header and padding, returning the inner sealed envelope.
     // Also extracts the recipientEdPub if non-null.
     // Returns empty if the header is malformed.
@@ -107,26 +194,34 @@ public:
     // external network observer can't distinguish file chunks from
     // control frames by size alone.  Wire layout:
     //   innerLen(4 BE) || payload || randomPadding
-    // Buckets are the same 2 / 16 / 256 KiB set used by wrapForRelay.
-    // Unlike wrapForRelay, there's no routing header (P2P is already
-    // addressed by the QUIC connection itself).
+    // Buckets are the same 2 / 16 / 256 KiB set used by wrapForRelay;
+    // anything larger rounds up to a 256 KiB multiple.  Unlike
+    // wrapForRelay, there's no routing header (P2P is already addressed
+    // by the QUIC connection itself).
     static Bytes padForP2P(const Bytes& payload);
 
     // Strip the length header + padding added by padForP2P.  Returns
     // empty if the header is malformed or claims more bytes than the
-    // framed buffer can hold.
-    static Bytes unpadFromP2P(const Bytes& padded);
+    // framed buffer can hold.  The pointer form reads straight out of
+    // a transport receive buffer.
+    static Bytes unpadFromP2P(const uint8_t* padded, size_t len);
+    static Bytes unpadFromP2P(const Bytes& padded)
+    { return unpadFromP2P(padded.data(), padded.size()); }
 
     // Unseal an envelope using the recipient's keys.
     //
     // recipientCurvePriv: recipient's X25519 private key (32)
     // recipientEdPub:     recipient's Ed25519 public key (32) — must match the
     //                     AAD the sender used, or AEAD decryption will fail.
-    // sealedBytes:        the sealed envelope (classical v2 or hybrid v2)
+    // sealedBytes:        the sealed envelope (classical / hybrid, single or
+    //                     multi-recipient)
     // recipientKemPriv:   recipient's ML-KEM-768 private key (2400, optional)
-    //                     Required for hybrid envelopes (version 0x03).
+    //                     Required for hybrid envelopes (version 0x03 / 0x05).
+    // lookupDsaPub:       resolves by-reference ML-DSA keys (optional;
+    //                     without it such envelopes are rejected)
     static UnsealResult unseal(const Bytes& recipientCurvePriv,
                                const Bytes& recipientEdPub,
                                const Bytes& sealedBytes,
-                               const Bytes& recipientKemPriv = {});
+                               const Bytes& recipientKemPriv = {},
+                               const DsaKeyLookup& lookupDsaPub = {});
 };
@@ -68,6 +68,7 @@ RatchetSession* SessionManager::getSession(const std::string& peerIdB64u) {
 
     RatchetSession session = RatchetSession::deserialize(blob);
     if (!session.isValid()) return nullptr;
+    session.setKemCadence(m_kemEveryDhSteps, m_kemMaxIntervalSecs);
 
     m_sessions[peerIdB64u] = std::move(session);
     return &m_sessions[peerIdB64u];
@@ -79,6 +80,20 @@ void SessionManager::persistSession(const std::string& peerIdB64u) {
     m_store.saveSession(peerIdB64u, it->second.serialize());
 }
 
+void SessionManager::setKemCadence(uint32_t everyDhSteps, int64_t maxIntervalSecs) {
+    m_kemEveryDhSteps    = everyDhSteps;
+    m_kemMaxIntervalSecs = maxIntervalSecs;
+    for (auto& [peer, session] : m_sessions)
+        session.setKemCadence(everyDhSteps, maxIntervalSecs);
+}
+
+void SessionManager::notePeerKemHeader(const std::string& peerIdB64u, int version) {
+    RatchetSession* s = getSession(peerIdB64u);
+    if (!s || s->peerReadsKemFlags()) return;
+    s->notePeerKemHeader(version);
+    if (s->peerReadsKemFlags()) persistSession(peerIdB64u);
+}
+
 bool SessionManager::hasSession(const std::string& peerIdB64u) const {
     if (m_sessions.count(peerIdB64u)) return true;
     return !m_store.loadSession(peerIdB64u).empty();
@@ -354,6 +369,7 @@ Bytes SessionManager::decryptFromPeer(const std::string& senderIdB64u,
         // This lets us derive both recv and send chains immediately — no LEGACY fallback
         RatchetSession ratchet = RatchetSession::initAsResponder(
             hr.sendCipher.key, ephPub, ephPriv, initiatorRatchetDhPub, hybrid);
+        ratchet.setKemCadence(m_kemEveryDhSteps, m_kemMaxIntervalSecs);
 
         m_sessions[senderIdB64u] = ratchet;
         persistSession(senderIdB64u);
@@ -473,6 +489,7 @@ Bytes SessionManager::decryptFromPeer(const std::string& senderIdB64u,
             hr.recvCipher.key, responderEphPub,
             ratchetDhPub, ratchetDhPriv,
             noise.isHybrid());
+        ratchet.setKemCadence(m_kemEveryDhSteps, m_kemMaxIntervalSecs);
         // Zero extracted private key now that ratchet owns it.
         sodium_memzero(ratchetDhPriv.data(), ratchetDhPriv.size());
         sodium_memzero(pendingBlob.data(), pendingBlob.size());
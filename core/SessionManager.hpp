@@ -89,6 +89,16 @@ public:
     // Delete a session (e.g., when removing a contact).
     void deleteSession(const std::string& peerIdB64u);
 
+    // KEM ratchet cadence for hybrid sessions (see
+    // RatchetSession::setKemCadence).  Applies to live sessions now and
+    // to every session created or loaded afterwards.
+    void setKemCadence(uint32_t everyDhSteps, int64_t maxIntervalSecs = 0);
+
+    // Pass on the flagged-header version a peer advertised ("khv") to
+    // its current session (see RatchetSession::notePeerKemHeader),
+    // persisting the session when that changes its header layout.
+    void notePeerKemHeader(const std::string& peerIdB64u, int version);
+
 private:
     // Get or load a ratchet session from cache/DB.
     RatchetSession* getSession(const std::string& peerIdB64u);
@@ -102,6 +112,9 @@ private:
     std::map<std::string, RatchetSession> m_sessions;
     Bytes m_lastMessageKey;
 
+    uint32_t m_kemEveryDhSteps    = 1;
+    int64_t  m_kemMaxIntervalSecs = 0;
+
     // Chaining keys from completed handshakes — used to decrypt additional
     // pre-key messages (type 0x06) that arrived while the handshake was pending.
     // Cleared when the ratchet session receives a normal ratchet message.
@@ -25,6 +25,7 @@ void SessionSealer::setDatabase(SqlCipherDb* db)
 {
     m_dbPtr = db;
     ensureVerifiedPeersTable();
+    ensurePeerDsaKeysTable();
 }
 
 // ── The choke point ─────────────────────────────────────────────────────────
@@ -32,18 +33,99 @@ void SessionSealer::setDatabase(SqlCipherDb* db)
 Bytes SessionSealer::sealForPeer(const std::string& peerIdB64u,
                                   const Bytes& plaintext)
 {
-    if (!m_sessionMgr) return {};
+    Bytes peerEdPub, sessionBlob;
+    bool signDsa = false;
+    if (!encryptForSeal(peerIdB64u, plaintext, peerEdPub, sessionBlob, signDsa))
+        return {};
+    return sealAndWrap(peerIdB64u, peerEdPub, sessionBlob, kSealedPrefix, signDsa);
+}
+
+std::vector<Bytes> SessionSealer::sealForPeers(
+    const std::vector<std::pair<std::string, Bytes>>& items)
+{
+    std::vector<Bytes> out(items.size());
+
+    // Trust gate + ratchet step per peer, exactly as sealForPeer.  Peers
+    // that read the multi-recipient envelope are held back to share one
+    // signature; the rest are sealed individually below.
+    std::vector<size_t> multiAt;
+    std::vector<Bytes>  multiEdPubs;
+    std::vector<SealedEnvelope::MultiRecipient> multi;
+    std::vector<size_t> singleAt;
+    std::vector<std::pair<Bytes, bool>> single;   // (peerEdPub, signDsa)
+    std::vector<Bytes> blobs(items.size());
+
+    for (size_t i = 0; i < items.size(); ++i) {
+        const std::string& peer = items[i].first;
+        Bytes peerEdPub;
+        bool signDsa = false;
+        if (!encryptForSeal(peer, items[i].second, peerEdPub, blobs[i], signDsa))
+            continue;
+
+        Bytes curvePub = peerReadsMultiSeal(peer)
+                             ? CryptoEngine::edPubToCurvePub(peerEdPub) : Bytes{};
+        if (curvePub.empty()) {
+            singleAt.push_back(i);
+            single.emplace_back(std::move(peerEdPub), signDsa);
+            continue;
+        }
+        SealedEnvelope::MultiRecipient r;
+        r.curvePub     = std::move(curvePub);
+        r.edPub        = peerEdPub;
+        r.kemPub       = lookupPeerKemPub(peer);
+        r.innerPayload = std::move(blobs[i]);
+        r.signDsa      = signDsa;
+        r.dsaPubByRef  = peerHoldsOurDsaKey(peer);
+        multiAt.push_back(i);
+        multiEdPubs.push_back(std::move(peerEdPub));
+        multi.push_back(std::move(r));
+    }
+
+    // One multi-capable peer gains nothing from the tree — seal it the
+    // ordinary (slightly smaller) way.
+    if (multi.size() == 1) {
+        singleAt.push_back(multiAt.front());
+        single.emplace_back(std::move(multiEdPubs.front()), multi.front().signDsa);
+        blobs[multiAt.front()] = std::move(multi.front().innerPayload);
+        multi.clear();
+    }
+
+    for (size_t k = 0; k < singleAt.size(); ++k) {
+        const size_t i = singleAt[k];
+        out[i] = sealAndWrap(items[i].first, single[k].first, blobs[i],
+                             kSealedPrefix, single[k].second);
+    }
+
+    if (!multi.empty()) {
+        const std::vector<Bytes> sealed = SealedEnvelope::sealMulti(
+            multi, m_crypto.identityPub(), m_crypto.identityPriv(),
+            m_crypto.dsaPub(), m_crypto.dsaPriv());
+        for (size_t k = 0; k < multi.size(); ++k) {
+            if (sealed[k].empty()) continue;
+            out[multiAt[k]] = wrapSealed(multiEdPubs[k], sealed[k], kSealedPrefix);
+        }
+    }
+    return out;
+}
+
+bool SessionSealer::encryptForSeal(const std::string& peerIdB64u,
+                                    const Bytes& plaintext,
+                                    Bytes& peerEdPub,
+                                    Bytes& sessionBlob,
+                                    bool& signDsa)
+{
+    if (!m_sessionMgr) return false;
 
     // Validate the peer ID up front, before we spend crypto on it.
     // CryptoEngine::edPubToCurvePub does the libsodium call for us +
     // returns empty on bad length; a truncated or non-base64url
     // peerIdB64u is rejected before encryptForPeer runs.
-    Bytes peerEdPub = CryptoEngine::fromBase64Url(peerIdB64u);
+    peerEdPub = CryptoEngine::fromBase64Url(peerIdB64u);
     if (peerEdPub.size() != 32) {
         P2P_WARN("[SEND] sealForPeer rejecting bad peerId length="
                  << peerEdPub.size() << " for "
                  << p2p::peerPrefix(peerIdB64u) << "...");
-        return {};
+        return false;
     }
 
     // detectKeyChange fires onPeerKeyChanged once per session per peer.
@@ -52,38 +134,19 @@ Bytes SessionSealer::sealForPeer(const std::string& peerIdB64u,
     if (detectKeyChange(peerIdB64u) && m_hardBlockOnKeyChange) {
         P2P_WARN("[SEND] BLOCKED — peer's safety number changed for "
                  << p2p::peerPrefix(peerIdB64u) << "... (hard-block on)");
-        return {};
+        return false;
     }
 
     // Pass peer's KEM pub so SessionManager can do hybrid Noise handshake if available.
     Bytes peerKemPub = lookupPeerKemPub(peerIdB64u);
-    Bytes sessionBlob = m_sessionMgr->encryptForPeer(peerIdB64u, plaintext, peerKemPub);
-    if (sessionBlob.empty()) return {};
-
-    Bytes recipientCurvePub = CryptoEngine::edPubToCurvePub(peerEdPub);
-    if (recipientCurvePub.empty()) return {};
+    sessionBlob = m_sessionMgr->encryptForPeer(peerIdB64u, plaintext, peerKemPub);
+    if (sessionBlob.empty()) return false;
 
-    // Use hybrid seal if we know the peer's ML-KEM-768 public key.
-    // Include ML-DSA-65 signature if we have DSA keys.
-    Bytes sealed = SealedEnvelope::seal(
-        recipientCurvePub, peerEdPub,
-        m_crypto.identityPub(), m_crypto.identityPriv(),
-        sessionBlob, peerKemPub,
-        m_crypto.dsaPub(), m_crypto.dsaPriv());
-    if (sealed.empty()) return {};
-
-    // Inner wire: kSealedPrefix + "\n" + sealed
-    Bytes inner;
-    const size_t prefixLen = std::strlen(kSealedPrefix);
-    inner.reserve(prefixLen + 1 + sealed.size());
-    inner.insert(inner.end(),
-                 reinterpret_cast<const uint8_t*>(kSealedPrefix),
-                 reinterpret_cast<const uint8_t*>(kSealedPrefix) + prefixLen);
-    inner.push_back('\n');
-    inner.insert(inner.end(), sealed.begin(), sealed.end());
-
-    // Wrap with relay routing header so /v1/send can route anonymously.
-    return SealedEnvelope::wrapForRelay(peerEdPub, inner);
+    // Ratchet traffic inherits its authenticity from the handshake, so
+    // under HandshakeOnly only the pre-key / handshake blobs carry DSA.
+    signDsa = m_dsaSignPolicy == DsaSignPolicy::EveryEnvelope
+           || sessionBlob[0] != SessionManager::kRatchetMsg;
+    return true;
 }
 
 Bytes SessionSealer::sealPreEncryptedForPeer(const std::string& peerIdB64u,
@@ -113,27 +176,10 @@ Bytes SessionSealer::sealPreEncryptedForPeer(const std::string& peerIdB64u,
         return {};
     }
 
-    Bytes recipientCurvePub = CryptoEngine::edPubToCurvePub(peerEdPub);
-    if (recipientCurvePub.empty()) return {};
-
-    Bytes peerKemPub = lookupPeerKemPub(peerIdB64u);
-    Bytes sealed = SealedEnvelope::seal(
-        recipientCurvePub, peerEdPub,
-        m_crypto.identityPub(), m_crypto.identityPriv(),
-        preEncryptedPayload, peerKemPub,
-        m_crypto.dsaPub(), m_crypto.dsaPriv());
-    if (sealed.empty()) return {};
-
-    Bytes inner;
-    const size_t prefixLen = std::strlen(kSealedFCPrefix);
-    inner.reserve(prefixLen + 1 + sealed.size());
-    inner.insert(inner.end(),
-                 reinterpret_cast<const uint8_t*>(kSealedFCPrefix),
-                 reinterpret_cast<const uint8_t*>(kSealedFCPrefix) + prefixLen);
-    inner.push_back('\n');
-    inner.insert(inner.end(), sealed.begin(), sealed.end());
-
-    return SealedEnvelope::wrapForRelay(peerEdPub, inner);
+    // Chunks are keyed off the ratchet, so they follow the ratchet's
+    // DSA policy.
+    return sealAndWrap(peerIdB64u, peerEdPub, preEncryptedPayload, kSealedFCPrefix,
+                       m_dsaSignPolicy == DsaSignPolicy::EveryEnvelope);
 }
 
 Bytes SessionSealer::sealHandshakeResponseForPeer(const std::string& peerIdB64u,
@@ -142,30 +188,54 @@ Bytes SessionSealer::sealHandshakeResponseForPeer(const std::string& peerIdB64u,
     if (handshakeBlob.empty()) return {};
 
     Bytes peerEdPub = CryptoEngine::fromBase64Url(peerIdB64u);
-    Bytes recipientCurvePub = CryptoEngine::edPubToCurvePub(peerEdPub);
-    if (recipientCurvePub.empty()) return {};
-
     // Handshake responses do NOT run detectKeyChange / hard-block:
     // the response itself is the identity proof, and refusing it
-    // would permanently wedge a legitimate re-keyed peer.
+    // would permanently wedge a legitimate re-keyed peer.  They are
+    // always DSA-signed — this is where ratchet traffic gets its PQ
+    // authentication from under HandshakeOnly.
+    return sealAndWrap(peerIdB64u, peerEdPub, handshakeBlob, kSealedPrefix,
+                       /*signDsa=*/true);
+}
 
-    Bytes peerKemPub = lookupPeerKemPub(peerIdB64u);
+Bytes SessionSealer::sealAndWrap(const std::string& peerIdB64u,
+                                  const Bytes& peerEdPub,
+                                  const Bytes& payload,
+                                  const char* prefix,
+                                  bool signDsa)
+{
+    Bytes recipientCurvePub = CryptoEngine::edPubToCurvePub(peerEdPub);
+    if (recipientCurvePub.empty()) return {};
+
+    // Use hybrid seal if we know the peer's ML-KEM-768 public key.
+    // Include ML-DSA-65 signature if we have DSA keys and the policy
+    // wants one; reference the pub by id once the peer has cached it.
+    static const Bytes kNone;
+    const Bytes peerKemPub = lookupPeerKemPub(peerIdB64u);
     Bytes sealed = SealedEnvelope::seal(
         recipientCurvePub, peerEdPub,
         m_crypto.identityPub(), m_crypto.identityPriv(),
-        handshakeBlob, peerKemPub,
-        m_crypto.dsaPub(), m_crypto.dsaPriv());
+        payload, peerKemPub,
+        signDsa ? m_crypto.dsaPub()  : kNone,
+        signDsa ? m_crypto.dsaPriv() : kNone,
+        peerHoldsOurDsaKey(peerIdB64u));
     if (sealed.empty()) return {};
+    return wrapSealed(peerEdPub, sealed, prefix);
+}
 
+Bytes SessionSealer::wrapSealed(const Bytes& peerEdPub, const Bytes& sealed,
+                                 const char* prefix)
+{
+    // Inner wire: prefix + "\n" + sealed
     Bytes inner;
-    const size_t prefixLen = std::strlen(kSealedPrefix);
+    const size_t prefixLen = std::strlen(prefix);
     inner.reserve(prefixLen + 1 + sealed.size());
     inner.insert(inner.end(),
-                 reinterpret_cast<const uint8_t*>(kSealedPrefix),
-                 reinterpret_cast<const uint8_t*>(kSealedPrefix) + prefixLen);
+                 reinterpret_cast<const uint8_t*>(prefix),
+                 reinterpret_cast<const uint8_t*>(prefix) + prefixLen);
     inner.push_back('\n');
     inner.insert(inner.end(), sealed.begin(), sealed.end());
 
+    // Wrap with relay routing header so /v1/send can route anonymously.
     return SealedEnvelope::wrapForRelay(peerEdPub, inner);
 }
 
@@ -359,3 +429,88 @@ void SessionSealer::markKemPubAnnouncedTo(const std::string& peerIdB64u)
 {
     m_kemPubAnnounced.insert(peerIdB64u);
 }
+
+// ── DSA pub store ─────────────────────────────────────────────────────────
+
+void SessionSealer::ensurePeerDsaKeysTable()
+{
+    if (!m_dbPtr || !m_dbPtr->isOpen()) return;
+    SqlCipherQuery q(*m_dbPtr);
+    q.exec(
+        "CREATE TABLE IF NOT EXISTS peer_dsa_keys ("
+        "  peer_id  TEXT PRIMARY KEY,"
+        "  dsa_pub  BLOB NOT NULL"
+        ");"
+    );
+}
+
+Bytes SessionSealer::lookupPeerDsaPub(const std::string& peerIdB64u)
+{
+    auto it = m_peerDsaPubs.find(peerIdB64u);
+    if (it != m_peerDsaPubs.end()) return it->second;
+
+    if (!m_dbPtr || !m_dbPtr->isOpen()) return {};
+    SqlCipherQuery q(m_dbPtr->handle());
+    if (!q.prepare("SELECT dsa_pub FROM peer_dsa_keys WHERE peer_id=:pid;"))
+        return {};
+    q.bindValue(":pid", peerIdB64u);
+    if (q.exec() && q.next()) {
+        Bytes pub = q.valueBlob(0);
+        if (!pub.empty()) {
+            m_peerDsaPubs[peerIdB64u] = pub;
+            return pub;
+        }
+    }
+    return {};
+}
+
+void SessionSealer::savePeerDsaPub(const std::string& peerIdB64u, const Bytes& dsaPub)
+{
+    if (dsaPub.empty()) return;
+    // Every inline-key envelope lands here; skip the DB write when
+    // nothing changed.
+    if (lookupPeerDsaPub(peerIdB64u) == dsaPub) return;
+    m_peerDsaPubs[peerIdB64u] = dsaPub;
+    if (m_dbPtr && m_dbPtr->isOpen()) {
+        SqlCipherQuery q(*m_dbPtr);
+        if (!q.prepare(
+                "INSERT INTO peer_dsa_keys (peer_id, dsa_pub) VALUES (:pid, :pub)"
+                " ON CONFLICT(peer_id) DO UPDATE SET dsa_pub=excluded.dsa_pub;"))
+            return;
+        q.bindValue(":pid", peerIdB64u);
+        q.bindValue(":pub", dsaPub);
+        q.exec();
+    }
+}
+
+Bytes SessionSealer::peerDsaKeyId(const std::string& peerIdB64u)
+{
+    return SealedEnvelope::dsaKeyId(lookupPeerDsaPub(peerIdB64u));
+}
+
+void SessionSealer::notePeerDsaKeyAck(const std::string& peerIdB64u, const Bytes& keyId)
+{
+    const Bytes ours = SealedEnvelope::dsaKeyId(m_crypto.dsaPub());
+    if (!ours.empty() && keyId == ours)
+        m_peersHoldingOurDsaKey.insert(peerIdB64u);
+    else
+        m_peersHoldingOurDsaKey.erase(peerIdB64u);
+}
+
+bool SessionSealer::peerHoldsOurDsaKey(const std::string& peerIdB64u) const
+{
+    return m_peersHoldingOurDsaKey.count(peerIdB64u) != 0;
+}
+
+void SessionSealer::notePeerMultiSeal(const std::string& peerIdB64u, int version)
+{
+    if (version >= kMultiSealVersion)
+        m_peersReadingMultiSeal.insert(peerIdB64u);
+    else
+        m_peersReadingMultiSeal.erase(peerIdB64u);
+}
+
+bool SessionSealer::peerReadsMultiSeal(const std::string& peerIdB64u) const
+{
+    return m_peersReadingMultiSeal.count(peerIdB64u) != 0;
+}
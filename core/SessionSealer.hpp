@@ -7,6 +7,7 @@
 #include <set>
 #include <string>
 #include <unordered_map>
+#include <utility>
 #include <vector>
 
 class CryptoEngine;
@@ -43,6 +44,9 @@ class SqlCipherDb;
  *     crypto.  Writes invalidate the cache entry.
  *   - A per-peer `m_peerKemPubs` cache + `contacts.kem_pub` column
  *     hold peer ML-KEM-768 pub keys seen via kem_pub_announce.
+ *   - A per-peer `m_peerDsaPubs` cache + `peer_dsa_keys` table hold
+ *     peer ML-DSA pubs learned from inline-key sealed envelopes, so
+ *     later envelopes can reference the key by id instead.
  *
  * Thread model:
  *   Called only from ChatController entry points, which are serialized
@@ -61,6 +65,13 @@ public:
 
     enum class PeerTrust { Unverified, Verified, Mismatch };
 
+    // Which envelopes carry an ML-DSA signature.  HandshakeOnly drops it
+    // from ratchet messages (and the file chunks keyed off them): those
+    // are already authenticated by a ratchet rooted in a handshake whose
+    // envelopes WERE DSA-signed, and the ~3.3 KB signature is what
+    // pushes a one-line hybrid message out of the 2 KiB bucket.
+    enum class DsaSignPolicy { EveryEnvelope, HandshakeOnly };
+
     SessionSealer(CryptoEngine& crypto);
 
     // Late-binding wiring — set after ChatController has opened the DB
@@ -78,6 +89,16 @@ public:
     //   - SealedEnvelope::seal failed
     Bytes sealForPeer(const std::string& peerIdB64u, const Bytes& plaintext);
 
+    // sealForPeer over a fan-out of (peerId, plaintext) pairs.  Same
+    // trust gate and ratchet step per peer; peers that advertised the
+    // multi-recipient envelope (notePeerMultiSeal) share a single
+    // Ed25519 / ML-DSA signature via SealedEnvelope::sealMulti, so a
+    // group send costs one PQ signature instead of one per member.
+    // Result lines up with `items`; an empty entry failed for the same
+    // reasons sealForPeer would have.
+    std::vector<Bytes> sealForPeers(
+        const std::vector<std::pair<std::string, Bytes>>& items);
+
     // Seal an already-encrypted payload for a peer without advancing
     // the ratchet.  File chunks use this: the chunk is already sealed
     // under a per-file AEAD key (derived from the ratchet at
@@ -118,6 +139,10 @@ public:
     void setHardBlockOnKeyChange(bool on) { m_hardBlockOnKeyChange = on; }
     bool hardBlockOnKeyChange() const     { return m_hardBlockOnKeyChange; }
 
+    // Default EveryEnvelope.
+    void setDsaSignPolicy(DsaSignPolicy p) { m_dsaSignPolicy = p; }
+    DsaSignPolicy dsaSignPolicy() const    { return m_dsaSignPolicy; }
+
     // Explicit key-change check — fires `onPeerKeyChanged` at most
     // once per session per peer.  Exposed separately from sealForPeer
     // so the inbound dispatch path can gate delivery on mismatch too.
@@ -156,9 +181,38 @@ public:
     bool hasAnnouncedKemPubTo(const std::string& peerIdB64u) const;
     void markKemPubAnnouncedTo(const std::string& peerIdB64u);
 
+    // ── DSA pub store ─────────────────────────────────────────────────
+    // Peer ML-DSA pubs learned from inline-key envelopes.  Resolves the
+    // by-reference form in SealedEnvelope::unseal.
+    Bytes lookupPeerDsaPub(const std::string& peerIdB64u);
+    void  savePeerDsaPub(const std::string& peerIdB64u, const Bytes& dsaPub);
+
+    // Id of the DSA pub we hold for this peer (empty if none).  Sent
+    // back to the peer in payloads so it knows it may switch to the
+    // by-reference form.
+    Bytes peerDsaKeyId(const std::string& peerIdB64u);
+
+    // Record what the peer says it holds for OUR key.  A matching id
+    // enables by-reference sealing to that peer; anything else
+    // (including empty — e.g. the peer lost its DB) disables it.
+    void notePeerDsaKeyAck(const std::string& peerIdB64u, const Bytes& keyId);
+    bool peerHoldsOurDsaKey(const std::string& peerIdB64u) const;
+
+    // ── Multi-recipient envelopes ─────────────────────────────────────
+    // Highest multi-recipient envelope version this build reads; stamped
+    // into outbound payloads as "msv".
+    static constexpr int kMultiSealVersion = 1;
+
+    // Record the "msv" a peer's latest payload carried (0 if absent).
+    // Only peers at kMultiSealVersion or above get multi-recipient
+    // envelopes from sealForPeers.
+    void notePeerMultiSeal(const std::string& peerIdB64u, int version);
+    bool peerReadsMultiSeal(const std::string& peerIdB64u) const;
+
 private:
     // ── DB-backed helpers ─────────────────────────────────────────────
     void ensureVerifiedPeersTable();
+    void ensurePeerDsaKeysTable();
     Bytes loadVerifiedFingerprint(const std::string& peerIdB64u) const;
     void  saveVerifiedFingerprint(const std::string& peerIdB64u,
                                    const Bytes& fingerprint);
@@ -173,6 +227,21 @@ private:
     const PeerKeyCacheEntry& fingerprintsFor(const std::string& peerIdB64u) const;
     void invalidatePeerKeyCache(const std::string& peerIdB64u) const;
 
+    // Shared tail of the three seal paths: SealedEnvelope::seal with
+    // the peer's KEM pub and, when `signDsa`, our ML-DSA keys (by
+    // reference if the peer holds them), then prefix + relay wrap.
+    Bytes sealAndWrap(const std::string& peerIdB64u, const Bytes& peerEdPub,
+                      const Bytes& payload, const char* prefix, bool signDsa);
+
+    // Front half of sealForPeer: peer-id check, trust gate, ratchet
+    // encrypt and the DSA policy decision.  False = don't send.
+    bool encryptForSeal(const std::string& peerIdB64u, const Bytes& plaintext,
+                        Bytes& peerEdPub, Bytes& sessionBlob, bool& signDsa);
+
+    // prefix + "\n" + sealed, then the relay routing wrap.
+    static Bytes wrapSealed(const Bytes& peerEdPub, const Bytes& sealed,
+                            const char* prefix);
+
     CryptoEngine&    m_crypto;
     SessionManager*  m_sessionMgr = nullptr;
     SqlCipherDb*     m_dbPtr      = nullptr;
@@ -184,6 +253,7 @@ private:
     std::set<std::string> m_keyChangeWarned;
 
     bool m_hardBlockOnKeyChange = false;
+    DsaSignPolicy m_dsaSignPolicy = DsaSignPolicy::EveryEnvelope;
 
     // Peer ML-KEM-768 public keys: peerIdB64u -> 1184-byte KEM pub.
     // Populated by kem_pub_announce messages, used by sealForPeer
@@ -191,4 +261,16 @@ private:
     std::unordered_map<std::string, Bytes> m_peerKemPubs;
     // Peers we've already announced our own KEM pub to this session.
     std::set<std::string> m_kemPubAnnounced;
+
+    // Peer ML-DSA pubs: peerIdB64u -> pub (write-through to peer_dsa_keys).
+    std::unordered_map<std::string, Bytes> m_peerDsaPubs;
+    // Peers that acknowledged holding our current DSA pub.  In-memory
+    // only: after a restart we send the inline key again until the
+    // peer's next payload re-acknowledges it.
+    std::set<std::string> m_peersHoldingOurDsaKey;
+
+    // Peers whose latest payload advertised kMultiSealVersion.  In-memory
+    // only, like the DSA ack: a restart seals individually until the
+    // peer speaks again.
+    std::set<std::string> m_peersReadingMultiSeal;
 };
@@ -0,0 +1,247 @@
+#include "TreeHash.hpp"
+#include "FileSource.hpp"
+
+#include <sodium.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <thread>
+
+namespace {
+
+constexpr size_t   kHashBytes        = 32;
+constexpr int64_t  kBytesPerThread   = 1024 * 1024;
+constexpr unsigned kMaxHashThreads   = 8;
+// Leaves read per FileSource read — 1 MiB, same window as blake2b256().
+constexpr int64_t  kLeavesPerWindow  = kBytesPerThread / TreeHash::kLeafBytes;
+
+int64_t leafCountFor(int64_t fileSize)
+{
+    return std::max<int64_t>(1, (fileSize + TreeHash::kLeafBytes - 1) / TreeHash::kLeafBytes);
+}
+
+void hashLeaf(const uint8_t* data, size_t len, uint8_t* out)
+{
+    static const uint8_t kTag = 0x00;
+    crypto_generichash_state st;
+    crypto_generichash_init(&st, nullptr, 0, kHashBytes);
+    crypto_generichash_update(&st, &kTag, 1);
+    crypto_generichash_update(&st, data, static_cast<unsigned long long>(len));
+    crypto_generichash_final(&st, out, kHashBytes);
+}
+
+void hashNode(const uint8_t* left, const uint8_t* right, uint8_t* out)
+{
+    uint8_t buf[1 + 2 * kHashBytes];
+    buf[0] = 0x01;
+    std::memcpy(buf + 1, left, kHashBytes);
+    std::memcpy(buf + 1 + kHashBytes, right, kHashBytes);
+    crypto_generichash(out, kHashBytes, buf, sizeof(buf), nullptr, 0);
+}
+
+Bytes rootOf(int64_t fileSize, const uint8_t* top)
+{
+    uint8_t buf[1 + 8 + 4 + kHashBytes];
+    buf[0] = 0x02;
+    const uint64_t size = uint64_t(fileSize);
+    for (int i = 0; i < 8; ++i) buf[1 + i] = uint8_t(size >> (56 - 8 * i));
+    const uint32_t leaf = uint32_t(TreeHash::kLeafBytes);
+    for (int i = 0; i < 4; ++i) buf[9 + i] = uint8_t(leaf >> (24 - 8 * i));
+    std::memcpy(buf + 13, top, kHashBytes);
+    Bytes root(kHashBytes, 0);
+    crypto_generichash(root.data(), kHashBytes, buf, sizeof(buf), nullptr, 0);
+    return root;
+}
+
+// Split [0, count) into `threads` contiguous shares and run fn(begin,
+// end) on each; the first share runs on the calling thread.
+template <typename Fn>
+void forEachShare(int64_t count, unsigned threads, const Fn& fn)
+{
+    threads = unsigned(std::clamp<int64_t>(threads, 1, std::max<int64_t>(1, count)));
+    const int64_t share = (count + threads - 1) / threads;
+    std::vector<std::thread> workers;
+    for (unsigned t = 1; t < threads; ++t) {
+        const int64_t begin = int64_t(t) * share;
+        const int64_t end   = std::min(count, begin + share);
+        if (begin >= end) break;
+        workers.emplace_back([&fn, begin, end] { fn(begin, end); });
+    }
+    fn(0, std::min(count, share));
+    for (auto& w : workers) w.join();
+}
+
+// Leaf hashes of a leaf-aligned run of bytes into `out` (32 per leaf).
+void hashLeaves(const uint8_t* data, size_t len, uint8_t* out, unsigned threads)
+{
+    if (len == 0) {
+        hashLeaf(data, 0, out);
+        return;
+    }
+    const int64_t count = (int64_t(len) + TreeHash::kLeafBytes - 1) / TreeHash::kLeafBytes;
+    forEachShare(count, threads, [&](int64_t begin, int64_t end) {
+        for (int64_t i = begin; i < end; ++i) {
+            const int64_t off = i * TreeHash::kLeafBytes;
+            const size_t  n   = size_t(std::min<int64_t>(TreeHash::kLeafBytes,
+                                                         int64_t(len) - off));
+            hashLeaf(data + off, n, out + size_t(i) * kHashBytes);
+        }
+    });
+}
+
+}  // namespace
+
+unsigned TreeHash::threadsFor(int64_t bytes)
+{
+    const unsigned cores = std::max(1u, std::thread::hardware_concurrency());
+    const int64_t  want  = bytes / kBytesPerThread;
+    return unsigned(std::clamp<int64_t>(want, 1, std::min(cores, kMaxHashThreads)));
+}
+
+bool TreeHash::validRange(int64_t fileSize, int64_t offset, int64_t len)
+{
+    if (offset < 0 || len <= 0 || offset % kLeafBytes != 0 ||
+        len > fileSize - offset) return false;
+    return len % kLeafBytes == 0 || offset + len == fileSize;
+}
+
+std::shared_ptr<const TreeHash> TreeHash::build(FileSource& source, unsigned threads)
+{
+    const int64_t size  = source.size();
+    const int64_t count = leafCountFor(size);
+    Bytes leaves(size_t(count) * kHashBytes, 0);
+    if (size == 0) {
+        hashLeaf(nullptr, 0, leaves.data());
+        return fromLeaves(size, std::move(leaves));
+    }
+
+    // Each thread preads its windows into its own buffer; the Windows
+    // stream has one file position, so it stays serial.
+    if (threads == 0) threads = threadsFor(size);
+    if (!source.concurrentReads()) threads = 1;
+
+    std::atomic<bool> failed{false};
+    const int64_t windows = (count + kLeavesPerWindow - 1) / kLeavesPerWindow;
+    forEachShare(windows, threads, [&](int64_t begin, int64_t end) {
+        Bytes buf(size_t(std::min<int64_t>(kLeavesPerWindow * kLeafBytes, size)));
+        for (int64_t w = begin; w < end && !failed.load(); ++w) {
+            const int64_t off = w * kLeavesPerWindow * kLeafBytes;
+            const size_t  n   = size_t(std::min<int64_t>(kLeavesPerWindow * kLeafBytes,
+                                                         size - off));
+            if (!source.read(off, n, buf.data())) {
+                failed = true;
+                return;
+            }
+            hashLeaves(buf.data(), n, leaves.data() + size_t(w * kLeavesPerWindow) * kHashBytes, 1);
+        }
+    });
+    if (failed) return nullptr;
+    return fromLeaves(size, std::move(leaves));
+}
+
+std::shared_ptr<const TreeHash> TreeHash::build(const Bytes& data, unsigned threads)
+{
+    const int64_t size = int64_t(data.size());
+    Bytes leaves(size_t(leafCountFor(size)) * kHashBytes, 0);
+    hashLeaves(data.data(), data.size(), leaves.data(),
+               threads ? threads : threadsFor(size));
+    return fromLeaves(size, std::move(leaves));
+}
+
+std::shared_ptr<const TreeHash> TreeHash::fromLeaves(int64_t fileSize, Bytes leaves)
+{
+    std::shared_ptr<TreeHash> tree(new TreeHash());
+    tree->m_size = fileSize;
+    tree->m_levels.push_back(std::move(leaves));
+    while (tree->m_levels.back().size() > kHashBytes) {
+        const Bytes&  prev  = tree->m_levels.back();
+        const size_t  count = prev.size() / kHashBytes;
+        Bytes next(((count + 1) / 2) * kHashBytes, 0);
+        for (size_t i = 0; i + 1 < count; i += 2)
+            hashNode(&prev[i * kHashBytes], &prev[(i + 1) * kHashBytes],
+                     &next[(i / 2) * kHashBytes]);
+        if (count % 2)
+            std::memcpy(&next[(count / 2) * kHashBytes],
+                        &prev[(count - 1) * kHashBytes], kHashBytes);
+        tree->m_levels.push_back(std::move(next));
+    }
+    tree->m_root = rootOf(fileSize, tree->m_levels.back().data());
+    return tree;
+}
+
+// Walk up from the range's leaves [a, b).  At each level the range
+// needs its left neighbour when it starts on a right child, and its
+// right neighbour when it ends on a left child that has one; an
+// unpaired last node moves up as is.  verifyRange() walks the same way,
+// consuming the hashes in the order they were appended here.
+Bytes TreeHash::rangeProof(int64_t offset, int64_t len) const
+{
+    if (!validRange(m_size, offset, len)) return {};
+    int64_t a = offset / kLeafBytes;
+    int64_t b = (offset + len + kLeafBytes - 1) / kLeafBytes;
+
+    Bytes proof;
+    for (size_t h = 0; h + 1 < m_levels.size(); ++h) {
+        const Bytes&  level = m_levels[h];
+        const int64_t size  = int64_t(level.size() / kHashBytes);
+        if (a & 1) {
+            proof.insert(proof.end(), level.begin() + (a - 1) * int64_t(kHashBytes),
+                                      level.begin() + a * int64_t(kHashBytes));
+            --a;
+        }
+        if ((b & 1) && b < size) {
+            proof.insert(proof.end(), level.begin() + b * int64_t(kHashBytes),
+                                      level.begin() + (b + 1) * int64_t(kHashBytes));
+            ++b;
+        }
+        a /= 2;
+        b = (b + 1) / 2;
+    }
+    return proof;
+}
+
+bool TreeHash::verifyRange(const Bytes& root, int64_t fileSize,
+                           int64_t offset, const uint8_t* data, size_t len,
+                           const Bytes& proof, unsigned threads)
+{
+    if (root.size() != kHashBytes || proof.size() % kHashBytes != 0 ||
+        !validRange(fileSize, offset, int64_t(len))) return false;
+
+    int64_t a = offset / kLeafBytes;
+    int64_t b = (offset + int64_t(len) + kLeafBytes - 1) / kLeafBytes;
+    Bytes nodes(size_t(b - a) * kHashBytes, 0);
+    hashLeaves(data, len, nodes.data(), threads ? threads : threadsFor(int64_t(len)));
+
+    size_t used = 0;
+    for (int64_t size = leafCountFor(fileSize); size > 1; size = (size + 1) / 2) {
+        if (a & 1) {
+            if (used + kHashBytes > proof.size()) return false;
+            nodes.insert(nodes.begin(), proof.begin() + int64_t(used),
+                                        proof.begin() + int64_t(used + kHashBytes));
+            used += kHashBytes;
+            --a;
+        }
+        if ((b & 1) && b < size) {
+            if (used + kHashBytes > proof.size()) return false;
+            nodes.insert(nodes.end(), proof.begin() + int64_t(used),
+                                      proof.begin() + int64_t(used + kHashBytes));
+            used += kHashBytes;
+            ++b;
+        }
+        const size_t count = nodes.size() / kHashBytes;
+        Bytes next(((count + 1) / 2) * kHashBytes, 0);
+        for (size_t i = 0; i + 1 < count; i += 2)
+            hashNode(&nodes[i * kHashBytes], &nodes[(i + 1) * kHashBytes],
+                     &next[(i / 2) * kHashBytes]);
+        if (count % 2)   // only the level's last node is left unpaired
+            std::memcpy(&next[(count / 2) * kHashBytes],
+                        &nodes[(count - 1) * kHashBytes], kHashBytes);
+        nodes = std::move(next);
+        a /= 2;
+        b = (b + 1) / 2;
+    }
+
+    if (used != proof.size() || nodes.size() != kHashBytes) return false;
+    return rootOf(fileSize, nodes.data()) == root;
+}
@@ -0,0 +1,77 @@
+#pragma once
+
+#include "types.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+class FileSource;
+
+/*
+ * TreeHash — the "tree-v1" file integrity mode: a Merkle tree over
+ * fixed 16 KiB leaves of the file.
+ *
+ *   leaf = BLAKE2b-256(0x00 || leaf bytes)
+ *   node = BLAKE2b-256(0x01 || left || right)   an unpaired last node
+ *                                                moves up unchanged
+ *   root = BLAKE2b-256(0x02 || BE64 fileSize || BE32 kLeafBytes || top)
+ *
+ * Leaves don't depend on each other, so build() hashes them on several
+ * cores — the single BLAKE2b-256 pass it replaces is inherently serial.
+ * Every chunk size a transfer can settle on is a whole number of leaves,
+ * so one chunk is checked against the root on its own: rangeProof()
+ * gives the sibling hashes around it (at most two per level, under 1 KB
+ * for a 100 MB file) and verifyRange() rebuilds the root from the chunk
+ * plus that proof.  A receiver therefore rejects a bad chunk the moment
+ * it arrives instead of after the whole file has landed.
+ *
+ * Immutable once built; the sender keeps it for streaming and resends.
+ */
+class TreeHash {
+public:
+    static constexpr int64_t kLeafBytes = 16 * 1024;
+
+    // Highest file-hash mode this build reads; stamped into outbound
+    // payloads as "fhv".  A file_key in tree mode carries
+    // "hashMode": kModeName and the root as its fileHash.
+    static constexpr int         kVersion  = 1;
+    static constexpr const char* kModeName = "tree-v1";
+
+    // Hash every leaf of `source`.  threads == 0 picks from the file
+    // size and the core count.  nullptr on a short read (file truncated
+    // under us).
+    static std::shared_ptr<const TreeHash> build(FileSource& source,
+                                                 unsigned threads = 0);
+    static std::shared_ptr<const TreeHash> build(const Bytes& data,
+                                                 unsigned threads = 0);
+
+    const Bytes& root() const     { return m_root; }
+    int64_t      fileSize() const { return m_size; }
+
+    // Sibling hashes proving bytes [offset, offset + len) against
+    // root().  The range must be leaf-aligned (see validRange).  Empty
+    // on a bad range — and for a single-leaf file, which needs none.
+    Bytes rangeProof(int64_t offset, int64_t len) const;
+
+    // True when `data` is bytes [offset, offset + len) of the file that
+    // `root` (of size `fileSize`) commits to.
+    static bool verifyRange(const Bytes& root, int64_t fileSize,
+                            int64_t offset, const uint8_t* data, size_t len,
+                            const Bytes& proof, unsigned threads = 0);
+
+    // Starts on a leaf boundary, non-empty, and ends on one or at EOF.
+    static bool validRange(int64_t fileSize, int64_t offset, int64_t len);
+
+    // Workers for hashing `bytes`: one per MiB, capped by the core count.
+    static unsigned threadsFor(int64_t bytes);
+
+private:
+    TreeHash() = default;
+    static std::shared_ptr<const TreeHash> fromLeaves(int64_t fileSize, Bytes leaves);
+
+    int64_t            m_size = 0;
+    std::vector<Bytes> m_levels;   // [0] = leaf hashes, 32 bytes each; back() = top
+    Bytes              m_root;
+};
@@ -92,6 +92,17 @@ typedef struct {
     void  (*ws_send_text_v2)(void* conn_handle, const char* message, void* platform_ctx);
     int   (*ws_is_connected_v2)(void* conn_handle, void* platform_ctx);
     int   (*ws_is_idle_v2)(void* conn_handle, void* platform_ctx);
+
+    /* ── Binary WebSocket send (optional) ───────────────────────────────
+     *
+     * Only needed for the WS send path (p2p_set_ws_send_enabled).  When
+     * the callback for the active FFI generation is null, envelopes keep
+     * going out via http_post.  `data` is only valid for the duration of
+     * the call — copy it before returning.
+     */
+    void  (*ws_send_binary)(const uint8_t* data, int len, void* platform_ctx);
+    void  (*ws_send_binary_v2)(void* conn_handle, const uint8_t* data, int len,
+                               void* platform_ctx);
 } p2p_platform;
 
 /* ── Lifecycle ──────────────────────────────────────────────────────────── */
@@ -213,6 +224,28 @@ void p2p_unverify_peer(p2p_context* ctx, const char* peer_id);
  */
 void p2p_set_hard_block_on_key_change(p2p_context* ctx, int enabled);
 
+/**
+ * Policy: when enabled, ML-DSA signatures are carried only on session
+ * handshake envelopes; ratchet messages and file chunks rely on the
+ * ratchet (rooted in that signed handshake) for authenticity.  Saves
+ * ~3.3 KB per hybrid envelope, which keeps short messages in the
+ * 2 KiB padding bucket.  Default is off (sign every envelope).
+ */
+void p2p_set_dsa_handshake_only(p2p_context* ctx, int enabled);
+
+/**
+ * Policy: how often hybrid sessions run an ML-KEM ratchet step.  A KEM
+ * step happens every `every_dh_steps` DH ratchet steps, or once
+ * `max_interval_secs` (> 0) have passed since the last one, whichever
+ * comes first.  Headers between KEM steps carry no KEM material, so
+ * short messages stay in the 2 KiB padding bucket; the cost is that
+ * post-quantum healing after a compromise can take up to that many
+ * steps.  Default 1 (every DH step).  0 disables a trigger; 0 for both
+ * falls back to 1.
+ */
+void p2p_set_kem_ratchet_cadence(p2p_context* ctx, uint32_t every_dh_steps,
+                                 int64_t max_interval_secs);
+
 /**
  * Wipe the ratchet session with peer_id so the next outbound message
  * performs a fresh handshake.  Useful when a peer reports decryption
@@ -306,6 +339,74 @@ void p2p_set_parallel_fan_out_k(p2p_context* ctx, int k);
  */
 void p2p_set_multi_hop_enabled(p2p_context* ctx, int enabled);
 
+/**
+ * Toggle the WS send path (throughput, NOT anonymity).
+ *
+ * When enabled, envelopes bound for the primary relay are pipelined as
+ * binary frames over the already-authenticated receive WebSocket (with
+ * windowed acknowledgements) instead of one anonymous HTTP POST each.
+ * The relay can then attribute every envelope to the sending peer, so
+ * this is off by default and privacy levels 1 and 2 switch it off.
+ * Multi-hop and parallel fan-out always use HTTP.  Falls back to HTTP
+ * when the relay doesn't advertise support or the platform didn't wire
+ * ws_send_binary / ws_send_binary_v2.
+ *
+ * `enabled` is treated as a C bool: 0 = off, non-zero = on.
+ */
+void p2p_set_ws_send_enabled(p2p_context* ctx, int enabled);
+
+/**
+ * Snapshot of relay transport health, for operator / diagnostics UIs.
+ * Writes a heap-allocated NUL-terminated JSON string into *out_json;
+ * caller must free() it.  Returns 0 on success, -1 on error.  Shape:
+ *   { "relays": [ { "url": "https://r1.example",
+ *                   "latency_ms": 182.4,      EWMA of POST round-trip
+ *                   "error_rate": 0.02,       EWMA, 0..1
+ *                   "throttle_rate": 0.0,     EWMA of HTTP 429, 0..1
+ *                   "sent": 1200, "failed": 3, "throttled": 0,
+ *                   "weight": 0.56,           current selection weight
+ *                   "ejected": false, "probing": false }, ... ] }
+ */
+int p2p_relay_stats_json(p2p_context* ctx, char** out_json);
+
+/**
+ * Cap outbound relay bandwidth, in bytes per second (0 = no cap).
+ * `global_bytes_per_sec` bounds all relay traffic together;
+ * `per_relay_bytes_per_sec` applies to each relay separately, and
+ * relay selection skips a relay that is over its cap while another
+ * still has budget.  Handshake / control envelopes are charged but
+ * never held back; chat and file traffic wait in their queues.
+ */
+void p2p_set_bandwidth_caps(p2p_context* ctx,
+                            int64_t global_bytes_per_sec,
+                            int64_t per_relay_bytes_per_sec);
+
+/**
+ * Constant-rate traffic shaping.  With interval_ms > 0 the client emits
+ * exactly one padded envelope to the relay every interval_ms — a queued
+ * real envelope when there is one, cover otherwise — instead of cover
+ * traffic on top of real traffic.  Bandwidth is fixed and the relay
+ * sees the same cadence whether the user is busy or idle; the price is
+ * throughput (one envelope per tick).  Every tick's envelope, real or
+ * cover, is padded to one bucket: 0 = 2 KiB, 1 = 16 KiB, 2 = 256 KiB.
+ * A real envelope larger than the bucket keeps its own, so pick 2 if
+ * files go through the relay.  interval_ms = 0 turns shaping off.
+ */
+void p2p_set_constant_rate(p2p_context* ctx, int interval_ms, int bucket);
+
+/**
+ * Snapshot of the relay send scheduler, for diagnostics UIs.  Writes
+ * a heap-allocated NUL-terminated JSON string into *out_json; caller
+ * must free() it.  Returns 0 on success, -1 on error.  Shape:
+ *   { "in_flight": 3,
+ *     "classes": [ { "class": "control" | "message" | "file_chunk",
+ *                    "depth": 0,  "bytes": 0,   waiting now
+ *                    "peak_depth": 4,
+ *                    "sent": 120, "sent_bytes": 245760,
+ *                    "max_wait_ms": 35 }, ... ] }
+ */
+int p2p_send_queue_stats_json(p2p_context* ctx, char** out_json);
+
 /**
  * Register a push-notification token with the relay.  Called by
  * mobile clients after they receive a device token from APNs (iOS)
@@ -481,6 +582,14 @@ void p2p_set_file_auto_accept_mb(p2p_context* ctx, int mb);
 void p2p_set_file_hard_max_mb(p2p_context* ctx, int mb);
 void p2p_set_file_require_p2p(p2p_context* ctx, int enabled);
 
+/**
+ * Start ICE toward a file's recipients as soon as it is queued, so the
+ * chunks can go direct the moment they accept.  Off by default: the
+ * early dial reveals this device's candidate addresses to recipients
+ * who may still decline.  Off, the direct path is dialed on accept.
+ */
+void p2p_set_file_warmup_before_consent(p2p_context* ctx, int enabled);
+
 /* ── Presence ──────────────────────────────────────────────────────────── */
 
 /** Check if peers are online (results via on_presence callback). */
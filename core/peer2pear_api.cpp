@@ -74,6 +74,13 @@ public:
             m_p.ws_send_text(message.c_str(), m_p.platform_ctx);
     }
 
+    bool sendBinaryMessage(const Bytes& data) override {
+        if (!m_p.ws_send_binary) return false;
+        m_p.ws_send_binary(data.data(), static_cast<int>(data.size()),
+                           m_p.platform_ctx);
+        return true;
+    }
+
 private:
     p2p_platform            m_p;
     SingleWebSocketFactory* m_factory = nullptr;  // non-owning
@@ -176,6 +183,12 @@ public:
         if (m_p.ws_send_text_v2)
             m_p.ws_send_text_v2(m_connHandle, message.c_str(), m_p.platform_ctx);
     }
+    bool sendBinaryMessage(const Bytes& data) override {
+        if (!m_p.ws_send_binary_v2) return false;
+        m_p.ws_send_binary_v2(m_connHandle, data.data(),
+                              static_cast<int>(data.size()), m_p.platform_ctx);
+        return true;
+    }
 
     void* connHandle() const { return m_connHandle; }
 
@@ -885,6 +898,23 @@ void p2p_set_hard_block_on_key_change(p2p_context* ctx, int enabled)
     ctx->controller->setHardBlockOnKeyChange(enabled != 0);
 }
 
+void p2p_set_dsa_handshake_only(p2p_context* ctx, int enabled)
+{
+    if (!ctx) return;
+    P2P_CTX_GUARD(ctx);
+    ctx->controller->setDsaSignPolicy(enabled
+        ? SessionSealer::DsaSignPolicy::HandshakeOnly
+        : SessionSealer::DsaSignPolicy::EveryEnvelope);
+}
+
+void p2p_set_kem_ratchet_cadence(p2p_context* ctx, uint32_t every_dh_steps,
+                                 int64_t max_interval_secs)
+{
+    if (!ctx) return;
+    P2P_CTX_GUARD(ctx);
+    ctx->controller->setKemRatchetCadence(every_dh_steps, max_interval_secs);
+}
+
 void p2p_reset_session(p2p_context* ctx, const char* peer_id)
 {
     if (!ctx || !peer_id) return;
@@ -1081,6 +1111,13 @@ void p2p_set_file_require_p2p(p2p_context* ctx, int enabled)
     ctx->controller->setFileRequireP2P(enabled != 0);
 }
 
+void p2p_set_file_warmup_before_consent(p2p_context* ctx, int enabled)
+{
+    if (!ctx) return;
+    P2P_CTX_GUARD(ctx);
+    ctx->controller->setFileWarmupBeforeConsent(enabled != 0);
+}
+
 void p2p_check_presence(p2p_context* ctx, const char** peer_ids, int count)
 {
     if (!ctx || !peer_ids) return;
@@ -1151,6 +1188,103 @@ void p2p_set_multi_hop_enabled(p2p_context* ctx, int enabled)
     ctx->controller->relay().setMultiHopEnabled(enabled != 0);
 }
 
+void p2p_set_ws_send_enabled(p2p_context* ctx, int enabled)
+{
+    if (!ctx) return;
+    P2P_CTX_GUARD(ctx);
+    ctx->controller->relay().setWsSendEnabled(enabled != 0);
+}
+
+int p2p_relay_stats_json(p2p_context* ctx, char** out_json)
+{
+    if (!ctx || !out_json) return -1;
+    std::string s;
+    {
+        P2P_CTX_GUARD(ctx);
+        nlohmann::json relays = nlohmann::json::array();
+        for (const auto& st : ctx->controller->relay().relayHealthStats()) {
+            nlohmann::json r;
+            r["url"]           = st.url;
+            r["latency_ms"]    = st.latencyMs;
+            r["error_rate"]    = st.errorRate;
+            r["throttle_rate"] = st.throttleRate;
+            r["sent"]          = st.sent;
+            r["failed"]        = st.failed;
+            r["throttled"]     = st.throttled;
+            r["weight"]        = st.weight;
+            r["ejected"]       = st.ejected;
+            r["probing"]       = st.probing;
+            relays.push_back(std::move(r));
+        }
+        nlohmann::json doc;
+        doc["relays"] = std::move(relays);
+        s = doc.dump();
+    }
+    char* buf = static_cast<char*>(std::malloc(s.size() + 1));
+    if (!buf) return -1;
+    std::memcpy(buf, s.data(), s.size());
+    buf[s.size()] = '\0';
+    *out_json = buf;
+    return 0;
+}
+
+void p2p_set_bandwidth_caps(p2p_context* ctx,
+                            int64_t global_bytes_per_sec,
+                            int64_t per_relay_bytes_per_sec)
+{
+    if (!ctx) return;
+    P2P_CTX_GUARD(ctx);
+    ctx->controller->relay().setBandwidthCaps(global_bytes_per_sec,
+                                              per_relay_bytes_per_sec);
+}
+
+void p2p_set_constant_rate(p2p_context* ctx, int interval_ms, int bucket)
+{
+    if (!ctx) return;
+    P2P_CTX_GUARD(ctx);
+    using TickBucket = RelayClient::TickBucket;
+    const TickBucket b = bucket <= 0 ? TickBucket::Small
+                       : bucket == 1 ? TickBucket::Medium
+                                     : TickBucket::Large;
+    ctx->controller->relay().setConstantRate(interval_ms, b);
+}
+
+int p2p_send_queue_stats_json(p2p_context* ctx, char** out_json)
+{
+    if (!ctx || !out_json) return -1;
+    std::string s;
+    {
+        P2P_CTX_GUARD(ctx);
+        const RelayClient& relay = ctx->controller->relay();
+        nlohmann::json classes = nlohmann::json::array();
+        for (const auto& st : relay.sendQueueStats()) {
+            nlohmann::json c;
+            switch (st.cls) {
+            case RelayClient::TrafficClass::Control:   c["class"] = "control";    break;
+            case RelayClient::TrafficClass::Message:   c["class"] = "message";    break;
+            case RelayClient::TrafficClass::FileChunk: c["class"] = "file_chunk"; break;
+            }
+            c["depth"]       = st.depth;
+            c["bytes"]       = st.bytes;
+            c["peak_depth"]  = st.peakDepth;
+            c["sent"]        = st.sent;
+            c["sent_bytes"]  = st.sentBytes;
+            c["max_wait_ms"] = st.maxWaitMs;
+            classes.push_back(std::move(c));
+        }
+        nlohmann::json doc;
+        doc["in_flight"] = relay.sendsInFlight();
+        doc["classes"]   = std::move(classes);
+        s = doc.dump();
+    }
+    char* buf = static_cast<char*>(std::malloc(s.size() + 1));
+    if (!buf) return -1;
+    std::memcpy(buf, s.data(), s.size());
+    buf[s.size()] = '\0';
+    *out_json = buf;
+    return 0;
+}
+
 void p2p_set_privacy_level(p2p_context* ctx, int level)
 {
     if (!ctx) return;
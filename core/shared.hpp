@@ -36,6 +36,13 @@ inline int64_t nowSecs() {
     return duration_cast<seconds>(system_clock::now().time_since_epoch()).count();
 }
 
+// Monotonic milliseconds, for durations (connection setup latency,
+// idle timers) that a wall-clock jump must not skew.
+inline int64_t steadyMs() {
+    using namespace std::chrono;
+    return duration_cast<milliseconds>(steady_clock::now().time_since_epoch()).count();
+}
+
 // Strip ASCII whitespace (space, tab, CR, LF) from both ends.  Used
 // on member-ID lists that may arrive with trailing newlines from
 // textarea copy-paste.  Returns an empty string if `s` is entirely
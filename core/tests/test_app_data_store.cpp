@@ -631,6 +631,86 @@ TEST(AppDataStore, ChainStateDropRemovesRow) {
         << "dropChainState must remove the row";
 }
 
+TEST(AppDataStore, ChainStateCacheFollowsConversationDelete) {
+    auto env = makeEnv(randomKey32(), randomKey32());
+    makeGroupConv(env, "g");
+    makeGroupConv(env, "h");
+    AppDataStore::ChainState s;
+    s.sessionId    = makeSessionId(0x0A);
+    s.expectedNext = 9;
+    env.store->saveChainState("g", "alice", s);
+    env.store->saveChainState("g", "bob",   s);
+    env.store->saveChainState("h", "alice", s);
+
+    AppDataStore::ChainState loaded;
+    ASSERT_TRUE(env.store->loadChainState("g", "alice", loaded, s.sessionId));  // cached
+    ASSERT_TRUE(env.store->deleteConversation("g"));
+
+    EXPECT_FALSE(env.store->loadChainState("g", "alice", loaded, s.sessionId))
+        << "cascade-deleted rows must not survive in the cache";
+    EXPECT_FALSE(env.store->loadChainState("g", "bob", loaded, s.sessionId));
+    ASSERT_TRUE(env.store->loadChainState("h", "alice", loaded, s.sessionId));
+    EXPECT_EQ(loaded.expectedNext, 9);
+}
+
+TEST(AppDataStore, ChainStateCacheIsPerSession) {
+    auto env = makeEnv(randomKey32(), randomKey32());
+    makeGroupConv(env, "g");
+    AppDataStore::ChainState a;
+    a.sessionId    = makeSessionId(0x0D);
+    a.expectedNext = 40;
+    ASSERT_TRUE(env.store->saveChainState("g", "alice", a));
+
+    // The sender re-keys and the row is rewritten behind this store's
+    // cache (another store on the same database).
+    AppDataStore other;
+    ASSERT_TRUE(other.bind(*env.db));
+    AppDataStore::ChainState b;
+    b.sessionId    = makeSessionId(0x0E);
+    b.expectedNext = 2;
+    ASSERT_TRUE(other.saveChainState("g", "alice", b));
+
+    // A receive on the new session must not be served the old one.
+    AppDataStore::ChainState loaded;
+    ASSERT_TRUE(env.store->loadChainState("g", "alice", loaded, b.sessionId));
+    EXPECT_EQ(loaded.sessionId, b.sessionId);
+    EXPECT_EQ(loaded.expectedNext, 2);
+
+    // And a straggler on the old session sees the current row, so the
+    // caller's reset check still fires.
+    ASSERT_TRUE(env.store->loadChainState("g", "alice", loaded, a.sessionId));
+    EXPECT_EQ(loaded.sessionId, b.sessionId);
+}
+
+TEST(AppDataStore, ChainStateCacheIsBoundedAndFallsBackToDisk) {
+    auto env = makeEnv(randomKey32(), randomKey32());
+    makeGroupConv(env, "g");
+    const size_t n = AppDataStore::kChainStateCacheMax + 8;
+    AppDataStore::ChainState s;
+    s.sessionId = makeSessionId(0x0B);
+    for (size_t i = 0; i < n; ++i) {
+        s.expectedNext = int64_t(i) + 1;
+        ASSERT_TRUE(env.store->saveChainState("g", "s" + std::to_string(i), s));
+    }
+    // The first few were evicted from memory; they still load from disk.
+    for (size_t i : {size_t(0), size_t(1), n - 1}) {
+        AppDataStore::ChainState loaded;
+        ASSERT_TRUE(env.store->loadChainState("g", "s" + std::to_string(i), loaded,
+                                              s.sessionId));
+        EXPECT_EQ(loaded.expectedNext, int64_t(i) + 1);
+    }
+}
+
+TEST(AppDataStore, ChainStateFailedSaveDoesNotCache) {
+    auto env = makeEnv(randomKey32(), randomKey32());
+    // No conversations row for "ghost" — the FK rejects the insert.
+    AppDataStore::ChainState s;
+    s.sessionId = makeSessionId(0x0C);
+    EXPECT_FALSE(env.store->saveChainState("ghost", "alice", s));
+    AppDataStore::ChainState loaded;
+    EXPECT_FALSE(env.store->loadChainState("ghost", "alice", loaded, s.sessionId));
+}
+
 TEST(AppDataStore, BufferRoundTripPreservesContent) {
     auto env = makeEnv(randomKey32(), randomKey32());
     makeGroupConv(env, "g");
@@ -822,6 +902,211 @@ TEST(AppDataStore, SendStateDropRemovesRow) {
         << "drop should remove the row; subsequent load returns default";
 }
 
+TEST(AppDataStore, LoadSendStatesReturnsEveryRowForGroup) {
+    auto env = makeEnv(randomKey32(), randomKey32());
+    makeGroupConv(env, "g");
+    makeGroupConv(env, "other");
+    const Bytes sid1 = makeSessionId(0x10);
+    const Bytes sid2 = makeSessionId(0x20);
+
+    AppDataStore::SendState s;
+    s.nextCounter = 5;
+    s.lastHash    = makePrevHash(0x05);
+    env.store->saveSendState("bob",   "g", sid1, s);
+    s.nextCounter = 9;
+    s.lastHash.clear();
+    env.store->saveSendState("carol", "g", sid2, s);
+    s.nextCounter = 77;
+    env.store->saveSendState("bob", "other", sid1, s);
+
+    const auto all = env.store->loadSendStates("g");
+    ASSERT_EQ(all.size(), 2u) << "rows from other groups stay out";
+    EXPECT_EQ(all.at({"bob",   sid1}).nextCounter, 5);
+    EXPECT_EQ(all.at({"bob",   sid1}).lastHash,    makePrevHash(0x05));
+    EXPECT_EQ(all.at({"carol", sid2}).nextCounter, 9);
+    EXPECT_TRUE(all.at({"carol", sid2}).lastHash.empty());
+    EXPECT_TRUE(env.store->loadSendStates("nope").empty());
+}
+
+TEST(AppDataStore, CommitGroupSendWritesCacheAndStateTogether) {
+    auto env = makeEnv(randomKey32(), randomKey32());
+    makeGroupConv(env, "g");
+    const Bytes sid1 = makeSessionId(0x31);
+    const Bytes sid2 = makeSessionId(0x32);
+
+    std::vector<AppDataStore::GroupSendRecord> records(2);
+    records[0].peerId           = "bob";
+    records[0].sessionId        = sid1;
+    records[0].counter          = 1;
+    records[0].sealedEnvelope   = {0xB0, 0x01};
+    records[0].next.nextCounter = 2;
+    records[0].next.lastHash    = makePrevHash(0xB1);
+    records[1].peerId           = "carol";
+    records[1].sessionId        = sid2;
+    records[1].counter          = 4;
+    records[1].sealedEnvelope   = {0xC0, 0x04};
+    records[1].next.nextCounter = 5;
+    records[1].next.lastHash    = makePrevHash(0xC5);
+    ASSERT_TRUE(env.store->commitGroupSend("g", records, 1000));
+
+    EXPECT_EQ(env.store->loadReplayCacheEntry("bob",   "g", sid1, 1), (Bytes{0xB0, 0x01}));
+    EXPECT_EQ(env.store->loadReplayCacheEntry("carol", "g", sid2, 4), (Bytes{0xC0, 0x04}));
+    const auto states = env.store->loadSendStates("g");
+    ASSERT_EQ(states.size(), 2u);
+    EXPECT_EQ(states.at({"bob",   sid1}).nextCounter, 2);
+    EXPECT_EQ(states.at({"bob",   sid1}).lastHash,    makePrevHash(0xB1));
+    EXPECT_EQ(states.at({"carol", sid2}).nextCounter, 5);
+
+    EXPECT_TRUE(env.store->commitGroupSend("g", {}, 1000))
+        << "nothing to write is not a failure";
+}
+
+TEST(AppDataStore, CommitGroupSendIsAllOrNothing) {
+    auto env = makeEnv(randomKey32(), randomKey32());
+    makeGroupConv(env, "g");
+    const Bytes sid = makeSessionId(0x41);
+
+    std::vector<AppDataStore::GroupSendRecord> records(2);
+    records[0].peerId           = "bob";
+    records[0].sessionId        = sid;
+    records[0].counter          = 1;
+    records[0].sealedEnvelope   = {0x01};
+    records[0].next.nextCounter = 2;
+    records[1].peerId           = "carol";
+    records[1].sessionId        = sid;
+    records[1].counter          = 1;  // no envelope — invalid
+    records[1].next.nextCounter = 2;
+    EXPECT_FALSE(env.store->commitGroupSend("g", records, 1000));
+
+    EXPECT_TRUE(env.store->loadReplayCacheEntry("bob", "g", sid, 1).empty())
+        << "a bad record must roll back the rows before it";
+    EXPECT_TRUE(env.store->loadSendStates("g").empty());
+}
+
+// ── Deduplicated replay cache ───────────────────────────────────────────────
+
+namespace {
+
+// `n` ref records (empty envelope) for one send at `counter`.
+std::vector<AppDataStore::GroupSendRecord> refRecords(size_t n, int64_t counter,
+                                                      const Bytes& sid) {
+    std::vector<AppDataStore::GroupSendRecord> out(n);
+    for (size_t i = 0; i < n; ++i) {
+        out[i].peerId           = "peer" + std::to_string(i);
+        out[i].sessionId        = sid;
+        out[i].counter          = counter;
+        out[i].prevHash         = makePrevHash(uint8_t(counter - 1));
+        out[i].next.nextCounter = counter + 1;
+        out[i].next.lastHash    = makePrevHash(uint8_t(counter));
+    }
+    return out;
+}
+
+int64_t countRows(TestEnv& env, const std::string& table) {
+    SqlCipherQuery q(env.db->handle());
+    q.prepare("SELECT COUNT(*) FROM " + table + ";");
+    return q.exec() && q.next() ? q.valueInt64(0) : -1;
+}
+
+}  // namespace
+
+TEST(AppDataStore, ReplayRefsShareOnePayloadPerMessage) {
+    auto env = makeEnv(randomKey32(), randomKey32());
+    makeGroupConv(env, "g");
+    const Bytes sid = makeSessionId(0x51);
+    const std::string shared = R"({"text":"hello","type":"group_msg"})";
+
+    ASSERT_TRUE(env.store->commitGroupSend("g", refRecords(3, 1, sid), 1000,
+                                           "msg-1", shared));
+    EXPECT_EQ(countRows(env, "group_replay_payload"), 1);
+    EXPECT_EQ(countRows(env, "group_replay_ref"), 3);
+    EXPECT_EQ(countRows(env, "group_replay_cache"), 0);
+
+    std::vector<AppDataStore::ReplayRef> got;
+    env.store->loadReplayRefRange("peer1", "g", sid, 1, 5,
+        [&](const AppDataStore::ReplayRef& r) { got.push_back(r); });
+    ASSERT_EQ(got.size(), 1u);
+    EXPECT_EQ(got[0].counter,  1);
+    EXPECT_EQ(got[0].prevHash, makePrevHash(0x00));
+    EXPECT_EQ(got[0].envHash,  makePrevHash(0x01));
+    EXPECT_EQ(got[0].payload,  shared);
+
+    // Send state advanced alongside, same as the full-envelope form.
+    EXPECT_EQ(env.store->loadSendStates("g").at({"peer2", sid}).nextCounter, 2);
+
+    SqlCipherQuery raw(env.db->handle());
+    raw.prepare("SELECT payload FROM group_replay_payload;");
+    ASSERT_TRUE(raw.exec());
+    ASSERT_TRUE(raw.next());
+    EXPECT_EQ(raw.valueText(0).find("hello"), std::string::npos)
+        << "shared payload must not sit in plaintext at rest";
+}
+
+TEST(AppDataStore, ReplayRefsNeedASharedPayload) {
+    auto env = makeEnv(randomKey32(), randomKey32());
+    makeGroupConv(env, "g");
+    EXPECT_FALSE(env.store->commitGroupSend("g", refRecords(2, 1, makeSessionId(0x52)), 1000));
+    EXPECT_EQ(countRows(env, "group_send_state"), 0);
+}
+
+TEST(AppDataStore, ReplayCacheBudgetEvictsOldestMessagesFirst) {
+    auto env = makeEnv(randomKey32(), randomKey32());
+    makeGroupConv(env, "g");
+    const Bytes sid = makeSessionId(0x53);
+
+    // One full-envelope row and one deduplicated message per counter.
+    for (int64_t ctr = 1; ctr <= 10; ++ctr) {
+        AppDataStore::GroupSendRecord full;
+        full.peerId           = "legacy";
+        full.sessionId        = sid;
+        full.counter          = ctr;
+        full.sealedEnvelope   = Bytes(1000, uint8_t(ctr));
+        full.next.nextCounter = ctr + 1;
+        full.next.lastHash    = makePrevHash(uint8_t(ctr));
+        auto records = refRecords(4, ctr, sid);
+        records.push_back(full);
+        ASSERT_TRUE(env.store->commitGroupSend("g", records, 1000 + ctr,
+                                               "msg-" + std::to_string(ctr),
+                                               std::string(500, 'x')));
+    }
+    const int64_t full = env.store->replayCacheBytes();
+
+    env.store->setReplayCacheBudget(full / 2);
+    EXPECT_LE(env.store->replayCacheBytes(), full / 2);
+
+    // Survivors are a suffix of the history, in both forms.
+    EXPECT_TRUE(env.store->loadReplayCacheEntry("legacy", "g", sid, 1).empty());
+    EXPECT_FALSE(env.store->loadReplayCacheEntry("legacy", "g", sid, 10).empty());
+    std::vector<int64_t> refs;
+    env.store->loadReplayRefRange("peer0", "g", sid, 1, 10,
+        [&](const AppDataStore::ReplayRef& r) { refs.push_back(r.counter); });
+    ASSERT_FALSE(refs.empty());
+    EXPECT_GT(refs.front(), 1);
+    EXPECT_EQ(refs.back(), 10);
+    EXPECT_EQ(countRows(env, "group_replay_ref"), int64_t(refs.size()) * 4)
+        << "refs go with their payload";
+
+    // Later sends keep it there; send state is never evicted.
+    const int64_t budget = env.store->replayCacheBytes();
+    env.store->setReplayCacheBudget(budget);
+    ASSERT_TRUE(env.store->commitGroupSend("g", refRecords(4, 11, sid), 2000,
+                                           "msg-11", std::string(500, 'x')));
+    EXPECT_LE(env.store->replayCacheBytes(), budget);
+    EXPECT_EQ(env.store->loadSendStates("g").at({"peer0", sid}).nextCounter, 12);
+}
+
+TEST(AppDataStore, ReplayCachePurgeCoversSharedPayloads) {
+    auto env = makeEnv(randomKey32(), randomKey32());
+    makeGroupConv(env, "g");
+    const Bytes sid = makeSessionId(0x54);
+    env.store->commitGroupSend("g", refRecords(3, 1, sid), 100, "old", "{}");
+    env.store->commitGroupSend("g", refRecords(3, 2, sid), 300, "new", "{}");
+
+    EXPECT_EQ(env.store->purgeReplayCacheOlderThan(200), 1);
+    EXPECT_EQ(countRows(env, "group_replay_payload"), 1);
+    EXPECT_EQ(countRows(env, "group_replay_ref"), 3);
+}
+
 // ── group_bundle_map (Phase 2, Invisible Groups) ────────────────────────────
 
 TEST(AppDataStore, BundleMapMissReturnsEmpty) {
@@ -154,13 +154,13 @@ int mockHttpPost(const char* url,
     const int reqId = mp->nextReqId.fetch_add(1);
     std::string u = url ? url : "";
 
-    if (u.find("/v1/send") != std::string::npos && body && bodyLen >= 33 &&
-        body[0] == 0x01) {
-        std::vector<uint8_t> edPub(body + 1, body + 33);
+    auto route = [mp](const uint8_t* env, int envLen) {
+        if (envLen < 33 || env[0] != 0x01) return;
+        std::vector<uint8_t> edPub(env + 1, env + 33);
         std::string key = CryptoEngine::toBase64Url(edPub);
         MockPlatform* recipient = mp->relay->lookup(key);
         if (recipient && recipient->ctx) {
-            std::vector<uint8_t> payload(body, body + bodyLen);
+            std::vector<uint8_t> payload(env, env + envLen);
             recipient->queue.push([recipient, payload]() {
                 if (!recipient->connected.load()) return;
                 p2p_ws_on_binary(recipient->ctx,
@@ -168,6 +168,20 @@ int mockHttpPost(const char* url,
                                  int(payload.size()));
             });
         }
+    };
+
+    if (u.find("/v1/send-batch") != std::string::npos && body) {
+        // u32 BE length || envelope, repeated.
+        for (int off = 0; off + 4 <= bodyLen;) {
+            const int n = int((uint32_t(body[off]) << 24) | (uint32_t(body[off + 1]) << 16)
+                            | (uint32_t(body[off + 2]) << 8) | uint32_t(body[off + 3]));
+            off += 4;
+            if (n < 0 || n > bodyLen - off) break;
+            route(body + off, n);
+            off += n;
+        }
+    } else if (u.find("/v1/send") != std::string::npos && body) {
+        route(body, bodyLen);
     }
     // No p2p_http_response — CHttpClient's pending cb stays orphaned,
     // which is fine because neither the send nor the connect paths
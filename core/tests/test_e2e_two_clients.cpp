@@ -95,6 +95,9 @@ public:
     bool isIdle() const override       { return !m_connected; }
 
     void sendTextMessage(const std::string& message) override;
+    // MockRelay never advertises the WS send path, so RelayClient
+    // shouldn't get here; report "unsupported" if it ever does.
+    bool sendBinaryMessage(const Bytes& /*data*/) override { return false; }
 
     void deliverBinary(const Bytes& frame) {
         if (onBinaryMessage) onBinaryMessage(frame);
@@ -129,6 +132,8 @@ public:
 
 // ── MockHttpClient ───────────────────────────────────────────────────────
 // POST /v1/send goes to the relay for routing.
+// POST /v1/send-batch is split and routed envelope by envelope, with a
+//      per-envelope results list like the real relay returns.
 // GET  /v1/relay_info returns 404 so RelayClient skips onion-mode caching.
 
 class MockHttpClient : public IHttpClient {
@@ -187,7 +192,8 @@ public:
             m_captured[key].push_back(relayEnvelope);
             // Optional knob for tests that want to observe replay defense.
             for (int i = 0; i < m_deliverTimes; ++i) {
-                it->second->deliverBinary(relayEnvelope);
+                if (m_holding) m_held.emplace_back(it->second, relayEnvelope);
+                else           it->second->deliverBinary(relayEnvelope);
             }
         }
 
@@ -196,6 +202,24 @@ public:
         cb(r);
     }
 
+    // A batch is stored in full before anything is pushed, like the real
+    // relay.  Deliveries are held until the whole batch is ingested, then
+    // drained in order; sends triggered while draining queue behind the
+    // rest of the batch instead of overtaking it.
+    template <typename Fn>
+    void ingestBatch(Fn&& ingest) {
+        const bool outer = !m_holding;
+        m_holding = true;
+        ingest();
+        if (!outer) return;
+        for (size_t i = 0; i < m_held.size(); ++i) {
+            auto [ws, env] = m_held[i];
+            ws->deliverBinary(env);
+        }
+        m_held.clear();
+        m_holding = false;
+    }
+
     // Test-only knob: deliver each relayed envelope this many times (default 1).
     void setDeliverMultiplier(int n) { m_deliverTimes = n; }
 
@@ -212,6 +236,8 @@ private:
     std::map<std::string, MockWebSocket*> m_peers;
     std::map<std::string, std::vector<Bytes>> m_captured;
     int m_deliverTimes = 1;
+    bool m_holding = false;
+    std::vector<std::pair<MockWebSocket*, Bytes>> m_held;
 
     friend class TwoClientSuite;  // needed for restart-replay test only
 };
@@ -220,12 +246,40 @@ void MockWebSocket::sendTextMessage(const std::string& message) {
     if (m_relay) m_relay->handleAuth(this, message);
 }
 
-void MockHttpClient::post(const std::string& /*url*/, const Bytes& body,
+void MockHttpClient::post(const std::string& url, const Bytes& body,
                           const Headers& /*headers*/, Callback cb) {
-    if (m_relay) m_relay->sendEnvelope(body, std::move(cb));
-    else {
+    if (!m_relay) {
         Response r; r.status = 500; cb(r);
+        return;
     }
+    if (url.find("/v1/send-batch") == std::string::npos) {
+        m_relay->sendEnvelope(body, std::move(cb));
+        return;
+    }
+
+    nlohmann::json results = nlohmann::json::array();
+    m_relay->ingestBatch([&] {
+        for (size_t off = 0; off + 4 <= body.size();) {
+            const size_t n = (size_t(body[off]) << 24) | (size_t(body[off + 1]) << 16)
+                           | (size_t(body[off + 2]) << 8) | size_t(body[off + 3]);
+            off += 4;
+            if (n > body.size() - off) break;
+            const Bytes env(body.begin() + off, body.begin() + off + n);
+            off += n;
+            m_relay->sendEnvelope(env, [&results](const Response& er) {
+                nlohmann::json e;
+                e["status"] = er.status;
+                results.push_back(e);
+            });
+        }
+    });
+    nlohmann::json doc;
+    doc["results"] = results;
+    const std::string js = doc.dump();
+    Response r;
+    r.status = 200;
+    r.body.assign(js.begin(), js.end());
+    cb(r);
 }
 
 }  // namespace
@@ -278,6 +332,13 @@ protected:
         };
         std::vector<GroupAvatar> groupAvatars;
 
+        struct Avatar {
+            std::string from;
+            std::string name;
+            std::string avatarB64;
+        };
+        std::vector<Avatar> avatars;
+
         struct MemberLeft {
             std::string from;
             std::string groupId;
@@ -388,6 +449,11 @@ protected:
                                               const std::string& avatarB64) {
             p.groupAvatars.push_back({groupId, avatarB64});
         };
+        p.ctrl->onAvatarReceived = [&p](const std::string& from,
+                                         const std::string& name,
+                                         const std::string& avatarB64) {
+            p.avatars.push_back({from, name, avatarB64});
+        };
         p.ctrl->onGroupMemberLeft = [&p](const std::string& from,
                                           const std::string& gid,
                                           const std::string& gname,
@@ -547,6 +613,38 @@ TEST_F(TwoClientSuite, BidirectionalConversation) {
     EXPECT_EQ(alice.received[1].text, "B#2");
 }
 
+// ── 2b. Payload compression moves a mid-sized avatar down a bucket ───────
+// ~15 KB of base64 plus sealing overhead lands in the 256 KiB relay
+// bucket uncompressed; deflate gets it under 16 KiB.  Once the two
+// clients have traded a message each (so each knows the other reads
+// the compressed form) the avatar must go out in the smaller bucket.
+// Short texts stay uncompressed — they're in the smallest bucket anyway.
+
+TEST_F(TwoClientSuite, AvatarCompressedIntoSmallerBucket) {
+    connectBoth();
+    alice.ctrl->sendText(bob.id, "hi");
+    bob.ctrl->sendText(alice.id, "hi back");
+    alice.ctrl->sendText(bob.id, "ok");
+    ASSERT_EQ(bob.received.size(), 2u);
+
+    Bytes jpegish(11000);
+    randombytes_buf(jpegish.data(), jpegish.size());
+    std::string avatarB64(sodium_base64_encoded_len(jpegish.size(),
+                                                    sodium_base64_VARIANT_ORIGINAL), '\0');
+    sodium_bin2base64(avatarB64.data(), avatarB64.size(), jpegish.data(),
+                      jpegish.size(), sodium_base64_VARIANT_ORIGINAL);
+    avatarB64.resize(avatarB64.size() - 1);
+
+    alice.ctrl->sendAvatar(bob.id, "Alice", avatarB64);
+
+    ASSERT_EQ(bob.avatars.size(), 1u);
+    EXPECT_EQ(bob.avatars[0].from, alice.id);
+    EXPECT_EQ(bob.avatars[0].name, "Alice");
+    EXPECT_EQ(bob.avatars[0].avatarB64, avatarB64);
+    ASSERT_FALSE(relay->capturedFor(bob.id).empty());
+    EXPECT_EQ(relay->capturedFor(bob.id).back().size(), 16u * 1024u);
+}
+
 // ── 3. Relay-level replay is dropped at the envelope dedup layer ─────────
 // The mock relay delivers each send twice; Bob's ChatController dedups on
 // the envelopeId field baked into the sealed envelope.
@@ -987,6 +1085,35 @@ TEST_F(TwoClientSuite, V2GroupText_DropsExactReplay) {
     EXPECT_EQ(bob.groupReceived[0].text, "exactly once please");
 }
 
+TEST_F(TwoClientSuite, V2GroupText_RosterRequestedWhenFullCopyLost) {
+    // The one message that carried the full roster to Bob never
+    // arrives.  The next one is hash-only; Bob doesn't know the group
+    // name, so his view hashes differently and he asks Alice, who
+    // answers with group_roster on the 1:1 path.
+    establishSessions();
+    const std::string gid = "grp-v2-roster-ddd";
+    bob.ctrl->setKnownGroupMembers(gid, { alice.id, bob.id });
+
+    relay->setDeliverMultiplier(0);
+    alice.ctrl->sendGroupMessageViaMailbox(
+        gid, "Project Hydra", { alice.id, bob.id }, "lost");
+    relay->setDeliverMultiplier(1);
+    alice.ctrl->sendGroupMessageViaMailbox(
+        gid, "Project Hydra", { alice.id, bob.id }, "hash only");
+
+    const auto it = std::find_if(bob.groupReceived.begin(), bob.groupReceived.end(),
+        [](const auto& g) { return g.text.empty(); });
+    ASSERT_NE(it, bob.groupReceived.end()) << "no group_roster surfaced on Bob";
+    EXPECT_EQ(it->groupName, "Project Hydra");
+    EXPECT_EQ(it->members, std::vector<std::string>{ bob.id });
+
+    // Gap recovery still replays the lost message; both texts land.
+    std::vector<std::string> texts;
+    for (const auto& g : bob.groupReceived)
+        if (!g.text.empty()) texts.push_back(g.text);
+    EXPECT_EQ(texts, (std::vector<std::string>{ "lost", "hash only" }));
+}
+
 // ── Phase 2: Invisible Groups (bundle_id round-trip) ─────────────────────────
 //
 // The bundle_id replaces groupId on the wire — sender mints + persists,
@@ -0,0 +1,263 @@
+// test_file_source.cpp — tests for FileSource, the outbound chunk reader.
+//
+// FileSource preads each range of the file being sent into one reused
+// buffer.  The invariants pinned here: every view is byte-identical to
+// the file, the hash over a FileSource equals the one-shot hash, a chunk
+// sealed straight from a view decrypts to the original bytes, and a file
+// truncated or rewritten after open() fails later views and reads.
+//
+// The benchmark compares the previous send-side read path (ifstream hash
+// pass + seek / read / copy per chunk) against hash + seal from one
+// FileSource, over the same file.
+
+#include "types.hpp"
+#include "FileSource.hpp"
+#include "FileTransferManager.hpp"
+#include "CryptoEngine.hpp"
+#include "test_support.hpp"
+
+#include <gtest/gtest.h>
+
+#include <sodium.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <vector>
+
+namespace fs = std::filesystem;
+
+namespace {
+
+using p2p_test::makeTempPath;
+
+Bytes randomBytes(size_t n) {
+    Bytes b(n);
+    randombytes_buf(b.data(), n);
+    return b;
+}
+
+void writeFile(const std::string& path, const Bytes& bytes) {
+    std::ofstream f(path, std::ios::binary | std::ios::trunc);
+    f.write(reinterpret_cast<const char*>(bytes.data()),
+            std::streamsize(bytes.size()));
+    f.close();
+    ASSERT_TRUE(f.good()) << "failed writing " << path;
+}
+
+class Bootstrap : public ::testing::Environment {
+public:
+    void SetUp() override { ASSERT_GE(sodium_init(), 0); }
+};
+::testing::Environment* const kBootstrap =
+    ::testing::AddGlobalTestEnvironment(new Bootstrap);
+
+}  // namespace
+
+TEST(FileSource, ViewsMatchFileBytes) {
+    const std::string path = makeTempPath("p2p-fs-view", ".bin");
+    const int64_t chunk = FileTransferManager::kChunkBytes;
+    const Bytes bytes = randomBytes(size_t(chunk) * 3 + 4321);
+    writeFile(path, bytes);
+
+    auto src = FileSource::open(path);
+    ASSERT_NE(src, nullptr);
+    EXPECT_EQ(src->size(), int64_t(bytes.size()));
+#ifndef _WIN32
+    EXPECT_TRUE(src->concurrentReads());
+#endif
+
+    // Walk it the way sendChunkEnvelopes does, prefetching one ahead.
+    for (int64_t off = 0; off < src->size(); off += chunk) {
+        const size_t n = size_t(std::min<int64_t>(chunk, src->size() - off));
+        const uint8_t* p = src->view(off, n);
+        ASSERT_NE(p, nullptr) << "offset " << off;
+        src->prefetch(off + int64_t(n), size_t(chunk));
+        EXPECT_TRUE(std::equal(p, p + n, bytes.begin() + off)) << "offset " << off;
+    }
+
+    // Out of range: a short read, never a pointer past the end.
+    EXPECT_EQ(src->view(src->size() - 10, 11), nullptr);
+    EXPECT_EQ(src->view(-1, 1), nullptr);
+    EXPECT_NE(src->view(src->size(), 0), nullptr);
+
+    src.reset();
+    fs::remove(path);
+}
+
+TEST(FileSource, HashAndSealFromViews) {
+    const std::string path = makeTempPath("p2p-fs-hash", ".bin");
+    // Spans several 1 MB hash windows with a ragged tail.
+    const Bytes bytes = randomBytes(3 * 1024 * 1024 + 77);
+    writeFile(path, bytes);
+
+    auto src = FileSource::open(path);
+    ASSERT_NE(src, nullptr);
+    EXPECT_EQ(FileTransferManager::blake2b256(*src),
+              FileTransferManager::blake2b256(bytes));
+
+    // A chunk sealed straight from a view into an existing buffer
+    // decrypts to the file's bytes, and aeadEncrypt's framing is unchanged.
+    CryptoEngine crypto;
+    const Bytes key = randomBytes(32);
+    const size_t n = size_t(FileTransferManager::kChunkBytes);
+    const uint8_t* p = src->view(1000, n);
+    ASSERT_NE(p, nullptr);
+
+    Bytes out = {0xAA, 0xBB};
+    ASSERT_TRUE(crypto.aeadEncryptAppend(key, p, n, out));
+    ASSERT_EQ(out.size(), 2 + 24 + n + 16);
+    EXPECT_EQ(out[0], 0xAA);
+    const Bytes sealed(out.begin() + 2, out.end());
+    EXPECT_EQ(crypto.aeadDecrypt(key, sealed),
+              Bytes(bytes.begin() + 1000, bytes.begin() + 1000 + int64_t(n)));
+
+    // Bad key: refused, buffer untouched.
+    EXPECT_FALSE(crypto.aeadEncryptAppend(Bytes(16, 0), p, n, out));
+    EXPECT_EQ(out.size(), 2 + 24 + n + 16);
+
+    src.reset();
+    fs::remove(path);
+}
+
+TEST(FileSource, EmptyAndMissingFiles) {
+    const std::string path = makeTempPath("p2p-fs-empty", ".bin");
+    writeFile(path, {});
+
+    auto src = FileSource::open(path);
+    ASSERT_NE(src, nullptr);
+    EXPECT_EQ(src->size(), 0);
+    EXPECT_NE(src->view(0, 0), nullptr);
+    EXPECT_EQ(src->view(0, 1), nullptr);
+    EXPECT_EQ(FileTransferManager::blake2b256(*src),
+              FileTransferManager::blake2b256(Bytes{}));
+    src.reset();
+    fs::remove(path);
+
+    EXPECT_EQ(FileSource::open(path), nullptr);
+}
+
+TEST(FileSource, TruncatedFileFailsViewInsteadOfFaulting) {
+    const std::string path = makeTempPath("p2p-fs-trunc", ".bin");
+    const Bytes bytes = randomBytes(1024 * 1024);
+    writeFile(path, bytes);
+
+    auto src = FileSource::open(path);
+    ASSERT_NE(src, nullptr);
+
+    // Shrunk under the sender: reads past the new end come back short,
+    // and the rest no longer match what was hashed.
+    fs::resize_file(path, 100 * 1024);
+    EXPECT_EQ(src->view(512 * 1024, 4096), nullptr);
+    EXPECT_EQ(src->view(0, 4096), nullptr);
+    Bytes buf(4096);
+    EXPECT_FALSE(src->read(512 * 1024, buf.size(), buf.data()));
+    EXPECT_EQ(FileTransferManager::blake2b256(*src), Bytes{});
+
+    src.reset();
+    fs::remove(path);
+}
+
+TEST(FileSource, RewrittenFileFailsLaterViews) {
+    const std::string path = makeTempPath("p2p-fs-rewrite", ".bin");
+    writeFile(path, randomBytes(256 * 1024));
+
+    auto src = FileSource::open(path);
+    ASSERT_NE(src, nullptr);
+    ASSERT_NE(src->view(0, 4096), nullptr);
+
+    // Same size, new contents.  Set the mtime explicitly so the test
+    // doesn't depend on the filesystem's timestamp granularity.
+    const auto before = fs::last_write_time(path);
+    writeFile(path, randomBytes(256 * 1024));
+    fs::last_write_time(path, before + std::chrono::seconds(1));
+    EXPECT_EQ(src->view(0, 4096), nullptr);
+
+    src.reset();
+    fs::remove(path);
+}
+
+// Opt-in benchmark (see README); prints both paths, asserts nothing
+// about speed.  Each pass starts from the same page-cache state (the
+// file was just written), so the gap is copies + syscalls, not I/O.
+TEST(FileSource, DISABLED_BenchmarkHashAndSealReadPaths) {
+    const std::string path = makeTempPath("p2p-fs-bench", ".bin");
+    const Bytes bytes = randomBytes(32 * 1024 * 1024);
+    writeFile(path, bytes);
+
+    CryptoEngine crypto;
+    const Bytes key = randomBytes(32);
+    const int64_t chunk = FileTransferManager::kChunkBytes;
+    using Clock = std::chrono::steady_clock;
+
+    // Before: blake2b256File-style ifstream pass, then seek + read into a
+    // buffer + aeadEncrypt + copy into the payload, per chunk.
+    const auto t0 = Clock::now();
+    Bytes hashOld;
+    size_t sealedOld = 0;
+    {
+        std::ifstream f(path, std::ios::binary);
+        crypto_generichash_state st;
+        crypto_generichash_init(&st, nullptr, 0, 32);
+        std::vector<char> buf(64 * 1024);
+        while (f.read(buf.data(), std::streamsize(buf.size())) || f.gcount() > 0)
+            crypto_generichash_update(&st,
+                reinterpret_cast<const unsigned char*>(buf.data()),
+                static_cast<unsigned long long>(f.gcount()));
+        hashOld.resize(32);
+        crypto_generichash_final(&st, hashOld.data(), 32);
+
+        std::ifstream src(path, std::ios::binary);
+        Bytes buffer;
+        for (int64_t off = 0; off < int64_t(bytes.size()); off += chunk) {
+            const int64_t n = std::min<int64_t>(chunk, int64_t(bytes.size()) - off);
+            src.seekg(off);
+            buffer.assign(size_t(n), 0);
+            src.read(reinterpret_cast<char*>(buffer.data()), std::streamsize(n));
+            const Bytes enc = crypto.aeadEncrypt(key, buffer);
+            Bytes inner;
+            inner.reserve(4 + enc.size());
+            inner.insert(inner.end(), 4, 0);
+            inner.insert(inner.end(), enc.begin(), enc.end());
+            sealedOld += inner.size();
+        }
+    }
+    const auto t1 = Clock::now();
+
+    // After: hash + seal through one FileSource.
+    Bytes hashNew;
+    size_t sealedNew = 0;
+    {
+        auto src = FileSource::open(path);
+        ASSERT_NE(src, nullptr);
+        hashNew = FileTransferManager::blake2b256(*src);
+        for (int64_t off = 0; off < src->size(); off += chunk) {
+            const size_t n = size_t(std::min<int64_t>(chunk, src->size() - off));
+            const uint8_t* p = src->view(off, n);
+            ASSERT_NE(p, nullptr);
+            src->prefetch(off + int64_t(n), size_t(chunk));
+            Bytes inner;
+            inner.reserve(4 + n + 40);
+            inner.insert(inner.end(), 4, 0);
+            ASSERT_TRUE(crypto.aeadEncryptAppend(key, p, n, inner));
+            sealedNew += inner.size();
+        }
+    }
+    const auto t2 = Clock::now();
+
+    EXPECT_EQ(hashOld, hashNew);
+    EXPECT_EQ(sealedOld, sealedNew);
+
+    auto ms = [](Clock::duration d) {
+        return static_cast<long long>(
+            std::chrono::duration_cast<std::chrono::milliseconds>(d).count());
+    };
+    std::printf("[bench] hash + seal 32 MB in %lld KB chunks: "
+                "ifstream %lld ms, FileSource %lld ms\n",
+                static_cast<long long>(chunk / 1024), ms(t1 - t0), ms(t2 - t1));
+
+    fs::remove(path);
+}
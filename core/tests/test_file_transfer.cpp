@@ -12,6 +12,14 @@
 //     rather than silently accept corrupted content.
 //   - Partial transfers persist to the DB so a receiver that's restarted
 //     mid-transfer reports the missing chunks via pendingResumptions().
+//   - A negotiated P2P chunk size stays off the relay and survives a
+//     receiver restart.
+//   - A tree-hashed transfer checks each chunk against the root as it
+//     arrives, re-requests the one that fails, and gives up once the
+//     source has plainly changed.
+//   - A receiver that crashes mid-transfer re-requests at most one
+//     progress window of chunks it had already received, and rows in
+//     the old bitmap format still resume.
 //
 // These are integration-style tests: they wire two FileTransferManager
 // instances together via capture-lambdas for the SealFn/SendFn hooks.
@@ -27,6 +35,7 @@
 #include "FileTransferManager.hpp"
 #include "CryptoEngine.hpp"
 #include "SqlCipherDb.hpp"
+#include "TreeHash.hpp"
 #include "test_support.hpp"
 
 #include <gtest/gtest.h>
@@ -40,6 +49,7 @@
 #include <fstream>
 #include <memory>
 #include <random>
+#include <set>
 #include <string>
 #include <utility>
 #include <vector>
@@ -319,6 +329,84 @@ TEST_F(FileTransferRoundTrip, FileRoundTripInOrderReassembles) {
     EXPECT_EQ(FileTransferManager::blake2b256File(savedPath), fileHash);
 }
 
+// ── P2P dispatch is tagged per transfer ───────────────────────────────────
+// The QUIC transport keys its per-transfer streams on the transferId the
+// P2P send hook receives, so every chunk must carry its own transfer's
+// id, and the receiver must reassemble two transfers whose chunks arrive
+// interleaved (what two independent streams deliver).
+
+TEST_F(FileTransferRoundTrip, P2PChunksCarryTransferIdAndInterleave) {
+    struct Sent { std::string transferId; Bytes payload; };
+    std::vector<Sent> p2p;
+    sender->setP2PFileSendFn([&](const std::string& peer, const std::string& tid,
+                                 const Bytes& chunk) {
+        EXPECT_EQ(peer, receiverPeerId);
+        p2p.push_back({tid, chunk});
+        return true;
+    });
+    std::vector<std::pair<std::string, size_t>> ended;   // (transferId, chunks sent by then)
+    sender->onOutboundStreamEnded = [&](const std::string& peer, const std::string& tid) {
+        EXPECT_EQ(peer, receiverPeerId);
+        ended.emplace_back(tid, p2p.size());
+    };
+    std::vector<std::string> saved;
+    receiver->onFileChunkReceived =
+        [&](const std::string&, const std::string&, const std::string&,
+            int64_t, int, int, const std::string& path, int64_t,
+            const std::string&, const std::string&) {
+            if (!path.empty()) saved.push_back(path);
+        };
+
+    const Bytes fileKey = randomBytes(32);
+    const size_t size   = size_t(FileTransferManager::kChunkBytes) * 3 + 11;
+    const int    totalChunks = 4;
+
+    const Bytes bytesA = prepareSource(size);
+    const std::string srcA = srcFile;
+    const Bytes hashA  = FileTransferManager::blake2b256(bytesA);
+    const std::string tidA = transferId;
+
+    const Bytes bytesB = prepareSource(size);
+    const Bytes hashB  = FileTransferManager::blake2b256(bytesB);
+    const std::string tidB = transferId + "-b";
+
+    ASSERT_TRUE(receiver->announceIncoming(senderPeerId, tidA, "a.bin", int64_t(size),
+                                           totalChunks, hashA, fileKey, 0));
+    ASSERT_TRUE(receiver->announceIncoming(senderPeerId, tidB, "b.bin", int64_t(size),
+                                           totalChunks, hashB, fileKey, 0));
+    ASSERT_EQ(sender->sendFileWithKey(senderPeerId, receiverPeerId, fileKey, tidA,
+                                      "a.bin", srcA, int64_t(size), hashA), tidA);
+    ASSERT_EQ(sender->sendFileWithKey(senderPeerId, receiverPeerId, fileKey, tidB,
+                                      "b.bin", srcFile, int64_t(size), hashB), tidB);
+    fs::remove(srcA);
+
+    EXPECT_TRUE(wire.empty()) << "P2P accepted every chunk; nothing should hit the relay";
+    ASSERT_EQ(p2p.size(), size_t(2 * totalChunks));
+    for (int i = 0; i < totalChunks; ++i) {
+        EXPECT_EQ(p2p[size_t(i)].transferId, tidA);
+        EXPECT_EQ(p2p[size_t(totalChunks + i)].transferId, tidB);
+    }
+    // Each pass ends right after its last chunk, so the transport can
+    // release that transfer's stream.
+    ASSERT_EQ(ended.size(), 2u);
+    EXPECT_EQ(ended[0], std::make_pair(tidA, size_t(totalChunks)));
+    EXPECT_EQ(ended[1], std::make_pair(tidB, size_t(2 * totalChunks)));
+
+    auto markSeen = [](const std::string&) { return true; };
+    const std::map<std::string, Bytes> fileKeys = {{senderPeerId, fileKey}};
+    for (int i = 0; i < totalChunks; ++i) {
+        EXPECT_TRUE(receiver->handleFileEnvelope(senderPeerId, p2p[size_t(totalChunks + i)].payload,
+                                                 markSeen, fileKeys));
+        EXPECT_TRUE(receiver->handleFileEnvelope(senderPeerId, p2p[size_t(i)].payload,
+                                                 markSeen, fileKeys));
+    }
+
+    ASSERT_EQ(saved.size(), 2u);
+    EXPECT_EQ(readFileBytes(saved[0]), bytesB);
+    EXPECT_EQ(readFileBytes(saved[1]), bytesA);
+    for (const auto& p : saved) cleanupSavedPath(p);
+}
+
 // ── 5. Round-trip with chunks delivered in reverse order ──────────────────
 // The receiver writes each chunk at its correct file offset, so the final
 // bytes should match regardless of arrival order.  Also confirms the
@@ -502,3 +590,389 @@ TEST_F(FileTransferRoundTrip, AnnounceRejectsInvalidArgs) {
         FileTransferManager::kMaxFileBytes + 1,
         /*totalChunks=*/1, fileHash, fileKey, 0));
 }
+
+// ── 9. Negotiated P2P chunk size ──────────────────────────────────────────
+// A file_accept may settle on chunks bigger than the relay's kChunkBytes
+// when both peers have a direct path.  Those transfers must stream only
+// over the P2P hook, reassemble on the receiver at the negotiated size,
+// and survive a receiver restart with the size intact.
+
+TEST(FileTransferManager, NegotiateChunkBytesPolicy) {
+    using FTM = FileTransferManager;
+    const int64_t big = 20LL * 1024 * 1024;
+
+    // No direct path, no offer, or a file that fits one relay chunk:
+    // stay on the relay size.
+    EXPECT_EQ(FTM::negotiateChunkBytes(big, FTM::kMaxP2PChunkBytes, false), FTM::kChunkBytes);
+    EXPECT_EQ(FTM::negotiateChunkBytes(big, 0, true), FTM::kChunkBytes);
+    EXPECT_EQ(FTM::negotiateChunkBytes(FTM::kChunkBytes, FTM::kMaxP2PChunkBytes, true),
+              FTM::kChunkBytes);
+
+    // Otherwise the sender's offer, capped at our own maximum.
+    EXPECT_EQ(FTM::negotiateChunkBytes(big, 1024 * 1024, true), 1024 * 1024);
+    EXPECT_EQ(FTM::negotiateChunkBytes(big, 64LL * 1024 * 1024, true), FTM::kMaxP2PChunkBytes);
+
+    EXPECT_EQ(FTM::chunkCountFor(9LL * 1024 * 1024 + 5, FTM::kMaxP2PChunkBytes), 3);
+}
+
+TEST_F(FileTransferRoundTrip, NegotiatedChunksStreamP2POnlyAndResume) {
+    constexpr int64_t kBig = FileTransferManager::kMaxP2PChunkBytes;
+    std::vector<Bytes> p2p;
+    sender->setP2PFileSendFn([&](const std::string&, const std::string&,
+                                 const Bytes& chunk) {
+        p2p.push_back(chunk);
+        return true;
+    });
+
+    const Bytes fileKey  = randomBytes(32);
+    const Bytes bytes    = prepareSource(size_t(kBig) * 2 + 777);
+    const Bytes fileHash = FileTransferManager::blake2b256(bytes);
+    const int64_t size   = int64_t(bytes.size());
+    const int totalChunks = FileTransferManager::chunkCountFor(size, kBig);
+    ASSERT_EQ(totalChunks, 3);
+
+    const std::string dbPath = makeTempPath("p2p-ft-bigchunk", ".db");
+    SqlCipherDb db;
+    Bytes dbKey(32);
+    randombytes_buf(dbKey.data(), dbKey.size());
+    ASSERT_TRUE(db.open(dbPath, dbKey)) << db.lastError();
+    receiver->setDatabase(&db);
+
+    // The relay-sized count no longer matches a negotiated announce.
+    EXPECT_FALSE(receiver->announceIncoming(
+        senderPeerId, transferId, "big.bin", size,
+        FileTransferManager::chunkCountFor(size), fileHash, fileKey, 0, {}, {}, kBig));
+    ASSERT_TRUE(receiver->announceIncoming(
+        senderPeerId, transferId, "big.bin", size,
+        totalChunks, fileHash, fileKey, 0, {}, {}, kBig));
+
+    sender->queueOutboundFile(senderPeerId, receiverPeerId, fileKey, transferId,
+                              "big.bin", srcFile, size, fileHash, {}, {}, kBig);
+    ASSERT_TRUE(sender->startOutboundStream(transferId, false, false,
+                                            /*p2pReadyNow=*/true, kBig));
+    EXPECT_TRUE(wire.empty()) << "negotiated chunks must never reach the relay";
+    ASSERT_EQ(int(p2p.size()), totalChunks);
+
+    // Deliver chunks 0 and 2, then restart the receiver.
+    auto markSeen = [](const std::string&) { return true; };
+    const std::map<std::string, Bytes> fileKeys = {{senderPeerId, fileKey}};
+    EXPECT_TRUE(receiver->handleFileEnvelope(senderPeerId, p2p[0], markSeen, fileKeys));
+    EXPECT_TRUE(receiver->handleFileEnvelope(senderPeerId, p2p[2], markSeen, fileKeys));
+    EXPECT_FALSE(transferCompletedFired);
+    receiver.reset();
+
+    auto fresh = std::make_unique<FileTransferManager>(crypto);
+    fresh->setPartialFileDir(partialDir);
+    fresh->setDatabase(&db);
+    fresh->onFileChunkReceived =
+        [this](const std::string&, const std::string&, const std::string&,
+               int64_t, int, int, const std::string& saved, int64_t,
+               const std::string&, const std::string&) {
+            if (!saved.empty()) savedPath = saved;
+        };
+    fresh->loadPersistedTransfers();
+
+    const auto pending = fresh->pendingResumptions();
+    ASSERT_EQ(pending.size(), 1u);
+    ASSERT_EQ(pending[0].missingChunks, std::vector<uint32_t>{1u});
+
+    // The sender's file_request path re-reads at the negotiated size too.
+    p2p.clear();
+    ASSERT_TRUE(sender->resendChunks(transferId, {1u}));
+    EXPECT_TRUE(wire.empty());
+    ASSERT_EQ(p2p.size(), 1u);
+    EXPECT_TRUE(fresh->handleFileEnvelope(senderPeerId, p2p[0], markSeen, fileKeys));
+
+    ASSERT_FALSE(savedPath.empty()) << "resumed transfer never completed";
+    EXPECT_EQ(readFileBytes(savedPath), bytes);
+
+    receiver = std::move(fresh);
+    db.close();
+    fs::remove(dbPath);
+}
+
+TEST_F(FileTransferRoundTrip, StartOutboundRejectsChunkSizeOutsideOffer) {
+    std::string abandoned;
+    sender->onOutboundAbandoned = [&](const std::string& tid, const std::string&) {
+        abandoned = tid;
+    };
+    const Bytes fileKey  = randomBytes(32);
+    const Bytes bytes    = prepareSource(size_t(FileTransferManager::kChunkBytes) * 4);
+    const Bytes fileHash = FileTransferManager::blake2b256(bytes);
+
+    // No chunkMax was offered, so a file_accept asking for 1 MiB chunks
+    // is bogus: the transfer is abandoned and nothing is sent.
+    sender->queueOutboundFile(senderPeerId, receiverPeerId, fileKey, transferId,
+                              "x.bin", srcFile, int64_t(bytes.size()), fileHash);
+    EXPECT_FALSE(sender->startOutboundStream(transferId, false, false, true,
+                                             1024 * 1024));
+    EXPECT_EQ(abandoned, transferId);
+    EXPECT_TRUE(wire.empty());
+    EXPECT_EQ(sender->outboundPeerFor(transferId), "");
+}
+
+// ── Tree-hashed transfers: per-chunk verification ─────────────────────────
+// The source changes under the sender after the file_key root was
+// computed — the one chunk it touched is rejected on arrival (never
+// written), re-requested, and the re-sent copy isn't mistaken for a
+// replay by the dedup set.
+
+TEST_F(FileTransferRoundTrip, TreeHashRejectsBadChunkAndAcceptsResend) {
+    const int64_t cb     = FileTransferManager::kChunkBytes;
+    const Bytes fileKey  = randomBytes(32);
+    const Bytes bytes    = prepareSource(size_t(cb) * 5 + 4321);
+    const auto  tree     = TreeHash::build(bytes);
+    const int64_t size   = int64_t(bytes.size());
+    const int totalChunks = FileTransferManager::chunkCountFor(size);
+
+    std::vector<uint32_t> rejected;
+    receiver->onChunkRejected = [&](const std::string& from, const std::string& tid,
+                                    uint32_t idx) {
+        EXPECT_EQ(from, senderPeerId);
+        EXPECT_EQ(tid, transferId);
+        rejected.push_back(idx);
+    };
+    ASSERT_TRUE(receiver->announceIncoming(
+        senderPeerId, transferId, "tree.bin", size, totalChunks,
+        tree->root(), fileKey, 0, {}, {}, cb, /*treeHash=*/true));
+
+    Bytes changed = bytes;
+    changed[size_t(2 * cb + 17)] ^= 0xFF;
+    writeFile(srcFile, changed);
+
+    sender->queueOutboundFile(senderPeerId, receiverPeerId, fileKey, transferId,
+                              "tree.bin", srcFile, size, tree->root(), {}, {}, cb,
+                              tree);
+    ASSERT_TRUE(sender->startOutboundStream(transferId, false, false, false, cb));
+    ASSERT_EQ(int(wire.size()), totalChunks);
+
+    std::set<std::string> seen;
+    auto markSeen = [&](const std::string& k) { return seen.insert(k).second; };
+    const std::map<std::string, Bytes> fileKeys = {{senderPeerId, fileKey}};
+    for (const auto& w : wire)
+        EXPECT_TRUE(receiver->handleFileEnvelope(senderPeerId, w.payload, markSeen, fileKeys));
+    EXPECT_EQ(rejected, std::vector<uint32_t>{2u});
+    EXPECT_FALSE(transferCompletedFired);
+    const auto pending = receiver->pendingResumptions();
+    ASSERT_EQ(pending.size(), 1u);
+    EXPECT_EQ(pending[0].missingChunks, std::vector<uint32_t>{2u});
+
+    // The file_request answer, from the restored source.
+    writeFile(srcFile, bytes);
+    wire.clear();
+    ASSERT_TRUE(sender->resendChunks(transferId, rejected));
+    ASSERT_EQ(wire.size(), 1u);
+    EXPECT_TRUE(receiver->handleFileEnvelope(senderPeerId, wire[0].payload, markSeen, fileKeys));
+
+    ASSERT_FALSE(savedPath.empty()) << "transfer never completed after the resend";
+    EXPECT_EQ(readFileBytes(savedPath), bytes);
+}
+
+// Replaced wholesale after the announce: every chunk fails, and the
+// receiver stops asking after kMaxCorruptChunks instead of pulling the
+// whole file just to reject it at the end.
+TEST_F(FileTransferRoundTrip, TreeHashGivesUpOnChangedSource) {
+    const int64_t cb     = FileTransferManager::kChunkBytes;
+    const Bytes fileKey  = randomBytes(32);
+    const Bytes bytes    = prepareSource(size_t(cb) * (FileTransferManager::kMaxCorruptChunks + 3));
+    const auto  tree     = TreeHash::build(bytes);
+    const int64_t size   = int64_t(bytes.size());
+
+    int rejected = 0;
+    bool canceled = false;
+    receiver->onChunkRejected = [&](const std::string&, const std::string&, uint32_t) {
+        ++rejected;
+    };
+    receiver->onInboundCanceled = [&](const std::string&, const std::string&) {
+        canceled = true;
+    };
+    ASSERT_TRUE(receiver->announceIncoming(
+        senderPeerId, transferId, "gone.bin", size, FileTransferManager::chunkCountFor(size),
+        tree->root(), fileKey, 0, {}, {}, cb, /*treeHash=*/true));
+
+    writeFile(srcFile, randomBytes(bytes.size()));
+    sender->queueOutboundFile(senderPeerId, receiverPeerId, fileKey, transferId,
+                              "gone.bin", srcFile, size, tree->root(), {}, {}, cb,
+                              tree);
+    ASSERT_TRUE(sender->startOutboundStream(transferId, false, false, false, cb));
+
+    auto markSeen = [](const std::string&) { return true; };
+    const std::map<std::string, Bytes> fileKeys = {{senderPeerId, fileKey}};
+    for (const auto& w : wire)
+        EXPECT_TRUE(receiver->handleFileEnvelope(senderPeerId, w.payload, markSeen, fileKeys));
+
+    EXPECT_EQ(rejected, FileTransferManager::kMaxCorruptChunks);
+    EXPECT_TRUE(canceled);
+    EXPECT_TRUE(savedPath.empty());
+    EXPECT_NE(lastStatus.find("integrity check FAILED"), std::string::npos) << lastStatus;
+    EXPECT_TRUE(receiver->pendingResumptions().empty());
+    EXPECT_FALSE(fs::exists(partialDir + "/" + transferId + ".partial"));
+}
+
+// ── Batched progress: crash resume ────────────────────────────────────────
+// The receiver dies mid-window without its destructor's final sync.  The
+// row it left behind lists only chunks that were fdatasync'd, as a single
+// run, and the restart re-requests at most one kProgressSyncChunks window
+// of chunks it had already received.
+
+TEST_F(FileTransferRoundTrip, CrashResumeReRequestsAtMostOneWindow) {
+    constexpr int kWindow = FileTransferManager::kProgressSyncChunks;
+    const int64_t cb      = FileTransferManager::kChunkBytes;
+    const Bytes fileKey   = randomBytes(32);
+    const Bytes bytes     = prepareSource(size_t(cb) * (6 * kWindow + 3) + 55);
+    const Bytes fileHash  = FileTransferManager::blake2b256(bytes);
+    const int64_t size    = int64_t(bytes.size());
+    const int totalChunks = FileTransferManager::chunkCountFor(size);
+    const int delivered   = 5 * kWindow + 7;
+
+    const std::string dbPath    = makeTempPath("p2p-ft-crash", ".db");
+    const std::string crashPath = makeTempPath("p2p-ft-crash-copy", ".db");
+    Bytes dbKey(32);
+    randombytes_buf(dbKey.data(), dbKey.size());
+    SqlCipherDb db;
+    ASSERT_TRUE(db.open(dbPath, dbKey)) << db.lastError();
+    receiver->setDatabase(&db);
+
+    ASSERT_TRUE(receiver->announceIncoming(
+        senderPeerId, transferId, "crash.bin", size, totalChunks, fileHash, fileKey, 0));
+    sender->queueOutboundFile(senderPeerId, receiverPeerId, fileKey, transferId,
+                              "crash.bin", srcFile, size, fileHash);
+    // Over kLargeFileBytes: streams once a path is up, relay included.
+    ASSERT_TRUE(sender->startOutboundStream(transferId, false, false,
+                                            /*p2pReadyNow=*/true, cb));
+    ASSERT_EQ(int(wire.size()), totalChunks);
+
+    auto markSeen = [](const std::string&) { return true; };
+    const std::map<std::string, Bytes> fileKeys = {{senderPeerId, fileKey}};
+    for (int i = 0; i < delivered; ++i)
+        EXPECT_TRUE(receiver->handleFileEnvelope(senderPeerId, wire[size_t(i)].payload,
+                                                 markSeen, fileKeys));
+
+    // In-order progress is one run: tag + count + one (first, count)
+    // pair, smaller than a bit per chunk.
+    {
+        SqlCipherQuery q(db);
+        ASSERT_TRUE(q.prepare("SELECT received_bitmap FROM file_transfers_in "
+                              "WHERE transfer_id=:tid;"));
+        q.bindValue(":tid", transferId);
+        ASSERT_TRUE(q.exec());
+        ASSERT_TRUE(q.next());
+        const Bytes blob = q.valueBlob(0);
+        EXPECT_EQ(blob.size(), 13u);
+        EXPECT_LT(blob.size(), 4u + size_t(totalChunks + 7) / 8);
+    }
+
+    // "Crash": snapshot the DB as it stands, before the destructor gets
+    // to sync the open window.
+    for (const char* suffix : {"", "-wal"}) {
+        std::error_code ec;
+        if (fs::exists(dbPath + suffix))
+            fs::copy_file(dbPath + suffix, crashPath + suffix,
+                          fs::copy_options::overwrite_existing, ec);
+        ASSERT_FALSE(ec) << ec.message();
+    }
+    receiver.reset();
+    db.close();
+
+    SqlCipherDb crashed;
+    ASSERT_TRUE(crashed.open(crashPath, dbKey)) << crashed.lastError();
+    receiver = std::make_unique<FileTransferManager>(crypto);
+    receiver->setPartialFileDir(partialDir);
+    receiver->setDatabase(&crashed);
+    receiver->onFileChunkReceived =
+        [this](const std::string&, const std::string&, const std::string&,
+               int64_t, int, int, const std::string& saved, int64_t,
+               const std::string&, const std::string&) {
+            if (!saved.empty()) savedPath = saved;
+        };
+    receiver->loadPersistedTransfers();
+
+    const auto pending = receiver->pendingResumptions();
+    ASSERT_EQ(pending.size(), 1u);
+    const auto& missing = pending[0].missingChunks;
+    ASSERT_FALSE(missing.empty());
+    // Everything from the last synced chunk on, and nothing before it.
+    for (size_t k = 0; k < missing.size(); ++k)
+        EXPECT_EQ(missing[k], missing[0] + uint32_t(k));
+    EXPECT_EQ(int(missing.back()), totalChunks - 1);
+    const int lost = delivered - int(missing[0]);
+    EXPECT_GE(lost, 0);
+    EXPECT_LT(lost, kWindow) << "re-requested more than one window";
+
+    wire.clear();
+    ASSERT_TRUE(sender->resendChunks(transferId, missing));
+    ASSERT_EQ(wire.size(), missing.size());
+    for (const auto& w : wire)
+        EXPECT_TRUE(receiver->handleFileEnvelope(senderPeerId, w.payload, markSeen, fileKeys));
+    ASSERT_FALSE(savedPath.empty()) << "resumed transfer never completed";
+    EXPECT_EQ(readFileBytes(savedPath), bytes);
+
+    receiver.reset();
+    crashed.close();
+    for (const std::string& p : {dbPath, crashPath})
+        for (const char* suffix : {"", "-wal", "-shm"}) fs::remove(p + suffix);
+}
+
+// Rows written before the run-length format hold a plain bitmap:
+// [4-byte bit count BE][packed bytes, LSB first].  They still resume.
+TEST_F(FileTransferRoundTrip, LegacyBitmapRowStillResumes) {
+    const int64_t cb      = FileTransferManager::kChunkBytes;
+    const Bytes fileKey   = randomBytes(32);
+    const Bytes bytes     = prepareSource(size_t(cb) * 4 + 10);
+    const Bytes fileHash  = FileTransferManager::blake2b256(bytes);
+    const int64_t size    = int64_t(bytes.size());
+    const int totalChunks = FileTransferManager::chunkCountFor(size);
+    ASSERT_EQ(totalChunks, 5);
+
+    const std::string dbPath = makeTempPath("p2p-ft-legacy", ".db");
+    Bytes dbKey(32);
+    randombytes_buf(dbKey.data(), dbKey.size());
+    SqlCipherDb db;
+    ASSERT_TRUE(db.open(dbPath, dbKey)) << db.lastError();
+    receiver->setDatabase(&db);
+
+    ASSERT_TRUE(receiver->announceIncoming(
+        senderPeerId, transferId, "legacy.bin", size, totalChunks, fileHash, fileKey, 0));
+    ASSERT_EQ(runSend(fileKey, fileHash, size, "legacy.bin"), transferId);
+    ASSERT_EQ(int(wire.size()), totalChunks);
+
+    auto markSeen = [](const std::string&) { return true; };
+    const std::map<std::string, Bytes> fileKeys = {{senderPeerId, fileKey}};
+    for (int i : {0, 2, 3})
+        EXPECT_TRUE(receiver->handleFileEnvelope(senderPeerId, wire[size_t(i)].payload,
+                                                 markSeen, fileKeys));
+    receiver.reset();
+
+    {
+        SqlCipherQuery q(db);
+        ASSERT_TRUE(q.prepare("UPDATE file_transfers_in SET received_bitmap=:bmap "
+                              "WHERE transfer_id=:tid;"));
+        q.bindValue(":bmap", Bytes{0, 0, 0, 5, 0x0D});   // chunks 0, 2, 3
+        q.bindValue(":tid",  transferId);
+        ASSERT_TRUE(q.exec());
+    }
+
+    receiver = std::make_unique<FileTransferManager>(crypto);
+    receiver->setPartialFileDir(partialDir);
+    receiver->setDatabase(&db);
+    receiver->onFileChunkReceived =
+        [this](const std::string&, const std::string&, const std::string&,
+               int64_t, int, int, const std::string& saved, int64_t,
+               const std::string&, const std::string&) {
+            if (!saved.empty()) savedPath = saved;
+        };
+    receiver->loadPersistedTransfers();
+
+    const auto pending = receiver->pendingResumptions();
+    ASSERT_EQ(pending.size(), 1u);
+    EXPECT_EQ(pending[0].missingChunks, (std::vector<uint32_t>{1u, 4u}));
+    for (int i : {1, 4})
+        EXPECT_TRUE(receiver->handleFileEnvelope(senderPeerId, wire[size_t(i)].payload,
+                                                 markSeen, fileKeys));
+    ASSERT_FALSE(savedPath.empty());
+    EXPECT_EQ(readFileBytes(savedPath), bytes);
+
+    receiver.reset();
+    db.close();
+    fs::remove(dbPath);
+}
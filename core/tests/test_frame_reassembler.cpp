@@ -0,0 +1,240 @@
+// test_frame_reassembler.cpp — unit tests for FrameReassembler.
+//
+// FrameReassembler turns QuicConnection's QUIC stream bytes back into
+// [4-byte BE length][payload] frames.  The invariants pinned here: every
+// frame comes out exactly once and byte-identical however the transport
+// slices the stream, frames that fit in one receive buffer are handed
+// out as views into that buffer, and an oversized header resets the
+// stream instead of buffering without bound.
+//
+// Scope: framing only.  msquic and libnice aren't linked into the test
+// build, so there is no loopback QUIC benchmark here: the throughput
+// benchmark times the reassembly step alone, fed with the receive-buffer
+// sizes msquic hands a stream callback.
+
+#include "types.hpp"
+#include "FrameReassembler.hpp"
+
+#include <gtest/gtest.h>
+
+#include <sodium.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <functional>
+#include <vector>
+
+namespace {
+
+constexpr uint32_t kMaxFrame = 256 * 1024;
+
+Bytes randomBytes(size_t n)
+{
+    Bytes b(n);
+    randombytes_buf(b.data(), b.size());
+    return b;
+}
+
+void appendFrame(Bytes& wire, const Bytes& payload)
+{
+    const uint32_t n = static_cast<uint32_t>(payload.size());
+    wire.push_back(uint8_t(n >> 24));
+    wire.push_back(uint8_t(n >> 16));
+    wire.push_back(uint8_t(n >> 8));
+    wire.push_back(uint8_t(n));
+    wire.insert(wire.end(), payload.begin(), payload.end());
+}
+
+// Feed `wire` in slices of `slice` bytes, collecting every frame.
+std::vector<Bytes> feedSliced(FrameReassembler& r, const Bytes& wire, size_t slice)
+{
+    std::vector<Bytes> out;
+    const FrameReassembler::FrameFn collect = [&](const uint8_t* d, size_t n) {
+        out.emplace_back(d, d + n);
+    };
+    for (size_t off = 0; off < wire.size(); off += slice) {
+        const size_t n = std::min(slice, wire.size() - off);
+        EXPECT_TRUE(r.feed(wire.data() + off, n, collect));
+    }
+    return out;
+}
+
+// The receive path QuicConnection had before FrameReassembler: append
+// every buffer, copy each frame out, erase from the front.  Kept here
+// as the benchmark baseline.
+void legacyProcess(Bytes& buf, const uint8_t* data, size_t len,
+                   const std::function<void(const Bytes&)>& cb)
+{
+    buf.insert(buf.end(), data, data + len);
+    while (buf.size() >= 4) {
+        const uint32_t frameLen = (uint32_t(buf[0]) << 24) | (uint32_t(buf[1]) << 16) |
+                                  (uint32_t(buf[2]) << 8)  |  uint32_t(buf[3]);
+        if (frameLen > kMaxFrame) { buf.clear(); return; }
+        if (buf.size() < 4u + frameLen) break;
+        Bytes payload(buf.begin() + 4, buf.begin() + 4 + frameLen);
+        buf.erase(buf.begin(), buf.begin() + 4 + frameLen);
+        cb(payload);
+    }
+}
+
+}  // namespace
+
+TEST(FrameReassembler, ContiguousFramesAreViewsIntoTheInput)
+{
+    ASSERT_GE(sodium_init(), 0);
+    const std::vector<Bytes> payloads = { randomBytes(10), randomBytes(300), randomBytes(1) };
+    Bytes wire;
+    for (const auto& p : payloads) appendFrame(wire, p);
+
+    FrameReassembler r(kMaxFrame);
+    std::vector<Bytes> got;
+    ASSERT_TRUE(r.feed(wire.data(), wire.size(), [&](const uint8_t* d, size_t n) {
+        EXPECT_GE(d, wire.data());
+        EXPECT_LE(d + n, wire.data() + wire.size()) << "frame was copied, not viewed";
+        got.emplace_back(d, d + n);
+    }));
+    EXPECT_EQ(got, payloads);
+    EXPECT_EQ(r.pending(), 0u);
+}
+
+TEST(FrameReassembler, EverySplitPointReassemblesIdentically)
+{
+    ASSERT_GE(sodium_init(), 0);
+    const std::vector<Bytes> payloads = { randomBytes(7), Bytes{}, randomBytes(40), randomBytes(3) };
+    Bytes wire;
+    for (const auto& p : payloads) appendFrame(wire, p);
+
+    // Two feeds, split at every offset — including inside a header.
+    for (size_t cut = 1; cut < wire.size(); ++cut) {
+        FrameReassembler r(kMaxFrame);
+        std::vector<Bytes> got;
+        const FrameReassembler::FrameFn collect = [&](const uint8_t* d, size_t n) {
+            got.emplace_back(d, d + n);
+        };
+        ASSERT_TRUE(r.feed(wire.data(), cut, collect));
+        ASSERT_TRUE(r.feed(wire.data() + cut, wire.size() - cut, collect));
+        EXPECT_EQ(got, payloads) << "cut at " << cut;
+        EXPECT_EQ(r.pending(), 0u);
+    }
+}
+
+TEST(FrameReassembler, ByteAtATimeFeed)
+{
+    ASSERT_GE(sodium_init(), 0);
+    const std::vector<Bytes> payloads = { randomBytes(1000), randomBytes(5), Bytes{} };
+    Bytes wire;
+    for (const auto& p : payloads) appendFrame(wire, p);
+
+    FrameReassembler r(kMaxFrame);
+    EXPECT_EQ(feedSliced(r, wire, 1), payloads);
+}
+
+TEST(FrameReassembler, PendingTracksStraddlingFrame)
+{
+    ASSERT_GE(sodium_init(), 0);
+    Bytes wire;
+    appendFrame(wire, randomBytes(100));
+
+    FrameReassembler r(kMaxFrame);
+    int frames = 0;
+    const FrameReassembler::FrameFn count = [&](const uint8_t*, size_t) { ++frames; };
+    ASSERT_TRUE(r.feed(wire.data(), 50, count));
+    EXPECT_EQ(r.pending(), 50u);
+    EXPECT_EQ(frames, 0);
+
+    r.reset();
+    EXPECT_EQ(r.pending(), 0u);
+
+    // After reset the next byte is a fresh header again.
+    ASSERT_TRUE(r.feed(wire.data(), wire.size(), count));
+    EXPECT_EQ(frames, 1);
+}
+
+TEST(FrameReassembler, MaxFrameAcceptedOversizeRejected)
+{
+    ASSERT_GE(sodium_init(), 0);
+    FrameReassembler r(kMaxFrame);
+    int frames = 0;
+    const FrameReassembler::FrameFn count = [&](const uint8_t*, size_t) { ++frames; };
+
+    Bytes ok;
+    appendFrame(ok, Bytes(kMaxFrame, 0xAB));
+    EXPECT_EQ(feedSliced(r, ok, 1200).size(), 1u);
+
+    // Oversize header on the fast path...
+    const Bytes big = { 0x00, 0x04, 0x00, 0x01, 0xFF, 0xFF };
+    EXPECT_FALSE(r.feed(big.data(), big.size(), count));
+    EXPECT_EQ(r.pending(), 0u);
+
+    // ...and split across feeds.
+    EXPECT_TRUE(r.feed(big.data(), 2, count));
+    EXPECT_FALSE(r.feed(big.data() + 2, 4, count));
+    EXPECT_EQ(r.pending(), 0u);
+    EXPECT_EQ(frames, 0);
+
+    // The stream recovers on the next well-formed frame.
+    Bytes next;
+    appendFrame(next, randomBytes(16));
+    EXPECT_TRUE(r.feed(next.data(), next.size(), count));
+    EXPECT_EQ(frames, 1);
+}
+
+// Two receive patterns: a burst of small message frames landing in one
+// large receive buffer, and padded 256 KiB file chunks sliced at msquic's
+// typical 64 KiB receive granularity.  Reassembly only — no QUIC, no
+// sockets — compared against the append/copy/erase loop this replaced.
+// Opt-in benchmark (see README).
+TEST(FrameReassembler, DISABLED_BenchmarkReassemblyThroughput)
+{
+    ASSERT_GE(sodium_init(), 0);
+    struct Shape { const char* name; size_t frameLen; size_t frames; size_t slice; };
+    const Shape shapes[] = {
+        { "burst 512 B x 4096 ", 512,        4096, 4096 * 516 },
+        { "chunk 256 KiB x 128", kMaxFrame,  128,  64 * 1024  },
+    };
+
+    for (const auto& s : shapes) {
+        Bytes wire;
+        const Bytes payload = randomBytes(s.frameLen);
+        for (size_t i = 0; i < s.frames; ++i) appendFrame(wire, payload);
+
+        auto timeIt = [&](auto&& feedAll) {
+            feedAll();   // warm-up: carry-buffer growth, page faults
+            const auto t0 = std::chrono::steady_clock::now();
+            constexpr int kRounds = 3;
+            for (int i = 0; i < kRounds; ++i) feedAll();
+            return std::chrono::duration_cast<std::chrono::microseconds>(
+                std::chrono::steady_clock::now() - t0).count() / kRounds;
+        };
+
+        size_t delivered = 0;
+        size_t bytes = 0;
+        FrameReassembler r(kMaxFrame);
+        const auto newUs = timeIt([&] {
+            for (size_t off = 0; off < wire.size(); off += s.slice) {
+                r.feed(wire.data() + off, std::min(s.slice, wire.size() - off),
+                       [&](const uint8_t*, size_t n) { ++delivered; bytes += n; });
+            }
+        });
+        EXPECT_EQ(delivered, 4 * s.frames);
+        EXPECT_EQ(bytes, 4 * s.frames * s.frameLen);
+
+        delivered = 0;
+        Bytes legacyBuf;
+        const auto oldUs = timeIt([&] {
+            for (size_t off = 0; off < wire.size(); off += s.slice) {
+                legacyProcess(legacyBuf, wire.data() + off,
+                              std::min(s.slice, wire.size() - off),
+                              [&](const Bytes&) { ++delivered; });
+            }
+        });
+        EXPECT_EQ(delivered, 4 * s.frames);
+
+        const double mib = double(wire.size()) / (1024.0 * 1024.0);
+        std::printf("[bench] %s: reassembler %7lld us (%6.0f MiB/s), legacy %8lld us (%6.0f MiB/s)\n",
+                    s.name,
+                    static_cast<long long>(newUs), mib / (double(newUs ? newUs : 1) / 1e6),
+                    static_cast<long long>(oldUs), mib / (double(oldUs ? oldUs : 1) / 1e6));
+    }
+}
@@ -0,0 +1,197 @@
+// test_nice_connection.cpp — ICE setup over loopback with libnice.
+//
+// NiceConnection lives in desktop/ and needs libnice + GLib, so this
+// binary is only built with PEER2PEAR_P2P=ON.  The invariants pinned here:
+// an offer / answer exchange between two NiceConnections reaches READY on
+// both sides whether the agents are gathered cold or taken pre-gathered
+// from IceAgentPool, every callback runs on the pool's one shared loop
+// thread, and pooled candidates are not handed out past their TTL or to a
+// connection with a different TURN config.
+//
+// Agents gather on 127.0.0.1 only, with STUN off, so the numbers are the
+// local cost of agent setup + gathering + connectivity checks — the part
+// the pool removes — without a network round trip in them.
+
+#include "NiceConnection.hpp"
+#include "IceAgentPool.hpp"
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <thread>
+#include <vector>
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+IceAgentPool::Config loopbackConfig(size_t warmAgents, int64_t ttlMs = 60 * 1000)
+{
+    IceAgentPool::Config cfg;
+    cfg.stunHost       = "";
+    cfg.warmAgents     = warmAgents;
+    cfg.candidateTtlMs = ttlMs;
+    cfg.localAddresses = {"127.0.0.1"};
+    return cfg;
+}
+
+// Wait (bounded) until the pool holds `n` gathered agents.
+bool waitReady(size_t n)
+{
+    const auto deadline = Clock::now() + std::chrono::seconds(5);
+    while (IceAgentPool::instance().readyCount() < n) {
+        if (Clock::now() > deadline) return false;
+        std::this_thread::sleep_for(std::chrono::milliseconds(2));
+    }
+    return true;
+}
+
+struct PairResult {
+    bool                       ready = false;
+    int64_t                    offerToReadyUs = 0;
+    std::set<std::thread::id>  callbackThreads;
+};
+
+// Offerer initIce → its SDP → answerer initIce + setRemoteSdp → answer SDP
+// → offerer setRemoteSdp, the order ChatController's ice_offer / ice_answer
+// handlers use.  Timed until both sides report READY.
+PairResult connectPair()
+{
+    auto a = std::make_unique<NiceConnection>();
+    auto b = std::make_unique<NiceConnection>();
+    NiceConnection* ap = a.get();
+    NiceConnection* bp = b.get();
+
+    PairResult r;
+    std::mutex m;
+    std::condition_variable cv;
+    bool aReady = false, bReady = false;
+
+    auto note = [&](bool* flag) {
+        std::lock_guard<std::mutex> lock(m);
+        r.callbackThreads.insert(std::this_thread::get_id());
+        if (flag) *flag = true;
+        cv.notify_all();
+    };
+    a->onStateChanged = [&](int s) { note(s == NICE_COMPONENT_STATE_READY ? &aReady : nullptr); };
+    b->onStateChanged = [&](int s) { note(s == NICE_COMPONENT_STATE_READY ? &bReady : nullptr); };
+    a->onLocalSdpReady = [&, bp](const std::string& sdp) {
+        note(nullptr);
+        bp->initIce(false);
+        bp->setRemoteSdp(sdp);
+    };
+    b->onLocalSdpReady = [&, ap](const std::string& sdp) {
+        note(nullptr);
+        ap->setRemoteSdp(sdp);
+    };
+
+    const auto t0 = Clock::now();
+    a->initIce(true);
+    {
+        std::unique_lock<std::mutex> lock(m);
+        r.ready = cv.wait_for(lock, std::chrono::seconds(10),
+                              [&] { return aReady && bReady; });
+        r.offerToReadyUs = std::chrono::duration_cast<std::chrono::microseconds>(
+            Clock::now() - t0).count();
+    }
+    // Tear both down on the loop thread in one go, so neither side's
+    // callbacks can reach the other mid-destruction.
+    IceAgentPool::instance().invokeSync([&] { a.reset(); b.reset(); });
+    return r;
+}
+
+int64_t median(std::vector<int64_t> v)
+{
+    std::sort(v.begin(), v.end());
+    return v.empty() ? 0 : v[v.size() / 2];
+}
+
+}  // namespace
+
+TEST(NiceConnection, LoopbackPairReachesReadyOnSharedLoop)
+{
+    IceAgentPool::instance().configure(loopbackConfig(0));
+    const PairResult r = connectPair();
+    ASSERT_TRUE(r.ready);
+    // Gather, SDP and state callbacks for both connections: one thread,
+    // and not the caller's.
+    ASSERT_EQ(r.callbackThreads.size(), 1u);
+    EXPECT_NE(*r.callbackThreads.begin(), std::this_thread::get_id());
+}
+
+// Opt-in benchmark (see README): median offer-to-ready, cold vs. pooled.
+TEST(NiceConnection, DISABLED_BenchmarkOfferToReadyColdVsPooled)
+{
+    IceAgentPool& pool = IceAgentPool::instance();
+    constexpr int kRounds = 5;
+
+    pool.configure(loopbackConfig(0));
+    std::vector<int64_t> cold;
+    for (int i = 0; i < kRounds; ++i) {
+        const PairResult r = connectPair();
+        ASSERT_TRUE(r.ready) << "cold round " << i;
+        cold.push_back(r.offerToReadyUs);
+    }
+
+    pool.configure(loopbackConfig(2));
+    pool.prewarm({});
+    std::vector<int64_t> pooled;
+    for (int i = 0; i < kRounds; ++i) {
+        // Both sides take an agent; start each round with the pool full.
+        ASSERT_TRUE(waitReady(2));
+        const auto before = pool.stats();
+        const PairResult r = connectPair();
+        ASSERT_TRUE(r.ready) << "pooled round " << i;
+        EXPECT_EQ(pool.stats().hits, before.hits + 2);
+        pooled.push_back(r.offerToReadyUs);
+    }
+
+    std::printf("[bench] ICE offer-to-ready over loopback (median of %d): "
+                "cold %6lld us, pre-gathered %6lld us\n",
+                kRounds,
+                static_cast<long long>(median(cold)),
+                static_cast<long long>(median(pooled)));
+}
+
+TEST(NiceConnection, PooledAgentsExpireAndFollowTurnConfig)
+{
+    IceAgentPool& pool = IceAgentPool::instance();
+
+    // Fresh agent: handed out with its SDP.
+    pool.configure(loopbackConfig(1));
+    pool.prewarm({});
+    ASSERT_TRUE(waitReady(1));
+    IceAgentPool::Prepared p = pool.take({});
+    ASSERT_NE(p.agent, nullptr);
+    EXPECT_NE(p.localSdp.find("127.0.0.1"), std::string::npos);
+    pool.closeAgent(p.agent, nullptr);
+
+    // Past the TTL: a miss, never a stale candidate set.
+    pool.configure(loopbackConfig(1, /*ttlMs=*/20));
+    pool.prewarm({});
+    const uint64_t gathered = pool.stats().gathered;
+    const auto deadline = Clock::now() + std::chrono::seconds(5);
+    while (pool.stats().gathered == gathered && Clock::now() < deadline)
+        std::this_thread::sleep_for(std::chrono::milliseconds(2));
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    EXPECT_EQ(pool.readyCount(), 0u);
+    const auto st = pool.stats();
+    p = pool.take({});
+    EXPECT_EQ(p.agent, nullptr);
+    EXPECT_EQ(pool.stats().misses, st.misses + 1);
+
+    // Gathered without TURN: a connection that needs the relay misses.
+    pool.configure(loopbackConfig(1));
+    pool.prewarm({});
+    ASSERT_TRUE(waitReady(1));
+    p = pool.take({"127.0.0.1", 3478, "user", "pass"});
+    EXPECT_EQ(p.agent, nullptr);
+
+    pool.configure(loopbackConfig(0));
+}
@@ -0,0 +1,230 @@
+// test_p2p_connection_pool.cpp — unit tests for P2PConnectionPool.
+//
+// P2PConnectionPool is the lifecycle policy behind ChatController's
+// per-peer QUIC connections.  The invariants pinned here: the pool never
+// grows past its cap except to keep pinned peers, the least recently used
+// connection is the one evicted, half-open / dropped / idle connections
+// are swept at the right moment, keepalive is toggled only on
+// transitions, background re-dials back off per peer until ready, and
+// setup latency + reuse hits are counted.
+//
+// Scope: policy only.  msquic and libnice aren't linked into the test
+// build; readiness is fed in through the sweep callback.
+
+#include "P2PConnectionPool.hpp"
+
+#include <gtest/gtest.h>
+
+#include <set>
+#include <string>
+#include <vector>
+
+namespace {
+
+P2PConnectionPool::Limits smallLimits()
+{
+    P2PConnectionPool::Limits l;
+    l.maxConnections      = 3;
+    l.setupGraceSecs      = 10;
+    l.keepAliveWindowSecs = 30;
+    l.idleEvictSecs       = 60;
+    l.redialBackoffSecs    = 10;
+    l.redialBackoffMaxSecs = 40;
+    return l;
+}
+
+P2PConnectionPool::ReadyFn readyIn(const std::set<std::string>& ready)
+{
+    return [ready](const std::string& p) { return ready.count(p) != 0; };
+}
+
+}  // namespace
+
+TEST(P2PConnectionPool, AdmitEvictsLeastRecentlyUsedPastCap)
+{
+    P2PConnectionPool pool(smallLimits());
+    EXPECT_TRUE(pool.admit("a", 1000).empty());
+    EXPECT_TRUE(pool.admit("b", 2000).empty());
+    EXPECT_TRUE(pool.admit("c", 3000).empty());
+
+    // "a" is the oldest, but a send just used it — "b" is now LRU.
+    pool.noteUse("a", 4000, /*hit=*/true);
+    const auto victims = pool.admit("d", 5000);
+    ASSERT_EQ(victims.size(), 1u);
+    EXPECT_EQ(victims[0], "b");
+    EXPECT_FALSE(pool.contains("b"));
+    EXPECT_TRUE(pool.contains("a"));
+    EXPECT_TRUE(pool.contains("d"));
+    EXPECT_EQ(pool.size(), 3u);
+    EXPECT_EQ(pool.stats().evictedLru, 1u);
+}
+
+TEST(P2PConnectionPool, PinnedPeersSurviveLruAndIdle)
+{
+    P2PConnectionPool pool(smallLimits());
+    pool.admit("a", 1000);
+    pool.admit("b", 2000);
+    pool.admit("c", 3000);
+
+    // Files queued to "a" and "b" — "c" is the only candidate.
+    const std::set<std::string> queued = {"a", "b"};
+    auto pinned = [&queued](const std::string& p) { return queued.count(p) != 0; };
+    auto victims = pool.admit("d", 4000, pinned);
+    ASSERT_EQ(victims.size(), 1u);
+    EXPECT_EQ(victims[0], "c");
+
+    // Everything else pinned: run over the cap rather than drop a
+    // connection a queued file is waiting on.
+    const std::set<std::string> all = {"a", "b", "d"};
+    victims = pool.admit("e", 5000,
+                         [&all](const std::string& p) { return all.count(p) != 0; });
+    EXPECT_TRUE(victims.empty());
+    EXPECT_EQ(pool.size(), 4u);
+
+    // Pinned + ready connections are never idled out.
+    for (const char* p : {"a", "b", "d", "e"}) pool.noteReady(p, 6000);
+    const auto sweep = pool.sweep(6000 + 120 * 1000,
+                                  readyIn({"a", "b", "d", "e"}), pinned);
+    EXPECT_EQ(std::set<std::string>(sweep.evict.begin(), sweep.evict.end()),
+              (std::set<std::string>{"d", "e"}));
+    EXPECT_TRUE(pool.contains("a"));
+    EXPECT_TRUE(pool.contains("b"));
+}
+
+TEST(P2PConnectionPool, SweepEvictsStaleDeadAndIdle)
+{
+    P2PConnectionPool pool(smallLimits());
+    pool.admit("slow", 0);
+    pool.admit("dropped", 0);
+    pool.admit("idle", 0);
+    pool.noteReady("dropped", 1000);
+    pool.noteReady("idle", 1000);
+
+    // Inside the setup grace: the half-open connection is left alone,
+    // but a ready connection that went away is evicted at once.
+    auto sweep = pool.sweep(5000, readyIn({"idle"}));
+    EXPECT_EQ(sweep.evict, std::vector<std::string>{"dropped"});
+    EXPECT_TRUE(pool.contains("slow"));
+
+    // Past the grace without ever reaching ready.
+    sweep = pool.sweep(10000, readyIn({"idle"}));
+    EXPECT_EQ(sweep.evict, std::vector<std::string>{"slow"});
+
+    // Inbound traffic counts as use; idle eviction waits for silence.
+    pool.noteActivity("idle", 30000);
+    sweep = pool.sweep(30000 + 59 * 1000, readyIn({"idle"}));
+    EXPECT_TRUE(sweep.evict.empty());
+    sweep = pool.sweep(30000 + 60 * 1000, readyIn({"idle"}));
+    EXPECT_EQ(sweep.evict, std::vector<std::string>{"idle"});
+    EXPECT_EQ(pool.size(), 0u);
+
+    const auto st = pool.stats();
+    EXPECT_EQ(st.evictedStale, 1u);
+    EXPECT_EQ(st.evictedDead, 1u);
+    EXPECT_EQ(st.evictedIdle, 1u);
+}
+
+TEST(P2PConnectionPool, KeepAliveReportedOnTransitionsOnly)
+{
+    P2PConnectionPool pool(smallLimits());
+    pool.admit("a", 0);
+    pool.noteReady("a", 1000);
+
+    auto sweep = pool.sweep(2000, readyIn({"a"}));
+    EXPECT_EQ(sweep.keepAliveOn, std::vector<std::string>{"a"});
+    EXPECT_TRUE(sweep.keepAliveOff.empty());
+
+    // Still recently used — no repeat.
+    sweep = pool.sweep(20000, readyIn({"a"}));
+    EXPECT_TRUE(sweep.keepAliveOn.empty());
+    EXPECT_TRUE(sweep.keepAliveOff.empty());
+
+    // Quiet past the window: keepalive off, connection kept until idle.
+    sweep = pool.sweep(1000 + 30 * 1000, readyIn({"a"}));
+    EXPECT_EQ(sweep.keepAliveOff, std::vector<std::string>{"a"});
+    EXPECT_TRUE(sweep.evict.empty());
+
+    // A send brings it back.
+    pool.noteUse("a", 40000, /*hit=*/true);
+    sweep = pool.sweep(41000, readyIn({"a"}));
+    EXPECT_EQ(sweep.keepAliveOn, std::vector<std::string>{"a"});
+
+    // Pinned peers stay kept alive however long they're quiet.
+    auto pinned = [](const std::string&) { return true; };
+    sweep = pool.sweep(40000 + 50 * 1000, readyIn({"a"}), pinned);
+    EXPECT_TRUE(sweep.keepAliveOff.empty());
+    EXPECT_TRUE(sweep.evict.empty());
+}
+
+TEST(P2PConnectionPool, SetupLatencyAndReuseMetrics)
+{
+    P2PConnectionPool pool(smallLimits());
+    pool.admit("a", 1000);
+    pool.admit("b", 2000, {}, /*warmup=*/true);
+    pool.noteReady("a", 1400);
+    pool.noteReady("b", 2800);
+    pool.noteReady("b", 9000);   // repeat READY doesn't recount
+
+    pool.noteUse("a", 3000, true);
+    pool.noteUse("a", 3100, true);
+    pool.noteUse("c", 3200, false);   // no connection: relay fallback
+
+    const auto st = pool.stats();
+    EXPECT_EQ(st.setups, 2u);
+    EXPECT_EQ(st.setupsReady, 2u);
+    EXPECT_EQ(st.warmups, 1u);
+    EXPECT_EQ(st.setupMsTotal, 400u + 800u);
+    EXPECT_EQ(st.setupMsMax, 800u);
+    EXPECT_EQ(st.averageSetupMs(), 600u);
+    EXPECT_EQ(st.reuseHits, 2u);
+    EXPECT_EQ(st.reuseMisses, 1u);
+    EXPECT_FALSE(pool.contains("c"));
+}
+
+TEST(P2PConnectionPool, ReAdmitResetsEntryAfterRemove)
+{
+    P2PConnectionPool pool(smallLimits());
+    pool.admit("a", 0);
+    pool.noteReady("a", 500);
+    pool.remove("a");
+    EXPECT_FALSE(pool.contains("a"));
+
+    // A re-dial starts a fresh setup: not-ready inside the grace is fine,
+    // not "dead".
+    pool.admit("a", 20000);
+    const auto sweep = pool.sweep(21000, readyIn({}));
+    EXPECT_TRUE(sweep.evict.empty());
+    EXPECT_EQ(pool.stats().setups, 2u);
+}
+
+TEST(P2PConnectionPool, RedialBacksOffPerPeerUntilReady)
+{
+    P2PConnectionPool pool(smallLimits());
+
+    // 10 s, 20 s, then capped at 40 s between attempts.
+    EXPECT_TRUE(pool.claimRedial("a", 0));
+    EXPECT_FALSE(pool.claimRedial("a", 9000));
+    EXPECT_TRUE(pool.claimRedial("a", 10000));
+    EXPECT_FALSE(pool.claimRedial("a", 29000));
+    EXPECT_TRUE(pool.claimRedial("a", 30000));
+    EXPECT_FALSE(pool.claimRedial("a", 69000));
+    EXPECT_TRUE(pool.claimRedial("a", 70000));
+    EXPECT_FALSE(pool.claimRedial("a", 109000));
+    EXPECT_TRUE(pool.claimRedial("a", 110000));
+
+    // Other peers keep their own schedule.
+    EXPECT_TRUE(pool.claimRedial("b", 9000));
+
+    // Ready resets the backoff: the next drop is re-dialed at once.
+    pool.admit("a", 110000);
+    pool.noteReady("a", 111000);
+    EXPECT_TRUE(pool.claimRedial("a", 112000));
+    EXPECT_FALSE(pool.claimRedial("a", 113000));
+
+    EXPECT_EQ(pool.stats().redialsDeferred, 5u);
+
+    // A peer nobody re-dialed for a full max step starts over.
+    pool.sweep(112000 + 10000 + 40000, readyIn({}));
+    EXPECT_TRUE(pool.claimRedial("a", 162000));
+    EXPECT_FALSE(pool.claimRedial("a", 163000));
+}
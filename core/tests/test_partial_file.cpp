@@ -0,0 +1,255 @@
+// test_partial_file.cpp — tests for PartialFile + ChunkWriterPool.
+//
+// PartialFile is the receiver's preallocated on-disk copy of an incoming
+// transfer.  The invariants pinned here: the file is created at its full
+// size, chunks written in any order through the writer pool land at the
+// right offsets, the hash accumulated while writing equals the file's
+// BLAKE2b-256 with nothing read back when chunks arrive within the
+// reorder budget, a reopened file hashes the chunks written before the
+// restart, and the pool bounds the bytes queued behind a slow disk.
+//
+// The benchmark compares the previous receive path (fstream seek + write
+// + flush per chunk, then a full re-read to hash) with PartialFile.
+
+#include "types.hpp"
+#include "PartialFile.hpp"
+#include "FileTransferManager.hpp"
+#include "test_support.hpp"
+
+#include <gtest/gtest.h>
+
+#include <sodium.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <future>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace fs = std::filesystem;
+
+namespace {
+
+using p2p_test::makeTempPath;
+
+Bytes randomBytes(size_t n) {
+    Bytes b(n);
+    randombytes_buf(b.data(), n);
+    return b;
+}
+
+Bytes readFileBytes(const std::string& path) {
+    std::ifstream f(path, std::ios::binary);
+    if (!f) return {};
+    return Bytes((std::istreambuf_iterator<char>(f)),
+                  std::istreambuf_iterator<char>());
+}
+
+Bytes chunkOf(const Bytes& file, int64_t chunkBytes, int i) {
+    const int64_t off = int64_t(i) * chunkBytes;
+    const int64_t len = std::min<int64_t>(chunkBytes, int64_t(file.size()) - off);
+    return Bytes(file.begin() + off, file.begin() + off + len);
+}
+
+class Bootstrap : public ::testing::Environment {
+public:
+    void SetUp() override { ASSERT_GE(sodium_init(), 0); }
+};
+::testing::Environment* const kBootstrap =
+    ::testing::AddGlobalTestEnvironment(new Bootstrap);
+
+}  // namespace
+
+TEST(PartialFile, PreallocatedOutOfOrderWritesHashWithoutReread) {
+    const std::string path = makeTempPath("p2p-pf-ooo", ".partial");
+    const int64_t cb = FileTransferManager::kChunkBytes;
+    const Bytes file = randomBytes(size_t(cb) * 9 + 123);
+    const int total = FileTransferManager::chunkCountFor(int64_t(file.size()), cb);
+
+    ChunkWriterPool pool;
+    auto pf = PartialFile::create(path, int64_t(file.size()), cb, &pool);
+    ASSERT_NE(pf, nullptr);
+    EXPECT_EQ(int64_t(fs::file_size(path)), int64_t(file.size()));
+
+    std::vector<int> order(static_cast<size_t>(total));
+    for (int i = 0; i < total; ++i) order[size_t(i)] = i;
+    std::shuffle(order.begin(), order.end(), std::mt19937(7));
+    for (int i : order) ASSERT_TRUE(pf->writeChunk(i, chunkOf(file, cb, i)));
+
+    ASSERT_TRUE(pf->sync());
+    EXPECT_EQ(pf->finishHash(), FileTransferManager::blake2b256(file));
+    EXPECT_EQ(pf->rereadBytes(), 0);
+    pf->close();
+    EXPECT_EQ(readFileBytes(path), file);
+
+    fs::remove(path);
+}
+
+TEST(PartialFile, ReorderOverflowReadsBackOnlyOverflow) {
+    const std::string path = makeTempPath("p2p-pf-overflow", ".partial");
+    const int64_t cb = 1024 * 1024;
+    const Bytes file = randomBytes(size_t(cb) * 12);
+    const int budgetChunks = int(PartialFile::kReorderBudgetBytes / size_t(cb));
+
+    ChunkWriterPool pool;
+    auto pf = PartialFile::create(path, int64_t(file.size()), cb, &pool);
+    ASSERT_NE(pf, nullptr);
+
+    // Chunk 0 last: 1..budget fit the reorder buffer, the rest spill.
+    for (int i = 1; i < 12; ++i) ASSERT_TRUE(pf->writeChunk(i, chunkOf(file, cb, i)));
+    ASSERT_TRUE(pf->writeChunk(0, chunkOf(file, cb, 0)));
+
+    ASSERT_TRUE(pf->sync());
+    EXPECT_EQ(pf->finishHash(), FileTransferManager::blake2b256(file));
+    EXPECT_EQ(pf->rereadBytes(), int64_t(11 - budgetChunks) * cb);
+
+    pf.reset();
+    fs::remove(path);
+}
+
+TEST(PartialFile, ReopenHashesChunksFromBeforeRestart) {
+    const std::string path = makeTempPath("p2p-pf-reopen", ".partial");
+    const int64_t cb = FileTransferManager::kChunkBytes;
+    const Bytes file = randomBytes(size_t(cb) * 4 + 9);
+
+    ChunkWriterPool pool;
+    {
+        auto pf = PartialFile::create(path, int64_t(file.size()), cb, &pool);
+        ASSERT_NE(pf, nullptr);
+        ASSERT_TRUE(pf->writeChunk(0, chunkOf(file, cb, 0)));
+        ASSERT_TRUE(pf->writeChunk(2, chunkOf(file, cb, 2)));
+        ASSERT_TRUE(pf->sync());
+    }
+
+    auto pf = PartialFile::reopen(path, int64_t(file.size()), cb,
+                                  {true, false, true, false, false}, &pool);
+    ASSERT_NE(pf, nullptr);
+    EXPECT_EQ(pf->finishHash(), Bytes{});   // not complete yet — and not consumed
+    for (int i : {1, 3, 4}) ASSERT_TRUE(pf->writeChunk(i, chunkOf(file, cb, i)));
+    ASSERT_TRUE(pf->sync());
+    EXPECT_EQ(pf->finishHash(), FileTransferManager::blake2b256(file));
+    // Only the two chunks from the first session came back off disk.
+    EXPECT_EQ(pf->rereadBytes(), 2 * cb);
+
+    pf.reset();
+    EXPECT_EQ(readFileBytes(path), file);
+    fs::remove(path);
+}
+
+TEST(PartialFile, RejectsBadIndexAndLength) {
+    const std::string path = makeTempPath("p2p-pf-bad", ".partial");
+    auto pf = PartialFile::create(path, 1000, 400, nullptr);
+    ASSERT_NE(pf, nullptr);
+    EXPECT_FALSE(pf->writeChunk(-1, Bytes(400, 1)));
+    EXPECT_FALSE(pf->writeChunk(3, Bytes(400, 1)));
+    EXPECT_FALSE(pf->writeChunk(0, Bytes(399, 1)));
+    EXPECT_FALSE(pf->writeChunk(2, Bytes(400, 1)));   // last chunk is 200
+    EXPECT_TRUE(pf->writeChunk(2, Bytes(200, 1)));
+    EXPECT_EQ(pf->finishHash(), Bytes{});
+
+    EXPECT_EQ(PartialFile::create(path, 0, 400, nullptr), nullptr);
+    pf.reset();
+    fs::remove(path);
+    EXPECT_EQ(PartialFile::reopen(path, 1000, 400, {}, nullptr), nullptr);
+}
+
+TEST(ChunkWriterPool, SubmitBlocksPastQueuedByteBound) {
+    ChunkWriterPool pool(/*threads=*/1, /*maxQueuedBytes=*/100);
+    std::promise<void> release;
+    std::shared_future<void> gate = release.get_future().share();
+    std::atomic<int> ran{0};
+
+    // Occupies the one worker; the queue is empty again after it's taken.
+    pool.submit([gate, &ran] { gate.wait(); ++ran; }, 60);
+    pool.submit([&ran] { ++ran; }, 60);
+    // Two jobs of 60 don't fit a 100-byte queue together.
+    auto blocked = std::async(std::launch::async, [&] {
+        pool.submit([&ran] { ++ran; }, 60);
+    });
+    EXPECT_EQ(blocked.wait_for(std::chrono::milliseconds(100)),
+              std::future_status::timeout);
+
+    release.set_value();
+    EXPECT_EQ(blocked.wait_for(std::chrono::seconds(5)), std::future_status::ready);
+    const auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+    while (ran.load() < 3 && std::chrono::steady_clock::now() < deadline)
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    EXPECT_EQ(ran.load(), 3);
+}
+
+// Opt-in benchmark (see README); prints the numbers, asserts nothing
+// about speed.  Three runs: the previous path (fstream seek +
+// write + flush per chunk, never synced, then a full re-read to hash),
+// PartialFile without syncing (same durability as before), and
+// PartialFile with the batched fdatasync FileTransferManager does.  The
+// file here is still in the page cache when the old path re-reads it, so
+// the saved read pass is the cheapest case; on a file that was evicted
+// it's a second trip to storage.
+TEST(PartialFile, DISABLED_BenchmarkReceiveWriteAndVerify) {
+    const int64_t cb = FileTransferManager::kChunkBytes;
+    const Bytes file = randomBytes(32 * 1024 * 1024);
+    const Bytes want = FileTransferManager::blake2b256(file);
+    const int total = FileTransferManager::chunkCountFor(int64_t(file.size()), cb);
+    std::vector<Bytes> chunks;
+    for (int i = 0; i < total; ++i) chunks.push_back(chunkOf(file, cb, i));
+    using Clock = std::chrono::steady_clock;
+
+    const std::string oldPath = makeTempPath("p2p-pf-bench-old", ".partial");
+    const auto t0 = Clock::now();
+    {
+        std::fstream f(oldPath, std::ios::in | std::ios::out | std::ios::binary |
+                                std::ios::trunc);
+        for (int i = 0; i < total; ++i) {
+            f.seekp(std::streamoff(int64_t(i) * cb));
+            f.write(reinterpret_cast<const char*>(chunks[size_t(i)].data()),
+                    std::streamsize(chunks[size_t(i)].size()));
+            f.flush();
+        }
+        f.close();
+        EXPECT_EQ(FileTransferManager::blake2b256File(oldPath), want);
+    }
+    const auto t1 = Clock::now();
+
+    auto runPartial = [&](const char* tag, bool batchedSync) {
+        const std::string path = makeTempPath(tag, ".partial");
+        {
+            ChunkWriterPool pool;
+            auto pf = PartialFile::create(path, int64_t(file.size()), cb, &pool);
+            ASSERT_NE(pf, nullptr);
+            for (int i = 0; i < total; ++i) {
+                ASSERT_TRUE(pf->writeChunk(i, chunks[size_t(i)]));
+                if (batchedSync && (i + 1) % FileTransferManager::kProgressSyncChunks == 0) {
+                    ASSERT_TRUE(pf->sync());
+                }
+            }
+            if (batchedSync) {
+                ASSERT_TRUE(pf->sync());
+            }
+            EXPECT_EQ(pf->finishHash(), want);
+            EXPECT_EQ(pf->rereadBytes(), 0);
+        }
+        fs::remove(path);
+    };
+    runPartial("p2p-pf-bench-nosync", false);
+    const auto t2 = Clock::now();
+    runPartial("p2p-pf-bench-sync", true);
+    const auto t3 = Clock::now();
+
+    auto ms = [](Clock::duration d) {
+        return static_cast<long long>(
+            std::chrono::duration_cast<std::chrono::milliseconds>(d).count());
+    };
+    std::printf("[bench] receive + verify 32 MB in %lld KB chunks: "
+                "fstream + re-read %lld ms, PartialFile %lld ms, "
+                "PartialFile + batched fdatasync %lld ms\n",
+                static_cast<long long>(cb / 1024),
+                ms(t1 - t0), ms(t2 - t1), ms(t3 - t2));
+
+    fs::remove(oldPath);
+}
@@ -0,0 +1,345 @@
+// test_payload_codec.cpp — unit tests for PayloadCodec.
+//
+// PayloadCodec owns the plaintext that goes into SessionSealer: legacy
+// JSON (with the "pcv" capability advertised), the compact CBOR form,
+// or either one deflated, for peers that have shown they can read it.
+// Dispatchers only ever see the decoded json, so the invariant pinned
+// here is that every form decodes to the same object the sender built.
+//
+// Scope: codec only.  The per-peer negotiation and the bucket check
+// that decides whether to compress live in ChatController and are
+// exercised end-to-end by test_e2e_two_clients, where the second and
+// later messages between two clients travel compact and a mid-sized
+// avatar drops a padding bucket.
+
+#include "types.hpp"
+#include "CryptoEngine.hpp"
+#include "PayloadCodec.hpp"
+#include "uuid.hpp"
+
+#include <gtest/gtest.h>
+
+#include <sodium.h>
+
+#include <string>
+
+using json = nlohmann::json;
+
+namespace {
+
+Bytes randomBytes(size_t n)
+{
+    Bytes b(n);
+    randombytes_buf(b.data(), b.size());
+    return b;
+}
+
+// Shaped like a v2 group_msg: ids, hashes and counters — the fields
+// the compact form is meant to shrink.
+json sampleGroupMsg()
+{
+    json p = json::object();
+    p["type"]       = "group_msg";
+    p["from"]       = CryptoEngine::toBase64Url(randomBytes(32));
+    p["groupId"]    = p2p::makeUuid();
+    p["msgId"]      = p2p::makeUuid();
+    p["ts"]         = int64_t(1767225600);
+    p["pv"]         = 2;
+    p["ctr"]        = 41;
+    p["prev"]       = CryptoEngine::toBase64Url(randomBytes(32));
+    p["skey_epoch"] = 3;
+    p["skey_idx"]   = 17;
+    p["ciphertext"] = CryptoEngine::toBase64Url(randomBytes(120));
+    json members = json::array();
+    for (int i = 0; i < 4; ++i)
+        members.push_back(CryptoEngine::toBase64Url(randomBytes(32)));
+    p["members"] = members;
+    return p;
+}
+
+}  // namespace
+
+TEST(PayloadCodec, JsonFormAdvertisesCapabilityAndRoundTrips)
+{
+    ASSERT_GE(sodium_init(), 0);
+    const json p = sampleGroupMsg();
+
+    const Bytes enc = PayloadCodec::encode(p, /*compact=*/false);
+    ASSERT_FALSE(enc.empty());
+    EXPECT_EQ(enc[0], '{');
+    EXPECT_FALSE(PayloadCodec::isCompact(enc.data(), enc.size()));
+
+    json dec = PayloadCodec::decode(enc);
+    ASSERT_TRUE(dec.is_object());
+    EXPECT_TRUE(PayloadCodec::advertisesCompact(dec, false));
+    dec.erase(PayloadCodec::kCapabilityField);
+    EXPECT_EQ(dec, p);
+}
+
+TEST(PayloadCodec, CompactFormRoundTripsAndIsSmaller)
+{
+    ASSERT_GE(sodium_init(), 0);
+    const json p = sampleGroupMsg();
+
+    const Bytes compact = PayloadCodec::encode(p, /*compact=*/true);
+    const std::string legacy = p.dump();
+    ASSERT_FALSE(compact.empty());
+    EXPECT_EQ(compact[0], PayloadCodec::kCompactVersion);
+    EXPECT_TRUE(PayloadCodec::isCompact(compact.data(), compact.size()));
+    // Binary keys/hashes + packed UUIDs + the type code: comfortably
+    // under 80% of the JSON it replaces.
+    EXPECT_LT(compact.size() * 5, legacy.size() * 4)
+        << "compact=" << compact.size() << " json=" << legacy.size();
+
+    const json dec = PayloadCodec::decode(compact);
+    ASSERT_TRUE(dec.is_object());
+    EXPECT_EQ(dec, p);
+    EXPECT_TRUE(PayloadCodec::advertisesCompact(dec, true));
+}
+
+TEST(PayloadCodec, NonCanonicalFieldsSurviveAsText)
+{
+    ASSERT_GE(sodium_init(), 0);
+    // Values in binary-eligible fields that don't round-trip exactly
+    // must come back byte-identical, not "normalised".
+    json p = json::object();
+    p["type"]       = "file_cancel";
+    p["from"]       = "not base64url!";
+    p["transferId"] = "ABCDEF01-2345-4678-9ABC-DEF012345678";   // uppercase
+    p["msgId"]      = "short-id";
+    p["session"]    = "";
+    p["text"]       = CryptoEngine::toBase64Url(randomBytes(32));  // not an id field
+
+    const json dec = PayloadCodec::decode(PayloadCodec::encode(p, true));
+    ASSERT_TRUE(dec.is_object());
+    EXPECT_EQ(dec, p);
+}
+
+TEST(PayloadCodec, UnknownTypeStringPassesThrough)
+{
+    ASSERT_GE(sodium_init(), 0);
+    json p = json::object();
+    p["type"] = "some_future_type";
+    p["from"] = CryptoEngine::toBase64Url(randomBytes(32));
+
+    const json dec = PayloadCodec::decode(PayloadCodec::encode(p, true));
+    ASSERT_TRUE(dec.is_object());
+    EXPECT_EQ(dec.value("type", std::string()), "some_future_type");
+}
+
+TEST(PayloadCodec, MalformedInputIsRejected)
+{
+    ASSERT_GE(sodium_init(), 0);
+    const Bytes good = PayloadCodec::encode(sampleGroupMsg(), true);
+
+    // Truncated CBOR.
+    Bytes truncated(good.begin(), good.begin() + good.size() / 2);
+    EXPECT_TRUE(PayloadCodec::decode(truncated).is_discarded());
+
+    // Unknown version byte.
+    Bytes badVersion = good;
+    badVersion[0] = 0x7F;
+    EXPECT_TRUE(PayloadCodec::decode(badVersion).is_discarded());
+
+    // Empty + non-object JSON.
+    EXPECT_TRUE(PayloadCodec::decode(Bytes{}).is_discarded());
+    const std::string arr = "[1,2,3]";
+    EXPECT_TRUE(PayloadCodec::decode(Bytes(arr.begin(), arr.end())).is_discarded());
+
+    // Type code outside the table.
+    json bogus = json::object();
+    bogus["type"] = 250;
+    Bytes bogusEnc{PayloadCodec::kCompactVersion};
+    json::to_cbor(bogus, bogusEnc);
+    EXPECT_TRUE(PayloadCodec::decode(bogusEnc).is_discarded());
+}
+
+TEST(PayloadCodec, NonObjectPayloadIsNotEncoded)
+{
+    EXPECT_TRUE(PayloadCodec::encode(json::array({1, 2}), false).empty());
+    EXPECT_TRUE(PayloadCodec::encode(json("text"), true).empty());
+}
+
+// ── Compressed form ──────────────────────────────────────────────────────
+
+namespace {
+
+// Standard base64, as the avatar paths carry it.
+std::string base64(const Bytes& b)
+{
+    std::string s(sodium_base64_encoded_len(b.size(), sodium_base64_VARIANT_ORIGINAL), '\0');
+    sodium_bin2base64(s.data(), s.size(), b.data(), b.size(),
+                      sodium_base64_VARIANT_ORIGINAL);
+    s.resize(s.size() - 1);  // drop the terminator
+    return s;
+}
+
+json iceOffer()
+{
+    std::string sdp =
+        "v=0\r\no=- 4611731400430051336 2 IN IP4 127.0.0.1\r\ns=-\r\nt=0 0\r\n"
+        "a=ice-ufrag:Yk3q\r\na=ice-pwd:9cJq2l1uK5mQfXhZpV0rT8sW\r\n";
+    const char* const cands[] = {
+        "a=candidate:1 1 UDP 2015363327 192.168.1.23 51234 typ host\r\n",
+        "a=candidate:2 1 UDP 2015363071 10.8.0.4 40112 typ host\r\n",
+        "a=candidate:3 1 UDP 1679819007 198.51.100.41 51234 typ srflx raddr 192.168.1.23 rport 51234\r\n",
+        "a=candidate:4 1 UDP 8331263 203.0.113.200 3478 typ relay raddr 198.51.100.41 rport 51234\r\n",
+    };
+    for (const char* c : cands) sdp += c;
+    json p = json::object();
+    p["type"] = "ice_offer";
+    p["sdp"]  = sdp;
+    p["quic"] = true;
+    p["quic_fingerprint"] = CryptoEngine::toBase64Url(randomBytes(32));
+    return p;
+}
+
+json textMsg(const std::string& text)
+{
+    json p = json::object();
+    p["type"]  = "text";
+    p["from"]  = CryptoEngine::toBase64Url(randomBytes(32));
+    p["msgId"] = p2p::makeUuid();
+    p["ts"]    = int64_t(1767225600);
+    p["text"]  = text;
+    return p;
+}
+
+}  // namespace
+
+TEST(PayloadCodec, CompressedFormWrapsEitherInnerForm)
+{
+    ASSERT_GE(sodium_init(), 0);
+    const json p = iceOffer();
+
+    for (bool compact : {false, true}) {
+        const Bytes inner = PayloadCodec::encode(p, compact);
+        const Bytes packed = PayloadCodec::compress(inner);
+        ASSERT_FALSE(packed.empty()) << "compact=" << compact;
+        EXPECT_TRUE(PayloadCodec::isCompressed(packed.data(), packed.size()));
+        EXPECT_LT(packed.size(), inner.size());
+
+        json dec = PayloadCodec::decode(packed);
+        ASSERT_TRUE(dec.is_object()) << "compact=" << compact;
+        EXPECT_EQ(PayloadCodec::advertisedLevel(dec, packed[0]),
+                  PayloadCodec::kCompressedVersion);
+        dec.erase(PayloadCodec::kCapabilityField);
+        EXPECT_EQ(dec, p);
+    }
+}
+
+TEST(PayloadCodec, CompressRefusesWhenItDoesNotShrink)
+{
+    ASSERT_GE(sodium_init(), 0);
+    // High-entropy payload barely longer than the framing: nothing to win.
+    const Bytes noise = randomBytes(24);
+    EXPECT_TRUE(PayloadCodec::compress(noise).empty());
+    EXPECT_TRUE(PayloadCodec::compress(Bytes{}).empty());
+
+    // Never nests.
+    const Bytes packed = PayloadCodec::compress(PayloadCodec::encode(iceOffer(), true));
+    ASSERT_FALSE(packed.empty());
+    EXPECT_TRUE(PayloadCodec::compress(packed).empty());
+}
+
+TEST(PayloadCodec, MalformedCompressedInputIsRejected)
+{
+    ASSERT_GE(sodium_init(), 0);
+    const Bytes good = PayloadCodec::compress(PayloadCodec::encode(iceOffer(), true));
+    ASSERT_FALSE(good.empty());
+    ASSERT_TRUE(PayloadCodec::decode(good).is_object());
+
+    Bytes unknownDict = good;
+    unknownDict[1] = 0x7E;
+    EXPECT_TRUE(PayloadCodec::decode(unknownDict).is_discarded());
+
+    // Stated length disagrees with what the stream inflates to.
+    Bytes wrongLen = good;
+    wrongLen[5] ^= 0x01;
+    EXPECT_TRUE(PayloadCodec::decode(wrongLen).is_discarded());
+
+    // Stated length above the decompression bound.
+    Bytes huge = good;
+    huge[2] = 0x7F;
+    EXPECT_TRUE(PayloadCodec::decode(huge).is_discarded());
+
+    Bytes truncated(good.begin(), good.begin() + good.size() / 2);
+    EXPECT_TRUE(PayloadCodec::decode(truncated).is_discarded());
+
+    // Trailing bytes after the deflate stream.
+    Bytes trailing = good;
+    trailing.push_back(0x00);
+    EXPECT_TRUE(PayloadCodec::decode(trailing).is_discarded());
+}
+
+TEST(PayloadCodec, AdvertisedLevelTakesHigherOfStampAndForm)
+{
+    json p = json::object();
+    p["type"] = "text";
+    EXPECT_EQ(PayloadCodec::advertisedLevel(p, '{'), 0);
+    EXPECT_EQ(PayloadCodec::advertisedLevel(p, PayloadCodec::kCompactVersion), 1);
+    EXPECT_EQ(PayloadCodec::advertisedLevel(p, PayloadCodec::kCompressedVersion), 2);
+
+    p[PayloadCodec::kCapabilityField] = 1;   // pre-compression client
+    EXPECT_EQ(PayloadCodec::advertisedLevel(p, '{'), 1);
+    p[PayloadCodec::kCapabilityField] = 2;
+    EXPECT_EQ(PayloadCodec::advertisedLevel(p, PayloadCodec::kCompactVersion), 2);
+    p[PayloadCodec::kCapabilityField] = 9;   // newer than us: clamp
+    EXPECT_EQ(PayloadCodec::advertisedLevel(p, '{'), PayloadCodec::kCodecLevel);
+}
+
+TEST(PayloadCodec, CorpusCompressionRatios)
+{
+    // Realistic corpus: the payload shapes that dominate traffic.  The
+    // ratios are what decide whether compression can move a payload to
+    // a smaller padding bucket; ChatController only compresses when it
+    // does (see test_e2e_two_clients for the bucket itself).
+    ASSERT_GE(sodium_init(), 0);
+
+    struct Case { const char* name; json payload; double maxRatio; };
+    const std::string chatty =
+        "Hey! Are we still on for dinner tonight? I was thinking the place "
+        "on 5th street around 7:30, unless you'd rather go somewhere closer "
+        "to the office. Let me know and I'll book a table for the four of us.";
+    std::string longText;
+    for (int i = 0; i < 12; ++i) longText += chatty + " ";
+
+    json roster = sampleGroupMsg();
+    json members = json::array();
+    for (int i = 0; i < 40; ++i)
+        members.push_back(CryptoEngine::toBase64Url(randomBytes(32)));
+    roster["type"]      = "group_member_update";
+    roster["groupName"] = "Weekend hiking crew";
+    roster["members"]   = members;
+
+    json avatar = json::object();
+    avatar["type"]   = "avatar";
+    avatar["from"]   = CryptoEngine::toBase64Url(randomBytes(32));
+    avatar["name"]   = "Alice";
+    avatar["avatar"] = base64(randomBytes(12000));  // JPEG bytes ~ random
+
+    const Case corpus[] = {
+        // SDP text: most of it is in the dictionary.
+        { "ice_offer",  iceOffer(),       0.60 },
+        // Natural-language text.
+        { "long_text",  textMsg(longText), 0.45 },
+        // Roster: keys already binary in compact form; little to win.
+        { "roster",     roster,           1.00 },
+        // Base64 of incompressible bytes: deflate recovers the 6-of-8 bits.
+        { "avatar",     avatar,           0.80 },
+    };
+
+    for (const Case& c : corpus) {
+        const Bytes inner  = PayloadCodec::encode(c.payload, /*compact=*/true);
+        const Bytes packed = PayloadCodec::compress(inner);
+        const size_t out = packed.empty() ? inner.size() : packed.size();
+        const double ratio = double(out) / double(inner.size());
+        EXPECT_LE(ratio, c.maxRatio) << c.name << ": " << inner.size()
+                                     << " -> " << out;
+        if (!packed.empty()) {
+            json dec = PayloadCodec::decode(packed);
+            ASSERT_TRUE(dec.is_object()) << c.name;
+            EXPECT_EQ(dec, c.payload) << c.name;
+        }
+    }
+}
@@ -16,6 +16,10 @@
 //   - State serialization survives a DB round-trip.
 //   - `lastMessageKey()` changes every encrypt — the symmetric chain
 //     actually advances instead of producing a static per-session key.
+//   - Hybrid KEM cadence: KEM fields only ride on the chains that need
+//     them, and a KEM step lands within the configured bound.
+//   - A pre-cadence peer's KEM chains (older root-key mixing) still
+//     decrypt, scripted from the public primitives.
 //
 // Test keypairs come from libsodium / CryptoEngine directly; the ratchet
 // doesn't care who produced them.  rootKey is a random 32-byte buffer
@@ -28,6 +32,7 @@
 
 #include <sodium.h>
 
+#include <algorithm>
 #include <cstring>
 #include <string>
 #include <vector>
@@ -459,3 +464,388 @@ TEST(RatchetSession, SessionIdEmptyOnLegacyV2DeserializedSession) {
         << "the v2 group sender's missing-deps fallback kicks in "
         << "rather than emitting wire-format pv=2 with junk session";
 }
+
+// ── KEM ratchet cadence (hybrid) ────────────────────────────────────────
+// Hybrid headers carry KEM material only when there's something to say:
+// our KEM pub until the peer acks it, and the ciphertext on chains that
+// performed a KEM step.  With a cadence of N, a KEM step lands on at
+// most every Nth DH step — that's the post-quantum PCS bound these tests
+// pin — and everything in between stays small enough for the smallest
+// padding bucket.
+
+namespace {
+
+RatchetHeader headerOf(const Bytes& wire) {
+    size_t n = 0;
+    return RatchetHeader::deserialize(wire, n, /*hybrid=*/true);
+}
+
+// A hybrid pair once each side has seen the other advertise "khv":
+// flagged headers from the first message on.
+Pair makeFlaggedPair() {
+    Pair p = makePair(/*hybrid=*/true);
+    p.initiator.notePeerKemHeader(RatchetSession::kKemHeaderVersion);
+    p.responder.notePeerKemHeader(RatchetSession::kKemHeaderVersion);
+    return p;
+}
+
+// Alternating bursts of 1-3 short messages, the shape of ordinary chat.
+// Returns every ciphertext Alice (initiator) produced, in order.
+std::vector<Bytes> chatTraffic(Pair& p, int turns, int* failures) {
+    std::vector<Bytes> fromAlice;
+    uint32_t lcg = 12345;
+    const Bytes pt(120, 'x');
+    for (int turn = 0; turn < turns; ++turn) {
+        lcg = lcg * 1103515245u + 12345u;
+        const int burst = 1 + static_cast<int>((lcg >> 16) % 3);
+        RatchetSession& tx = (turn % 2 == 0) ? p.initiator : p.responder;
+        RatchetSession& rx = (turn % 2 == 0) ? p.responder : p.initiator;
+        for (int k = 0; k < burst; ++k) {
+            const Bytes wire = tx.encrypt(pt);
+            if (rx.decrypt(wire) != pt) ++*failures;
+            if (&tx == &p.initiator) fromAlice.push_back(wire);
+        }
+    }
+    return fromAlice;
+}
+
+}  // namespace
+
+TEST(RatchetSession, HybridMultiRoundExchangeStaysInSync) {
+    // Both sides' KEM material has to line up across many DH steps,
+    // not just the first message — in either header layout.
+    for (bool flagged : {false, true}) {
+        auto p = flagged ? makeFlaggedPair() : makePair(/*hybrid=*/true);
+        for (int i = 0; i < 8; ++i) {
+            const Bytes ping = bytesOf(("A " + std::to_string(i)).c_str());
+            const Bytes pong = bytesOf(("B " + std::to_string(i)).c_str());
+            ASSERT_EQ(p.responder.decrypt(p.initiator.encrypt(ping)), ping)
+                << "round " << i << " flagged " << flagged;
+            ASSERT_EQ(p.initiator.decrypt(p.responder.encrypt(pong)), pong)
+                << "round " << i << " flagged " << flagged;
+        }
+    }
+}
+
+TEST(RatchetSession, HybridSendsPreCadenceHeaderUntilPeerReadsFlags) {
+    // A pre-cadence client can't parse the flagged layout, so nobody
+    // gets it until it has shown it reads it.
+    auto p = makePair(/*hybrid=*/true);
+    const Bytes a0 = p.initiator.encrypt(bytesOf("a0"));
+    EXPECT_TRUE(headerOf(a0).legacyPq);
+    EXPECT_EQ(headerOf(a0).kemPub.size(), 1184u) << "pre-cadence parsers need the pub";
+    ASSERT_EQ(p.responder.decrypt(a0), bytesOf("a0"));
+    EXPECT_FALSE(p.responder.peerReadsKemFlags());
+
+    // Bob learns Alice's "khv" (app payload) and switches; Alice latches
+    // on the first flagged header she decrypts.
+    p.responder.notePeerKemHeader(RatchetSession::kKemHeaderVersion);
+    const Bytes b0 = p.responder.encrypt(bytesOf("b0"));
+    EXPECT_TRUE(headerOf(b0).pq);
+    EXPECT_FALSE(headerOf(b0).legacyPq);
+    ASSERT_EQ(p.initiator.decrypt(b0), bytesOf("b0"));
+    EXPECT_TRUE(p.initiator.peerReadsKemFlags());
+
+    // The latch survives persistence.
+    RatchetSession alice = RatchetSession::deserialize(p.initiator.serialize());
+    ASSERT_TRUE(alice.isValid());
+    const Bytes a1 = alice.encrypt(bytesOf("a1"));
+    EXPECT_TRUE(headerOf(a1).pq);
+    EXPECT_EQ(p.responder.decrypt(a1), bytesOf("a1"));
+
+    // An older advertisement changes nothing.
+    auto q = makePair(/*hybrid=*/true);
+    q.initiator.notePeerKemHeader(0);
+    EXPECT_FALSE(q.initiator.peerReadsKemFlags());
+}
+
+// Pre-cadence clients mixed the KEM secret of a step into the root key,
+// HKDF(ss, root, "ratchet-kem"), before their sending-chain KDF; their
+// receiving side already used KDF(root, DH || ss).  These helpers replay
+// that derivation so a test can script one side of such a peer.
+namespace {
+
+std::pair<Bytes, Bytes> rootKdf(const Bytes& root, const Bytes& input) {
+    unsigned char out[64];
+    crypto_generichash(out, sizeof(out), input.data(), input.size(),
+                       root.data(), root.size());
+    return {Bytes(out, out + 32), Bytes(out + 32, out + 64)};
+}
+
+Bytes dh(const Bytes& priv, const Bytes& pub) {
+    Bytes out(crypto_scalarmult_BYTES);
+    EXPECT_EQ(crypto_scalarmult(out.data(), priv.data(), pub.data()), 0);
+    return out;
+}
+
+// First message key of a chain.
+Bytes firstMessageKey(const Bytes& chainKey) {
+    Bytes mk(32);
+    const unsigned char two = 0x02;
+    crypto_generichash(mk.data(), mk.size(), &two, 1,
+                       chainKey.data(), chainKey.size());
+    return mk;
+}
+
+Bytes sealWithHeader(const RatchetHeader& h, const Bytes& mk, const Bytes& pt) {
+    const Bytes hb = h.serialize();
+    Bytes out = hb;
+    Bytes nonce(crypto_aead_xchacha20poly1305_ietf_NPUBBYTES);
+    randombytes_buf(nonce.data(), nonce.size());
+    out.insert(out.end(), nonce.begin(), nonce.end());
+    Bytes ct(pt.size() + crypto_aead_xchacha20poly1305_ietf_ABYTES);
+    unsigned long long clen = 0;
+    crypto_aead_xchacha20poly1305_ietf_encrypt(
+        ct.data(), &clen, pt.data(), pt.size(), hb.data(), hb.size(),
+        nullptr, nonce.data(), mk.data());
+    out.insert(out.end(), ct.begin(), ct.begin() + clen);
+    return out;
+}
+
+Bytes openWithHeader(const Bytes& wire, const Bytes& mk) {
+    size_t hlen = 0;
+    RatchetHeader::deserialize(wire, hlen, /*hybrid=*/true);
+    const size_t npub = crypto_aead_xchacha20poly1305_ietf_NPUBBYTES;
+    if (hlen == 0 || wire.size() < hlen + npub) return {};
+    Bytes pt(wire.size() - hlen - npub);
+    unsigned long long plen = 0;
+    if (crypto_aead_xchacha20poly1305_ietf_decrypt(
+            pt.data(), &plen, nullptr,
+            wire.data() + hlen + npub, wire.size() - hlen - npub,
+            wire.data(), hlen, wire.data() + hlen, mk.data()) != 0)
+        return {};
+    pt.resize(plen);
+    return pt;
+}
+
+}  // namespace
+
+TEST(RatchetSession, HybridReadsPreCadenceSenderKemChain) {
+    const Party alice = makeParty();
+    const Party bob   = makeParty();
+    const Bytes root  = randomRootKey();
+    auto a = RatchetSession::initAsInitiator(root, bob.dhPub, alice.dhPub,
+                                             alice.dhPriv, /*hybrid=*/true);
+    const Bytes a0 = a.encrypt(bytesOf("a0"));
+    const Bytes aliceKemPub = headerOf(a0).kemPub;
+    ASSERT_EQ(aliceKemPub.size(), 1184u);
+
+    // Bob (pre-cadence) takes a DH step that is also a KEM step,
+    // starting from the root his receiving chain left him with.
+    Bytes bobRoot = rootKdf(root, dh(bob.dhPriv, alice.dhPub)).first;
+    const auto [b1Pub, b1Priv] = CryptoEngine::generateEphemeralX25519();
+    const auto [bobKemPub, bobKemPriv] = CryptoEngine::generateKemKeypair();
+    KemEncapsResult enc = CryptoEngine::kemEncaps(aliceKemPub);
+    ASSERT_FALSE(enc.ciphertext.empty());
+    bobRoot = CryptoEngine::hkdf(enc.sharedSecret, bobRoot, bytesOf("ratchet-kem"), 32);
+    const auto [bobRoot2, bobSendChain] = rootKdf(bobRoot, dh(b1Priv, alice.dhPub));
+
+    RatchetHeader h;
+    h.dhPub    = b1Pub;
+    h.kemCt    = enc.ciphertext;
+    h.kemPub   = bobKemPub;
+    h.legacyPq = true;
+    const Bytes b0 = sealWithHeader(h, firstMessageKey(bobSendChain), bytesOf("b0"));
+    ASSERT_EQ(a.decrypt(b0), bytesOf("b0"));
+
+    // Alice's reply is a KEM step to Bob's fresh pub, mixed the way Bob's
+    // receiving side expects — the session stays in sync both ways.
+    const Bytes a1 = a.encrypt(bytesOf("a1"));
+    const RatchetHeader ha1 = headerOf(a1);
+    ASSERT_EQ(ha1.kemCt.size(), 1088u);
+    Bytes mixed = dh(b1Priv, ha1.dhPub);
+    const Bytes ss = CryptoEngine::kemDecaps(ha1.kemCt, bobKemPriv);
+    mixed.insert(mixed.end(), ss.begin(), ss.end());
+    const Bytes bobRecvChain = rootKdf(bobRoot2, mixed).second;
+    EXPECT_EQ(openWithHeader(a1, firstMessageKey(bobRecvChain)), bytesOf("a1"));
+
+    // A forged ciphertext fails both derivations and leaves Alice as she was.
+    RatchetHeader bad = h;
+    bad.dhPub = CryptoEngine::generateEphemeralX25519().first;
+    const Bytes forged = sealWithHeader(bad, firstMessageKey(bobSendChain), bytesOf("x"));
+    const Bytes before = a.serialize();
+    EXPECT_TRUE(a.decrypt(forged).empty());
+    EXPECT_EQ(a.serialize(), before);
+}
+
+TEST(RatchetSession, HybridLostFirstMessageOfKemChainStillDecrypts) {
+    // The ciphertext rides in every message of a KEM chain, so the peer
+    // can decapsulate from whichever one arrives first.
+    auto p = makeFlaggedPair();
+    ASSERT_FALSE(p.responder.decrypt(p.initiator.encrypt(bytesOf("a0"))).empty());
+    ASSERT_FALSE(p.initiator.decrypt(p.responder.encrypt(bytesOf("b0"))).empty());
+
+    const Bytes lost = p.initiator.encrypt(bytesOf("lost"));
+    const Bytes kept = p.initiator.encrypt(bytesOf("kept"));
+    ASSERT_FALSE(headerOf(lost).kemCt.empty());
+    ASSERT_EQ(headerOf(kept).kemCt, headerOf(lost).kemCt);
+
+    EXPECT_EQ(p.responder.decrypt(kept), bytesOf("kept"));
+    EXPECT_EQ(p.responder.decrypt(lost), bytesOf("lost"));
+    EXPECT_EQ(p.initiator.decrypt(p.responder.encrypt(bytesOf("b1"))), bytesOf("b1"));
+}
+
+TEST(RatchetSession, KemCadenceBoundsGapBetweenKemSteps) {
+    for (uint32_t n : {1u, 4u, 8u}) {
+        auto p = makeFlaggedPair();
+        p.initiator.setKemCadence(n);
+        p.responder.setKemCadence(n);
+
+        int failures = 0;
+        const auto fromAlice = chatTraffic(p, 120, &failures);
+        ASSERT_EQ(failures, 0) << "cadence " << n;
+
+        // Walk Alice's sending chains; count the run of chains without
+        // a KEM ciphertext between two that have one.
+        Bytes lastDh;
+        int kemChains = 0, gap = 0, maxGap = 0;
+        for (const Bytes& wire : fromAlice) {
+            const RatchetHeader h = headerOf(wire);
+            if (h.dhPub == lastDh) continue;
+            lastDh = h.dhPub;
+            if (h.kemCt.empty()) { ++gap; continue; }
+            ++kemChains;
+            maxGap = std::max(maxGap, gap);
+            gap = 0;
+        }
+        EXPECT_GT(kemChains, 0) << "cadence " << n;
+        // PCS bound: at most N chains go by without PQ entropy.  (The
+        // very first chain can't carry one — no peer pub yet — which is
+        // why the bound is N rather than N - 1.)
+        EXPECT_LE(maxGap, static_cast<int>(n)) << "cadence " << n;
+    }
+}
+
+TEST(RatchetSession, KemCadenceKeepsMostShortMessagesFreeOfKemFields) {
+    // The distribution the cadence exists for: at N=1 every message
+    // carries >= 1 KB of KEM material; at N=8 most carry none and the
+    // header is the classical 40 bytes plus one flags byte.
+    auto share = [](uint32_t n) {
+        auto p = makeFlaggedPair();
+        p.initiator.setKemCadence(n);
+        p.responder.setKemCadence(n);
+        int failures = 0;
+        const auto fromAlice = chatTraffic(p, 200, &failures);
+        EXPECT_EQ(failures, 0);
+        size_t bare = 0;
+        for (const Bytes& wire : fromAlice) {
+            const RatchetHeader h = headerOf(wire);
+            if (h.kemPub.empty() && h.kemCt.empty()) {
+                EXPECT_EQ(h.serialize().size(),
+                          static_cast<size_t>(RatchetHeader::kClassicalSize) + 1);
+                ++bare;
+            }
+        }
+        return double(bare) / double(fromAlice.size());
+    };
+
+    EXPECT_LT(share(1), 0.05);
+    EXPECT_GT(share(8), 0.70);
+}
+
+TEST(RatchetSession, KemCadenceIntervalForcesStepWhenStepsNotDue) {
+    // Step trigger off, time trigger on and already elapsed (the last
+    // KEM step is "never"): the first DH step with a fresh peer pub is
+    // a KEM step.
+    auto p = makeFlaggedPair();
+    p.initiator.setKemCadence(0, 3600);
+    p.responder.setKemCadence(0, 3600);
+    EXPECT_EQ(p.initiator.kemEveryDhSteps(), 0u);
+    EXPECT_EQ(p.initiator.kemMaxIntervalSecs(), 3600);
+
+    ASSERT_FALSE(p.responder.decrypt(p.initiator.encrypt(bytesOf("a0"))).empty());
+    ASSERT_FALSE(p.initiator.decrypt(p.responder.encrypt(bytesOf("b0"))).empty());
+    const Bytes a1 = p.initiator.encrypt(bytesOf("a1"));
+    EXPECT_FALSE(headerOf(a1).kemCt.empty());
+    ASSERT_FALSE(p.responder.decrypt(a1).empty());
+
+    // Within the hour no further KEM step happens.
+    for (int i = 0; i < 4; ++i) {
+        ASSERT_FALSE(p.initiator.decrypt(p.responder.encrypt(bytesOf("b"))).empty());
+        const Bytes a = p.initiator.encrypt(bytesOf("a"));
+        EXPECT_TRUE(headerOf(a).kemCt.empty());
+        ASSERT_FALSE(p.responder.decrypt(a).empty());
+    }
+
+    // Zero for both triggers falls back to every DH step.
+    p.initiator.setKemCadence(0, 0);
+    EXPECT_EQ(p.initiator.kemEveryDhSteps(), 1u);
+}
+
+TEST(RatchetSession, HeaderFlagsRoundTripAndRejectUnknownBits) {
+    RatchetHeader h;
+    h.dhPub.assign(32, 0xAB);
+    h.prevChainLen = 7;
+    h.messageNum   = 3;
+    h.pq = true;
+    h.kemCt.assign(1088, 0x11);
+    h.holdsPeerKemPub = true;
+
+    const Bytes wire = h.serialize();
+    ASSERT_EQ(wire.size(), 40u + 1u + 1088u);
+    EXPECT_EQ(wire[40], RatchetHeader::kFlagMarker | RatchetHeader::kFlagKemCt
+                        | RatchetHeader::kFlagHoldsKemPub);
+
+    size_t n = 0;
+    const RatchetHeader back = RatchetHeader::deserialize(wire, n, true);
+    EXPECT_EQ(n, wire.size());
+    EXPECT_EQ(back.kemCt, h.kemCt);
+    EXPECT_TRUE(back.kemPub.empty());
+    EXPECT_TRUE(back.holdsPeerKemPub);
+    EXPECT_EQ(back.serialize(), wire);
+
+    // Classical sessions never look past the first 40 bytes.
+    RatchetHeader::deserialize(wire, n, /*hybrid=*/false);
+    EXPECT_EQ(n, 40u);
+
+    Bytes bad = wire;
+    bad[40] |= 0x40;
+    RatchetHeader::deserialize(bad, n, true);
+    EXPECT_EQ(n, 0u);
+
+    // Flag promises a ciphertext the buffer doesn't hold.
+    Bytes shortCt(wire.begin(), wire.begin() + 41 + 100);
+    RatchetHeader::deserialize(shortCt, n, true);
+    EXPECT_EQ(n, 0u);
+}
+
+TEST(RatchetSession, LegacyPqHeaderLayoutStillParses) {
+    // Pre-cadence peers wrote ctLen(2) + kemCt + kemPub.  The parse must
+    // recognise it and serialize() must reproduce the bytes, since the
+    // header is the AEAD associated data.
+    Bytes wire(32, 0xCD);
+    for (int i = 0; i < 8; ++i) wire.push_back(0);
+    wire.push_back(0x04); wire.push_back(0x40);      // ctLen = 1088
+    wire.insert(wire.end(), 1088, 0x22);
+    wire.insert(wire.end(), 1184, 0x33);
+
+    size_t n = 0;
+    const RatchetHeader h = RatchetHeader::deserialize(wire, n, true);
+    EXPECT_EQ(n, wire.size());
+    EXPECT_TRUE(h.legacyPq);
+    EXPECT_EQ(h.kemCt.size(), 1088u);
+    EXPECT_EQ(h.kemPub.size(), 1184u);
+    EXPECT_EQ(h.serialize(), wire);
+}
+
+TEST(RatchetSession, KemCadenceStateSurvivesSerializeRoundTrip) {
+    auto p = makeFlaggedPair();
+    p.initiator.setKemCadence(3);
+    p.responder.setKemCadence(3);
+    int failures = 0;
+    chatTraffic(p, 11, &failures);
+    ASSERT_EQ(failures, 0);
+
+    // Cadence itself is configuration, re-applied by the owner on load;
+    // the in-flight KEM state has to survive so the chains stay aligned.
+    RatchetSession alice = RatchetSession::deserialize(p.initiator.serialize());
+    RatchetSession bob   = RatchetSession::deserialize(p.responder.serialize());
+    ASSERT_TRUE(alice.isValid());
+    ASSERT_TRUE(bob.isValid());
+    alice.setKemCadence(3);
+    bob.setKemCadence(3);
+
+    Pair reloaded{std::move(alice), std::move(bob)};
+    chatTraffic(reloaded, 30, &failures);
+    EXPECT_EQ(failures, 0);
+}
@@ -24,6 +24,7 @@
 #include "IHttpClient.hpp"
 #include "ITimer.hpp"
 #include "IWebSocket.hpp"
+#include "SealedEnvelope.hpp"
 #include "test_support.hpp"
 
 #include <gtest/gtest.h>
@@ -31,13 +32,16 @@
 #include <sodium.h>
 #include <nlohmann/json.hpp>
 
+#include <algorithm>
 #include <cstdio>
 #include <cstring>
 #include <deque>
 #include <filesystem>
 #include <functional>
+#include <map>
 #include <memory>
 #include <string>
+#include <utility>
 #include <vector>
 
 namespace fs = std::filesystem;
@@ -111,10 +115,64 @@ public:
     struct Post { std::string url; Bytes body; };
     std::vector<Post> posts;
 
+    // Host substring → HTTP status to fail with.  Lets the relay-health
+    // tests make one relay misbehave while the rest answer 200.
+    std::map<std::string, int> failStatusByHost;
+
+    // /v1/send-batch behaviour.  batchSupported=false answers 404 like a
+    // relay that predates the endpoint; batchStatuses (if non-empty)
+    // gives per-envelope result statuses, otherwise every envelope 200s.
+    bool             batchSupported = true;
+    std::vector<int> batchStatuses;
+
+    // When set, responses are parked in `deferred` until completeNext()
+    // answers them (oldest first) — lets the scheduler tests keep
+    // requests in flight.
+    bool deferResponses = false;
+    std::deque<std::pair<Callback, Response>> deferred;
+
+    bool completeNext() {
+        if (deferred.empty()) return false;
+        auto [cb, r] = std::move(deferred.front());
+        deferred.pop_front();
+        cb(r);
+        return true;
+    }
+
     void post(const std::string& url, const Bytes& body,
               const Headers& /*headers*/, Callback cb) override {
         posts.push_back({url, body});
         Response r; r.status = 200;
+        for (const auto& [host, status] : failStatusByHost) {
+            if (url.find(host) == std::string::npos) continue;
+            r.status = status;
+            r.error  = "HTTP " + std::to_string(status);
+        }
+        if (r.error.empty() && url.find("/v1/send-batch") != std::string::npos) {
+            if (!batchSupported) {
+                r.status = 404;
+                r.error  = "HTTP 404";
+            } else {
+                nlohmann::json results = nlohmann::json::array();
+                size_t i = 0;
+                for (size_t off = 0; off + 4 <= body.size(); ++i) {
+                    const size_t n = (size_t(body[off]) << 24) | (size_t(body[off + 1]) << 16)
+                                   | (size_t(body[off + 2]) << 8) | size_t(body[off + 3]);
+                    off += 4 + n;
+                    nlohmann::json e;
+                    e["status"] = i < batchStatuses.size() ? batchStatuses[i] : 200;
+                    results.push_back(e);
+                }
+                nlohmann::json doc;
+                doc["results"] = results;
+                const std::string js = doc.dump();
+                r.body.assign(js.begin(), js.end());
+            }
+        }
+        if (deferResponses) {
+            deferred.emplace_back(std::move(cb), std::move(r));
+            return;
+        }
         cb(r);
     }
     void get(const std::string& /*url*/, const Headers& /*headers*/,
@@ -156,6 +214,15 @@ public:
         if (onTextMessage) onTextMessage(r.dump());
     }
 
+    std::vector<Bytes> sentBinaries;     // captures outbound binary frames
+    bool               binarySupported = true;
+
+    bool sendBinaryMessage(const Bytes& data) override {
+        if (!binarySupported) return false;
+        sentBinaries.push_back(data);
+        return true;
+    }
+
 private:
     bool m_connected = false;
     bool m_authReplied = false;
@@ -844,3 +911,867 @@ TEST(MultiSubscribe, RejectsNonTlsSubscribeUrl) {
 
     fs::remove_all(r.dataDir);
 }
+
+// ── Relay health scoring ────────────────────────────────────────────────────
+//
+// Per-relay EWMA of latency / error rate / 429 rate drives weighted
+// relay selection; consecutive failures eject a relay until its probe
+// timer re-admits it.  These tests pin the ejection + probe lifecycle
+// and the stats surface.  Latency weighting isn't exercised here —
+// the mock HTTP client answers synchronously, so every sample is ~0ms.
+
+namespace {
+
+size_t countSendPostsTo(const std::vector<CapturingHttpClient::Post>& posts,
+                        const std::string& host) {
+    size_t n = 0;
+    for (const auto& p : posts) {
+        if (p.url.find("/v1/send") != std::string::npos &&
+            p.url.find(host) != std::string::npos) ++n;
+    }
+    return n;
+}
+
+const RelayClient::RelayHealthStats* findStats(
+        const std::vector<RelayClient::RelayHealthStats>& all,
+        const std::string& url) {
+    for (const auto& s : all) if (s.url == url) return &s;
+    return nullptr;
+}
+
+}  // namespace
+
+TEST(RelayHealth, FailingRelayIsEjectedAndStopsReceivingTraffic) {
+    ASSERT_GE(sodium_init(), 0);
+
+    auto r = primeRelay({"https://r1.test", "https://r2.test"});
+    r.http->failStatusByHost["r1.test"] = 503;
+
+    // Drive sends until r1 has failed kEjectAfterFailures times in a row.
+    for (int i = 0; i < 200 && countSendPostsTo(r.http->posts, "r1.test") < 3; ++i)
+        r.relay->sendEnvelope(makeFakeEnvelope(uint8_t(i)));
+    ASSERT_EQ(countSendPostsTo(r.http->posts, "r1.test"), 3u);
+
+    const auto stats = r.relay->relayHealthStats();
+    const auto* s1 = findStats(stats, "https://r1.test");
+    ASSERT_NE(s1, nullptr);
+    EXPECT_TRUE(s1->ejected);
+    EXPECT_EQ(s1->failed, 3u);
+    EXPECT_GT(s1->errorRate, 0.0);
+    EXPECT_EQ(s1->weight, 0.0);
+
+    // While ejected, every send lands on r2.
+    r.http->posts.clear();
+    for (int i = 0; i < 30; ++i) r.relay->sendEnvelope(makeFakeEnvelope(0x40));
+    EXPECT_EQ(countSendPostsTo(r.http->posts, "r1.test"), 0u);
+    EXPECT_EQ(countSendPostsTo(r.http->posts, "r2.test"), 30u);
+
+    fs::remove_all(r.dataDir);
+}
+
+TEST(RelayHealth, EjectedRelayIsProbedBackInAfterTimer) {
+    ASSERT_GE(sodium_init(), 0);
+
+    auto r = primeRelay({"https://r1.test", "https://r2.test"});
+    r.http->failStatusByHost["r1.test"] = 500;
+    for (int i = 0; i < 200 && countSendPostsTo(r.http->posts, "r1.test") < 3; ++i)
+        r.relay->sendEnvelope(makeFakeEnvelope(uint8_t(i)));
+    ASSERT_TRUE(findStats(r.relay->relayHealthStats(), "https://r1.test")->ejected);
+
+    // Relay recovers; fire the pending probe timer.
+    r.http->failStatusByHost.clear();
+    while (r.timers->fireNext()) {}
+    {
+        const auto stats = r.relay->relayHealthStats();
+        const auto* s1 = findStats(stats, "https://r1.test");
+        ASSERT_NE(s1, nullptr);
+        EXPECT_FALSE(s1->ejected);
+        EXPECT_TRUE(s1->probing);
+    }
+
+    // First successful send through r1 clears the probing state.
+    r.http->posts.clear();
+    for (int i = 0; i < 200 && countSendPostsTo(r.http->posts, "r1.test") == 0; ++i)
+        r.relay->sendEnvelope(makeFakeEnvelope(0x50));
+    ASSERT_EQ(countSendPostsTo(r.http->posts, "r1.test"), 1u);
+    const auto stats = r.relay->relayHealthStats();
+    EXPECT_FALSE(findStats(stats, "https://r1.test")->probing);
+    EXPECT_FALSE(findStats(stats, "https://r1.test")->ejected);
+
+    fs::remove_all(r.dataDir);
+}
+
+TEST(RelayHealth, FailedProbeReEjectsImmediately) {
+    ASSERT_GE(sodium_init(), 0);
+
+    auto r = primeRelay({"https://r1.test", "https://r2.test"});
+    r.http->failStatusByHost["r1.test"] = 429;  // throttling counts too
+    for (int i = 0; i < 200 && countSendPostsTo(r.http->posts, "r1.test") < 3; ++i)
+        r.relay->sendEnvelope(makeFakeEnvelope(uint8_t(i)));
+    ASSERT_TRUE(findStats(r.relay->relayHealthStats(), "https://r1.test")->ejected);
+    EXPECT_EQ(findStats(r.relay->relayHealthStats(), "https://r1.test")->throttled, 3u);
+
+    while (r.timers->fireNext()) {}
+    ASSERT_TRUE(findStats(r.relay->relayHealthStats(), "https://r1.test")->probing);
+
+    // Still throttling: a single failed probe sends it straight back out.
+    r.http->posts.clear();
+    for (int i = 0; i < 200 && countSendPostsTo(r.http->posts, "r1.test") == 0; ++i)
+        r.relay->sendEnvelope(makeFakeEnvelope(0x60));
+    ASSERT_EQ(countSendPostsTo(r.http->posts, "r1.test"), 1u);
+    EXPECT_TRUE(findStats(r.relay->relayHealthStats(), "https://r1.test")->ejected);
+
+    fs::remove_all(r.dataDir);
+}
+
+TEST(RelayHealth, AllRelaysEjectedStillSends) {
+    ASSERT_GE(sodium_init(), 0);
+
+    auto r = primeRelay({"https://r1.test", "https://r2.test"});
+    r.http->failStatusByHost["r1.test"] = 502;
+    r.http->failStatusByHost["r2.test"] = 502;
+    for (int i = 0; i < 6; ++i) r.relay->sendEnvelope(makeFakeEnvelope(uint8_t(i)));
+    const auto stats = r.relay->relayHealthStats();
+    ASSERT_TRUE(findStats(stats, "https://r1.test")->ejected);
+    ASSERT_TRUE(findStats(stats, "https://r2.test")->ejected);
+
+    r.http->posts.clear();
+    r.relay->sendEnvelope(makeFakeEnvelope(0x70));
+    EXPECT_EQ(countSendPosts(r.http->posts), 1u)
+        << "with every relay ejected, sends must fall back rather than stall";
+
+    fs::remove_all(r.dataDir);
+}
+
+TEST(RelayHealth, FanOutSkipsEjectedRelays) {
+    ASSERT_GE(sodium_init(), 0);
+
+    auto r = primeRelay({"https://r1.test", "https://r2.test", "https://r3.test"});
+    r.http->failStatusByHost["r3.test"] = 503;
+    r.relay->setParallelFanOut(true);
+    r.relay->setParallelFanOutK(0);
+    for (int i = 0; i < 3; ++i) r.relay->sendEnvelope(makeFakeEnvelope(uint8_t(i)));
+    ASSERT_TRUE(findStats(r.relay->relayHealthStats(), "https://r3.test")->ejected);
+
+    r.http->posts.clear();
+    r.relay->sendEnvelope(makeFakeEnvelope(0x80));
+    EXPECT_EQ(countSendPosts(r.http->posts), 2u);
+    EXPECT_EQ(countSendPostsTo(r.http->posts, "r3.test"), 0u);
+
+    fs::remove_all(r.dataDir);
+}
+
+// ── WS send path ────────────────────────────────────────────────────────
+// Envelopes pipelined as binary frames over the authenticated WS, with a
+// relay-advertised ack window.  Anything the WS can't finish falls back
+// to HTTP /v1/send.
+
+namespace {
+
+// primeRelay + a second auth_ok advertising `window`, as a relay that
+// supports send frames would.
+PrimedRelay primeWsSendRelay(int window) {
+    PrimedRelay r = primeRelay({});
+    nlohmann::json ok;
+    ok["type"]           = "auth_ok";
+    ok["ws_send_window"] = window;
+    r.ws->onTextMessage(ok.dump());
+    r.relay->setWsSendEnabled(true);
+    r.http->posts.clear();
+    return r;
+}
+
+uint32_t frameSeq(const Bytes& frame) {
+    return (uint32_t(frame[1]) << 24) | (uint32_t(frame[2]) << 16)
+         | (uint32_t(frame[3]) << 8)  |  uint32_t(frame[4]);
+}
+
+void ack(SimpleWebSocket* ws, uint32_t seq, int status = 200) {
+    nlohmann::json a;
+    a["type"]   = "send_ack";
+    a["seq"]    = seq;
+    a["status"] = status;
+    if (status != 200) a["error"] = "rate limit exceeded";
+    ws->onTextMessage(a.dump());
+}
+
+}  // namespace
+
+TEST(WsSend, PipelinesFramesWithinAdvertisedWindow) {
+    ASSERT_GE(sodium_init(), 0);
+
+    auto r = primeWsSendRelay(2);
+    ASSERT_TRUE(r.relay->wsSendActive());
+
+    const Bytes e1 = makeFakeEnvelope(0x01);
+    r.relay->sendEnvelope(e1);
+    r.relay->sendEnvelope(makeFakeEnvelope(0x02));
+    r.relay->sendEnvelope(makeFakeEnvelope(0x03));
+
+    EXPECT_EQ(countSendPosts(r.http->posts), 0u);
+    ASSERT_EQ(r.ws->sentBinaries.size(), 2u) << "third frame must wait for an ack";
+
+    const Bytes& f1 = r.ws->sentBinaries[0];
+    ASSERT_EQ(f1.size(), 5 + e1.size());
+    EXPECT_EQ(f1[0], 0x53);
+    EXPECT_EQ(Bytes(f1.begin() + 5, f1.end()), e1);
+
+    ack(r.ws, frameSeq(f1));
+    ASSERT_EQ(r.ws->sentBinaries.size(), 3u);
+    EXPECT_EQ(r.ws->sentBinaries[2][5 + 1], 0x03);
+    EXPECT_EQ(countSendPosts(r.http->posts), 0u);
+
+    fs::remove_all(r.dataDir);
+}
+
+TEST(WsSend, StaysOnHttpWhenRelayDoesNotAdvertiseIt) {
+    ASSERT_GE(sodium_init(), 0);
+
+    auto r = primeRelay({});
+    r.relay->setWsSendEnabled(true);
+    EXPECT_FALSE(r.relay->wsSendActive());
+
+    r.relay->sendEnvelope(makeFakeEnvelope(0x10));
+    EXPECT_TRUE(r.ws->sentBinaries.empty());
+    EXPECT_EQ(countSendPosts(r.http->posts), 1u);
+
+    fs::remove_all(r.dataDir);
+}
+
+TEST(WsSend, DisconnectResendsUnackedAndQueuedOverHttp) {
+    ASSERT_GE(sodium_init(), 0);
+
+    auto r = primeWsSendRelay(1);
+    r.relay->sendEnvelope(makeFakeEnvelope(0x21));
+    r.relay->sendEnvelope(makeFakeEnvelope(0x22));
+    ASSERT_EQ(r.ws->sentBinaries.size(), 1u);
+    ASSERT_EQ(countSendPosts(r.http->posts), 0u);
+
+    r.ws->close();
+    ASSERT_EQ(countSendPosts(r.http->posts), 2u);
+    // Original order preserved: the in-flight frame goes first.
+    EXPECT_EQ(r.http->posts[0].body[1], 0x21);
+    EXPECT_EQ(r.http->posts[1].body[1], 0x22);
+    EXPECT_FALSE(r.relay->wsSendActive());
+
+    fs::remove_all(r.dataDir);
+}
+
+TEST(WsSend, AckTimeoutFallsBackToHttp) {
+    ASSERT_GE(sodium_init(), 0);
+
+    auto r = primeWsSendRelay(4);
+    r.relay->sendEnvelope(makeFakeEnvelope(0x31));
+    ASSERT_EQ(r.ws->sentBinaries.size(), 1u);
+
+    while (r.timers->fireNext() && countSendPosts(r.http->posts) == 0) {}
+    EXPECT_EQ(countSendPosts(r.http->posts), 1u);
+    EXPECT_FALSE(r.relay->wsSendActive());
+
+    // A late ack for the spilled frame is ignored.
+    ack(r.ws, frameSeq(r.ws->sentBinaries[0]));
+    r.relay->sendEnvelope(makeFakeEnvelope(0x32));
+    EXPECT_EQ(r.ws->sentBinaries.size(), 1u);
+    EXPECT_EQ(countSendPosts(r.http->posts), 2u);
+
+    fs::remove_all(r.dataDir);
+}
+
+TEST(WsSend, ErrorAckFeedsTheHttpRetryQueue) {
+    ASSERT_GE(sodium_init(), 0);
+
+    auto r = primeWsSendRelay(4);
+    r.relay->sendEnvelope(makeFakeEnvelope(0x41));
+    ASSERT_EQ(r.ws->sentBinaries.size(), 1u);
+
+    ack(r.ws, frameSeq(r.ws->sentBinaries[0]), 429);
+    EXPECT_EQ(countSendPosts(r.http->posts), 0u) << "retry is scheduled, not immediate";
+
+    while (r.timers->fireNext() && countSendPosts(r.http->posts) == 0) {}
+    ASSERT_EQ(countSendPosts(r.http->posts), 1u);
+    EXPECT_EQ(r.http->posts[0].body[1], 0x41);
+
+    const auto stats = r.relay->relayHealthStats();
+    const auto* st = findStats(stats, "wss://primary.test");
+    ASSERT_NE(st, nullptr);
+    EXPECT_GE(st->throttled, 1u);
+
+    fs::remove_all(r.dataDir);
+}
+
+TEST(WsSend, PrivacyLevelsAboveZeroTurnItOff) {
+    ASSERT_GE(sodium_init(), 0);
+
+    auto r = primeWsSendRelay(4);
+    ASSERT_TRUE(r.relay->wsSendActive());
+    r.relay->setPrivacyLevel(1);
+    EXPECT_FALSE(r.relay->wsSendActive());
+
+    r.relay->setJitterRange(0, 0);  // keep the HTTP post synchronous
+    r.relay->setCoverTrafficInterval(0);
+    r.relay->sendEnvelope(makeFakeEnvelope(0x51));
+    EXPECT_TRUE(r.ws->sentBinaries.empty());
+    EXPECT_EQ(countSendPosts(r.http->posts), 1u);
+
+    fs::remove_all(r.dataDir);
+}
+
+TEST(WsSend, PlatformWithoutBinarySendFallsBack) {
+    ASSERT_GE(sodium_init(), 0);
+
+    auto r = primeWsSendRelay(4);
+    r.ws->binarySupported = false;
+    r.relay->sendEnvelope(makeFakeEnvelope(0x61));
+    EXPECT_EQ(countSendPosts(r.http->posts), 1u);
+    EXPECT_FALSE(r.relay->wsSendActive());
+
+    fs::remove_all(r.dataDir);
+}
+
+// ── Batched sends ───────────────────────────────────────────────────────
+// A SendBatch scope coalesces HTTP sends into one /v1/send-batch request
+// per relay; each envelope still gets its own result.
+
+namespace {
+
+size_t countBatchPosts(const std::vector<CapturingHttpClient::Post>& posts) {
+    size_t n = 0;
+    for (const auto& p : posts) {
+        if (p.url.find("/v1/send-batch") != std::string::npos) ++n;
+    }
+    return n;
+}
+
+std::vector<Bytes> splitBatch(const Bytes& body) {
+    std::vector<Bytes> out;
+    for (size_t off = 0; off + 4 <= body.size();) {
+        const size_t n = (size_t(body[off]) << 24) | (size_t(body[off + 1]) << 16)
+                       | (size_t(body[off + 2]) << 8) | size_t(body[off + 3]);
+        off += 4;
+        out.emplace_back(body.begin() + off, body.begin() + off + n);
+        off += n;
+    }
+    return out;
+}
+
+}  // namespace
+
+TEST(SendBatch, CoalescesEnvelopesIntoOneRequest) {
+    ASSERT_GE(sodium_init(), 0);
+
+    auto r = primeRelay({});
+    const Bytes e1 = makeFakeEnvelope(0x01, 64);
+    const Bytes e2 = makeFakeEnvelope(0x02, 3000);  // different padding bucket
+    const Bytes e3 = makeFakeEnvelope(0x03, 64);
+    {
+        RelayClient::SendBatch batch(*r.relay);
+        r.relay->sendEnvelope(e1);
+        r.relay->sendEnvelope(e2);
+        r.relay->sendEnvelope(e3);
+        EXPECT_TRUE(r.http->posts.empty()) << "nothing leaves until the scope closes";
+    }
+    ASSERT_EQ(r.http->posts.size(), 1u);
+    EXPECT_EQ(countBatchPosts(r.http->posts), 1u);
+
+    const auto parts = splitBatch(r.http->posts[0].body);
+    ASSERT_EQ(parts.size(), 3u);
+    EXPECT_EQ(parts[0], e1);
+    EXPECT_EQ(parts[1], e2);
+    EXPECT_EQ(parts[2], e3);
+
+    fs::remove_all(r.dataDir);
+}
+
+TEST(SendBatch, SingleEnvelopeUsesPlainSend) {
+    ASSERT_GE(sodium_init(), 0);
+
+    auto r = primeRelay({});
+    {
+        RelayClient::SendBatch batch(*r.relay);
+        r.relay->sendEnvelope(makeFakeEnvelope(0x11));
+    }
+    ASSERT_EQ(r.http->posts.size(), 1u);
+    EXPECT_EQ(countBatchPosts(r.http->posts), 0u);
+
+    fs::remove_all(r.dataDir);
+}
+
+TEST(SendBatch, NestedScopesFlushOnceAtTheOutermost) {
+    ASSERT_GE(sodium_init(), 0);
+
+    auto r = primeRelay({});
+    {
+        RelayClient::SendBatch outer(*r.relay);
+        r.relay->sendEnvelope(makeFakeEnvelope(0x21));
+        {
+            RelayClient::SendBatch inner(*r.relay);
+            r.relay->sendEnvelope(makeFakeEnvelope(0x22));
+        }
+        EXPECT_TRUE(r.http->posts.empty());
+        r.relay->sendEnvelope(makeFakeEnvelope(0x23));
+    }
+    ASSERT_EQ(countBatchPosts(r.http->posts), 1u);
+    EXPECT_EQ(splitBatch(r.http->posts[0].body).size(), 3u);
+
+    fs::remove_all(r.dataDir);
+}
+
+TEST(SendBatch, RelayWithoutEndpointFallsBackAndIsRemembered) {
+    ASSERT_GE(sodium_init(), 0);
+
+    auto r = primeRelay({});
+    r.http->batchSupported = false;
+    {
+        RelayClient::SendBatch batch(*r.relay);
+        r.relay->sendEnvelope(makeFakeEnvelope(0x31));
+        r.relay->sendEnvelope(makeFakeEnvelope(0x32));
+    }
+    EXPECT_EQ(countBatchPosts(r.http->posts), 1u);
+    EXPECT_EQ(countSendPosts(r.http->posts) - countBatchPosts(r.http->posts), 2u);
+
+    r.http->posts.clear();
+    {
+        RelayClient::SendBatch batch(*r.relay);
+        r.relay->sendEnvelope(makeFakeEnvelope(0x33));
+        r.relay->sendEnvelope(makeFakeEnvelope(0x34));
+    }
+    EXPECT_EQ(countBatchPosts(r.http->posts), 0u) << "404 relay must not be batched again";
+    EXPECT_EQ(countSendPosts(r.http->posts), 2u);
+
+    fs::remove_all(r.dataDir);
+}
+
+TEST(SendBatch, PerEnvelopeFailureFeedsRetryQueue) {
+    ASSERT_GE(sodium_init(), 0);
+
+    auto r = primeRelay({});
+    r.http->batchStatuses = {200, 429, 200};
+    {
+        RelayClient::SendBatch batch(*r.relay);
+        r.relay->sendEnvelope(makeFakeEnvelope(0x41));
+        r.relay->sendEnvelope(makeFakeEnvelope(0x42));
+        r.relay->sendEnvelope(makeFakeEnvelope(0x43));
+    }
+    ASSERT_EQ(r.http->posts.size(), 1u);
+
+    r.http->posts.clear();
+    while (r.timers->fireNext() && r.http->posts.empty()) {}
+    ASSERT_EQ(r.http->posts.size(), 1u) << "only the throttled envelope is retried";
+    EXPECT_EQ(countBatchPosts(r.http->posts), 0u);
+    EXPECT_EQ(r.http->posts[0].body[1], 0x42);
+
+    fs::remove_all(r.dataDir);
+}
+
+TEST(SendBatch, FanOutBatchesPerRelay) {
+    ASSERT_GE(sodium_init(), 0);
+
+    auto r = primeRelay({"https://r1.test", "https://r2.test"});
+    r.relay->setParallelFanOut(true);
+    r.relay->setParallelFanOutK(0);
+    {
+        RelayClient::SendBatch batch(*r.relay);
+        for (int i = 0; i < 5; ++i) r.relay->sendEnvelope(makeFakeEnvelope(uint8_t(0x50 + i)));
+    }
+    ASSERT_EQ(r.http->posts.size(), 2u);
+    EXPECT_EQ(countBatchPosts(r.http->posts), 2u);
+    for (const auto& p : r.http->posts) EXPECT_EQ(splitBatch(p.body).size(), 5u);
+
+    fs::remove_all(r.dataDir);
+}
+
+TEST(SendBatch, JitterDelaysTheBatchToItsSlot) {
+    ASSERT_GE(sodium_init(), 0);
+
+    auto r = primeRelay({});
+    r.relay->setJitterRange(120, 120);  // every envelope draws the same slot
+    {
+        RelayClient::SendBatch batch(*r.relay);
+        for (uint8_t i = 0; i < 3; ++i) r.relay->sendEnvelope(makeFakeEnvelope(0x71 + i));
+    }
+    EXPECT_TRUE(r.http->posts.empty()) << "the batch waits out its jitter";
+
+    while (r.timers->fireNext()) {}
+    ASSERT_EQ(r.http->posts.size(), 1u);
+    EXPECT_EQ(countBatchPosts(r.http->posts), 1u);
+    EXPECT_EQ(splitBatch(r.http->posts[0].body).size(), 3u);
+
+    fs::remove_all(r.dataDir);
+}
+
+TEST(SendBatch, PrivacyLevelJitterSplitsIntoSlotBatches) {
+    ASSERT_GE(sodium_init(), 0);
+
+    auto r = primeRelay({});
+    r.relay->setPrivacyLevel(1);
+    r.relay->setCoverTrafficInterval(0);  // count only the real envelopes
+    constexpr size_t kEnvelopes = 40;
+    {
+        RelayClient::SendBatch batch(*r.relay);
+        for (size_t i = 0; i < kEnvelopes; ++i)
+            r.relay->sendEnvelope(makeFakeEnvelope(uint8_t(0x80 + i)));
+    }
+    while (r.timers->fireNext()) {}
+
+    // 50-300 ms jitter spans 11 slots of 25 ms: never one request for
+    // the whole group send, never one request per envelope.
+    size_t envelopes = 0;
+    for (const auto& p : r.http->posts) {
+        envelopes += (p.url.find("/v1/send-batch") != std::string::npos)
+                   ? splitBatch(p.body).size() : 1;
+    }
+    EXPECT_EQ(envelopes, kEnvelopes);
+    EXPECT_GE(countBatchPosts(r.http->posts), 1u);
+    EXPECT_GT(r.http->posts.size(), 1u);
+    EXPECT_LE(r.http->posts.size(), 11u);
+
+    fs::remove_all(r.dataDir);
+}
+
+// ── Send scheduler ──────────────────────────────────────────────────────
+// sendEnvelope queues per TrafficClass and keeps a bounded number of
+// sends in flight: Control is strict priority, Message / FileChunk share
+// by weighted fair queueing, and token-bucket caps hold the queues.
+
+namespace {
+
+using TC = RelayClient::TrafficClass;
+
+// Index of the POST that carried `env`, or -1.
+int postIndexOf(const std::vector<CapturingHttpClient::Post>& posts, const Bytes& env) {
+    for (size_t i = 0; i < posts.size(); ++i)
+        if (posts[i].body == env) return int(i);
+    return -1;
+}
+
+}  // namespace
+
+TEST(SendScheduler, ControlJumpsQueuedFileChunks) {
+    ASSERT_GE(sodium_init(), 0);
+
+    auto r = primeRelay({});
+    r.http->deferResponses = true;
+    for (uint8_t i = 0; i < 10; ++i)
+        r.relay->sendEnvelope(makeFakeEnvelope(0x40 + i, 4096), TC::FileChunk);
+    const size_t window = r.http->posts.size();
+    ASSERT_GT(window, 0u);
+    ASSERT_LT(window, 10u) << "the backlog must stay in our queues";
+
+    const Bytes control = makeFakeEnvelope(0xC0);
+    r.relay->sendEnvelope(control, TC::Control);
+    EXPECT_EQ(r.http->posts.size(), window) << "window is full";
+
+    ASSERT_TRUE(r.http->completeNext());
+    ASSERT_EQ(r.http->posts.size(), window + 1);
+    EXPECT_EQ(r.http->posts.back().body, control)
+        << "control takes the first free slot ahead of queued chunks";
+
+    while (r.http->completeNext()) {}
+    EXPECT_EQ(countSendPosts(r.http->posts), 11u);
+    EXPECT_EQ(r.relay->sendsInFlight(), 0);
+
+    fs::remove_all(r.dataDir);
+}
+
+TEST(SendScheduler, MessagesOvertakeAFileBacklog) {
+    ASSERT_GE(sodium_init(), 0);
+
+    auto r = primeRelay({});
+    r.http->deferResponses = true;
+    for (uint8_t i = 0; i < 30; ++i)
+        r.relay->sendEnvelope(makeFakeEnvelope(0x40 + i, 16 * 1024), TC::FileChunk);
+    const int window = int(r.http->posts.size());
+    std::vector<Bytes> texts;
+    for (uint8_t i = 0; i < 3; ++i) {
+        texts.push_back(makeFakeEnvelope(0xA0 + i, 1024));
+        r.relay->sendEnvelope(texts.back(), TC::Message);
+    }
+
+    while (r.http->completeNext()) {}
+    ASSERT_EQ(countSendPosts(r.http->posts), 33u);
+
+    // The texts take the next three free slots, not the ones after the
+    // 30 chunks queued ahead of them.
+    for (size_t i = 0; i < texts.size(); ++i)
+        EXPECT_EQ(postIndexOf(r.http->posts, texts[i]), window + int(i));
+
+    fs::remove_all(r.dataDir);
+}
+
+TEST(SendScheduler, FileChunksAreNotStarvedByChat) {
+    ASSERT_GE(sodium_init(), 0);
+
+    auto r = primeRelay({});
+    r.http->deferResponses = true;
+    // Fill the window with control sends so everything below is queued
+    // before any of it is dispatched.
+    for (int i = 0; i < 6; ++i)
+        r.relay->sendEnvelope(makeFakeEnvelope(0xC0, 64), TC::Control);
+    ASSERT_EQ(r.http->posts.size(), 6u);
+
+    for (int i = 0; i < 40; ++i)
+        r.relay->sendEnvelope(makeFakeEnvelope(0xA0, 1024), TC::Message);
+    for (int i = 0; i < 5; ++i)
+        r.relay->sendEnvelope(makeFakeEnvelope(0xF0, 1024), TC::FileChunk);
+    r.http->posts.clear();
+
+    // Equal sizes at 8:1 weights — roughly one chunk per eight texts.
+    for (int i = 0; i < 18; ++i) ASSERT_TRUE(r.http->completeNext());
+    size_t chunks = 0;
+    for (const auto& p : r.http->posts)
+        if (p.body[1] == 0xF0) ++chunks;
+    EXPECT_GE(chunks, 2u);
+    EXPECT_LE(chunks, 3u);
+
+    while (r.http->completeNext()) {}
+    fs::remove_all(r.dataDir);
+}
+
+TEST(SendScheduler, GlobalCapHoldsChatButNotControl) {
+    ASSERT_GE(sodium_init(), 0);
+
+    auto r = primeRelay({});
+    r.relay->setBandwidthCaps(1000, 0);
+
+    r.relay->sendEnvelope(makeFakeEnvelope(0x01, 3000));   // takes the bucket into debt
+    ASSERT_EQ(countSendPosts(r.http->posts), 1u);
+
+    const size_t timersBefore = r.timers->pendingCount();
+    r.relay->sendEnvelope(makeFakeEnvelope(0x02));
+    EXPECT_EQ(countSendPosts(r.http->posts), 1u) << "held until the bucket refills";
+    EXPECT_GT(r.timers->pendingCount(), timersBefore) << "pump timer armed";
+
+    const auto stats = r.relay->sendQueueStats();
+    ASSERT_EQ(stats.size(), 3u);
+    EXPECT_EQ(stats[size_t(TC::Message)].depth, 1u);
+    EXPECT_EQ(stats[size_t(TC::Message)].sent, 1u);
+
+    const Bytes control = makeFakeEnvelope(0xC0);
+    r.relay->sendEnvelope(control, TC::Control);
+    ASSERT_EQ(countSendPosts(r.http->posts), 2u);
+    EXPECT_EQ(r.http->posts.back().body, control);
+
+    r.relay->setBandwidthCaps(0, 0);  // lifting the cap releases the queue
+    EXPECT_EQ(countSendPosts(r.http->posts), 3u);
+    EXPECT_EQ(r.relay->sendQueueStats()[size_t(TC::Message)].depth, 0u);
+
+    fs::remove_all(r.dataDir);
+}
+
+TEST(SendScheduler, PerRelayCapSteersToRelayWithBudget) {
+    ASSERT_GE(sodium_init(), 0);
+
+    auto r = primeRelay({"https://r1.test", "https://r2.test"});
+    r.relay->setBandwidthCaps(0, 1000);
+
+    r.relay->sendEnvelope(makeFakeEnvelope(0x01, 3000));
+    r.relay->sendEnvelope(makeFakeEnvelope(0x02, 3000));
+    ASSERT_EQ(countSendPosts(r.http->posts), 2u);
+    const bool firstOnR1 = r.http->posts[0].url.find("r1.test") != std::string::npos;
+    const bool secondOnR1 = r.http->posts[1].url.find("r1.test") != std::string::npos;
+    EXPECT_NE(firstOnR1, secondOnR1) << "the relay in debt sits out";
+
+    // Both relays over their cap now — the next one waits.
+    r.relay->sendEnvelope(makeFakeEnvelope(0x03));
+    EXPECT_EQ(countSendPosts(r.http->posts), 2u);
+    EXPECT_EQ(r.relay->sendQueueStats()[size_t(TC::Message)].depth, 1u);
+
+    fs::remove_all(r.dataDir);
+}
+
+TEST(SendScheduler, BatchScopeIsNotLimitedByTheWindow) {
+    ASSERT_GE(sodium_init(), 0);
+
+    auto r = primeRelay({});
+    r.http->deferResponses = true;
+    {
+        RelayClient::SendBatch batch(*r.relay);
+        for (uint8_t i = 0; i < 20; ++i)
+            r.relay->sendEnvelope(makeFakeEnvelope(i));
+    }
+    ASSERT_EQ(r.http->posts.size(), 1u);
+    EXPECT_EQ(splitBatch(r.http->posts[0].body).size(), 20u);
+    EXPECT_EQ(r.relay->sendQueueStats()[size_t(TC::Message)].depth, 0u);
+
+    ASSERT_TRUE(r.http->completeNext());
+    EXPECT_EQ(r.relay->sendsInFlight(), 0);
+
+    fs::remove_all(r.dataDir);
+}
+
+TEST(SendScheduler, BatchScopeLeavesAnEarlierBacklogToTheWindow) {
+    ASSERT_GE(sodium_init(), 0);
+
+    auto r = primeRelay({});
+    r.http->deferResponses = true;
+    for (uint8_t i = 0; i < 10; ++i)
+        r.relay->sendEnvelope(makeFakeEnvelope(0x40 + i, 4096), TC::FileChunk);
+    const size_t window = r.http->posts.size();
+    ASSERT_LT(window, 10u);
+
+    {
+        RelayClient::SendBatch batch(*r.relay);
+        for (uint8_t i = 0; i < 3; ++i)
+            r.relay->sendEnvelope(makeFakeEnvelope(0xA0 + i), TC::Message);
+    }
+
+    // The scope's three envelopes go out together; the queued chunks
+    // don't ride along.
+    ASSERT_EQ(r.http->posts.size(), window + 1);
+    EXPECT_EQ(splitBatch(r.http->posts.back().body).size(), 3u);
+    EXPECT_EQ(r.relay->sendQueueStats()[size_t(TC::FileChunk)].depth, 10u - window);
+    EXPECT_EQ(r.relay->sendsInFlight(), int(window) + 3);
+
+    while (r.http->completeNext()) {}
+    EXPECT_EQ(r.relay->sendQueueStats()[size_t(TC::FileChunk)].depth, 0u);
+    EXPECT_EQ(r.relay->sendsInFlight(), 0);
+
+    fs::remove_all(r.dataDir);
+}
+
+TEST(SendScheduler, UnansweredSendsFreeTheirSlotsAfterTimeout) {
+    ASSERT_GE(sodium_init(), 0);
+
+    auto r = primeRelay({});
+    r.http->deferResponses = true;
+    for (uint8_t i = 0; i < 10; ++i)
+        r.relay->sendEnvelope(makeFakeEnvelope(0x40 + i), TC::Message);
+    const size_t window = r.http->posts.size();
+    ASSERT_EQ(r.relay->sendsInFlight(), int(window));
+
+    // The transport never answers: the stall timer frees the window and
+    // the queue moves on.
+    while (r.http->posts.size() == window && r.timers->fireNext()) {}
+    EXPECT_GT(r.http->posts.size(), window);
+    EXPECT_EQ(r.relay->sendQueueStats()[size_t(TC::Message)].depth,
+              10u - r.http->posts.size());
+
+    // Late answers for the freed slots don't drive the count negative.
+    while (r.http->completeNext()) {}
+    EXPECT_EQ(r.relay->sendsInFlight(), 0);
+
+    fs::remove_all(r.dataDir);
+}
+
+// ── Constant-rate shaping ───────────────────────────────────────────────
+// One envelope per tick: a queued real envelope if there is one, cover
+// otherwise — never both, nothing between ticks, and every tick the same
+// padded size.
+
+namespace {
+
+bool isSelfAddressed(const Bytes& body, const CryptoEngine& crypto) {
+    const Bytes self = crypto.identityPub();
+    return body.size() > 33 && Bytes(body.begin() + 1, body.begin() + 33) == self;
+}
+
+// Fire timers until one produces a POST.  Stopped timers leave no-op
+// entries in the pool, so a single fireNext() may not be the tick.
+// A well-formed wrapForRelay envelope around `sealedLen` marker bytes.
+Bytes makeRelayEnvelope(uint8_t marker, size_t sealedLen) {
+    return SealedEnvelope::wrapForRelay(Bytes(32, marker), Bytes(sealedLen, marker));
+}
+
+bool startsWith(const Bytes& body, const Bytes& prefix) {
+    return body.size() >= prefix.size() &&
+           std::equal(prefix.begin(), prefix.end(), body.begin());
+}
+
+bool fireUntilPost(PrimedRelay& r) {
+    const size_t before = r.http->posts.size();
+    while (r.http->posts.size() == before)
+        if (!r.timers->fireNext()) return false;
+    return true;
+}
+
+}  // namespace
+
+TEST(ConstantRate, EmitsCoverOnEveryIdleTick) {
+    ASSERT_GE(sodium_init(), 0);
+
+    auto r = primeRelay({});
+    r.relay->setConstantRate(100);
+    ASSERT_TRUE(r.relay->constantRateActive());
+
+    for (int i = 0; i < 5; ++i) ASSERT_TRUE(r.timers->fireNext());
+    ASSERT_EQ(countSendPosts(r.http->posts), 5u);
+    for (const auto& p : r.http->posts)
+        EXPECT_TRUE(isSelfAddressed(p.body, *r.crypto));
+
+    r.relay->setConstantRate(0);
+    fs::remove_all(r.dataDir);
+}
+
+TEST(ConstantRate, RealEnvelopesTakeCoverSlots) {
+    ASSERT_GE(sodium_init(), 0);
+
+    auto r = primeRelay({});
+    r.relay->setCoverTrafficInterval(1);  // would normally add bursts
+    r.relay->setConstantRate(100);
+
+    const Bytes e1 = makeRelayEnvelope(0x01, 100);
+    const Bytes e2 = makeRelayEnvelope(0x02, 100);
+    r.relay->sendEnvelope(e1);
+    r.relay->sendEnvelope(e2, RelayClient::TrafficClass::FileChunk);
+    EXPECT_TRUE(r.http->posts.empty()) << "nothing leaves between ticks";
+
+    ASSERT_TRUE(fireUntilPost(r));
+    ASSERT_EQ(r.http->posts.size(), 1u) << "one envelope per tick, no burst";
+    EXPECT_TRUE(startsWith(r.http->posts[0].body, e1));
+
+    ASSERT_TRUE(fireUntilPost(r));
+    ASSERT_EQ(r.http->posts.size(), 2u);
+    EXPECT_TRUE(startsWith(r.http->posts[1].body, e2));
+
+    ASSERT_TRUE(fireUntilPost(r));
+    ASSERT_EQ(r.http->posts.size(), 3u);
+    EXPECT_TRUE(isSelfAddressed(r.http->posts[2].body, *r.crypto));
+
+    r.relay->setConstantRate(0);
+    r.relay->setCoverTrafficInterval(0);
+    fs::remove_all(r.dataDir);
+}
+
+TEST(ConstantRate, EveryTickIsPaddedToTheTickBucket) {
+    ASSERT_GE(sodium_init(), 0);
+
+    auto r = primeRelay({});
+    r.relay->setConstantRate(100, RelayClient::TickBucket::Medium);
+
+    // A 2 KiB real envelope grows to the tick's 16 KiB and still
+    // unwraps to what was sealed; a 256 KiB one can't shrink and keeps
+    // its own bucket.
+    const Bytes small = makeRelayEnvelope(0x01, 100);
+    const Bytes large = makeRelayEnvelope(0x02, 100 * 1024);
+    ASSERT_EQ(small.size(), 2u * 1024u);
+    r.relay->sendEnvelope(small);
+    r.relay->sendEnvelope(large);
+    for (int i = 0; i < 20; ++i) ASSERT_TRUE(fireUntilPost(r));
+    ASSERT_EQ(r.http->posts.size(), 20u);
+
+    EXPECT_EQ(r.http->posts[0].body.size(), 16u * 1024u);
+    EXPECT_EQ(SealedEnvelope::unwrapFromRelay(r.http->posts[0].body),
+              SealedEnvelope::unwrapFromRelay(small));
+    EXPECT_EQ(r.http->posts[1].body, large);
+    for (size_t i = 2; i < r.http->posts.size(); ++i)
+        EXPECT_EQ(r.http->posts[i].body.size(), 16u * 1024u) << "cover tick " << i;
+
+    r.relay->setConstantRate(0);
+    fs::remove_all(r.dataDir);
+}
+
+TEST(ConstantRate, TurningItOffReleasesTheQueue) {
+    ASSERT_GE(sodium_init(), 0);
+
+    auto r = primeRelay({});
+    r.relay->setConstantRate(100);
+    for (uint8_t i = 0; i < 3; ++i) r.relay->sendEnvelope(makeFakeEnvelope(i));
+    EXPECT_TRUE(r.http->posts.empty());
+    EXPECT_EQ(r.relay->sendQueueStats()[size_t(RelayClient::TrafficClass::Message)].depth, 3u);
+
+    r.relay->setConstantRate(0);
+    EXPECT_EQ(countSendPosts(r.http->posts), 3u);
+    EXPECT_FALSE(fireUntilPost(r)) << "tick stopped";
+
+    fs::remove_all(r.dataDir);
+}
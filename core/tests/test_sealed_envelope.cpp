@@ -15,6 +15,9 @@
 //   4. envelopeId uniqueness — each seal produces a fresh 16-byte id so
 //      replay dedup on the receiver side actually distinguishes envelopes.
 //   5. Relay wrap/unwrap round-trip with proper padding buckets.
+//   6. Multi-recipient (0x04 / 0x05) — one shared signature over a
+//      commitment tree, each copy still bound to its own recipient, and
+//      never accepted as a single-recipient signature.
 //
 // Test identities use libsodium directly (crypto_sign_keypair) rather than
 // bootstrapping a CryptoEngine for every test — that would add ~2.6s of
@@ -329,6 +332,20 @@ TEST(SealedEnvelope, P2PPadUnpadRoundTripLargeBucket) {
     EXPECT_EQ(roundTripped, payload);
 }
 
+TEST(SealedEnvelope, P2PPadRoundsOversizeUpToLargeBucketMultiple) {
+    // A negotiated multi-megabyte P2P chunk: past the largest bucket,
+    // so it rounds up to the next 256 KiB multiple.
+    Bytes payload(4 * 1024 * 1024 + 600);
+    for (size_t i = 0; i < payload.size(); ++i) payload[i] = uint8_t(i * 31);
+
+    Bytes padded = SealedEnvelope::padForP2P(payload);
+    EXPECT_EQ(padded.size(), 4u * 1024 * 1024 + 256u * 1024);
+    EXPECT_EQ(SealedEnvelope::unpadFromP2P(padded), payload);
+
+    // Relay padding is unchanged: no bucket past 256 KiB.
+    EXPECT_EQ(SealedEnvelope::relayPaddedSize(300 * 1024), 300u * 1024 + 37);
+}
+
 TEST(SealedEnvelope, P2PUnpadRejectsMalformed) {
     // Too short for even the 4-byte length header.
     EXPECT_TRUE(SealedEnvelope::unpadFromP2P(Bytes{}).empty());
@@ -363,3 +380,343 @@ TEST(SealedEnvelope, P2PPadOpaqueAcrossPayloadSizes) {
     EXPECT_EQ(SealedEnvelope::unpadFromP2P(paddedA).size(), a.size());
     EXPECT_EQ(SealedEnvelope::unpadFromP2P(paddedB).size(), b.size());
 }
+
+// ── 12. ML-DSA key by reference ───────────────────────────────────────────
+// Once the recipient has cached the sender's ML-DSA pub, the envelope
+// carries its 16-byte id instead of the ~2 KB key.  unseal() resolves
+// the id through the caller's lookup; without one (or with the wrong
+// key) the envelope fails closed and flags unknownDsaKey.
+
+TEST(SealedEnvelope, DsaInlineKeySurfacedToCaller) {
+    const EdKey    sender    = makeEd();
+    const EdKey    recipient = makeEd();
+    const CurveKey recipCurv = makeCurve();
+    auto [dsaPub, dsaPriv]   = CryptoEngine::generateDsaKeypair();
+
+    const Bytes inner = bytesOf("inline dsa");
+    const Bytes sealed = SealedEnvelope::seal(
+        recipCurv.pub, recipient.pub, sender.pub, sender.priv, inner,
+        {}, dsaPub, dsaPriv);
+    ASSERT_FALSE(sealed.empty());
+
+    const UnsealResult r = SealedEnvelope::unseal(recipCurv.priv, recipient.pub, sealed);
+    ASSERT_TRUE(r.valid);
+    EXPECT_EQ(r.innerPayload, inner);
+    EXPECT_EQ(r.senderDsaPub, dsaPub) << "caller needs the pub to cache it";
+}
+
+TEST(SealedEnvelope, DsaKeyByReferenceRoundTripAndShrinks) {
+    const EdKey    sender    = makeEd();
+    const EdKey    recipient = makeEd();
+    const CurveKey recipCurv = makeCurve();
+    auto [dsaPub, dsaPriv]   = CryptoEngine::generateDsaKeypair();
+
+    const Bytes inner = bytesOf("by-reference dsa");
+    const Bytes inlineForm = SealedEnvelope::seal(
+        recipCurv.pub, recipient.pub, sender.pub, sender.priv, inner,
+        {}, dsaPub, dsaPriv, /*dsaPubByRef=*/false);
+    const Bytes refForm = SealedEnvelope::seal(
+        recipCurv.pub, recipient.pub, sender.pub, sender.priv, inner,
+        {}, dsaPub, dsaPriv, /*dsaPubByRef=*/true);
+    ASSERT_FALSE(refForm.empty());
+    EXPECT_EQ(inlineForm.size() - refForm.size(),
+              dsaPub.size() - SealedEnvelope::kDsaKeyIdLen);
+
+    Bytes lookedUpFor;
+    const UnsealResult r = SealedEnvelope::unseal(
+        recipCurv.priv, recipient.pub, refForm, {},
+        [&](const Bytes& senderEdPub, const Bytes& keyId) {
+            lookedUpFor = senderEdPub;
+            EXPECT_EQ(keyId, SealedEnvelope::dsaKeyId(dsaPub));
+            return dsaPub;
+        });
+    ASSERT_TRUE(r.valid);
+    EXPECT_EQ(r.innerPayload, inner);
+    EXPECT_EQ(lookedUpFor, sender.pub);
+    EXPECT_TRUE(r.senderDsaPub.empty()) << "nothing new to cache";
+}
+
+TEST(SealedEnvelope, DsaKeyByReferenceFailsClosedWhenUnresolved) {
+    const EdKey    sender    = makeEd();
+    const EdKey    recipient = makeEd();
+    const CurveKey recipCurv = makeCurve();
+    auto [dsaPub, dsaPriv]   = CryptoEngine::generateDsaKeypair();
+    auto [otherPub, otherPriv] = CryptoEngine::generateDsaKeypair();
+
+    const Bytes sealed = SealedEnvelope::seal(
+        recipCurv.pub, recipient.pub, sender.pub, sender.priv, bytesOf("x"),
+        {}, dsaPub, dsaPriv, /*dsaPubByRef=*/true);
+    ASSERT_FALSE(sealed.empty());
+
+    // No lookup at all.
+    UnsealResult r = SealedEnvelope::unseal(recipCurv.priv, recipient.pub, sealed);
+    EXPECT_FALSE(r.valid);
+    EXPECT_TRUE(r.unknownDsaKey);
+
+    // Lookup returns a different key — id mismatch, never verified against.
+    r = SealedEnvelope::unseal(recipCurv.priv, recipient.pub, sealed, {},
+        [&](const Bytes&, const Bytes&) { return otherPub; });
+    EXPECT_FALSE(r.valid);
+    EXPECT_TRUE(r.unknownDsaKey);
+    EXPECT_TRUE(r.innerPayload.empty());
+}
+
+// ── Multi-recipient envelopes (0x04 / 0x05) ───────────────────────────────
+// sealMulti signs a commitment tree over every recipient's copy once; each
+// recipient rebuilds the root from its own leaf + path.
+
+namespace {
+
+struct MultiPeer { EdKey ed; CurveKey curve; };
+
+std::vector<MultiPeer> makeMultiPeers(size_t n) {
+    std::vector<MultiPeer> peers;
+    for (size_t i = 0; i < n; ++i) peers.push_back({makeEd(), makeCurve()});
+    return peers;
+}
+
+SealedEnvelope::MultiRecipient multiRecipient(const MultiPeer& p, const Bytes& inner) {
+    SealedEnvelope::MultiRecipient r;
+    r.curvePub     = p.curve.pub;
+    r.edPub        = p.ed.pub;
+    r.innerPayload = inner;
+    return r;
+}
+
+}  // namespace
+
+TEST(SealedEnvelope, MultiRecipientRoundTrip) {
+    const EdKey sender = makeEd();
+    const auto  peers  = makeMultiPeers(5);
+
+    std::vector<SealedEnvelope::MultiRecipient> recips;
+    for (size_t i = 0; i < peers.size(); ++i) {
+        const std::string inner = "payload-" + std::to_string(i);
+        recips.push_back(multiRecipient(peers[i], bytesOf(inner.c_str())));
+    }
+
+    const std::vector<Bytes> sealed =
+        SealedEnvelope::sealMulti(recips, sender.pub, sender.priv);
+    ASSERT_EQ(sealed.size(), peers.size());
+
+    std::vector<Bytes> ids;
+    for (size_t i = 0; i < peers.size(); ++i) {
+        ASSERT_FALSE(sealed[i].empty());
+        EXPECT_EQ(sealed[i][0], 0x04);
+        const UnsealResult r = SealedEnvelope::unseal(
+            peers[i].curve.priv, peers[i].ed.pub, sealed[i]);
+        ASSERT_TRUE(r.valid) << "recipient " << i;
+        EXPECT_EQ(r.innerPayload, recips[i].innerPayload);
+        EXPECT_EQ(r.senderEdPub, sender.pub);
+        ids.push_back(r.envelopeId);
+    }
+    for (size_t i = 0; i < ids.size(); ++i)
+        for (size_t j = i + 1; j < ids.size(); ++j)
+            EXPECT_NE(ids[i], ids[j]) << "replay ids must stay per-recipient";
+
+    // 5 leaves: leaf 0 has 3 siblings on its path, leaf 4 is promoted
+    // twice and has only 1 — same-length payloads, so exactly 2 hashes.
+    EXPECT_EQ(sealed[0].size() - sealed[4].size(), 2u * 32u);
+}
+
+TEST(SealedEnvelope, MultiRecipientHybridSharedDsaSignature) {
+    const EdKey sender = makeEd();
+    auto [dsaPub, dsaPriv] = CryptoEngine::generateDsaKeypair();
+    const auto peers = makeMultiPeers(3);
+    std::vector<Bytes> kemPrivs;
+
+    std::vector<SealedEnvelope::MultiRecipient> recips;
+    for (size_t i = 0; i < peers.size(); ++i) {
+        auto [kemPub, kemPriv] = CryptoEngine::generateKemKeypair();
+        kemPrivs.push_back(kemPriv);
+        auto r = multiRecipient(peers[i], bytesOf("hybrid multi"));
+        r.kemPub = kemPub;
+        recips.push_back(std::move(r));
+    }
+    recips[0].signDsa = true;                               // inline key
+    recips[1].signDsa = true;  recips[1].dsaPubByRef = true; // by reference
+    // recips[2]: Ed25519 only (ratchet traffic under HandshakeOnly)
+
+    const auto sealed = SealedEnvelope::sealMulti(
+        recips, sender.pub, sender.priv, dsaPub, dsaPriv);
+    ASSERT_EQ(sealed.size(), 3u);
+    for (const Bytes& s : sealed) {
+        ASSERT_FALSE(s.empty());
+        EXPECT_EQ(s[0], 0x05);
+    }
+
+    UnsealResult r0 = SealedEnvelope::unseal(
+        peers[0].curve.priv, peers[0].ed.pub, sealed[0], kemPrivs[0]);
+    ASSERT_TRUE(r0.valid);
+    EXPECT_EQ(r0.senderDsaPub, dsaPub);
+
+    UnsealResult r1 = SealedEnvelope::unseal(
+        peers[1].curve.priv, peers[1].ed.pub, sealed[1], kemPrivs[1],
+        [&](const Bytes&, const Bytes&) { return dsaPub; });
+    ASSERT_TRUE(r1.valid);
+    EXPECT_TRUE(r1.senderDsaPub.empty());
+
+    UnsealResult r2 = SealedEnvelope::unseal(
+        peers[2].curve.priv, peers[2].ed.pub, sealed[2], kemPrivs[2]);
+    ASSERT_TRUE(r2.valid);
+    EXPECT_TRUE(r2.senderDsaPub.empty());
+    EXPECT_LT(sealed[2].size(), sealed[1].size()) << "no DSA block for recipient 2";
+}
+
+TEST(SealedEnvelope, MultiRecipientBoundToEachRecipient) {
+    const EdKey sender = makeEd();
+    const auto  peers  = makeMultiPeers(2);
+    const auto sealed = SealedEnvelope::sealMulti(
+        {multiRecipient(peers[0], bytesOf("for zero")),
+         multiRecipient(peers[1], bytesOf("for one"))},
+        sender.pub, sender.priv);
+    ASSERT_EQ(sealed.size(), 2u);
+
+    // Someone else's keys can't open it, and the AAD still pins the
+    // routing recipient.
+    EXPECT_FALSE(SealedEnvelope::unseal(
+        peers[1].curve.priv, peers[1].ed.pub, sealed[0]).valid);
+    EXPECT_FALSE(SealedEnvelope::unseal(
+        peers[0].curve.priv, peers[1].ed.pub, sealed[0]).valid);
+
+    // Any flipped bit fails the MAC.
+    Bytes tampered = sealed[1];
+    tampered[tampered.size() / 2] ^= 0x01;
+    EXPECT_FALSE(SealedEnvelope::unseal(
+        peers[1].curve.priv, peers[1].ed.pub, tampered).valid);
+}
+
+TEST(SealedEnvelope, MultiRecipientSkipsMalformedRecipient) {
+    const EdKey sender = makeEd();
+    const auto  peers  = makeMultiPeers(3);
+
+    std::vector<SealedEnvelope::MultiRecipient> recips;
+    for (const auto& p : peers) recips.push_back(multiRecipient(p, bytesOf("x")));
+    recips[1].curvePub.resize(31);
+
+    const auto sealed = SealedEnvelope::sealMulti(recips, sender.pub, sender.priv);
+    ASSERT_EQ(sealed.size(), 3u);
+    EXPECT_TRUE(sealed[1].empty());
+    EXPECT_TRUE(SealedEnvelope::unseal(
+        peers[0].curve.priv, peers[0].ed.pub, sealed[0]).valid);
+    EXPECT_TRUE(SealedEnvelope::unseal(
+        peers[2].curve.priv, peers[2].ed.pub, sealed[2]).valid);
+
+    // Bad sender keys: nothing goes out.
+    const auto none = SealedEnvelope::sealMulti(recips, sender.pub, Bytes(10));
+    for (const Bytes& s : none) EXPECT_TRUE(s.empty());
+}
+
+// A group member holds the sender's shared signature over
+// label || count || root.  Those bytes also read as a single-recipient
+// (envelopeId || inner) pair, so the member re-seals them as a 0x02
+// envelope to someone else under the sender's identity.  unseal() must
+// refuse it.  Built by hand: the classical v2 wire format, opened and
+// re-sealed with the member's own keys.
+namespace {
+
+constexpr char kEnvelopeKeyLabel[] = "Peer2Pear-SealedEnvelope-v2";
+constexpr char kMultiLabel[]       = "Peer2Pear-SealedMulti-v1";
+
+void envelopeKeyFor(const uint8_t ecdh[32], uint8_t key[32]) {
+    crypto_generichash(key, 32, ecdh, 32,
+                       reinterpret_cast<const unsigned char*>(kEnvelopeKeyLabel),
+                       sizeof(kEnvelopeKeyLabel) - 1);
+}
+
+// version(1) || ephPub(32) || nonce(24) || ct — classical only.
+Bytes openClassical(const CurveKey& me, const Bytes& myEdPub, const Bytes& sealed) {
+    const Bytes eph(sealed.begin() + 1, sealed.begin() + 33);
+    uint8_t ecdh[32], key[32];
+    if (crypto_scalarmult(ecdh, me.priv.data(), eph.data()) != 0) return {};
+    envelopeKeyFor(ecdh, key);
+    Bytes aad = eph;
+    aad.insert(aad.end(), myEdPub.begin(), myEdPub.end());
+    const uint8_t* nonce = sealed.data() + 33;
+    const uint8_t* c     = nonce + crypto_aead_xchacha20poly1305_ietf_NPUBBYTES;
+    const size_t   cLen  = sealed.size() - 33 - crypto_aead_xchacha20poly1305_ietf_NPUBBYTES;
+    Bytes pt(cLen);
+    unsigned long long plen = 0;
+    if (crypto_aead_xchacha20poly1305_ietf_decrypt(pt.data(), &plen, nullptr, c, cLen,
+                                                   aad.data(), aad.size(), nonce, key) != 0)
+        return {};
+    pt.resize(size_t(plen));
+    return pt;
+}
+
+Bytes sealClassical(const Bytes& curvePub, const Bytes& edPub, const Bytes& pt) {
+    auto [ephPub, ephPriv] = CryptoEngine::generateEphemeralX25519();
+    uint8_t ecdh[32], key[32];
+    if (crypto_scalarmult(ecdh, ephPriv.data(), curvePub.data()) != 0) return {};
+    envelopeKeyFor(ecdh, key);
+    Bytes aad = ephPub;
+    aad.insert(aad.end(), edPub.begin(), edPub.end());
+    uint8_t nonce[crypto_aead_xchacha20poly1305_ietf_NPUBBYTES];
+    randombytes_buf(nonce, sizeof(nonce));
+    Bytes ct(pt.size() + crypto_aead_xchacha20poly1305_ietf_ABYTES);
+    unsigned long long clen = 0;
+    crypto_aead_xchacha20poly1305_ietf_encrypt(ct.data(), &clen, pt.data(), pt.size(),
+                                               aad.data(), aad.size(), nullptr, nonce, key);
+    Bytes out{0x02};
+    out.insert(out.end(), ephPub.begin(), ephPub.end());
+    out.insert(out.end(), nonce, nonce + sizeof(nonce));
+    out.insert(out.end(), ct.begin(), ct.begin() + long(clen));
+    return out;
+}
+
+}  // namespace
+
+TEST(SealedEnvelope, MultiRecipientSignatureCannotPassAsSingleRecipient) {
+    const EdKey sender = makeEd();
+    const auto  peers  = makeMultiPeers(2);   // [0] the member, [1] the victim
+    const Bytes inner  = bytesOf("group text");
+
+    // A one-leaf tree: the root is the member's own leaf, no path.
+    const auto sealed = SealedEnvelope::sealMulti(
+        {multiRecipient(peers[0], inner)}, sender.pub, sender.priv);
+    ASSERT_EQ(sealed.size(), 1u);
+    ASSERT_TRUE(SealedEnvelope::unseal(peers[0].curve.priv, peers[0].ed.pub,
+                                       sealed[0]).valid);
+
+    // envelopeId(16) || senderEdPub(32) || edSig(64) || 00 00
+    //   || leafIndex(2) || leafCount(2) || inner
+    const Bytes pt = openClassical(peers[0].curve, peers[0].ed.pub, sealed[0]);
+    ASSERT_EQ(pt.size(), 16u + 32u + 64u + 2u + 4u + inner.size());
+    const Bytes edSig(pt.begin() + 48, pt.begin() + 112);
+
+    Bytes root(32);
+    {
+        crypto_generichash_state st;
+        crypto_generichash_init(&st, reinterpret_cast<const unsigned char*>(kMultiLabel),
+                                sizeof(kMultiLabel) - 1, 32);
+        const uint8_t leafTag = 0x00;
+        crypto_generichash_update(&st, &leafTag, 1);
+        crypto_generichash_update(&st, peers[0].ed.pub.data(), 32);
+        crypto_generichash_update(&st, pt.data(), 16);
+        crypto_generichash_update(&st, inner.data(), inner.size());
+        crypto_generichash_final(&st, root.data(), 32);
+    }
+    Bytes signedBytes = bytesOf(kMultiLabel);
+    signedBytes.push_back(0);
+    signedBytes.push_back(1);
+    signedBytes.insert(signedBytes.end(), root.begin(), root.end());
+    ASSERT_EQ(crypto_sign_verify_detached(edSig.data(), signedBytes.data(),
+                                          signedBytes.size(), sender.pub.data()), 0)
+        << "test rebuilt the signed bytes wrong";
+
+    // Re-split the signed bytes at 16 and seal them to the victim.
+    Bytes forged(signedBytes.begin(), signedBytes.begin() + 16);
+    forged.insert(forged.end(), sender.pub.begin(), sender.pub.end());
+    forged.insert(forged.end(), edSig.begin(), edSig.end());
+    forged.push_back(0);
+    forged.push_back(0);
+    forged.insert(forged.end(), signedBytes.begin() + 16, signedBytes.end());
+
+    const Bytes envelope = sealClassical(peers[1].curve.pub, peers[1].ed.pub, forged);
+    ASSERT_FALSE(envelope.empty());
+    const UnsealResult r = SealedEnvelope::unseal(peers[1].curve.priv, peers[1].ed.pub,
+                                                  envelope);
+    EXPECT_FALSE(r.valid);
+    EXPECT_TRUE(r.senderEdPub.empty());
+    EXPECT_TRUE(r.innerPayload.empty());
+}
@@ -501,3 +501,37 @@ TEST_F(SessionManagerSuite, Corruption_FlippedBitInMsg1Dropped) {
     EXPECT_TRUE(bob.mgr->decryptFromPeer(alice.peerId, m1).empty());
     EXPECT_FALSE(bob.mgr->hasSession(alice.peerId));
 }
+
+// ── 14. "khv" switches a hybrid session to the flagged header ─────────
+// Hybrid ratchet messages start in the pre-cadence header layout so an
+// older peer can parse them.  Once the peer's advertised version is
+// passed on, the session writes flagged headers — and keeps doing so
+// after a restart.
+
+TEST_F(SessionManagerSuite, PeerKemHeaderVersionSwitchesLayoutAndPersists) {
+    ASSERT_TRUE(s_aliceCrypto->hasPQKeys());
+    const Bytes first = alice.mgr->encryptForPeer(bob.peerId, bytesOf("first"),
+                                                  s_bobCrypto->kemPub());
+    ASSERT_EQ(bob.mgr->decryptFromPeer(alice.peerId, first), bytesOf("first"));
+    ASSERT_EQ(bob.outgoing.size(), 1u);
+    (void)alice.mgr->decryptFromPeer(bob.peerId, bob.outgoing[0]);
+
+    // [0x03] || header: the byte after the 40 classical header bytes
+    // tells the layouts apart.
+    auto flagged = [](const Bytes& wire) {
+        return wire.size() > 41 && wire[0] == SessionManager::kRatchetMsg
+            && (wire[41] & RatchetHeader::kFlagMarker) != 0;
+    };
+
+    const Bytes before = alice.mgr->encryptForPeer(bob.peerId, bytesOf("before"));
+    EXPECT_FALSE(flagged(before));
+    EXPECT_EQ(bob.mgr->decryptFromPeer(alice.peerId, before), bytesOf("before"));
+
+    alice.mgr->notePeerKemHeader(bob.peerId, RatchetSession::kKemHeaderVersion);
+    alice.mgr.reset();
+    alice.mgr = std::make_unique<SessionManager>(*s_aliceCrypto, *alice.store);
+
+    const Bytes after = alice.mgr->encryptForPeer(bob.peerId, bytesOf("after"));
+    EXPECT_TRUE(flagged(after));
+    EXPECT_EQ(bob.mgr->decryptFromPeer(alice.peerId, after), bytesOf("after"));
+}
@@ -20,6 +20,7 @@
 #include "SessionSealer.hpp"
 
 #include "CryptoEngine.hpp"
+#include "SealedEnvelope.hpp"
 #include "SqlCipherDb.hpp"
 #include "test_support.hpp"
 
@@ -437,6 +438,24 @@ TEST_F(SessionSealerSuite, SealForPeer_EmptyWithoutSessionManager) {
     EXPECT_TRUE(m_sealer->sealForPeer(s_peerIdB64u, pt).empty());
 }
 
+TEST_F(SessionSealerSuite, SealForPeers_AlignedEmptyWithoutSessionManager) {
+    // Same guard as sealForPeer, one empty slot per input.
+    const auto out = m_sealer->sealForPeers(
+        {{s_peerIdB64u, Bytes{1, 2, 3}}, {"short", Bytes{4}}});
+    ASSERT_EQ(out.size(), 2u);
+    EXPECT_TRUE(out[0].empty());
+    EXPECT_TRUE(out[1].empty());
+}
+
+TEST_F(SessionSealerSuite, MultiSeal_FollowsPeerAdvertisement) {
+    EXPECT_FALSE(m_sealer->peerReadsMultiSeal(s_peerIdB64u));
+    m_sealer->notePeerMultiSeal(s_peerIdB64u, SessionSealer::kMultiSealVersion);
+    EXPECT_TRUE(m_sealer->peerReadsMultiSeal(s_peerIdB64u));
+    // A payload without "msv" (peer downgraded) turns it back off.
+    m_sealer->notePeerMultiSeal(s_peerIdB64u, 0);
+    EXPECT_FALSE(m_sealer->peerReadsMultiSeal(s_peerIdB64u));
+}
+
 // Arch-review #2: file chunks must share the hard-block-on-key-change
 // gate with text messages.  Before the fix, the setSealFn path called
 // SealedEnvelope::seal directly and skipped the trust check, so a
@@ -511,3 +530,62 @@ TEST_F(SessionSealerSuite, SealForPeer_RejectsTruncatedPeerId) {
     std::string oversized = s_peerIdB64u + s_peerIdB64u;  // 86 chars → 64+ bytes
     EXPECT_TRUE(m_sealer->sealForPeer(oversized, pt).empty());
 }
+
+// ── 9. ML-DSA pub cache + by-reference / signing policy ──────────────────────
+
+TEST_F(SessionSealerSuite, DsaPub_SaveLookupSurvivesFreshInstance) {
+    EXPECT_TRUE(m_sealer->lookupPeerDsaPub(s_peerIdB64u).empty());
+    EXPECT_TRUE(m_sealer->peerDsaKeyId(s_peerIdB64u).empty());
+
+    m_sealer->savePeerDsaPub(s_peerIdB64u, s_peerCrypto->dsaPub());
+    EXPECT_EQ(m_sealer->peerDsaKeyId(s_peerIdB64u),
+              SealedEnvelope::dsaKeyId(s_peerCrypto->dsaPub()));
+
+    // peer_dsa_keys is its own table, so non-contacts survive a restart
+    // too — a by-reference envelope after restart must still verify.
+    m_sealer.reset();
+    SessionSealer fresh(*s_meCrypto);
+    fresh.setDatabase(m_db.get());
+    EXPECT_EQ(fresh.lookupPeerDsaPub(s_peerIdB64u), s_peerCrypto->dsaPub());
+}
+
+TEST_F(SessionSealerSuite, DsaKeyAck_OnlyMatchingIdEnablesReference) {
+    ASSERT_TRUE(s_meCrypto->hasDSAKeys());
+    EXPECT_FALSE(m_sealer->peerHoldsOurDsaKey(s_peerIdB64u));
+
+    m_sealer->notePeerDsaKeyAck(s_peerIdB64u,
+                                SealedEnvelope::dsaKeyId(s_meCrypto->dsaPub()));
+    EXPECT_TRUE(m_sealer->peerHoldsOurDsaKey(s_peerIdB64u));
+
+    // A stale id (we regenerated) or no id at all (peer lost its DB)
+    // turns it back off so we resend the full key.
+    m_sealer->notePeerDsaKeyAck(s_peerIdB64u, Bytes(SealedEnvelope::kDsaKeyIdLen, 0x01));
+    EXPECT_FALSE(m_sealer->peerHoldsOurDsaKey(s_peerIdB64u));
+    m_sealer->notePeerDsaKeyAck(s_peerIdB64u,
+                                SealedEnvelope::dsaKeyId(s_meCrypto->dsaPub()));
+    m_sealer->notePeerDsaKeyAck(s_peerIdB64u, Bytes{});
+    EXPECT_FALSE(m_sealer->peerHoldsOurDsaKey(s_peerIdB64u));
+}
+
+// The point of both knobs: a small payload should land in the 2 KiB
+// relay bucket.  Inline key + signature (~5.3 KB) spills into 16 KiB;
+// by reference alone still carries the 3.3 KB signature; HandshakeOnly
+// drops the signature from ratchet-keyed traffic entirely.
+TEST_F(SessionSealerSuite, DsaSignPolicy_HandshakeOnlyKeepsChunksInSmallBucket) {
+    ASSERT_TRUE(s_meCrypto->hasDSAKeys());
+    const Bytes chunk(200, 0x42);
+
+    EXPECT_EQ(m_sealer->dsaSignPolicy(), SessionSealer::DsaSignPolicy::EveryEnvelope);
+    EXPECT_EQ(m_sealer->sealPreEncryptedForPeer(s_peerIdB64u, chunk).size(), 16u * 1024);
+
+    m_sealer->notePeerDsaKeyAck(s_peerIdB64u,
+                                SealedEnvelope::dsaKeyId(s_meCrypto->dsaPub()));
+    EXPECT_EQ(m_sealer->sealPreEncryptedForPeer(s_peerIdB64u, chunk).size(), 16u * 1024);
+
+    m_sealer->setDsaSignPolicy(SessionSealer::DsaSignPolicy::HandshakeOnly);
+    EXPECT_EQ(m_sealer->sealPreEncryptedForPeer(s_peerIdB64u, chunk).size(), 2u * 1024);
+
+    // Handshake responses stay signed regardless.
+    EXPECT_EQ(m_sealer->sealHandshakeResponseForPeer(s_peerIdB64u, chunk).size(),
+              16u * 1024);
+}
@@ -0,0 +1,194 @@
+// test_tree_hash.cpp — tests for TreeHash, the tree-v1 file integrity mode.
+//
+// TreeHash is a Merkle tree over 16 KiB leaves whose root stands in for
+// the sequential BLAKE2b-256 in a file_key.  The invariants pinned here:
+// the root doesn't depend on how many threads hashed the leaves or on
+// whether they came from a buffer or a file on disk, it commits to the
+// file size, every chunk at every chunk size a transfer can negotiate
+// verifies against the root on its own, and a chunk with a changed byte,
+// the wrong proof, or a misaligned range does not.
+//
+// The benchmark compares the sequential announce-time hash with a tree
+// build over the same file.
+
+#include "types.hpp"
+#include "TreeHash.hpp"
+#include "FileSource.hpp"
+#include "FileTransferManager.hpp"
+#include "test_support.hpp"
+
+#include <gtest/gtest.h>
+
+#include <sodium.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace fs = std::filesystem;
+
+namespace {
+
+using p2p_test::makeTempPath;
+using FTM = FileTransferManager;
+
+Bytes randomBytes(size_t n) {
+    Bytes b(n);
+    randombytes_buf(b.data(), n);
+    return b;
+}
+
+void writeFile(const std::string& path, const Bytes& bytes) {
+    std::ofstream f(path, std::ios::binary | std::ios::trunc);
+    f.write(reinterpret_cast<const char*>(bytes.data()),
+            std::streamsize(bytes.size()));
+    f.close();
+    ASSERT_TRUE(f.good()) << "failed writing " << path;
+}
+
+class Bootstrap : public ::testing::Environment {
+public:
+    void SetUp() override { ASSERT_GE(sodium_init(), 0); }
+};
+::testing::Environment* const kBootstrap =
+    ::testing::AddGlobalTestEnvironment(new Bootstrap);
+
+}  // namespace
+
+TEST(TreeHash, RootIndependentOfThreadsAndSource) {
+    const std::string path = makeTempPath("p2p-th-root", ".bin");
+    // Ragged tail, and an odd leaf count so unpaired nodes move up.
+    const Bytes bytes = randomBytes(3 * 1024 * 1024 + 5 * 16 * 1024 + 99);
+    writeFile(path, bytes);
+
+    const auto one  = TreeHash::build(bytes, 1);
+    const auto many = TreeHash::build(bytes, 4);
+    ASSERT_NE(one, nullptr);
+    ASSERT_NE(many, nullptr);
+    ASSERT_EQ(one->root().size(), 32u);
+    EXPECT_EQ(one->root(), many->root());
+
+    auto src = FileSource::open(path);
+    ASSERT_NE(src, nullptr);
+    const auto fromFile = TreeHash::build(*src, 3);
+    ASSERT_NE(fromFile, nullptr);
+    EXPECT_EQ(fromFile->root(), one->root());
+    EXPECT_EQ(fromFile->fileSize(), int64_t(bytes.size()));
+
+    // Not the sequential hash, and bound to the size: trailing zeros
+    // that leave every full leaf alone still move the root.
+    EXPECT_NE(one->root(), FTM::blake2b256(bytes));
+    Bytes padded = bytes;
+    padded.push_back(0);
+    EXPECT_NE(TreeHash::build(padded)->root(), one->root());
+
+    src.reset();
+    fs::remove(path);
+}
+
+TEST(TreeHash, EveryChunkVerifiesAtNegotiableSizes) {
+    const Bytes bytes = randomBytes(size_t(FTM::kMaxP2PChunkBytes) * 2 + 40000);
+    const auto tree = TreeHash::build(bytes);
+    ASSERT_NE(tree, nullptr);
+    const int64_t size = int64_t(bytes.size());
+
+    for (int64_t cb : {FTM::kChunkBytes,
+                       FTM::negotiateChunkBytes(size, 1000 * 1000, true),
+                       FTM::kMaxP2PChunkBytes}) {
+        ASSERT_EQ(cb % TreeHash::kLeafBytes, 0) << cb;
+        const int total = FTM::chunkCountFor(size, cb);
+        for (int i = 0; i < total; ++i) {
+            const int64_t off = int64_t(i) * cb;
+            const int64_t len = std::min(cb, size - off);
+            const Bytes proof = tree->rangeProof(off, len);
+            // Two siblings per level at most.
+            EXPECT_LE(proof.size(), 2u * 32u * 16u);
+            EXPECT_TRUE(TreeHash::verifyRange(tree->root(), size, off,
+                                              bytes.data() + off, size_t(len), proof))
+                << "chunk " << i << " of " << total << " at " << cb;
+        }
+    }
+
+    // A file inside one leaf is its own proof.
+    const Bytes small = randomBytes(1000);
+    const auto smallTree = TreeHash::build(small);
+    EXPECT_TRUE(smallTree->rangeProof(0, 1000).empty());
+    EXPECT_TRUE(TreeHash::verifyRange(smallTree->root(), 1000, 0,
+                                      small.data(), small.size(), {}));
+}
+
+TEST(TreeHash, RejectsTamperedChunkWrongProofAndBadRange) {
+    const int64_t cb = FTM::kChunkBytes;
+    const Bytes bytes = randomBytes(size_t(cb) * 6 + 1234);
+    const int64_t size = int64_t(bytes.size());
+    const auto tree = TreeHash::build(bytes);
+    const Bytes& root = tree->root();
+
+    const int64_t off = 2 * cb;
+    const Bytes proof = tree->rangeProof(off, cb);
+    ASSERT_TRUE(TreeHash::verifyRange(root, size, off, bytes.data() + off, size_t(cb), proof));
+
+    // One flipped byte.
+    Bytes chunk(bytes.begin() + off, bytes.begin() + off + cb);
+    chunk[chunk.size() / 2] ^= 0x01;
+    EXPECT_FALSE(TreeHash::verifyRange(root, size, off, chunk.data(), chunk.size(), proof));
+
+    // Right bytes, a neighbour's proof or the wrong place.
+    EXPECT_FALSE(TreeHash::verifyRange(root, size, off, bytes.data() + off, size_t(cb),
+                                       tree->rangeProof(off + cb, cb)));
+    EXPECT_FALSE(TreeHash::verifyRange(root, size, off + cb, bytes.data() + off,
+                                       size_t(cb), proof));
+
+    // Proof cut short, padded, or a different root / size.
+    EXPECT_FALSE(TreeHash::verifyRange(root, size, off, bytes.data() + off, size_t(cb),
+                                       Bytes(proof.begin(), proof.end() - 32)));
+    Bytes longer = proof;
+    longer.insert(longer.end(), 32, 0);
+    EXPECT_FALSE(TreeHash::verifyRange(root, size, off, bytes.data() + off, size_t(cb), longer));
+    EXPECT_FALSE(TreeHash::verifyRange(FTM::blake2b256(bytes), size, off,
+                                       bytes.data() + off, size_t(cb), proof));
+    EXPECT_FALSE(TreeHash::verifyRange(root, size + 1, off, bytes.data() + off,
+                                       size_t(cb), proof));
+
+    // Ranges that don't sit on leaf boundaries.
+    EXPECT_TRUE(tree->rangeProof(off + 1, cb).empty());
+    EXPECT_TRUE(tree->rangeProof(off, cb - 1).empty());
+    EXPECT_TRUE(tree->rangeProof(size - 10, 11).empty());
+    EXPECT_FALSE(TreeHash::validRange(size, 0, 0));
+    EXPECT_TRUE(TreeHash::validRange(size, 6 * cb, size - 6 * cb));
+}
+
+// Opt-in benchmark (see README); prints both, asserts nothing about
+// speed.  Both read the same warm page cache; the gap is the leaf
+// hashing spread over cores (plus the node hashes the tree adds).
+TEST(TreeHash, DISABLED_BenchmarkSequentialVsTreeBuild) {
+    const std::string path = makeTempPath("p2p-th-bench", ".bin");
+    writeFile(path, randomBytes(64 * 1024 * 1024));
+    auto src = FileSource::open(path);
+    ASSERT_NE(src, nullptr);
+    using Clock = std::chrono::steady_clock;
+
+    const auto t0 = Clock::now();
+    const Bytes seq = FTM::blake2b256(*src);
+    const auto t1 = Clock::now();
+    const auto tree = TreeHash::build(*src);
+    const auto t2 = Clock::now();
+    ASSERT_EQ(seq.size(), 32u);
+    ASSERT_NE(tree, nullptr);
+
+    auto ms = [](Clock::duration d) {
+        return static_cast<long long>(
+            std::chrono::duration_cast<std::chrono::milliseconds>(d).count());
+    };
+    std::printf("[bench] announce hash 64 MB: sequential BLAKE2b %lld ms, "
+                "tree-v1 on %u thread(s) %lld ms\n",
+                ms(t1 - t0), TreeHash::threadsFor(src->size()), ms(t2 - t1));
+
+    src.reset();
+    fs::remove(path);
+}
@@ -0,0 +1,502 @@
+#include "IceAgentPool.hpp"
+#include "log.hpp"
+#include "shared.hpp"
+
+#include <gio/gio.h>
+#include <sodium.h>
+
+#include <algorithm>
+#include <future>
+
+using p2p::steadyMs;
+
+namespace {
+
+// An agent still gathering after this long is stuck (STUN / TURN server
+// unreachable past libnice's own retries); close it and try again.
+constexpr int64_t kGatherTimeoutMs = 30 * 1000;
+// Expiry + refill cadence on the loop thread.
+constexpr guint kReapIntervalSecs = 5;
+
+std::string turnKeyFor(const IceAgentPool::Turn& turn)
+{
+    if (!turn.enabled()) return {};
+    unsigned char h[16];
+    crypto_generichash_state st;
+    crypto_generichash_init(&st, nullptr, 0, sizeof(h));
+    const std::string port = std::to_string(turn.port);
+    for (const std::string* part : {&turn.host, &port, &turn.user, &turn.pass}) {
+        crypto_generichash_update(&st, reinterpret_cast<const unsigned char*>(part->c_str()),
+                                  part->size() + 1);   // keep the NUL as a separator
+    }
+    crypto_generichash_final(&st, h, sizeof(h));
+    return std::string(reinterpret_cast<const char*>(h), sizeof(h));
+}
+
+void zeroTurn(IceAgentPool::Turn& turn)
+{
+    if (!turn.user.empty()) sodium_memzero(turn.user.data(), turn.user.size());
+    if (!turn.pass.empty()) sodium_memzero(turn.pass.data(), turn.pass.size());
+    turn = {};
+}
+
+void zeroBytes(Bytes& b)
+{
+    if (!b.empty()) sodium_memzero(b.data(), b.size());
+    b.clear();
+}
+
+}  // namespace
+
+IceAgentPool& IceAgentPool::instance()
+{
+    static IceAgentPool pool;
+    return pool;
+}
+
+IceAgentPool::~IceAgentPool()
+{
+    if (!m_loop) return;
+    g_main_loop_quit(m_loop);
+    if (m_thread.joinable()) {
+        if (m_thread.get_id() == std::this_thread::get_id()) m_thread.detach();
+        else m_thread.join();
+    }
+    for (Entry& e : m_entries) {
+        g_signal_handlers_disconnect_by_data(e.agent, this);
+        g_object_unref(e.agent);
+    }
+    m_entries.clear();
+    zeroBytes(m_turn.user);
+    zeroBytes(m_turn.pass);
+    zeroBytes(m_credsKey);
+    g_main_loop_unref(m_loop);
+    g_main_context_unref(m_context);
+}
+
+void IceAgentPool::configure(const Config& cfg)
+{
+    std::vector<NiceAgent*> drop;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_cfg = cfg;
+        m_stunIp.clear();
+        m_stunResolvedMs = 0;
+        drop = dropAllLocked();
+    }
+    for (NiceAgent* agent : drop) closeAgent(agent, this);
+    scheduleRefill();
+}
+
+IceAgentPool::Config IceAgentPool::config() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_cfg;
+}
+
+// ── Shared main loop ────────────────────────────────────────────────────────
+
+void IceAgentPool::ensureLoopLocked()
+{
+    if (m_context) return;
+    m_context = g_main_context_new();
+    m_loop    = g_main_loop_new(m_context, FALSE);
+
+    GSource* reaper = g_timeout_source_new_seconds(kReapIntervalSecs);
+    g_source_set_callback(reaper, &IceAgentPool::cbReap, this, nullptr);
+    g_source_attach(reaper, m_context);
+    g_source_unref(reaper);
+
+    // Thread-default so GResolver's async result lands back on this loop.
+    m_thread = std::thread([ctx = m_context, loop = m_loop]() {
+        g_main_context_push_thread_default(ctx);
+        g_main_loop_run(loop);
+        g_main_context_pop_thread_default(ctx);
+    });
+    P2P_LOG("[ICE] Shared main loop started");
+}
+
+GMainContext* IceAgentPool::context()
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    ensureLoopLocked();
+    return m_context;
+}
+
+bool IceAgentPool::onLoopThread()
+{
+    return g_main_context_is_owner(context());
+}
+
+void IceAgentPool::invokeSync(const std::function<void()>& fn)
+{
+    GMainContext* ctx = context();
+    if (g_main_context_is_owner(ctx)) {
+        fn();
+        return;
+    }
+    struct Call {
+        const std::function<void()>* fn;
+        std::promise<void>           done;
+    } call{&fn, {}};
+    std::future<void> done = call.done.get_future();
+    g_main_context_invoke(ctx, [](gpointer data) -> gboolean {
+        auto* c = static_cast<Call*>(data);
+        (*c->fn)();
+        c->done.set_value();
+        return G_SOURCE_REMOVE;
+    }, &call);
+    done.wait();
+}
+
+// ── Agents ──────────────────────────────────────────────────────────────────
+
+NiceAgent* IceAgentPool::createAgent(const Turn& turn, guint& streamId)
+{
+    GMainContext* ctx = context();
+    NiceAgent* agent = nice_agent_new(ctx, NICE_COMPATIBILITY_RFC5245);
+
+    std::string stunServer;
+    int stunPort = 0;
+    bool resolve = false;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (!m_cfg.stunHost.empty()) {
+            const int64_t now = steadyMs();
+            resolve = !m_stunResolving &&
+                      (m_stunResolvedMs == 0 || now - m_stunResolvedMs >= m_cfg.stunResolveTtlMs);
+            // Until the first lookup lands, pass the name through as before.
+            stunServer = m_stunIp.empty() ? m_cfg.stunHost : m_stunIp;
+            stunPort   = m_cfg.stunPort;
+        }
+    }
+    if (resolve) g_main_context_invoke(ctx, &IceAgentPool::cbResolveStun, this);
+    if (!stunServer.empty()) {
+        g_object_set(G_OBJECT(agent), "stun-server", stunServer.c_str(), NULL);
+        g_object_set(G_OBJECT(agent), "stun-server-port", stunPort, NULL);
+    }
+    applyAddresses(agent);
+
+    streamId = nice_agent_add_stream(agent, 1);
+
+    // TURN relay (required for symmetric NAT).
+    if (turn.enabled()) {
+        nice_agent_set_relay_info(agent, streamId, 1,
+            turn.host.c_str(), turn.port,
+            turn.user.c_str(), turn.pass.c_str(),
+            NICE_RELAY_TYPE_TURN_UDP);
+        P2P_LOG("[ICE] TURN relay configured: " << turn.host << ":" << turn.port);
+    }
+    return agent;
+}
+
+void IceAgentPool::applyAddresses(NiceAgent* agent)
+{
+    std::vector<std::string> addrs;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        addrs = m_cfg.localAddresses;
+    }
+    for (const std::string& a : addrs) {
+        NiceAddress addr;
+        nice_address_init(&addr);
+        if (nice_address_set_from_string(&addr, a.c_str()))
+            nice_agent_add_local_address(agent, &addr);
+        else
+            P2P_WARN("[ICE] Ignoring bad local address " << a);
+    }
+}
+
+void IceAgentPool::closeAgent(NiceAgent* agent, gpointer handlerData)
+{
+    if (!agent) return;
+    struct Close { NiceAgent* agent; gpointer data; };
+    g_main_context_invoke(context(), [](gpointer data) -> gboolean {
+        auto* c = static_cast<Close*>(data);
+        if (c->data) g_signal_handlers_disconnect_by_data(c->agent, c->data);
+        nice_agent_close_async(c->agent, nullptr, nullptr);
+        g_object_unref(c->agent);
+        delete c;
+        return G_SOURCE_REMOVE;
+    }, new Close{agent, handlerData});
+}
+
+// ── Pool ────────────────────────────────────────────────────────────────────
+
+IceAgentPool::Prepared IceAgentPool::take(const Turn& turn)
+{
+    Prepared out;
+    std::vector<NiceAgent*> drop;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        ensureLoopLocked();
+        drop = noteDemandLocked(turn);
+        const int64_t now = steadyMs();
+        for (auto it = m_entries.begin(); it != m_entries.end(); ++it) {
+            if (it->gatheredMs == 0 || it->turnKey != m_turnKey) continue;
+            if (now - it->gatheredMs >= m_cfg.candidateTtlMs) continue;   // reap() closes it
+            out.agent    = it->agent;
+            out.streamId = it->streamId;
+            out.localSdp = std::move(it->localSdp);
+            m_entries.erase(it);
+            break;
+        }
+        if (out.agent) ++m_stats.hits;
+        else           ++m_stats.misses;
+    }
+    for (NiceAgent* agent : drop) closeAgent(agent, this);
+    if (out.agent) g_signal_handlers_disconnect_by_data(out.agent, this);
+    scheduleRefill();
+    return out;
+}
+
+void IceAgentPool::prewarm(const Turn& turn)
+{
+    std::vector<NiceAgent*> drop;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        ensureLoopLocked();
+        drop = noteDemandLocked(turn);
+    }
+    for (NiceAgent* agent : drop) closeAgent(agent, this);
+    scheduleRefill();
+}
+
+std::vector<NiceAgent*> IceAgentPool::noteDemandLocked(const Turn& turn)
+{
+    m_lastDemandMs = std::max<int64_t>(steadyMs(), 1);
+    std::string key = turnKeyFor(turn);
+    if (key == m_turnKey) return {};
+
+    zeroBytes(m_turn.user);
+    zeroBytes(m_turn.pass);
+    m_turn.host = turn.host;
+    m_turn.port = turn.port;
+    m_turn.user = sealCred(turn.user);
+    m_turn.pass = sealCred(turn.pass);
+    m_turnKey   = std::move(key);
+    std::vector<NiceAgent*> drop;
+    for (auto it = m_entries.begin(); it != m_entries.end();) {
+        if (it->turnKey == m_turnKey) { ++it; continue; }
+        drop.push_back(it->agent);
+        it = m_entries.erase(it);
+    }
+    return drop;
+}
+
+// nonce || secretbox(s), under a key drawn on first use that never
+// leaves the process.  Between refills the pool holds no plaintext copy.
+Bytes IceAgentPool::sealCred(const std::string& s)
+{
+    if (s.empty()) return {};
+    if (m_credsKey.empty()) {
+        m_credsKey.resize(crypto_secretbox_KEYBYTES);
+        randombytes_buf(m_credsKey.data(), m_credsKey.size());
+    }
+    Bytes ct(crypto_secretbox_NONCEBYTES + crypto_secretbox_MACBYTES + s.size());
+    randombytes_buf(ct.data(), crypto_secretbox_NONCEBYTES);
+    crypto_secretbox_easy(ct.data() + crypto_secretbox_NONCEBYTES,
+                          reinterpret_cast<const unsigned char*>(s.data()), s.size(),
+                          ct.data(), m_credsKey.data());
+    return ct;
+}
+
+std::string IceAgentPool::openCred(const Bytes& ct) const
+{
+    if (ct.size() < crypto_secretbox_NONCEBYTES + crypto_secretbox_MACBYTES ||
+        m_credsKey.empty()) return {};
+    std::string s(ct.size() - crypto_secretbox_NONCEBYTES - crypto_secretbox_MACBYTES, '\0');
+    if (crypto_secretbox_open_easy(reinterpret_cast<unsigned char*>(s.data()),
+                                   ct.data() + crypto_secretbox_NONCEBYTES,
+                                   ct.size() - crypto_secretbox_NONCEBYTES,
+                                   ct.data(), m_credsKey.data()) != 0) {
+        sodium_memzero(s.data(), s.size());
+        return {};
+    }
+    return s;
+}
+
+std::vector<NiceAgent*> IceAgentPool::dropAllLocked()
+{
+    std::vector<NiceAgent*> drop;
+    for (Entry& e : m_entries) drop.push_back(e.agent);
+    m_entries.clear();
+    return drop;
+}
+
+void IceAgentPool::scheduleRefill()
+{
+    GMainContext* ctx = nullptr;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (!m_context || m_lastDemandMs == 0) return;
+        ctx = m_context;
+    }
+    g_main_context_invoke(ctx, &IceAgentPool::cbRefill, this);
+}
+
+void IceAgentPool::refill()
+{
+    Turn        turn;
+    std::string turnKey;
+    size_t      need = 0;
+    bool        needStun = false;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        const int64_t now = steadyMs();
+        if (m_lastDemandMs == 0 || now - m_lastDemandMs >= m_cfg.idleStopMs) return;
+        // Gather once the STUN address is known, so pooled agents carry
+        // a server-reflexive candidate.  cbResolved() refills when done.
+        if (m_stunResolving) return;
+        needStun = !m_cfg.stunHost.empty() && m_stunResolvedMs == 0;
+        if (m_entries.size() < m_cfg.warmAgents) need = m_cfg.warmAgents - m_entries.size();
+        if (need > 0 && !needStun)
+            turn = {m_turn.host, m_turn.port, openCred(m_turn.user), openCred(m_turn.pass)};
+        turnKey = m_turnKey;
+    }
+    if (needStun) {
+        zeroTurn(turn);
+        resolveStun();
+        return;
+    }
+
+    for (size_t i = 0; i < need; ++i) {
+        Entry e;
+        e.agent     = createAgent(turn, e.streamId);
+        e.turnKey   = turnKey;
+        e.startedMs = steadyMs();
+        g_signal_connect(G_OBJECT(e.agent), "candidate-gathering-done",
+                         G_CALLBACK(cbGatheringDone), this);
+        NiceAgent* agent = e.agent;
+        const guint streamId = e.streamId;
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_entries.push_back(std::move(e));
+        }
+        // May signal gathering-done before returning — the entry is
+        // already in place for cbGatheringDone to find.
+        nice_agent_gather_candidates(agent, streamId);
+    }
+    zeroTurn(turn);
+}
+
+void IceAgentPool::reap()
+{
+    std::vector<NiceAgent*> drop;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        const int64_t now = steadyMs();
+        for (auto it = m_entries.begin(); it != m_entries.end();) {
+            const bool stale = it->gatheredMs
+                ? now - it->gatheredMs >= m_cfg.candidateTtlMs
+                : now - it->startedMs  >= kGatherTimeoutMs;
+            if (!stale && it->turnKey == m_turnKey) { ++it; continue; }
+            if (it->gatheredMs) ++m_stats.expired;
+            drop.push_back(it->agent);
+            it = m_entries.erase(it);
+        }
+    }
+    for (NiceAgent* agent : drop) closeAgent(agent, this);
+    refill();
+}
+
+void IceAgentPool::resolveStun()
+{
+    std::string host;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (m_stunResolving || m_cfg.stunHost.empty()) return;
+        m_stunResolving = true;
+        host = m_cfg.stunHost;
+    }
+    GResolver* resolver = g_resolver_get_default();
+    g_resolver_lookup_by_name_async(resolver, host.c_str(), nullptr,
+                                    &IceAgentPool::cbResolved, this);
+    g_object_unref(resolver);
+}
+
+IceAgentPool::Stats IceAgentPool::stats() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_stats;
+}
+
+size_t IceAgentPool::readyCount() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    const int64_t now = steadyMs();
+    return size_t(std::count_if(m_entries.begin(), m_entries.end(), [&](const Entry& e) {
+        return e.gatheredMs && e.turnKey == m_turnKey &&
+               now - e.gatheredMs < m_cfg.candidateTtlMs;
+    }));
+}
+
+// ── Loop-thread callbacks ───────────────────────────────────────────────────
+
+gboolean IceAgentPool::cbRefill(gpointer data)
+{
+    static_cast<IceAgentPool*>(data)->refill();
+    return G_SOURCE_REMOVE;
+}
+
+gboolean IceAgentPool::cbReap(gpointer data)
+{
+    static_cast<IceAgentPool*>(data)->reap();
+    return G_SOURCE_CONTINUE;
+}
+
+gboolean IceAgentPool::cbResolveStun(gpointer data)
+{
+    static_cast<IceAgentPool*>(data)->resolveStun();
+    return G_SOURCE_REMOVE;
+}
+
+void IceAgentPool::cbResolved(GObject* source, GAsyncResult* result, gpointer data)
+{
+    IceAgentPool* self = static_cast<IceAgentPool*>(data);
+    GError* err = nullptr;
+    GList* addrs = g_resolver_lookup_by_name_finish(G_RESOLVER(source), result, &err);
+
+    // Prefer IPv4: the agents gather IPv4 host candidates on every
+    // interface, IPv6 only where configured.
+    std::string ip;
+    for (GList* l = addrs; l; l = l->next) {
+        GInetAddress* a = G_INET_ADDRESS(l->data);
+        const bool v4 = g_inet_address_get_family(a) == G_SOCKET_FAMILY_IPV4;
+        if (!ip.empty() && !v4) continue;
+        gchar* s = g_inet_address_to_string(a);
+        ip = s;
+        g_free(s);
+        if (v4) break;
+    }
+    if (addrs) g_resolver_free_addresses(addrs);
+    if (err) {
+        P2P_WARN("[ICE] STUN server lookup failed: " << err->message);
+        g_error_free(err);
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(self->m_mutex);
+        self->m_stunResolving  = false;
+        self->m_stunResolvedMs = std::max<int64_t>(steadyMs(), 1);
+        if (!ip.empty()) self->m_stunIp = ip;
+    }
+    self->refill();
+}
+
+void IceAgentPool::cbGatheringDone(NiceAgent* agent, guint /*streamId*/, gpointer data)
+{
+    IceAgentPool* self = static_cast<IceAgentPool*>(data);
+    gchar* sdp = nice_agent_generate_local_sdp(agent);
+    {
+        std::lock_guard<std::mutex> lock(self->m_mutex);
+        for (Entry& e : self->m_entries) {
+            if (e.agent != agent) continue;
+            e.localSdp   = sdp ? sdp : "";
+            e.gatheredMs = std::max<int64_t>(steadyMs(), 1);
+            ++self->m_stats.gathered;
+            break;
+        }
+    }
+    g_free(sdp);
+}
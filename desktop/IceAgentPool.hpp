@@ -0,0 +1,173 @@
+#pragma once
+
+#include "types.hpp"
+//
+// IceAgentPool — process-wide ICE runtime shared by every NiceConnection.
+//
+//   - Main loop: one GLib main context + one worker thread drive every
+//     libnice agent in the process, instead of a context + loop + thread
+//     per connection.  All libnice callbacks fire on that thread.
+//   - Agent pool: a few agents are kept with candidate gathering already
+//     done, so a new connection can hand out its SDP immediately instead
+//     of waiting on host enumeration + the STUN round trip.
+//   - Candidate TTL: a pooled agent's host and server-reflexive candidates
+//     are only handed out for candidateTtlMs after gathering — NAT
+//     bindings and interface addresses go stale — after which the agent
+//     is closed and a fresh one gathered.  Candidates can't be copied
+//     between agents (a srflx candidate is the NAT mapping of that
+//     agent's own socket), so the agent is the unit of caching.
+//   - STUN address cache: libnice wants a literal IP for "stun-server";
+//     the configured host is resolved asynchronously on the loop thread
+//     and the address reused for stunResolveTtlMs.
+//
+// Pooled agents are gathered with the most recent TURN config passed to
+// take() / prewarm(); a take() with different TURN settings misses and
+// re-primes the pool.  The pool keeps that config's username and
+// password only as ciphertext under a process-ephemeral key, opened
+// into a scratch copy for each refill and zeroed after it.  Refills stop once nothing has asked for an agent
+// in idleStopMs, so an idle client doesn't keep pinging the STUN server.
+//
+// **Threading:** take() / prewarm() / createAgent() are callable from any
+// thread.  Agent creation for the pool, gathering callbacks, expiry and
+// teardown all run on the loop thread.
+//
+
+#undef signals
+#include <nice/agent.h>
+#define signals Q_SIGNALS
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+class IceAgentPool {
+public:
+    struct Config {
+        std::string stunHost         = "stun.l.google.com";   // empty = no STUN
+        int         stunPort         = 19302;
+        size_t      warmAgents       = 2;
+        int64_t     candidateTtlMs   = 60 * 1000;
+        int64_t     idleStopMs       = 10 * 60 * 1000;
+        int64_t     stunResolveTtlMs = 10 * 60 * 1000;
+        // Gather on these addresses only (e.g. "127.0.0.1"); empty means
+        // every non-loopback interface, libnice's default.
+        std::vector<std::string> localAddresses;
+    };
+
+    struct Turn {
+        std::string host;
+        int         port = 0;
+        std::string user;
+        std::string pass;
+        bool enabled() const { return !host.empty() && port > 0; }
+    };
+
+    // A gathered agent handed over by take().  `agent` is null on a miss.
+    // The caller owns the reference and must retire it with closeAgent().
+    struct Prepared {
+        NiceAgent*  agent    = nullptr;
+        guint       streamId = 0;
+        std::string localSdp;
+    };
+
+    struct Stats {
+        uint64_t hits     = 0;   // take() handed out a gathered agent
+        uint64_t misses   = 0;   // ... had none — caller gathers cold
+        uint64_t gathered = 0;   // pool agents that finished gathering
+        uint64_t expired  = 0;   // pool agents closed unused after the TTL
+    };
+
+    static IceAgentPool& instance();
+
+    // Replace the config; pooled agents are closed and re-gathered.
+    void configure(const Config& cfg);
+    Config config() const;
+
+    // The shared context.  Starts the loop thread on first use.
+    GMainContext* context();
+    bool onLoopThread();
+    // Run `fn` on the loop thread and wait for it (inline when already
+    // there).  Used to serialize teardown against in-flight callbacks.
+    void invokeSync(const std::function<void()>& fn);
+
+    Prepared take(const Turn& turn);
+    // Start filling the pool for `turn` ahead of the first take().
+    void prewarm(const Turn& turn);
+
+    // A new agent on the shared context with STUN / TURN applied and one
+    // single-component stream added.  Gathering not started.
+    NiceAgent* createAgent(const Turn& turn, guint& streamId);
+    // Close + release an agent on the loop thread.  Disconnects every
+    // signal handler registered with `handlerData` first.
+    void closeAgent(NiceAgent* agent, gpointer handlerData);
+
+    Stats stats() const;
+    // Pooled agents gathered and inside their TTL.
+    size_t readyCount() const;
+
+    IceAgentPool(const IceAgentPool&) = delete;
+    IceAgentPool& operator=(const IceAgentPool&) = delete;
+
+private:
+    IceAgentPool() = default;
+    ~IceAgentPool();
+
+    // m_turn as kept between refills: credentials sealed, see sealCred().
+    struct SealedTurn {
+        std::string host;
+        int         port = 0;
+        Bytes       user;
+        Bytes       pass;
+    };
+
+    struct Entry {
+        NiceAgent*  agent      = nullptr;
+        guint       streamId   = 0;
+        std::string localSdp;
+        std::string turnKey;
+        int64_t     startedMs  = 0;
+        int64_t     gatheredMs = 0;   // 0 while gathering
+    };
+
+    void ensureLoopLocked();
+    // Record a request for an agent with `turn`.  Returns pooled agents
+    // gathered with a different TURN config, for the caller to close.
+    std::vector<NiceAgent*> noteDemandLocked(const Turn& turn);
+    std::vector<NiceAgent*> dropAllLocked();
+    void scheduleRefill();
+    void refill();          // loop thread
+    void reap();            // loop thread
+    void resolveStun();     // loop thread
+    void applyAddresses(NiceAgent* agent);
+    Bytes       sealCred(const std::string& s);        // m_mutex held
+    std::string openCred(const Bytes& ct) const;       // m_mutex held
+
+    static gboolean cbRefill(gpointer data);
+    static gboolean cbReap(gpointer data);
+    static gboolean cbResolveStun(gpointer data);
+    static void     cbResolved(GObject* source, GAsyncResult* result, gpointer data);
+    static void     cbGatheringDone(NiceAgent* agent, guint streamId, gpointer data);
+
+    mutable std::mutex m_mutex;
+    Config             m_cfg;
+
+    GMainContext* m_context = nullptr;
+    GMainLoop*    m_loop    = nullptr;
+    std::thread   m_thread;
+
+    std::vector<Entry> m_entries;
+    SealedTurn         m_turn;         // config the pool gathers with
+    std::string        m_turnKey;      // hash of the plaintext config
+    Bytes              m_credsKey;     // seals m_turn's credentials
+    int64_t            m_lastDemandMs = 0;
+
+    std::string m_stunIp;              // cached resolution of m_cfg.stunHost
+    int64_t     m_stunResolvedMs = 0;
+    bool        m_stunResolving  = false;
+
+    Stats m_stats;
+};
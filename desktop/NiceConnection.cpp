@@ -1,4 +1,5 @@
 #include "NiceConnection.hpp"
+#include "IceAgentPool.hpp"
 #include "log.hpp"
 #include <sodium.h>
 #include <cstring>
@@ -8,15 +9,20 @@ NiceConnection::NiceConnection()
 
 NiceConnection::~NiceConnection() {
     if (m_agent) {
-        nice_agent_close_async(m_agent, nullptr, nullptr);
+        // Detach on the loop thread: once this returns, no libnice
+        // callback is running into (or queued for) this object.
+        IceAgentPool& pool = IceAgentPool::instance();
+        pool.invokeSync([this, &pool]() {
+            if (m_sdpSource) {
+                g_source_destroy(m_sdpSource);
+                g_source_unref(m_sdpSource);
+                m_sdpSource = nullptr;
+            }
+            nice_agent_attach_recv(m_agent, m_streamId, 1, pool.context(), nullptr, nullptr);
+            pool.closeAgent(m_agent, this);
+        });
+        m_agent = nullptr;
     }
-    if (m_loop) {
-        g_main_loop_quit(m_loop);
-        if (m_thread.joinable()) m_thread.join();
-        g_main_loop_unref(m_loop);
-        g_main_context_unref(m_context);
-    }
-    if (m_agent) g_object_unref(m_agent);
     // Zero TURN credentials in memory.
     if (!m_turnUser.empty()) {
         sodium_memzero(m_turnUser.data(), m_turnUser.size());
@@ -37,40 +43,45 @@ void NiceConnection::setTurnServer(const std::string& host, int port,
 }
 
 void NiceConnection::initIce(bool controlling) {
-    m_context = g_main_context_new();
-    m_loop = g_main_loop_new(m_context, FALSE);
-
-    m_agent = nice_agent_new(m_context, NICE_COMPATIBILITY_RFC5245);
+    // STUN server, TURN relay and the shared GLib context all come from
+    // IceAgentPool; a pooled agent has its candidates gathered already.
+    IceAgentPool& pool = IceAgentPool::instance();
+    const IceAgentPool::Turn turn{m_turnHost, m_turnPort, m_turnUser, m_turnPass};
+    IceAgentPool::Prepared prepared = pool.take(turn);
+    const bool pooled = prepared.agent != nullptr;
+    if (pooled) {
+        m_agent    = prepared.agent;
+        m_streamId = prepared.streamId;
+    } else {
+        m_agent = pool.createAgent(turn, m_streamId);
+    }
     g_object_set(G_OBJECT(m_agent), "controlling-mode", controlling ? TRUE : FALSE, NULL);
 
-    // Add a public STUN server for NAT traversal.
-    g_object_set(G_OBJECT(m_agent), "stun-server", "stun.l.google.com", NULL);
-    g_object_set(G_OBJECT(m_agent), "stun-server-port", 19302, NULL);
-
-    m_streamId = nice_agent_add_stream(m_agent, 1);
-
-    // Add TURN relay server if configured (required for symmetric NAT).
-    if (!m_turnHost.empty() && m_turnPort > 0) {
-        nice_agent_set_relay_info(m_agent, m_streamId, 1,
-            m_turnHost.c_str(), m_turnPort,
-            m_turnUser.c_str(), m_turnPass.c_str(),
-            NICE_RELAY_TYPE_TURN_UDP);
-        P2P_LOG("[ICE] TURN relay configured: " << m_turnHost << ":" << m_turnPort);
+    g_signal_connect(G_OBJECT(m_agent), "component-state-changed", G_CALLBACK(cbComponentStateChanged), this);
+    nice_agent_attach_recv(m_agent, m_streamId, 1, pool.context(), cbRecv, this);
+
+    if (pooled) {
+        P2P_LOG("[ICE] Using pre-gathered agent | sdp length: " << prepared.localSdp.size());
+        m_pooledSdp = std::move(prepared.localSdp);
+        m_sdpSource = g_idle_source_new();
+        g_source_set_callback(m_sdpSource, &NiceConnection::cbPooledSdp, this, nullptr);
+        g_source_attach(m_sdpSource, pool.context());
+        return;
     }
-
     g_signal_connect(G_OBJECT(m_agent), "candidate-gathering-done", G_CALLBACK(cbCandidateGatheringDone), this);
-    g_signal_connect(G_OBJECT(m_agent), "component-state-changed", G_CALLBACK(cbComponentStateChanged), this);
-
-    nice_agent_attach_recv(m_agent, m_streamId, 1, m_context, cbRecv, this);
-
-    // Run the GLib main loop on a worker thread; libnice callbacks fire there.
-    m_thread = std::thread([this]() { runMainLoop(); });
-    nice_agent_gather_candidates(m_agent, m_streamId);
+    // libnice emits signals on whichever thread drops the agent lock; gather
+    // on the loop thread so a host-only gather's callback lands there too.
+    pool.invokeSync([this]() { nice_agent_gather_candidates(m_agent, m_streamId); });
 }
 
 void NiceConnection::setRemoteSdp(const std::string& sdp) {
     if (m_agent) {
-        int parsed = nice_agent_parse_remote_sdp(m_agent, sdp.c_str());
+        // On the loop thread, like gathering — parsing can kick off
+        // connectivity checks and their state callbacks.
+        int parsed = 0;
+        IceAgentPool::instance().invokeSync([&]() {
+            parsed = nice_agent_parse_remote_sdp(m_agent, sdp.c_str());
+        });
         P2P_LOG("[ICE] setRemoteSdp: parsed " << parsed << " candidates"
                 << " | sdp length: " << sdp.size());
     } else {
@@ -120,10 +131,6 @@ bool NiceConnection::isRelayed() const {
            (remote && remote->type == NICE_CANDIDATE_TYPE_RELAYED);
 }
 
-void NiceConnection::runMainLoop() {
-    g_main_loop_run(m_loop);
-}
-
 void NiceConnection::cbCandidateGatheringDone(NiceAgent* agent, guint /*stream_id*/, gpointer data) {
     NiceConnection* self = static_cast<NiceConnection*>(data);
     gchar* sdp = nice_agent_generate_local_sdp(agent);
@@ -133,6 +140,12 @@ void NiceConnection::cbCandidateGatheringDone(NiceAgent* agent, guint /*stream_i
     g_free(sdp);
 }
 
+gboolean NiceConnection::cbPooledSdp(gpointer data) {
+    NiceConnection* self = static_cast<NiceConnection*>(data);
+    if (self->onLocalSdpReady) self->onLocalSdpReady(self->m_pooledSdp);
+    return G_SOURCE_REMOVE;
+}
+
 void NiceConnection::cbComponentStateChanged(NiceAgent* /*agent*/, guint /*stream_id*/, guint /*component_id*/, guint state, gpointer data) {
     NiceConnection* self = static_cast<NiceConnection*>(data);
     self->m_state = state;
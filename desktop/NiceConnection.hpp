@@ -8,11 +8,16 @@
 // `std::function` callbacks pattern.  This keeps the door open for
 // cross-platform P2P; libnice itself is C-only.
 //
-// **Threading model:** initIce() spawns a worker thread that runs the GLib
-// main loop.  All libnice callbacks (and therefore all of the on* callbacks
-// below) fire on that worker thread.  Callers must marshal back to their
-// own thread if they need it (desktop's QuicConnection runs on the GLib
-// thread by design — no marshaling needed there).
+// **Threading model:** every NiceConnection's agent runs on the single
+// GLib main loop thread owned by IceAgentPool.  All libnice callbacks (and
+// therefore all of the on* callbacks below) fire on that thread.  Callers
+// must marshal back to their own thread if they need it (desktop's
+// QuicConnection runs on the GLib thread by design — no marshaling needed
+// there).
+//
+// initIce() takes a pre-gathered agent from IceAgentPool when one is
+// fresh, so onLocalSdpReady fires on the next loop iteration instead of
+// after a full candidate gather.
 
 // nice/agent.h pulls in GLib's gio headers which use a struct member named
 // 'signals' — this clashes with Qt5's 'signals' macro when this header is
@@ -26,7 +31,6 @@
 #include <cstdint>
 #include <functional>
 #include <string>
-#include <thread>
 #include <vector>
 
 class NiceConnection {
@@ -39,7 +43,8 @@ public:
     NiceConnection& operator=(const NiceConnection&) = delete;
 
     // Initialize the ICE agent.  One side must be 'controlling' (the offerer).
-    // Optionally provide TURN relay credentials for symmetric-NAT fallback.
+    // Optionally provide TURN relay credentials for symmetric-NAT fallback
+    // (before initIce — they're baked into the agent's candidates).
     void initIce(bool controlling);
     void setTurnServer(const std::string& host, int port,
                        const std::string& username, const std::string& password);
@@ -70,15 +75,16 @@ private:
     static void cbCandidateGatheringDone(NiceAgent* agent, guint stream_id, gpointer data);
     static void cbComponentStateChanged(NiceAgent* agent, guint stream_id, guint component_id, guint state, gpointer data);
     static void cbRecv(NiceAgent* agent, guint stream_id, guint component_id, guint len, gchar* buf, gpointer data);
-
-    void runMainLoop();   // body of the worker thread
+    static gboolean cbPooledSdp(gpointer data);
 
     NiceAgent*       m_agent   = nullptr;
-    GMainContext*    m_context = nullptr;
-    GMainLoop*       m_loop    = nullptr;
     guint            m_streamId = 0;
     std::atomic<int> m_state;
-    std::thread      m_thread;
+
+    // Pre-gathered agent: its SDP, handed out from an idle source on the
+    // loop thread (destroyed in teardown if it hasn't run yet).
+    std::string      m_pooledSdp;
+    GSource*         m_sdpSource = nullptr;
 
     // TURN relay config (set before initIce).
     std::string m_turnHost;
@@ -68,6 +68,15 @@ public:
         });
     }
 
+    bool sendBinaryMessage(const Bytes& data) override {
+        QByteArray frame(reinterpret_cast<const char*>(data.data()),
+                         static_cast<int>(data.size()));
+        p2p::runOnOwnerThread(this, [this, frame]() {
+            m_ws.sendBinaryMessage(frame);
+        });
+        return true;
+    }
+
 private:
     QWebSocket m_ws;
 };
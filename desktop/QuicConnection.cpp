@@ -1,10 +1,12 @@
 #include "QuicConnection.hpp"
 #include "NiceConnection.hpp"
 #include "CryptoEngine.hpp"
+#include "FileTransferManager.hpp"
 #include "log.hpp"
 
 #include <nlohmann/json.hpp>
 #include <sodium.h>
+#include <algorithm>
 #include <cstring>
 #include <cstdlib>
 
@@ -23,6 +25,18 @@ using json = nlohmann::json;
 
 // Max frame size matches the mailbox envelope limit (256 KB).
 static constexpr uint32_t kMaxFrameSize = 256 * 1024;
+// File streams also carry negotiated P2P chunks: the largest chunk plus
+// its AEAD/meta overhead, padded up to the next 256 KiB multiple.
+static constexpr uint32_t kMaxFileFrameSize =
+    uint32_t(FileTransferManager::kMaxP2PChunkBytes) + kMaxFrameSize;
+
+// Frames up to this size (the 2 / 16 KiB padding buckets) are coalesced
+// while a send is in flight; larger ones are sent scatter/gather as-is.
+static constexpr size_t kCoalesceMaxFrame = 16 * 1024 + 4;
+// Upper bound on one coalesced StreamSend.
+static constexpr size_t kCoalesceMaxBatch = 64 * 1024;
+// Idle send buffers kept for reuse.
+static constexpr size_t kSendPoolMax = 32;
 
 // ---------------------------
 // Static msquic state
@@ -126,7 +140,9 @@ inline bool bytesStartsWith(const Bytes& data, const char* prefix) {
 // ---------------------------
 
 QuicConnection::QuicConnection(ITimerFactory& timers)
-    : m_timerFactory(&timers)
+    : m_msgFramer(kMaxFrameSize)
+    , m_fileFramer(kMaxFileFrameSize)
+    , m_timerFactory(&timers)
     , m_handshakeTimer(timers.create())
 {
     initQuicGlobal();
@@ -135,8 +151,23 @@ QuicConnection::QuicConnection(ITimerFactory& timers)
 QuicConnection::~QuicConnection() {
     if (m_handshakeTimer) m_handshakeTimer->stop();
     if (s_msquic) {
-        if (m_msgStream)  s_msquic->StreamClose(m_msgStream);
-        if (m_fileStream) s_msquic->StreamClose(m_fileStream);
+        // Hand unsent batches to msquic rather than dropping them, then
+        // shut each stream down gracefully so they're queued ahead of its
+        // FIN.  Buffers still held come back through SEND_COMPLETE while
+        // the streams close.
+        std::lock_guard<std::recursive_mutex> lock(m_sendMutex);
+        if (m_msgStream)  flushPendingSend(m_msgStream, m_msgSend);
+        if (m_fileStream) flushPendingSend(m_fileStream, m_fileSend);
+        for (auto& [stream, ts] : m_transferStreams) flushPendingSend(stream, ts->send);
+    }
+    if (s_msquic) {
+        auto closeStream = [](HQUIC stream) {
+            s_msquic->StreamShutdown(stream, QUIC_STREAM_SHUTDOWN_FLAG_GRACEFUL, 0);
+            s_msquic->StreamClose(stream);
+        };
+        if (m_msgStream)  closeStream(m_msgStream);
+        if (m_fileStream) closeStream(m_fileStream);
+        for (auto& [stream, ts] : m_transferStreams) closeStream(stream);
         if (m_connection) {
             s_msquic->ConnectionShutdown(m_connection, QUIC_CONNECTION_SHUTDOWN_FLAG_NONE, 0);
             s_msquic->ConnectionClose(m_connection);
@@ -144,8 +175,8 @@ QuicConnection::~QuicConnection() {
         if (m_listener)      s_msquic->ListenerClose(m_listener);
         if (m_configuration) s_msquic->ConfigurationClose(m_configuration);
     }
-    // m_ice's unique_ptr destructor cleans up the GLib loop and joins the
-    // worker thread — see NiceConnection::~NiceConnection.
+    // m_ice's unique_ptr destructor detaches its agent from the shared
+    // GLib loop — see NiceConnection::~NiceConnection.
 }
 
 // ---------------------------
@@ -154,7 +185,7 @@ QuicConnection::~QuicConnection() {
 
 void QuicConnection::initIce(bool controlling) {
     m_controlling = controlling;
-    m_ice = std::make_unique<NiceConnection>();
+    if (!m_ice) m_ice = std::make_unique<NiceConnection>();
 
     m_ice->onLocalSdpReady = [this](const std::string& sdp) {
         if (onLocalSdpReady) onLocalSdpReady(sdp);
@@ -167,16 +198,35 @@ void QuicConnection::initIce(bool controlling) {
 
 void QuicConnection::setTurnServer(const std::string& host, int port,
                                     const std::string& user, const std::string& pass) {
-    if (m_ice) m_ice->setTurnServer(host, port, user, pass);
+    // Called before initIce — the agent is built with the relay config.
+    if (!m_ice) m_ice = std::make_unique<NiceConnection>();
+    m_ice->setTurnServer(host, port, user, pass);
 }
 
 void QuicConnection::setRemoteSdp(const std::string& sdp) {
     if (m_ice) m_ice->setRemoteSdp(sdp);
 }
 
-void QuicConnection::setPeerSupportsQuic(bool supports, const std::string& fingerprint) {
-    m_peerSupportsQuic = supports;
-    m_peerFingerprint  = fingerprint;
+void QuicConnection::setPeerSupportsQuic(bool supports, const std::string& fingerprint,
+                                         int peerTransferStreams) {
+    m_peerSupportsQuic    = supports;
+    m_peerFingerprint     = fingerprint;
+    m_peerTransferStreams = peerTransferStreams;
+}
+
+void QuicConnection::setKeepAlive(bool on) {
+    if (m_keepAlive.exchange(on) == on) return;
+    if (m_quicActive) applyKeepAlive();
+}
+
+void QuicConnection::applyKeepAlive() {
+    if (!s_msquic || !m_connection) return;
+    QUIC_SETTINGS settings = {};
+    settings.KeepAliveIntervalMs = m_keepAlive ? kKeepAliveIntervalMs : 0;
+    settings.IsSet.KeepAliveIntervalMs = TRUE;
+    if (QUIC_FAILED(s_msquic->SetParam(m_connection, QUIC_PARAM_CONN_SETTINGS,
+                                        sizeof(settings), &settings)))
+        P2P_WARN("[QUIC] Failed to update keepalive");
 }
 
 bool QuicConnection::isReady() const {
@@ -279,12 +329,12 @@ void QuicConnection::onIceDataReceived(const Bytes& data) {
     }
 
     if (m_rawIceMode) {
-        if (onDataReceived) onDataReceived(data);
+        if (onDataReceived) onDataReceived(data.data(), data.size());
         return;
     }
 
     if (!m_quicActive) {
-        if (onDataReceived) onDataReceived(data);
+        if (onDataReceived) onDataReceived(data.data(), data.size());
     }
 }
 
@@ -315,7 +365,7 @@ void QuicConnection::startQuicClient() {
     settings.IsSet.IdleTimeoutMs = TRUE;
     settings.PeerUnidiStreamCount = 0;
     settings.IsSet.PeerUnidiStreamCount = TRUE;
-    settings.PeerBidiStreamCount = 2;
+    settings.PeerBidiStreamCount = 2 + kMaxTransferStreams;
     settings.IsSet.PeerBidiStreamCount = TRUE;
 
     // App-layer crypto is the primary security layer.  See header for rationale.
@@ -364,7 +414,7 @@ void QuicConnection::startQuicServer() {
     QUIC_SETTINGS settings = {};
     settings.IdleTimeoutMs = 30000;
     settings.IsSet.IdleTimeoutMs = TRUE;
-    settings.PeerBidiStreamCount = 2;
+    settings.PeerBidiStreamCount = 2 + kMaxTransferStreams;
     settings.IsSet.PeerBidiStreamCount = TRUE;
 
     // Same rationale as client — app-layer crypto is the primary security layer.
@@ -419,6 +469,7 @@ QUIC_STATUS QUIC_API QuicConnection::connectionCallback(HQUIC /*conn*/, void* ct
         P2P_LOG("[QUIC] Connected!");
         self->m_quicActive = true;
         if (self->m_handshakeTimer) self->m_handshakeTimer->stop();
+        if (self->m_keepAlive) self->applyKeepAlive();
         self->openStreams();
         // Fire the state-change callback directly on the msquic worker thread.
         // ChatController's callbacks are thread-tolerant.
@@ -433,11 +484,7 @@ QUIC_STATUS QUIC_API QuicConnection::connectionCallback(HQUIC /*conn*/, void* ct
     case QUIC_CONNECTION_EVENT_PEER_STREAM_STARTED: {
         HQUIC stream = ev->PEER_STREAM_STARTED.Stream;
         s_msquic->SetCallbackHandler(stream, (void*)streamCallback, ctx);
-        if (!self->m_msgStream) {
-            self->m_msgStream = stream;
-        } else if (!self->m_fileStream) {
-            self->m_fileStream = stream;
-        }
+        self->adoptPeerStream(stream);
         return QUIC_STATUS_SUCCESS;
     }
 
@@ -457,28 +504,49 @@ QUIC_STATUS QUIC_API QuicConnection::streamCallback(HQUIC stream, void* ctx,
 
     switch (ev->Type) {
     case QUIC_STREAM_EVENT_RECEIVE: {
+        FrameReassembler*              framer = nullptr;
+        const FrameReassembler::FrameFn* cb   = &self->onFileDataReceived;
+        if (stream == self->m_msgStream) {
+            framer = &self->m_msgFramer;
+            cb     = &self->onDataReceived;
+        } else if (stream == self->m_fileStream) {
+            framer = &self->m_fileFramer;
+        } else {
+            // An entry is only erased on its own stream's SHUTDOWN_COMPLETE
+            // (or in the destructor) and msquic delivers one stream's events
+            // serially, so the framer is fed unlocked.
+            std::lock_guard<std::recursive_mutex> lock(self->m_sendMutex);
+            auto it = self->m_transferStreams.find(stream);
+            if (it != self->m_transferStreams.end()) framer = &it->second->framer;
+        }
+        if (!framer) return QUIC_STATUS_SUCCESS;
+
         for (uint32_t i = 0; i < ev->RECEIVE.BufferCount; ++i) {
             const QUIC_BUFFER& buf = ev->RECEIVE.Buffers[i];
-
-            if (stream == self->m_msgStream) {
-                self->processFramedStream(self->m_msgRecvBuf, buf.Buffer, buf.Length,
-                                           self->onDataReceived);
-            } else if (stream == self->m_fileStream) {
-                self->processFramedStream(self->m_fileRecvBuf, buf.Buffer, buf.Length,
-                                           self->onFileDataReceived);
-            }
+            self->processFramedStream(*framer, buf.Buffer, buf.Length, *cb);
         }
         return QUIC_STATUS_SUCCESS;
     }
 
     case QUIC_STREAM_EVENT_SEND_COMPLETE:
-        std::free(ev->SEND_COMPLETE.ClientContext);
+        self->onSendComplete(stream,
+                             static_cast<SendBuffer*>(ev->SEND_COMPLETE.ClientContext));
         return QUIC_STATUS_SUCCESS;
 
-    case QUIC_STREAM_EVENT_PEER_SEND_SHUTDOWN:
+    case QUIC_STREAM_EVENT_PEER_SEND_SHUTDOWN: {
+        // The peer finished a transfer on a stream it opened; we never
+        // send on those, so close our half too.
+        std::lock_guard<std::recursive_mutex> lock(self->m_sendMutex);
+        auto it = self->m_transferStreams.find(stream);
+        if (it != self->m_transferStreams.end() && !it->second->local)
+            s_msquic->StreamShutdown(stream, QUIC_STREAM_SHUTDOWN_FLAG_GRACEFUL, 0);
         return QUIC_STATUS_SUCCESS;
+    }
 
     case QUIC_STREAM_EVENT_SHUTDOWN_COMPLETE:
+        // The destructor closes its own handles.
+        if (!ev->SHUTDOWN_COMPLETE.AppCloseInProgress)
+            self->onTransferStreamShutdown(stream);
         return QUIC_STATUS_SUCCESS;
 
     default:
@@ -537,78 +605,216 @@ void QuicConnection::openStreams() {
     P2P_LOG("[QUIC] Opened message + file streams");
 }
 
-void QuicConnection::sendFramed(HQUIC stream, const Bytes& data) {
-    if (!stream || !s_msquic) return;
+static void writeFrameHeader(uint8_t* out, uint32_t len) {
+    out[0] = static_cast<uint8_t>((len >> 24) & 0xFF);
+    out[1] = static_cast<uint8_t>((len >> 16) & 0xFF);
+    out[2] = static_cast<uint8_t>((len >>  8) & 0xFF);
+    out[3] = static_cast<uint8_t>( len        & 0xFF);
+}
 
-    const uint32_t len      = static_cast<uint32_t>(data.size());
-    const uint32_t totalLen = 4 + len;
+QuicConnection::StreamSendState* QuicConnection::sendStateFor(HQUIC stream) {
+    if (stream && stream == m_msgStream)  return &m_msgSend;
+    if (stream && stream == m_fileStream) return &m_fileSend;
+    auto it = m_transferStreams.find(stream);
+    return it != m_transferStreams.end() ? &it->second->send : nullptr;
+}
 
-    auto* buf = static_cast<uint8_t*>(std::malloc(totalLen));
-    if (!buf) return;
+std::unique_ptr<QuicConnection::SendBuffer> QuicConnection::acquireSendBuffer() {
+    if (m_sendPool.empty()) return std::make_unique<SendBuffer>();
+    auto buf = std::move(m_sendPool.back());
+    m_sendPool.pop_back();
+    return buf;
+}
 
-    buf[0] = static_cast<uint8_t>((len >> 24) & 0xFF);
-    buf[1] = static_cast<uint8_t>((len >> 16) & 0xFF);
-    buf[2] = static_cast<uint8_t>((len >>  8) & 0xFF);
-    buf[3] = static_cast<uint8_t>( len        & 0xFF);
-    std::memcpy(buf + 4, data.data(), len);
+void QuicConnection::releaseSendBuffer(SendBuffer* raw) {
+    std::unique_ptr<SendBuffer> buf(raw);
+    if (!buf || m_sendPool.size() >= kSendPoolMax) return;
+    // Keep coalescing capacity around; don't hoard 256 KiB chunk bodies.
+    if (buf->payload.capacity() > kCoalesceMaxBatch) Bytes().swap(buf->payload);
+    else                                             buf->payload.clear();
+    m_sendPool.push_back(std::move(buf));
+}
 
-    QUIC_BUFFER quicBuf;
-    quicBuf.Length = totalLen;
-    quicBuf.Buffer = buf;
+void QuicConnection::submitSend(HQUIC stream, StreamSendState& st,
+                                std::unique_ptr<SendBuffer> buf, uint32_t bufferCount) {
+    SendBuffer* raw = buf.release();   // msquic's until SEND_COMPLETE
+    raw->bulk = bufferCount > 1;
+    uint32_t& counter = raw->bulk ? st.bulkInFlight : st.inFlight;
+    ++counter;
+    if (QUIC_FAILED(s_msquic->StreamSend(stream, raw->quic, bufferCount,
+                                         QUIC_SEND_FLAG_NONE, raw))) {
+        P2P_WARN("[QUIC] StreamSend failed — dropping " << bufferCount << " buffer(s)");
+        --counter;
+        releaseSendBuffer(raw);
+    }
+}
 
-    s_msquic->StreamSend(stream, &quicBuf, 1, QUIC_SEND_FLAG_NONE, buf);
+void QuicConnection::flushPendingSend(HQUIC stream, StreamSendState& st) {
+    if (!st.pending) return;
+    auto buf = std::move(st.pending);
+    buf->quic[0].Length = static_cast<uint32_t>(buf->payload.size());
+    buf->quic[0].Buffer = buf->payload.data();
+    submitSend(stream, st, std::move(buf), 1);
 }
 
-void QuicConnection::processFramedStream(Bytes& buf, const uint8_t* data, uint32_t len,
-                                           std::function<void(const Bytes&)>& cb) {
-    buf.insert(buf.end(), data, data + len);
+void QuicConnection::onSendComplete(HQUIC stream, SendBuffer* buf) {
+    std::lock_guard<std::recursive_mutex> lock(m_sendMutex);
+    StreamSendState* st = sendStateFor(stream);
+    if (st && buf) {
+        uint32_t& counter = buf->bulk ? st->bulkInFlight : st->inFlight;
+        if (counter > 0) --counter;
+    }
+    releaseSendBuffer(buf);
+    // Whatever queued up behind this send goes out as one batch.
+    if (st && s_msquic) flushPendingSend(stream, *st);
+}
 
-    while (buf.size() >= 4) {
-        const uint32_t frameLen =
-            (static_cast<uint32_t>(buf[0]) << 24) |
-            (static_cast<uint32_t>(buf[1]) << 16) |
-            (static_cast<uint32_t>(buf[2]) <<  8) |
-             static_cast<uint32_t>(buf[3]);
+QuicConnection::TransferStream::TransferStream(bool isLocal)
+    : local(isLocal)
+    , framer(kMaxFileFrameSize)
+{}
+
+// Classify a peer-opened stream by its QUIC stream id: 0 and 4 are the
+// client's message and file streams, anything else is a transfer stream.
+// Falls back to arrival order if the id can't be read.
+void QuicConnection::adoptPeerStream(HQUIC stream) {
+    uint64_t id    = 0;
+    uint32_t idLen = sizeof(id);
+    const bool haveId = QUIC_SUCCEEDED(
+        s_msquic->GetParam(stream, QUIC_PARAM_STREAM_ID, &idLen, &id));
+
+    if (haveId ? id == 0 : !m_msgStream)  { m_msgStream  = stream; return; }
+    if (haveId ? id == 4 : !m_fileStream) { m_fileStream = stream; return; }
+
+    std::lock_guard<std::recursive_mutex> lock(m_sendMutex);
+    m_transferStreams.emplace(stream, std::make_unique<TransferStream>(false));
+}
 
-        // Reject frames larger than the mailbox envelope limit.
-        if (frameLen > kMaxFrameSize) {
-            P2P_WARN("[QUIC] Frame too large: " << frameLen << " — dropping buffer");
-            buf.clear();
-            return;
+// Caller holds m_sendMutex.
+HQUIC QuicConnection::fileStreamFor(const std::string& transferId) {
+    const int limit = std::min(kMaxTransferStreams, m_peerTransferStreams);
+    if (transferId.empty() || limit <= 0 || !m_connection) return m_fileStream;
+
+    int local = 0;
+    for (auto& [stream, ts] : m_transferStreams) {
+        if (!ts->local) continue;
+        ++local;   // a closing stream still counts against the peer's limit
+        if (!ts->closing && ts->transferId == transferId) return stream;
+    }
+
+    // Pool full: every stream belongs to a live transfer, and taking one
+    // over would interleave two transfers' frames.  Share stream 4.
+    if (local >= limit) return m_fileStream;
+
+    HQUIC stream = nullptr;
+    if (QUIC_SUCCEEDED(s_msquic->StreamOpen(m_connection, QUIC_STREAM_OPEN_FLAG_NONE,
+                                            streamCallback, this, &stream))) {
+        if (QUIC_SUCCEEDED(s_msquic->StreamStart(stream, QUIC_STREAM_START_FLAG_NONE))) {
+            auto ts = std::make_unique<TransferStream>(true);
+            ts->transferId = transferId;
+            m_transferStreams.emplace(stream, std::move(ts));
+            return stream;
         }
+        s_msquic->StreamClose(stream);
+    }
+    P2P_WARN("[QUIC] Failed to open transfer stream — using shared file stream");
+    return m_fileStream;
+}
 
-        if (buf.size() < 4u + frameLen) break;
+void QuicConnection::endTransfer(const std::string& transferId) {
+    if (transferId.empty() || !s_msquic) return;
+    std::lock_guard<std::recursive_mutex> lock(m_sendMutex);
+    for (auto& [stream, ts] : m_transferStreams) {
+        if (!ts->local || ts->closing || ts->transferId != transferId) continue;
+        // Queued frames go out ahead of the FIN; the entry stays (and
+        // keeps its slot) until msquic reports the shutdown complete.
+        flushPendingSend(stream, ts->send);
+        ts->closing = true;
+        s_msquic->StreamShutdown(stream, QUIC_STREAM_SHUTDOWN_FLAG_GRACEFUL, 0);
+        return;
+    }
+}
 
-        Bytes payload(buf.begin() + 4, buf.begin() + 4 + frameLen);
-        buf.erase(buf.begin(), buf.begin() + 4 + frameLen);
+void QuicConnection::onTransferStreamShutdown(HQUIC stream) {
+    {
+        std::lock_guard<std::recursive_mutex> lock(m_sendMutex);
+        auto it = m_transferStreams.find(stream);
+        if (it == m_transferStreams.end()) return;
+        m_transferStreams.erase(it);
+    }
+    s_msquic->StreamClose(stream);
+}
 
-        if (cb) cb(payload);
+void QuicConnection::sendFramed(HQUIC stream, Bytes data) {
+    if (!stream || !s_msquic) return;
+    std::lock_guard<std::recursive_mutex> lock(m_sendMutex);
+    StreamSendState* st = sendStateFor(stream);
+    if (!st) return;
+
+    const uint32_t len = static_cast<uint32_t>(data.size());
+
+    if (4u + len <= kCoalesceMaxFrame) {
+        if (st->pending && st->pending->payload.size() + 4 + len > kCoalesceMaxBatch)
+            flushPendingSend(stream, *st);
+        if (!st->pending) st->pending = acquireSendBuffer();
+
+        Bytes& out = st->pending->payload;
+        uint8_t header[4];
+        writeFrameHeader(header, len);
+        out.insert(out.end(), header, header + 4);
+        out.insert(out.end(), data.begin(), data.end());
+
+        // Only an in-flight batch of small frames is worth waiting
+        // behind; a large frame can take many round trips to complete.
+        if (st->inFlight == 0) flushPendingSend(stream, *st);
+        return;
     }
+
+    // Large frame: anything already queued must go first to keep order.
+    flushPendingSend(stream, *st);
+
+    auto buf = acquireSendBuffer();
+    writeFrameHeader(buf->header, len);
+    buf->payload = std::move(data);
+    buf->quic[0].Length = 4;
+    buf->quic[0].Buffer = buf->header;
+    buf->quic[1].Length = len;
+    buf->quic[1].Buffer = buf->payload.data();
+    submitSend(stream, *st, std::move(buf), 2);
+}
+
+void QuicConnection::processFramedStream(FrameReassembler& framer,
+                                           const uint8_t* data, uint32_t len,
+                                           const FrameReassembler::FrameFn& cb) {
+    // Reject frames larger than the mailbox envelope limit.
+    if (!framer.feed(data, len, cb))
+        P2P_WARN("[QUIC] Frame too large — dropping buffer");
 }
 
 // ---------------------------
 // Send interface
 // ---------------------------
 
-void QuicConnection::sendData(const Bytes& data) {
+void QuicConnection::sendData(Bytes data) {
     if (m_rawIceMode) {
         if (m_ice) m_ice->sendData(data);
         return;
     }
 
     if (m_quicActive && m_msgStream) {
-        sendFramed(m_msgStream, data);
+        sendFramed(m_msgStream, std::move(data));
     } else if (m_ice && m_ice->isReady()) {
         m_ice->sendData(data);
     }
 }
 
 // Returns true if the file data was dispatched over QUIC.
-bool QuicConnection::sendFileData(const Bytes& data) {
+bool QuicConnection::sendFileData(Bytes data, const std::string& transferId) {
     if (m_rawIceMode) return false;  // no QUIC file stream in raw mode
 
     if (m_quicActive && m_fileStream) {
-        sendFramed(m_fileStream, data);
+        std::lock_guard<std::recursive_mutex> lock(m_sendMutex);
+        sendFramed(fileStreamFor(transferId), std::move(data));
         return true;
     }
     return false;
@@ -10,9 +10,16 @@
 // Wraps NiceConnection (composition) for NAT traversal, then upgrades to a
 // QUIC connection for reliable, framed, multiplexed P2P transport.
 //
-// Two QUIC streams:
+// QUIC streams:
 //   - Message stream (bidirectional, stream 0): text messages, signaling
 //   - File stream (bidirectional, stream 4): bulk file transfers
+//   - Transfer streams (bidirectional, any other id): one per outbound
+//     file transfer, opened on demand by either side from a pool of
+//     kMaxTransferStreams, so concurrent transfers to the same peer get
+//     independent ordering and flow control.  A transfer keeps its stream
+//     until endTransfer(); past the pool, transfers share stream 4.
+//     Only used when the peer advertised "quic_file_streams" in its
+//     ice_offer / ice_answer; otherwise every transfer shares stream 4.
 //
 // Falls back to raw ICE (NiceConnection passthrough) when:
 //   - Peer doesn't support QUIC (no "quic" field in ice_offer/answer)
@@ -21,18 +28,34 @@
 //
 // Wire framing on QUIC streams: [4 bytes BE length][payload]
 //
+// Received frames are delivered as (pointer, length) views — straight
+// out of msquic's receive buffer when the frame fits in one, otherwise
+// out of FrameReassembler's carry buffer.  The view is only valid for
+// the duration of the callback; raw-ICE fallback data is delivered the
+// same way.
+//
+// Sends take ownership of the frame body.  A large frame goes out as two
+// QUIC_BUFFERs (header + the caller's bytes, no copy); small frames sent
+// while an earlier batch of small frames is still in flight are packed
+// into one buffer and go out together when it completes.  They never wait
+// on a large frame — msquic queues them behind it in stream order anyway.
+// Send buffers come from a small pool and return to it on SEND_COMPLETE.
+//
 // **Threading:** all callbacks fire on whatever thread libnice/msquic
 // happen to be running on (the GLib main loop thread for ICE events,
 // msquic's worker pool for QUIC events).  ChatController's callbacks are
 // thread-safe by design.  No Qt thread marshaling is used.
 //
 
+#include "FrameReassembler.hpp"
 #include "ITimer.hpp"
 
 #include <atomic>
 #include <cstdint>
 #include <functional>
+#include <map>
 #include <memory>
+#include <mutex>
 #include <string>
 #include <vector>
 
@@ -55,25 +78,46 @@ public:
                        const std::string& user, const std::string& pass);
     void setRemoteSdp(const std::string& sdp);
 
-    // Send data on the message stream (framed, reliable).
-    void sendData(const Bytes& data);
+    // Send data on the message stream (framed, reliable).  Pass an
+    // rvalue to hand the buffer to msquic without a copy.
+    void sendData(Bytes data);
 
-    // Send data on the file stream (framed, reliable, bulk).
+    // Send data on a file stream (framed, reliable, bulk).  With a
+    // transferId the chunk goes on that transfer's own stream when the
+    // peer accepts transfer streams, else on the shared file stream.
     // Returns true if sent via QUIC, false if not available (caller should use mailbox).
-    bool sendFileData(const Bytes& data);
+    bool sendFileData(Bytes data, const std::string& transferId = {});
+
+    // The sender is done with transferId (all chunks out, cancelled, or
+    // path lost): shut its transfer stream down once queued frames are
+    // sent, freeing the slot for another transfer.
+    void endTransfer(const std::string& transferId);
 
     bool isReady() const;
 
-    // QUIC capability negotiation.
-    void setPeerSupportsQuic(bool supports, const std::string& fingerprint = {});
+    // Transfer streams each side may open on top of streams 0 and 4.
+    // Advertised as "quic_file_streams" in ice_offer / ice_answer.
+    static constexpr int kMaxTransferStreams = 4;
+
+    // QUIC capability negotiation.  `peerTransferStreams` is the peer's
+    // "quic_file_streams" (0 for builds that predate transfer streams).
+    void setPeerSupportsQuic(bool supports, const std::string& fingerprint = {},
+                             int peerTransferStreams = 0);
     bool quicActive() const { return m_quicActive; }
+
+    // QUIC keepalive: PING every kKeepAliveIntervalMs so an otherwise
+    // quiet connection outlives the 30 s idle timeout.  Safe to call
+    // before the handshake; the setting is applied once it connects.
+    static constexpr uint32_t kKeepAliveIntervalMs = 15000;
+    void setKeepAlive(bool on);
     std::string localQuicFingerprint() const { return m_localFingerprint; }
 
     // ── Event callbacks (assign before / shortly after initIce). ──────────
     std::function<void(const std::string& sdp)>     onLocalSdpReady;
     std::function<void(int niceComponentState)>     onStateChanged;
-    std::function<void(const Bytes& data)>          onDataReceived;     // message stream
-    std::function<void(const Bytes& data)>          onFileDataReceived; // file stream
+    // Views valid only for the duration of the call — copy to keep.
+    std::function<void(const uint8_t* data, size_t len)> onDataReceived;     // message stream
+    std::function<void(const uint8_t* data, size_t len)> onFileDataReceived; // file stream
 
     // Public statics for atexit cleanup.
     static const QUIC_API_TABLE* s_msquic;
@@ -100,11 +144,11 @@ private:
     HQUIC m_msgStream     = nullptr;
     HQUIC m_fileStream    = nullptr;
 
-    // Framing buffers (length-prefix reassembly).
-    Bytes m_msgRecvBuf;
-    Bytes m_fileRecvBuf;
-    void processFramedStream(Bytes& buf, const uint8_t* data, uint32_t len,
-                             std::function<void(const Bytes&)>& cb);
+    // Length-prefix reassembly, one per stream.
+    FrameReassembler m_msgFramer;
+    FrameReassembler m_fileFramer;
+    void processFramedStream(FrameReassembler& framer, const uint8_t* data, uint32_t len,
+                             const FrameReassembler::FrameFn& cb);
 
     // TLS / fingerprint.
     std::string m_localFingerprint;
@@ -115,6 +159,7 @@ private:
     bool m_controlling = false;
     bool m_quicActive  = false;
     bool m_rawIceMode  = false;
+    std::atomic<bool> m_keepAlive{false};   // read again on CONNECTED
 
     // Handshake timer (replaces QTimer).
     ITimerFactory*          m_timerFactory = nullptr;
@@ -125,10 +170,58 @@ private:
     uint16_t    m_peerQuicPort  = 0;
     std::string m_peerAddress;   // dotted-quad / IPv6 string; empty until ICE ready
 
+    // Send path.  A SendBuffer is owned by msquic from StreamSend until
+    // SEND_COMPLETE hands it back (as the ClientContext), then recycled.
+    struct SendBuffer {
+        QUIC_BUFFER quic[2];
+        uint8_t     header[4];
+        Bytes       payload;   // one frame body, or several whole coalesced frames
+        bool        bulk = false;   // a large frame sent scatter/gather
+    };
+    struct StreamSendState {
+        uint32_t                    inFlight = 0;       // coalesced batches
+        uint32_t                    bulkInFlight = 0;   // large frames
+        std::unique_ptr<SendBuffer> pending;   // small frames waiting on an in-flight batch
+    };
+    // Recursive: msquic may complete a send on the thread that issued it,
+    // and the completion handler flushes the next batch.
+    std::recursive_mutex                     m_sendMutex;
+    std::vector<std::unique_ptr<SendBuffer>> m_sendPool;
+    StreamSendState                          m_msgSend;
+    StreamSendState                          m_fileSend;
+
+    // Transfer streams.  Local ones each carry one outbound transfer until
+    // endTransfer(); with the pool full, further transfers share the file
+    // stream.  Peer-opened ones only receive.  An entry goes away on its
+    // stream's SHUTDOWN_COMPLETE.  Guarded by m_sendMutex.
+    struct TransferStream {
+        explicit TransferStream(bool isLocal);
+        bool             local;
+        bool             closing = false;   // shut down, waiting on SHUTDOWN_COMPLETE
+        std::string      transferId;
+        FrameReassembler framer;
+        StreamSendState  send;
+    };
+    std::map<HQUIC, std::unique_ptr<TransferStream>> m_transferStreams;
+    int m_peerTransferStreams = 0;
+
+    HQUIC fileStreamFor(const std::string& transferId);
+    void  adoptPeerStream(HQUIC stream);
+    void  onTransferStreamShutdown(HQUIC stream);
+
+    StreamSendState*            sendStateFor(HQUIC stream);
+    std::unique_ptr<SendBuffer> acquireSendBuffer();
+    void releaseSendBuffer(SendBuffer* buf);
+    void submitSend(HQUIC stream, StreamSendState& st,
+                    std::unique_ptr<SendBuffer> buf, uint32_t bufferCount);
+    void flushPendingSend(HQUIC stream, StreamSendState& st);
+    void onSendComplete(HQUIC stream, SendBuffer* buf);
+
     void startQuicClient();
     void startQuicServer();
     void openStreams();
-    void sendFramed(HQUIC stream, const Bytes& data);
+    void applyKeepAlive();
+    void sendFramed(HQUIC stream, Bytes data);
     void fallbackToRawIce();
 
     // msquic callbacks (static, dispatch via context pointer).
@@ -880,6 +880,11 @@ final class Peer2PearClient: ObservableObject {
                   let handle = handle, let msgCStr else { return }
             client.wsPool.find(handle)?.sendText(String(cString: msgCStr))
         }
+        platform.ws_send_binary_v2 = { handle, bytes, len, ctx in
+            guard let client = Peer2PearClient.from(ctx),
+                  let handle = handle, let bytes else { return }
+            client.wsPool.find(handle)?.sendBinary(Data(bytes: bytes, count: Int(len)))
+        }
         platform.ws_is_connected_v2 = { handle, ctx in
             guard let client = Peer2PearClient.from(ctx),
                   let handle = handle else { return 0 }
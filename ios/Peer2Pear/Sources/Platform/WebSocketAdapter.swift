@@ -5,9 +5,9 @@ import Foundation
 /// (see WebSocketPool) maintains many of these in parallel for the
 /// receive-side multi-relay subscribe feature.
 ///
-/// The C core invokes lifecycle methods (open / close / sendText) via
-/// the v2 FFI (ws_open_v2 et al), passing the OpaquePointer that
-/// identifies this connection.  The receive loop fires p2p_ws_on_*_v2
+/// The C core invokes lifecycle methods (open / close / sendText /
+/// sendBinary) via the v2 FFI (ws_open_v2 et al), passing the
+/// OpaquePointer that identifies this connection.  The receive loop fires p2p_ws_on_*_v2
 /// with that same pointer so the core can dispatch to the matching
 /// IWebSocket on the C++ side.
 final class WebSocketAdapter: NSObject, URLSessionWebSocketDelegate {
@@ -46,6 +46,12 @@ final class WebSocketAdapter: NSObject, URLSessionWebSocketDelegate {
         }
     }
 
+    func sendBinary(_ data: Data) {
+        task?.send(.data(data)) { error in
+            if let error { print("[WS] send error: \(error)") }
+        }
+    }
+
     // MARK: - URLSessionWebSocketDelegate
 
     func urlSession(_ session: URLSession, webSocketTask: URLSessionWebSocketTask,
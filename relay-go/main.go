@@ -80,6 +80,7 @@ func main() {
 
 	// ── Protocol (/v1/*) ─────────────────────────────────────────────
 	mux.HandleFunc("POST /v1/send", hub.HandleSend)
+	mux.HandleFunc("POST /v1/send-batch", hub.HandleSendBatch)
 	mux.HandleFunc("/v1/receive", hub.HandleReceive) // WebSocket — no method restriction
 	mux.HandleFunc("POST /v1/forward", hub.HandleForward)
 	// Onion routing endpoints.
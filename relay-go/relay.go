@@ -6,8 +6,10 @@ import (
 	"crypto/rand"
 	"crypto/sha256"
 	"encoding/base64"
+	"encoding/binary"
 	"encoding/hex"
 	"encoding/json"
+	"errors"
 	"fmt"
 	"io"
 	"log"
@@ -28,6 +30,21 @@ import (
 //	bytes 33+:     sealed ciphertext
 //
 // The relay reads only bytes 0-32 for routing. Everything else is opaque.
+//
+// WS send frame (client → relay, binary, on an authenticated /v1/receive):
+//
+//	byte  0:       wsSendFrameTag (0x53)
+//	bytes 1-4:     sequence number (uint32, big-endian)
+//	bytes 5+:      envelope, exactly as a POST /v1/send body
+//
+// Batch body (POST /v1/send-batch), repeated until the body ends:
+//
+//	bytes 0-3:     envelope length (uint32, big-endian)
+//	bytes 4+:      envelope, exactly as a POST /v1/send body
+//
+// Each WS send frame is answered with a text frame
+// {"type":"send_ack","seq":N,"status":S[,"error":"..."]} where S is the
+// status POST /v1/send would have returned.
 
 const (
 	envelopeVersion  = 0x01
@@ -53,6 +70,22 @@ const (
 	// /v1/send boundary, but recipient pubkey IS visible in the envelope header.
 	recipientRateLimitPerMin = 300
 
+	// WS send path.  The window is advertised in auth_ok and bounds how
+	// many unacked send frames a client keeps in flight.  Unlike
+	// /v1/send, a WS sender is authenticated, so the rate limit is per
+	// peer rather than per IP — higher than rateLimitPerMin because
+	// pipelined senders are exactly the ones pushing volume (file chunks).
+	wsSendFrameTag        = 0x53
+	wsSendHeaderLen       = 1 + 4
+	wsSendWindow          = 64
+	wsSendRateLimitPerMin = 600
+
+	// POST /v1/send-batch caps.  Each envelope in a batch still counts
+	// against the per-IP and per-recipient limits individually, so a
+	// batch of N costs exactly what N /v1/send calls would.
+	maxBatchEnvelopes = 64
+	maxBatchBytes     = 4 << 20 // 4 MiB
+
 	// Max peer IDs a single peer can subscribe to for presence.
 	maxPresenceSubs = 200
 
@@ -478,37 +511,154 @@ func (h *Hub) HandleSend(w http.ResponseWriter, r *http.Request) {
 		httpError(w, http.StatusBadRequest, "read error")
 		return
 	}
-	if len(body) > maxEnvelopeBytes {
-		httpError(w, http.StatusRequestEntityTooLarge, "envelope too large")
+
+	delivered, status, err := h.ingestEnvelope(body)
+	if err != nil {
+		httpError(w, status, err.Error())
 		return
 	}
+	if delivered {
+		writeJSON(w, http.StatusOK, map[string]any{"delivered": true})
+	} else {
+		writeJSON(w, http.StatusOK, map[string]any{"stored": true})
+	}
+}
 
-	recipientID, err := parseRecipient(body)
+// ── POST /v1/send-batch — N independent envelopes in one request ────────────
+
+// HandleSendBatch accepts a length-prefixed list of envelopes (see the
+// wire format at the top of this file) and answers with one result per
+// envelope, in body order:
+//
+//	{"results": [{"status": 200, "stored": true}, {"status": 429, "error": "..."}]}
+//
+// Envelopes are otherwise handled exactly like separate /v1/send calls —
+// same validation, same limits, and delivery jitter still applies to each
+// one independently in the recipient's writer goroutine.  A framing error
+// rejects the whole request before anything is stored.
+func (h *Hub) HandleSendBatch(w http.ResponseWriter, r *http.Request) {
+	ipKey := hashIP(h.clientIP(r))
+	if !h.rl.allow(ipKey) {
+		httpError(w, http.StatusTooManyRequests, "rate limit exceeded")
+		return
+	}
+
+	body, err := io.ReadAll(io.LimitReader(r.Body, int64(maxBatchBytes)+1))
 	if err != nil {
-		httpError(w, http.StatusBadRequest, err.Error())
+		httpError(w, http.StatusBadRequest, "read error")
+		return
+	}
+	if len(body) > maxBatchBytes {
+		httpError(w, http.StatusRequestEntityTooLarge, "batch too large")
+		return
+	}
+
+	var envelopes [][]byte
+	for off := 0; off < len(body); {
+		if len(body)-off < 4 {
+			httpError(w, http.StatusBadRequest, "truncated length prefix")
+			return
+		}
+		n := int(binary.BigEndian.Uint32(body[off : off+4]))
+		off += 4
+		if n > len(body)-off {
+			httpError(w, http.StatusBadRequest, "truncated envelope")
+			return
+		}
+		envelopes = append(envelopes, body[off:off+n])
+		off += n
+	}
+	if len(envelopes) == 0 {
+		httpError(w, http.StatusBadRequest, "empty batch")
+		return
+	}
+	if len(envelopes) > maxBatchEnvelopes {
+		httpError(w, http.StatusRequestEntityTooLarge, "too many envelopes")
 		return
 	}
 
+	results := make([]map[string]any, 0, len(envelopes))
+	for i, env := range envelopes {
+		// The request itself already consumed one per-IP token.
+		if i > 0 && !h.rl.allow(ipKey) {
+			results = append(results, map[string]any{
+				"status": http.StatusTooManyRequests,
+				"error":  "rate limit exceeded",
+			})
+			continue
+		}
+		delivered, status, err := h.ingestEnvelope(env)
+		switch {
+		case err != nil:
+			results = append(results, map[string]any{"status": status, "error": err.Error()})
+		case delivered:
+			results = append(results, map[string]any{"status": status, "delivered": true})
+		default:
+			results = append(results, map[string]any{"status": status, "stored": true})
+		}
+	}
+	writeJSON(w, http.StatusOK, map[string]any{"results": results})
+}
+
+// ingestEnvelope validates one sealed envelope and hands it to
+// deliverOrStore.  Shared by POST /v1/send and WS send frames so both
+// paths enforce the same size cap, header check and per-recipient
+// limit.  On error, status is the HTTP status to report.
+func (h *Hub) ingestEnvelope(body []byte) (delivered bool, status int, err error) {
+	if len(body) > maxEnvelopeBytes {
+		return false, http.StatusRequestEntityTooLarge, errors.New("envelope too large")
+	}
+
+	recipientID, err := parseRecipient(body)
+	if err != nil {
+		return false, http.StatusBadRequest, err
+	}
+
 	// Per-recipient ingress limit — independent of source IP.
 	// An attacker rotating IPs can no longer flood a specific victim's mailbox.
 	if !h.rlRecip.allowWithLimit(recipientID, recipientRateLimitPerMin) {
-		httpError(w, http.StatusTooManyRequests, "recipient rate limit exceeded")
-		return
+		return false, http.StatusTooManyRequests, errors.New("recipient rate limit exceeded")
 	}
 
-	delivered, err := h.deliverOrStore(recipientID, body)
+	delivered, err = h.deliverOrStore(recipientID, body)
 	if err != nil {
-		httpError(w, http.StatusTooManyRequests, err.Error())
-		return
+		return false, http.StatusTooManyRequests, err
 	}
 
 	if delivered {
 		log.Printf("relayed: to=%s… size=%dB", truncID(recipientID), len(body))
-		writeJSON(w, http.StatusOK, map[string]any{"delivered": true})
 	} else {
 		log.Printf("stored: to=%s… size=%dB", truncID(recipientID), len(body))
-		writeJSON(w, http.StatusOK, map[string]any{"stored": true})
 	}
+	return delivered, http.StatusOK, nil
+}
+
+// handleWsSend ingests one send frame from an authenticated WS and
+// returns the send_ack to queue back, or nil when the frame is too
+// malformed to carry a sequence number (nothing to ack against).
+//
+// The sender is known here — that's the trade the client makes for
+// pipelining — but it's only used as a rate-limit key, never logged
+// or stored alongside the envelope.
+func (h *Hub) handleWsSend(peer *Peer, frame []byte) []byte {
+	if len(frame) < wsSendHeaderLen || frame[0] != wsSendFrameTag {
+		return nil
+	}
+	ack := map[string]any{
+		"type": "send_ack",
+		"seq":  binary.BigEndian.Uint32(frame[1:wsSendHeaderLen]),
+	}
+	if !h.rl.allowWithLimit("ws-send|"+peer.ID, wsSendRateLimitPerMin) {
+		ack["status"] = http.StatusTooManyRequests
+		ack["error"] = "rate limit exceeded"
+	} else if _, status, err := h.ingestEnvelope(frame[wsSendHeaderLen:]); err != nil {
+		ack["status"] = status
+		ack["error"] = err.Error()
+	} else {
+		ack["status"] = http.StatusOK
+	}
+	resp, _ := json.Marshal(ack)
+	return resp
 }
 
 // ── WS /v1/receive — Authenticated receive channel ──────────────────────────
@@ -596,8 +746,13 @@ func (h *Hub) HandleReceive(w http.ResponseWriter, r *http.Request) {
 		log.Printf("delivered %d stored envelope(s) to %s…", delivered, truncID(peer.ID))
 	}
 
-	// Send auth confirmation
-	conn.WriteJSON(map[string]any{"type": "auth_ok", "peer_id": peer.ID})
+	// Send auth confirmation.  ws_send_window tells the client this
+	// relay accepts send frames on this socket (see handleWsSend).
+	conn.WriteJSON(map[string]any{
+		"type":           "auth_ok",
+		"peer_id":        peer.ID,
+		"ws_send_window": wsSendWindow,
+	})
 
 	// Step 4: Start writer goroutine (sends from the Send channel).
 	//
@@ -664,7 +819,11 @@ func (h *Hub) HandleReceive(w http.ResponseWriter, r *http.Request) {
 		}
 	}()
 
-	// Step 5: Read loop — handle presence queries
+	// Step 5: Read loop — presence queries (text) and send frames
+	// (binary).  The read limit admits one max-size envelope plus the
+	// send-frame header; anything larger closes the connection and the
+	// client re-sends its unacked frames over HTTP.
+	conn.SetReadLimit(int64(maxEnvelopeBytes + wsSendHeaderLen))
 	conn.SetReadDeadline(time.Now().Add(wsReadTimeout))
 	conn.SetPongHandler(func(string) error {
 		conn.SetReadDeadline(time.Now().Add(wsReadTimeout))
@@ -672,12 +831,29 @@ func (h *Hub) HandleReceive(w http.ResponseWriter, r *http.Request) {
 	})
 
 	for {
-		_, msgBytes, err := conn.ReadMessage()
+		msgType, msgBytes, err := conn.ReadMessage()
 		if err != nil {
 			break
 		}
 		conn.SetReadDeadline(time.Now().Add(wsReadTimeout))
 
+		if msgType == websocket.BinaryMessage {
+			ack := h.handleWsSend(peer, msgBytes)
+			if ack == nil {
+				continue
+			}
+			// Blocking send, unlike the presence replies below: a
+			// dropped ack would stall the client's window until its
+			// ack timeout.  A full Send channel is backpressure on
+			// the sender; a dead writer ends the connection.
+			select {
+			case peer.Send <- ack:
+			case <-done:
+				return
+			}
+			continue
+		}
+
 		var msg map[string]any
 		if json.Unmarshal(msgBytes, &msg) != nil {
 			continue
@@ -11,7 +11,13 @@
 //     replay protection.
 //   - End-to-end: queued envelopes survive a simulated relay restart AND
 //     an incomplete delivery.
+//   - WS send frames: acked with the /v1/send status, stored/delivered
+//     like an HTTP send.
+//   - /v1/send-batch: per-envelope results, framing errors store nothing.
 //   - /healthz sanity.
+//   - Benchmarks: the /v1/send handler per envelope, and messages/sec
+//     over loopback for HTTP sends, pipelined WS send frames and
+//     /v1/send-batch.
 
 package main
 
@@ -29,6 +35,7 @@ import (
 	"encoding/pem"
 	"fmt"
 	"io"
+	"log"
 	"math/big"
 	"net"
 	"net/http"
@@ -58,7 +65,7 @@ func (r *testRelay) Close() {
 	r.mbox.Close()
 }
 
-func newTestRelay(t *testing.T) *testRelay {
+func newTestRelay(t testing.TB) *testRelay {
 	t.Helper()
 	return newTestRelayOpt(t, false)
 }
@@ -66,7 +73,7 @@ func newTestRelay(t *testing.T) *testRelay {
 // newTestRelayOpt lets tests enable trustProxy so distinct X-Forwarded-For
 // values bypass the per-IP rate limit (needed for tests that want to
 // exercise the per-recipient or WS-auth limits in isolation).
-func newTestRelayOpt(t *testing.T, trustProxy bool) *testRelay {
+func newTestRelayOpt(t testing.TB, trustProxy bool) *testRelay {
 	t.Helper()
 	dbPath := filepath.Join(t.TempDir(), "relay.db")
 	mbox, err := NewMailbox(dbPath)
@@ -81,6 +88,7 @@ func newTestRelayOpt(t *testing.T, trustProxy bool) *testRelay {
 
 	mux := http.NewServeMux()
 	mux.HandleFunc("POST /v1/send", hub.HandleSend)
+	mux.HandleFunc("POST /v1/send-batch", hub.HandleSendBatch)
 	mux.HandleFunc("/v1/receive", hub.HandleReceive)
 	mux.HandleFunc("POST /v1/forward", hub.HandleForward)
 	mux.HandleFunc("GET /v1/relay_info", hub.HandleRelayInfo)
@@ -96,7 +104,7 @@ func newTestRelayOpt(t *testing.T, trustProxy bool) *testRelay {
 // The relay onion key is X25519.  Most tests don't exercise onion
 // routing, but the onion tests below wrap envelopes to this pubkey, so
 // we generate a real keypair here — the pub half must actually match.
-func testRelayOnionKey(t *testing.T) (*[32]byte, *[32]byte) {
+func testRelayOnionKey(t testing.TB) (*[32]byte, *[32]byte) {
 	t.Helper()
 	pub, priv, err := box.GenerateKey(cryptorand.Reader)
 	if err != nil {
@@ -113,7 +121,7 @@ type testPeer struct {
 	priv  ed25519.PrivateKey
 }
 
-func newTestPeer(t *testing.T) testPeer {
+func newTestPeer(t testing.TB) testPeer {
 	t.Helper()
 	pub, priv, err := ed25519.GenerateKey(cryptorand.Reader)
 	if err != nil {
@@ -171,7 +179,7 @@ type authResult struct {
 // until it receives a text frame (auth_ok or error).  Binary frames seen
 // on the way in are stored envelopes being drained.  Returns the live
 // conn so the caller can keep reading.
-func dialAndAuth(t *testing.T, r *testRelay, p testPeer, ts int64) (*websocket.Conn, authResult) {
+func dialAndAuth(t testing.TB, r *testRelay, p testPeer, ts int64) (*websocket.Conn, authResult) {
 	t.Helper()
 	conn, _, err := websocket.DefaultDialer.Dial(toWsURL(r.srv.URL, "/v1/receive"), nil)
 	if err != nil {
@@ -1339,3 +1347,352 @@ func TestHub_SecondConnectionReplacesFirst(t *testing.T) {
 		}
 	}
 }
+
+// ── WS send frames ─────────────────────────────────────────────────────
+
+func wsSendFrame(seq uint32, env []byte) []byte {
+	frame := make([]byte, wsSendHeaderLen+len(env))
+	frame[0] = wsSendFrameTag
+	binary.BigEndian.PutUint32(frame[1:wsSendHeaderLen], seq)
+	copy(frame[wsSendHeaderLen:], env)
+	return frame
+}
+
+// readSendAck reads until a send_ack text frame arrives, skipping relay
+// cover traffic and any other frames in between.
+func readSendAck(t testing.TB, conn *websocket.Conn) map[string]any {
+	t.Helper()
+	conn.SetReadDeadline(time.Now().Add(3 * time.Second))
+	for {
+		msgType, data, err := conn.ReadMessage()
+		if err != nil {
+			t.Fatalf("ws read: %v", err)
+		}
+		if msgType != websocket.TextMessage {
+			continue
+		}
+		var m map[string]any
+		if json.Unmarshal(data, &m) == nil && m["type"] == "send_ack" {
+			return m
+		}
+	}
+}
+
+func TestWsSend_AcksAndStores(t *testing.T) {
+	r := newTestRelay(t)
+	defer r.Close()
+
+	alice := newTestPeer(t)
+	bob := newTestPeer(t)
+	conn, result := dialAndAuth(t, r, alice, time.Now().UnixMilli())
+	defer conn.Close()
+	if result.Reply["type"] != "auth_ok" {
+		t.Fatalf("auth: %v", result.Reply)
+	}
+	if w, _ := result.Reply["ws_send_window"].(float64); int(w) != wsSendWindow {
+		t.Fatalf("ws_send_window = %v, want %d", result.Reply["ws_send_window"], wsSendWindow)
+	}
+
+	for seq := uint32(1); seq <= 3; seq++ {
+		env := buildEnvelope(bob, 300)
+		if err := conn.WriteMessage(websocket.BinaryMessage, wsSendFrame(seq, env)); err != nil {
+			t.Fatalf("ws write: %v", err)
+		}
+	}
+	for seq := 1; seq <= 3; seq++ {
+		ack := readSendAck(t, conn)
+		if int(ack["seq"].(float64)) != seq || int(ack["status"].(float64)) != http.StatusOK {
+			t.Fatalf("ack %d: %v", seq, ack)
+		}
+	}
+	if r.mbox.Count() != 3 {
+		t.Fatalf("mailbox count %d, want 3", r.mbox.Count())
+	}
+}
+
+func TestWsSend_BadEnvelopeIsNackedNotStored(t *testing.T) {
+	r := newTestRelay(t)
+	defer r.Close()
+
+	alice := newTestPeer(t)
+	conn, result := dialAndAuth(t, r, alice, time.Now().UnixMilli())
+	defer conn.Close()
+	if result.Reply["type"] != "auth_ok" {
+		t.Fatalf("auth: %v", result.Reply)
+	}
+
+	bad := []byte{0x02, 0xAA, 0xBB} // wrong version, too short
+	if err := conn.WriteMessage(websocket.BinaryMessage, wsSendFrame(9, bad)); err != nil {
+		t.Fatalf("ws write: %v", err)
+	}
+	ack := readSendAck(t, conn)
+	if int(ack["seq"].(float64)) != 9 || int(ack["status"].(float64)) != http.StatusBadRequest {
+		t.Fatalf("ack: %v", ack)
+	}
+	if ack["error"] == nil {
+		t.Fatalf("ack carries no error: %v", ack)
+	}
+	if r.mbox.Count() != 0 {
+		t.Fatalf("mailbox count %d, want 0", r.mbox.Count())
+	}
+}
+
+// ── POST /v1/send-batch ────────────────────────────────────────────────
+
+func batchBody(envs ...[]byte) []byte {
+	var buf bytes.Buffer
+	for _, e := range envs {
+		var n [4]byte
+		binary.BigEndian.PutUint32(n[:], uint32(len(e)))
+		buf.Write(n[:])
+		buf.Write(e)
+	}
+	return buf.Bytes()
+}
+
+func TestHandleSendBatch_PerEnvelopeResults(t *testing.T) {
+	r := newTestRelay(t)
+	defer r.Close()
+
+	bob := newTestPeer(t)
+	carol := newTestPeer(t)
+	bad := []byte{0x02, 0xAA} // wrong version, too short
+	body := batchBody(buildEnvelope(bob, 200), bad, buildEnvelope(carol, 2048))
+
+	resp, err := http.Post(r.srv.URL+"/v1/send-batch", "application/octet-stream", bytes.NewReader(body))
+	if err != nil {
+		t.Fatalf("POST: %v", err)
+	}
+	defer resp.Body.Close()
+	if resp.StatusCode != http.StatusOK {
+		t.Fatalf("status %d, want 200", resp.StatusCode)
+	}
+	var out struct {
+		Results []map[string]any `json:"results"`
+	}
+	if err := json.NewDecoder(resp.Body).Decode(&out); err != nil {
+		t.Fatalf("decode: %v", err)
+	}
+	want := []int{http.StatusOK, http.StatusBadRequest, http.StatusOK}
+	if len(out.Results) != len(want) {
+		t.Fatalf("got %d results, want %d", len(out.Results), len(want))
+	}
+	for i, st := range want {
+		if got := int(out.Results[i]["status"].(float64)); got != st {
+			t.Fatalf("result %d: status %d, want %d (%v)", i, got, st, out.Results[i])
+		}
+	}
+	if r.mbox.Count() != 2 {
+		t.Fatalf("mailbox count %d, want 2", r.mbox.Count())
+	}
+}
+
+func TestHandleSendBatch_RejectsTruncatedFraming(t *testing.T) {
+	r := newTestRelay(t)
+	defer r.Close()
+
+	bob := newTestPeer(t)
+	body := batchBody(buildEnvelope(bob, 200), buildEnvelope(bob, 200))
+	body = body[:len(body)-10]
+
+	resp, err := http.Post(r.srv.URL+"/v1/send-batch", "application/octet-stream", bytes.NewReader(body))
+	if err != nil {
+		t.Fatalf("POST: %v", err)
+	}
+	resp.Body.Close()
+	if resp.StatusCode != http.StatusBadRequest {
+		t.Fatalf("status %d, want 400", resp.StatusCode)
+	}
+	if r.mbox.Count() != 0 {
+		t.Fatalf("mailbox count %d, want 0 — framing errors must store nothing", r.mbox.Count())
+	}
+}
+
+// ── Benchmarks ─────────────────────────────────────────────────────────
+//
+//	go test -run xxx -bench . -benchmem
+//
+// Rate-limit entries are dropped between operations so the numbers are
+// for the handlers, not the 429 path, and relay logging goes to
+// io.Discard — one log line per envelope would otherwise dominate.
+
+func quietLogs(b *testing.B) {
+	prev := log.Writer()
+	log.SetOutput(io.Discard)
+	b.Cleanup(func() { log.SetOutput(prev) })
+}
+
+func unthrottle(h *Hub) {
+	for _, rl := range []*rateLimiter{h.rl, h.rlRecip} {
+		rl.mu.Lock()
+		clear(rl.entries)
+		rl.mu.Unlock()
+	}
+}
+
+// drainPeer connects p and discards everything pushed to it, so sends
+// addressed to p take the live-delivery path instead of the mailbox.
+func drainPeer(b *testing.B, r *testRelay, p testPeer) {
+	b.Helper()
+	conn, result := dialAndAuth(b, r, p, time.Now().UnixMilli())
+	if result.Reply["type"] != "auth_ok" {
+		conn.Close()
+		b.Fatalf("auth: %v", result.Reply)
+	}
+	conn.SetReadDeadline(time.Time{})
+	go func() {
+		for {
+			if _, _, err := conn.ReadMessage(); err != nil {
+				return
+			}
+		}
+	}()
+	b.Cleanup(func() { conn.Close() })
+}
+
+func reportMsgsPerSec(b *testing.B, msgs int) {
+	if s := b.Elapsed().Seconds(); s > 0 {
+		b.ReportMetric(float64(msgs)/s, "msgs/s")
+	}
+}
+
+// BenchmarkHandleSend calls the /v1/send handler directly — no socket —
+// so it isolates parse, rate-limit check and delivery per envelope.
+// An online recipient's writer sleeps deliveryJitterMs per envelope, so
+// a sustained run spills past its Send buffer into the mailbox exactly
+// as it would in production.  The offline case stamps a fresh recipient
+// into every envelope so the run never hits the per-recipient cap.
+func BenchmarkHandleSend(b *testing.B) {
+	for _, online := range []bool{true, false} {
+		name := "offline-recipient"
+		if online {
+			name = "online-recipient"
+		}
+		b.Run(name, func(b *testing.B) {
+			quietLogs(b)
+			r := newTestRelay(b)
+			defer r.Close()
+
+			bob := newTestPeer(b)
+			if online {
+				drainPeer(b, r, bob)
+			}
+			env := buildEnvelope(bob, 1024)
+			b.SetBytes(int64(len(env)))
+			b.ResetTimer()
+			for i := 0; i < b.N; i++ {
+				if !online {
+					binary.BigEndian.PutUint64(env[1:9], uint64(i))
+				}
+				unthrottle(r.hub)
+				w := httptest.NewRecorder()
+				r.hub.HandleSend(w, httptest.NewRequest(http.MethodPost, "/v1/send", bytes.NewReader(env)))
+				if w.Code != http.StatusOK {
+					b.Fatalf("status %d: %s", w.Code, w.Body.String())
+				}
+			}
+			reportMsgsPerSec(b, b.N)
+		})
+	}
+}
+
+// BenchmarkSendThroughput is messages/sec from one client to an online
+// recipient over loopback: one keep-alive POST /v1/send per envelope,
+// WS send frames pipelined up to the advertised window, and full
+// POST /v1/send-batch requests.
+func BenchmarkSendThroughput(b *testing.B) {
+	b.Run("http", func(b *testing.B) {
+		quietLogs(b)
+		r := newTestRelay(b)
+		defer r.Close()
+
+		bob := newTestPeer(b)
+		drainPeer(b, r, bob)
+		env := buildEnvelope(bob, 1024)
+		client := r.srv.Client()
+		b.SetBytes(int64(len(env)))
+		b.ResetTimer()
+		for i := 0; i < b.N; i++ {
+			unthrottle(r.hub)
+			resp, err := client.Post(r.srv.URL+"/v1/send", "application/octet-stream", bytes.NewReader(env))
+			if err != nil {
+				b.Fatalf("POST: %v", err)
+			}
+			io.Copy(io.Discard, resp.Body)
+			resp.Body.Close()
+			if resp.StatusCode != http.StatusOK {
+				b.Fatalf("status %d", resp.StatusCode)
+			}
+		}
+		reportMsgsPerSec(b, b.N)
+	})
+
+	b.Run("ws-pipelined", func(b *testing.B) {
+		quietLogs(b)
+		r := newTestRelay(b)
+		defer r.Close()
+
+		alice := newTestPeer(b)
+		bob := newTestPeer(b)
+		drainPeer(b, r, bob)
+		conn, result := dialAndAuth(b, r, alice, time.Now().UnixMilli())
+		defer conn.Close()
+		if result.Reply["type"] != "auth_ok" {
+			b.Fatalf("auth: %v", result.Reply)
+		}
+		env := buildEnvelope(bob, 1024)
+		b.SetBytes(int64(len(env)))
+		b.ResetTimer()
+		for sent := 0; sent < b.N; {
+			n := min(wsSendWindow, b.N-sent)
+			unthrottle(r.hub)
+			for i := 0; i < n; i++ {
+				if err := conn.WriteMessage(websocket.BinaryMessage, wsSendFrame(uint32(sent+i), env)); err != nil {
+					b.Fatalf("ws write: %v", err)
+				}
+			}
+			for i := 0; i < n; i++ {
+				if ack := readSendAck(b, conn); int(ack["status"].(float64)) != http.StatusOK {
+					b.Fatalf("ack: %v", ack)
+				}
+			}
+			sent += n
+		}
+		reportMsgsPerSec(b, b.N)
+	})
+	b.Run("send-batch", func(b *testing.B) {
+		quietLogs(b)
+		r := newTestRelay(b)
+		defer r.Close()
+
+		bob := newTestPeer(b)
+		drainPeer(b, r, bob)
+		env := buildEnvelope(bob, 1024)
+		envs := make([][]byte, maxBatchEnvelopes)
+		for i := range envs {
+			envs[i] = env
+		}
+		client := r.srv.Client()
+		b.SetBytes(int64(len(env)))
+		b.ResetTimer()
+		for sent := 0; sent < b.N; {
+			n := min(maxBatchEnvelopes, b.N-sent)
+			unthrottle(r.hub)
+			resp, err := client.Post(r.srv.URL+"/v1/send-batch", "application/octet-stream",
+				bytes.NewReader(batchBody(envs[:n]...)))
+			if err != nil {
+				b.Fatalf("POST: %v", err)
+			}
+			var out struct {
+				Results []map[string]any `json:"results"`
+			}
+			err = json.NewDecoder(resp.Body).Decode(&out)
+			resp.Body.Close()
+			if err != nil || resp.StatusCode != http.StatusOK || len(out.Results) != n {
+				b.Fatalf("status %d, %d results (%v)", resp.StatusCode, len(out.Results), err)
+			}
+			sent += n
+		}
+		reportMsgsPerSec(b, b.N)
+	})
+}